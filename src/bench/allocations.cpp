@@ -0,0 +1,27 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Linked into bench_allocations only: replaces the global operator new, which the array and nothrow forms forward to,
+// with one that counts the allocations made, so that benches can report them next to their timings.
+
+#include <bench/bench.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> g_allocation_count{0};
+
+void *operator new(std::size_t size) {
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+static const bool g_allocations_counted = (benchmark::g_allocations = &g_allocation_count, true);
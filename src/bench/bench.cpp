@@ -17,6 +17,9 @@
 #include <numeric>
 #include <regex>
 
+// Constant-initialized, so that allocations.cpp can set it during dynamic initialization.
+const std::atomic<uint64_t> *benchmark::g_allocations = nullptr;
+
 void benchmark::ConsolePrinter::header() {
     std::cout << "# Benchmark, evals, iterations, total, min, max, median"
               << std::endl;
@@ -44,7 +47,11 @@ void benchmark::ConsolePrinter::result(const State &state) {
     std::cout << std::setprecision(6)
               << state.m_name << ", " << state.m_num_evals << ", "
               << state.m_num_iters << ", " << total << ", " << min << ", "
-              << max << ", " << median << std::endl;
+              << max << ", " << median;
+    for (const auto &[name, value] : state.m_counters) {
+        std::cout << ", " << name << "=" << value;
+    }
+    std::cout << std::endl;
 }
 
 void benchmark::ConsolePrinter::footer() {}
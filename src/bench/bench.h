@@ -5,7 +5,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <limits>
 #include <map>
@@ -52,6 +54,10 @@ using duration = clock::duration;
 
 class Printer;
 
+/// Allocations made through the global operator new so far, or nullptr if they are not counted. Only
+/// bench_allocations, which links allocations.cpp, counts them, so that the timings of bench_bitcoin do not pay for it.
+extern const std::atomic<uint64_t> *g_allocations;
+
 class State {
 public:
     std::string m_name;
@@ -60,6 +66,8 @@ public:
     const uint64_t m_num_evals;
     std::vector<double> m_elapsed_results;
     time_point m_start_time;
+    //! Results other than timings, such as allocations per iteration, which the printers report by name
+    std::vector<std::pair<std::string, double>> m_counters;
 
     bool UpdateTimer(time_point finish_time);
 
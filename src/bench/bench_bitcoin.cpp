@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 
 #include <crypto/sha256.h>
+#include <crypto/sha512_256.h>
 #include <key.h>
 #include <logging.h>
 #include <script/sigcache.h>
@@ -127,6 +128,10 @@ int main(int argc, char **argv) {
         }
     }
 
+    // Benchmark the same hash implementations the node would pick.
+    SHA256AutoDetect();
+    SHA512_256AutoDetect();
+
     benchmark::BenchRunner::RunAll(*printer, evaluations, scaling_factor,
                                    regex_filter, is_list_only);
 
@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <bench/data.h>
 #include <checkqueue.h>
+#include <crypto/sha256.h>
 #include <logging.h>
 #include <policy/policy.h>
 #include <prevector.h>
@@ -12,6 +13,7 @@
 #include <random.h>
 #include <script/sigcache.h>
 #include <streams.h>
+#include <uint256.h>
 #include <util/defer.h>
 #include <util/system.h>
 #include <validation.h>
@@ -61,6 +63,59 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State &state) {
     queue.StopWorkerThreads();
 }
 
+// This Benchmark tests how the CheckQueue scales with the number of threads on
+// checks of uneven cost, as the script checks of a block are: most are cheap,
+// but some take a hundred times longer.
+static void CCheckQueueScaling(int nThreads, benchmark::State &state) {
+    static constexpr size_t BATCHES = 200;
+    static constexpr size_t BATCH_SIZE = 20;
+
+    struct UnevenJob {
+        uint32_t nRounds{0};
+        UnevenJob() {}
+        explicit UnevenJob(FastRandomContext &insecure_rand)
+            : nRounds(insecure_rand.randrange(100) == 0 ? 10000 : 100) {}
+        bool operator()() {
+            uint256 hash;
+            for (uint32_t i = 0; i < nRounds; ++i) {
+                CSHA256().Write(hash.begin(), hash.size()).Finalize(hash.begin());
+            }
+            return !hash.IsNull();
+        }
+        void swap(UnevenJob &x) { std::swap(nRounds, x.nRounds); };
+    };
+    CCheckQueue<UnevenJob> queue{QUEUE_BATCH_SIZE};
+    // The master thread is the last one
+    queue.StartWorkerThreads(nThreads - 1);
+    Defer d([&queue]{
+        queue.StopWorkerThreads();
+    });
+    while (state.KeepRunning()) {
+        // Make insecure_rand here so that each iteration is identical.
+        FastRandomContext insecure_rand(true);
+        CCheckQueueControl<UnevenJob> control(&queue);
+        for (size_t i = 0; i < BATCHES; ++i) {
+            std::vector<UnevenJob> vChecks;
+            vChecks.reserve(BATCH_SIZE);
+            for (size_t x = 0; x < BATCH_SIZE; ++x) {
+                vChecks.emplace_back(insecure_rand);
+            }
+            control.Add(vChecks);
+        }
+        assert(control.Wait());
+    }
+}
+
+static void CCheckQueueScaling_4Threads(benchmark::State &state) {
+    CCheckQueueScaling(4, state);
+}
+static void CCheckQueueScaling_16Threads(benchmark::State &state) {
+    CCheckQueueScaling(16, state);
+}
+static void CCheckQueueScaling_64Threads(benchmark::State &state) {
+    CCheckQueueScaling(64, state);
+}
+
 static void CCheckQueue_RealData32MB(bool cacheSigs, benchmark::State &state) {
     // This 32MB block has 166943 non-coinbase txins
     const CBlock block = []{
@@ -163,5 +218,8 @@ static void CCheckQueue_RealBlock_32MB_WithCacheStore(benchmark::State &state) {
 }
 
 BENCHMARK(CCheckQueueSpeedPrevectorJob, 1400);
+BENCHMARK(CCheckQueueScaling_4Threads, 10);
+BENCHMARK(CCheckQueueScaling_16Threads, 10);
+BENCHMARK(CCheckQueueScaling_64Threads, 10);
 BENCHMARK(CCheckQueue_RealBlock_32MB_NoCacheStore, 5);
 BENCHMARK(CCheckQueue_RealBlock_32MB_WithCacheStore, 5);
@@ -9,6 +9,7 @@
 #include <crypto/sha256.h>
 #include <crypto/sha3.h>
 #include <crypto/sha512.h>
+#include <crypto/sha512_256.h>
 #include <crypto/siphash.h>
 #include <hash.h>
 #include <random.h>
@@ -75,6 +76,35 @@ static void SHA512(benchmark::State &state) {
     }
 }
 
+static void SHA512_256(benchmark::State &state) {
+    uint8_t hash[CSHA512_256::OUTPUT_SIZE];
+    std::vector<uint8_t> in(BUFFER_SIZE, 0);
+    while (state.KeepRunning()) {
+        CSHA512_256().Write(in.data(), in.size()).Finalize(hash);
+    }
+}
+
+static void SHA512_256_32b(benchmark::State &state) {
+    std::vector<uint8_t> in(32, 0);
+    while (state.KeepRunning()) {
+        CSHA512_256().Write(in.data(), in.size()).Finalize(in.data());
+    }
+}
+
+static void SHA512_256D64_1024(benchmark::State &state) {
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning()) {
+        SHA512_256D64(in.data(), in.data(), 1024);
+    }
+}
+
+static void SHA512_256D80_1024(benchmark::State &state) {
+    std::vector<uint8_t> in(80 * 1024, 0);
+    while (state.KeepRunning()) {
+        SHA512_256D80(in.data(), in.data(), 1024);
+    }
+}
+
 static void SipHash_32b(benchmark::State &state) {
     uint256 x;
     uint64_t k1 = 0;
@@ -102,10 +132,14 @@ BENCHMARK(RIPEMD160, 440);
 BENCHMARK(SHA1, 570);
 BENCHMARK(SHA256, 340);
 BENCHMARK(SHA512, 330);
+BENCHMARK(SHA512_256, 330);
 BENCHMARK(SHA3_256_1M, 250);
 
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA512_256_32b, 2000 * 1000);
+BENCHMARK(SHA512_256D64_1024, 1000);
+BENCHMARK(SHA512_256D80_1024, 1000);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
@@ -0,0 +1,94 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <config.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <script/interpreter.h>
+#include <script/scriptcache.h>
+#include <script/sigcache.h>
+#include <script/sighashtype.h>
+#include <test/util.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <vector>
+
+/**
+ * Transactions spending the coinbases of freshly mined blocks, each with a
+ * signature to check.
+ */
+static std::vector<CTransactionRef> MakeSpends(const Config &config) {
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey())
+                                           << OP_CHECKSIG;
+
+    constexpr size_t NUM_BLOCKS{200};
+    std::vector<CTransactionRef> txs;
+    for (size_t b = 0; b < NUM_BLOCKS; ++b) {
+        CMutableTransaction tx;
+        tx.vin.push_back(MineBlock(config, scriptPubKey));
+        if (NUM_BLOCKS - b < COINBASE_MATURITY) {
+            continue;
+        }
+        const Amount value = WITH_LOCK(
+            cs_main,
+            return pcoinsTip->AccessCoin(tx.vin[0].prevout).GetTxOut().nValue);
+        tx.vout.emplace_back(value - 1000 * SATOSHI, scriptPubKey);
+        std::vector<uint8_t> vchSig;
+        const uint256 hash =
+            SignatureHash(scriptPubKey, CTransaction(tx), 0,
+                          SigHashType().withForkId(), value);
+        bool signedOk{key.SignECDSA(hash, vchSig)};
+        assert(signedOk);
+        vchSig.push_back(uint8_t(SIGHASH_ALL | SIGHASH_FORKID));
+        tx.vin[0].scriptSig << vchSig;
+        txs.push_back(MakeTransactionRef(tx));
+    }
+    return txs;
+}
+
+static void AdmitTransactions(benchmark::State &state, bool precheck) {
+    const Config &config = GetConfig();
+    const std::vector<CTransactionRef> txs = MakeSpends(config);
+
+    while (state.KeepRunning()) {
+        // Start every run with empty caches, so that the scripts get checked.
+        g_mempool.clear();
+        InitSignatureCache();
+        InitScriptExecutionCache();
+
+        std::vector<CValidationState> states(txs.size());
+        if (precheck) {
+            PreCheckTransactionsForMempool(config, g_mempool, txs, states);
+        }
+        for (size_t i = 0; i < txs.size(); ++i) {
+            assert(states[i].IsValid());
+            LOCK(cs_main);
+            bool ret{AcceptToMemoryPool(config, g_mempool, states[i], txs[i],
+                                        nullptr /* pfMissingInputs */,
+                                        false /* bypass_limits */,
+                                        /* nAbsurdFee */ Amount::zero())};
+            assert(ret);
+        }
+    }
+}
+
+/** Transactions checked and accepted one after the other, under cs_main. */
+static void MempoolAdmissionSerial(benchmark::State &state) {
+    AdmitTransactions(state, false);
+}
+
+/**
+ * Transactions prechecked on the precheck threads, and then accepted under
+ * cs_main with their scripts in the script cache.
+ */
+static void MempoolAdmissionPrecheck(benchmark::State &state) {
+    AdmitTransactions(state, true);
+}
+
+BENCHMARK(MempoolAdmissionSerial, 10);
+BENCHMARK(MempoolAdmissionPrecheck, 10);
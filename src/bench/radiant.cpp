@@ -0,0 +1,173 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/radiant_blocks.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <config.h>
+#include <consensus/validation.h>
+#include <miner.h>
+#include <policy/policy.h>
+#include <script/script.h>
+#include <script/script_execution_context.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <vector>
+
+using benchmark::radiant::BlockFixture;
+using benchmark::radiant::GenerateBlockFixture;
+using benchmark::radiant::Workload;
+
+// The number of workload transactions in each generated block.
+static constexpr size_t FIXTURE_TXS = 200;
+static constexpr size_t FIXTURE_TXS_LARGE = 50;
+
+/// Build the execution contexts (and with them the Radiant ref summaries) for
+/// every input of the block.
+static void RadiantContexts(benchmark::State &state, Workload workload, size_t nTx) {
+    const BlockFixture fixture = GenerateBlockFixture(GetConfig(), workload, nTx);
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        for (const auto &tx : fixture.txs) {
+            auto contexts = ScriptExecutionContext::createForAllInputs(*tx, *pcoinsTip);
+            assert(contexts.size() == tx->vin.size());
+        }
+    }
+}
+
+/// Run all the input scripts of the block, bypassing the script and signature
+/// caches so every iteration executes them.
+static void RadiantCheckInputs(benchmark::State &state, Workload workload, size_t nTx) {
+    const BlockFixture fixture = GenerateBlockFixture(GetConfig(), workload, nTx);
+    const uint32_t flags =
+        STANDARD_SCRIPT_VERIFY_FLAGS | SCRIPT_ENHANCED_REFERENCES | SCRIPT_PUSH_TX_STATE;
+    std::vector<PrecomputedTransactionData> txdata;
+    for (const auto &tx : fixture.txs) {
+        txdata.emplace_back(*tx);
+    }
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < fixture.txs.size(); ++i) {
+            CValidationState vstate;
+            int nSigChecks;
+            bool ret = CheckInputs(*fixture.txs[i], vstate, *pcoinsTip, true, flags, false, false, txdata[i],
+                                   nSigChecks);
+            assert(ret);
+        }
+    }
+}
+
+/// Connect the block on top of the tip. The script cache is filled by the
+/// first iteration, as it would be for transactions already in the mempool,
+/// so this mostly measures the coin, ref rule and summary work around script
+/// execution (see RadiantCheckInputs for the scripts themselves).
+static void RadiantConnectBlock(benchmark::State &state, Workload workload, size_t nTx) {
+    const Config &config = GetConfig();
+    const BlockFixture fixture = GenerateBlockFixture(config, workload, nTx);
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        CValidationState vstate;
+        bool ret = TestBlockValidity(vstate, config.GetChainParams(), fixture.block, ::ChainActive().Tip(),
+                                     BlockValidationOptions(config).withCheckPoW(false));
+        assert(ret);
+    }
+}
+
+/// Assemble a block template from a mempool holding the workload.
+static void RadiantCreateNewBlock(benchmark::State &state, Workload workload, size_t nTx) {
+    const Config &config = GetConfig();
+    const BlockFixture fixture = GenerateBlockFixture(config, workload, nTx);
+    {
+        LOCK(cs_main);
+        for (const auto &tx : fixture.txs) {
+            CValidationState vstate;
+            bool ret{::AcceptToMemoryPool(config, ::g_mempool, vstate, tx, nullptr /* pfMissingInputs */,
+                                          false /* bypass_limits */, /* nAbsurdFee */ Amount::zero())};
+            assert(ret);
+        }
+    }
+
+    const CScript scriptPubKey = CScript() << OP_TRUE;
+    while (state.KeepRunning()) {
+        auto pblocktemplate = BlockAssembler{config, ::g_mempool}.CreateNewBlock(scriptPubKey);
+        assert(pblocktemplate->block.vtx.size() == nTx + 1);
+    }
+}
+
+static void RadiantContexts_FungibleToken(benchmark::State &state) {
+    RadiantContexts(state, Workload::FungibleToken, FIXTURE_TXS);
+}
+static void RadiantContexts_SingletonNFT(benchmark::State &state) {
+    RadiantContexts(state, Workload::SingletonNFT, FIXTURE_TXS);
+}
+static void RadiantContexts_ManyRefs(benchmark::State &state) {
+    RadiantContexts(state, Workload::ManyRefs, FIXTURE_TXS);
+}
+static void RadiantContexts_LargeState(benchmark::State &state) {
+    RadiantContexts(state, Workload::LargeState, FIXTURE_TXS_LARGE);
+}
+
+static void RadiantCheckInputs_FungibleToken(benchmark::State &state) {
+    RadiantCheckInputs(state, Workload::FungibleToken, FIXTURE_TXS);
+}
+static void RadiantCheckInputs_SingletonNFT(benchmark::State &state) {
+    RadiantCheckInputs(state, Workload::SingletonNFT, FIXTURE_TXS);
+}
+static void RadiantCheckInputs_ManyRefs(benchmark::State &state) {
+    RadiantCheckInputs(state, Workload::ManyRefs, FIXTURE_TXS);
+}
+static void RadiantCheckInputs_LargeState(benchmark::State &state) {
+    RadiantCheckInputs(state, Workload::LargeState, FIXTURE_TXS_LARGE);
+}
+
+static void RadiantConnectBlock_FungibleToken(benchmark::State &state) {
+    RadiantConnectBlock(state, Workload::FungibleToken, FIXTURE_TXS);
+}
+static void RadiantConnectBlock_SingletonNFT(benchmark::State &state) {
+    RadiantConnectBlock(state, Workload::SingletonNFT, FIXTURE_TXS);
+}
+static void RadiantConnectBlock_ManyRefs(benchmark::State &state) {
+    RadiantConnectBlock(state, Workload::ManyRefs, FIXTURE_TXS);
+}
+static void RadiantConnectBlock_LargeState(benchmark::State &state) {
+    RadiantConnectBlock(state, Workload::LargeState, FIXTURE_TXS_LARGE);
+}
+
+static void RadiantCreateNewBlock_FungibleToken(benchmark::State &state) {
+    RadiantCreateNewBlock(state, Workload::FungibleToken, FIXTURE_TXS);
+}
+static void RadiantCreateNewBlock_SingletonNFT(benchmark::State &state) {
+    RadiantCreateNewBlock(state, Workload::SingletonNFT, FIXTURE_TXS);
+}
+static void RadiantCreateNewBlock_ManyRefs(benchmark::State &state) {
+    RadiantCreateNewBlock(state, Workload::ManyRefs, FIXTURE_TXS);
+}
+static void RadiantCreateNewBlock_LargeState(benchmark::State &state) {
+    RadiantCreateNewBlock(state, Workload::LargeState, FIXTURE_TXS_LARGE);
+}
+
+BENCHMARK(RadiantContexts_FungibleToken, 200);
+BENCHMARK(RadiantContexts_SingletonNFT, 200);
+BENCHMARK(RadiantContexts_ManyRefs, 100);
+BENCHMARK(RadiantContexts_LargeState, 200);
+
+BENCHMARK(RadiantCheckInputs_FungibleToken, 50);
+BENCHMARK(RadiantCheckInputs_SingletonNFT, 50);
+BENCHMARK(RadiantCheckInputs_ManyRefs, 20);
+BENCHMARK(RadiantCheckInputs_LargeState, 50);
+
+BENCHMARK(RadiantConnectBlock_FungibleToken, 50);
+BENCHMARK(RadiantConnectBlock_SingletonNFT, 50);
+BENCHMARK(RadiantConnectBlock_ManyRefs, 20);
+BENCHMARK(RadiantConnectBlock_LargeState, 50);
+
+BENCHMARK(RadiantCreateNewBlock_FungibleToken, 20);
+BENCHMARK(RadiantCreateNewBlock_SingletonNFT, 20);
+BENCHMARK(RadiantCreateNewBlock_ManyRefs, 20);
+BENCHMARK(RadiantCreateNewBlock_LargeState, 20);
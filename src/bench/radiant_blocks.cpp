@@ -0,0 +1,189 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/radiant_blocks.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <config.h>
+#include <consensus/consensus.h>
+#include <consensus/merkle.h>
+#include <feerate.h>
+#include <pow.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <test/util.h>
+#include <validation.h>
+#include <version.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace benchmark {
+namespace radiant {
+
+namespace {
+
+    /** The shape of the transactions of a workload. */
+    struct Shape {
+        size_t nIn;
+        size_t nOut;
+        /** Number of refs carried by every token output. */
+        size_t nRefsPerScript;
+        /** Number of distinct refs minted, or 0 for one ref per minted output. */
+        size_t nRefs;
+        /** Size of the extra state pushed in front of OP_STATESEPARATOR. */
+        size_t nStateSize;
+        bool singleton;
+    };
+
+    Shape GetShape(Workload workload) {
+        switch (workload) {
+            case Workload::FungibleToken:
+                return {2, 2, 1, 4, 0, false};
+            case Workload::SingletonNFT:
+                return {1, 1, 1, 0, 0, true};
+            case Workload::ManyRefs:
+                return {1, 2, 8, 8, 0, false};
+            case Workload::LargeState:
+                return {2, 2, 1, 4, 4096, false};
+        }
+        assert(!"invalid workload");
+        return {};
+    }
+
+    const CScript TRUE_SCRIPT = CScript() << OP_TRUE;
+
+    /**
+     * A token output: an owner hash (plus any extra state) followed by a code
+     * script which, for every ref, checks that the tokens are conserved or, for
+     * singletons, that the ref is passed on to exactly one output.
+     */
+    CScript TokenScript(const Shape &shape, const std::vector<uint288> &refs, uint8_t owner) {
+        CScript script;
+        script << std::vector<uint8_t>(20, owner);
+        if (shape.nStateSize) {
+            script << std::vector<uint8_t>(shape.nStateSize, owner);
+        }
+        script << OP_STATESEPARATOR << OP_DROP;
+        if (shape.nStateSize) {
+            script << OP_DROP;
+        }
+        auto pushRef = [&script](opcodetype opcode, const uint288 &ref) {
+            script << opcode;
+            script.insert(script.end(), ref.begin(), ref.end());
+        };
+        for (const uint288 &ref : refs) {
+            if (shape.singleton) {
+                pushRef(OP_PUSHINPUTREFSINGLETON, ref);
+                script << OP_REFOUTPUTCOUNT_OUTPUTS << OP_1 << OP_NUMEQUALVERIFY;
+            } else {
+                pushRef(OP_PUSHINPUTREF, ref);
+                script << OP_REFVALUESUM_OUTPUTS;
+                pushRef(OP_PUSHINPUTREF, ref);
+                script << OP_REFVALUESUM_UTXOS << OP_LESSTHANOREQUAL << OP_VERIFY;
+            }
+        }
+        script << OP_TRUE;
+        return script;
+    }
+
+    /** Mine a block containing `txs` (in the given, topological order). */
+    void MineBlockWithTxs(const Config &config, const std::vector<CTransactionRef> &txs) {
+        auto block = PrepareBlock(config, TRUE_SCRIPT);
+        block->vtx.insert(block->vtx.end(), txs.begin(), txs.end());
+        block->hashMerkleRoot = BlockMerkleRoot(*block);
+        while (!CheckProofOfWork(block->GetHash(), block->nBits, config.GetChainParams().GetConsensus())) {
+            ++block->nNonce;
+            assert(block->nNonce);
+        }
+        bool processed{ProcessNewBlock(config, block, true, nullptr)};
+        assert(processed);
+        assert(WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()) == block->GetHash());
+    }
+
+} // namespace
+
+BlockFixture GenerateBlockFixture(const Config &config, Workload workload, size_t nTx) {
+    assert(nTx > 0);
+    const Consensus::Params &params = config.GetChainParams().GetConsensus();
+    const Shape shape = GetShape(workload);
+    const size_t nTokenOutputs = nTx * shape.nIn;
+    const size_t nRefs = shape.nRefs ? shape.nRefs : nTokenOutputs;
+    assert(shape.nRefsPerScript <= nRefs);
+
+    // Mine until the first coinbase is mature and the next block has all the
+    // Radiant reference and state opcodes enabled.
+    const CTxIn coinbase = MineBlock(config, TRUE_SCRIPT);
+    const int activationHeight = std::max<int>(params.PushTXStateHeight, COINBASE_MATURITY + 1);
+    while (WITH_LOCK(cs_main, return ::ChainActive().Height()) < activationHeight) {
+        MineBlock(config, TRUE_SCRIPT);
+    }
+
+    // Fan the coinbase out into one output per ref to be minted.
+    CMutableTransaction fanout;
+    fanout.vin.push_back(coinbase);
+    const Amount coinbaseValue = GetBlockSubsidy(1, params);
+    for (size_t i = 0; i < nRefs; ++i) {
+        fanout.vout.emplace_back(coinbaseValue / int64_t(nRefs), TRUE_SCRIPT);
+    }
+    const CTransactionRef fanoutTx = MakeTransactionRef(fanout);
+
+    // Mint: every fan-out output becomes a ref, and each workload transaction
+    // gets nIn token outputs carrying its refs to spend.
+    std::vector<uint288> refs;
+    CMutableTransaction mint;
+    Amount mintValue = Amount::zero();
+    for (size_t i = 0; i < nRefs; ++i) {
+        const COutPoint outpoint(fanoutTx->GetId(), i);
+        mint.vin.emplace_back(outpoint);
+        refs.push_back(Converters::fromOutpoint(outpoint));
+        mintValue += fanout.vout[i].nValue;
+    }
+    auto refsForTx = [&](size_t n) {
+        std::vector<uint288> ret;
+        for (size_t j = 0; j < shape.nRefsPerScript; ++j) {
+            // Singletons get a ref per output, the rest share refs across transactions.
+            ret.push_back(refs[(shape.singleton ? n * shape.nIn + j : n + j) % nRefs]);
+        }
+        return ret;
+    };
+    for (size_t n = 0; n < nTx; ++n) {
+        const CScript script = TokenScript(shape, refsForTx(n), 0);
+        for (size_t i = 0; i < shape.nIn; ++i) {
+            mint.vout.emplace_back(mintValue / int64_t(nTokenOutputs), script);
+        }
+    }
+    const CTransactionRef mintTx = MakeTransactionRef(mint);
+
+    MineBlockWithTxs(config, {fanoutTx, mintTx});
+
+    // The workload: each transaction moves its tokens to a new owner, paying
+    // enough fee out of the first output to be accepted to the mempool.
+    const CFeeRate feeRate(2 * DEFAULT_MIN_RELAY_TX_FEE_PER_KB);
+    BlockFixture fixture;
+    for (size_t n = 0; n < nTx; ++n) {
+        CMutableTransaction mtx;
+        Amount value = Amount::zero();
+        for (size_t i = 0; i < shape.nIn; ++i) {
+            mtx.vin.emplace_back(COutPoint(mintTx->GetId(), n * shape.nIn + i));
+            value += mint.vout[n * shape.nIn + i].nValue;
+        }
+        const CScript script = TokenScript(shape, refsForTx(n), uint8_t(n + 1));
+        for (size_t i = 0; i < shape.nOut; ++i) {
+            mtx.vout.emplace_back(value / int64_t(shape.nOut), script);
+        }
+        mtx.vout[0].nValue -= feeRate.GetFee(::GetSerializeSize(mtx, PROTOCOL_VERSION));
+        fixture.txs.push_back(MakeTransactionRef(mtx));
+    }
+
+    auto block = PrepareBlock(config, TRUE_SCRIPT);
+    block->vtx.insert(block->vtx.end(), fixture.txs.begin(), fixture.txs.end());
+    block->hashMerkleRoot = BlockMerkleRoot(*block);
+    fixture.block = *block;
+    return fixture;
+}
+
+} // namespace radiant
+} // namespace benchmark
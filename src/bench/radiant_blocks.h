@@ -0,0 +1,46 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+
+#include <cstddef>
+#include <vector>
+
+class Config;
+
+namespace benchmark {
+namespace radiant {
+
+/** The kinds of synthetic Radiant blocks the generator can produce. */
+enum class Workload {
+    /** Transfers of a handful of fungible tokens: 2 inputs, 2 outputs, one ref each. */
+    FungibleToken,
+    /** Singleton (NFT) state updates: 1 input, 1 output, a unique singleton ref each. */
+    SingletonNFT,
+    /** Outputs carrying 8 refs, each of which is checked for conservation. */
+    ManyRefs,
+    /** Fungible token transfers with a 4KB state script in front of the code script. */
+    LargeState,
+};
+
+struct BlockFixture {
+    /** The workload transactions. Their inputs are all unspent at the tip. */
+    std::vector<CTransactionRef> txs;
+    /** A block extending the tip with a coinbase followed by txs. */
+    CBlock block;
+};
+
+/**
+ * Build a chain on top of a fresh regtest genesis (as set up by the bench
+ * runner) on which the Radiant reference opcodes are active and which
+ * confirms the token outputs that `nTx` workload transactions spend. The
+ * result is deterministic, so the same fixture is benched on every run.
+ */
+BlockFixture GenerateBlockFixture(const Config &config, Workload workload, size_t nTx);
+
+} // namespace radiant
+} // namespace benchmark
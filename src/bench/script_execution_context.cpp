@@ -0,0 +1,85 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <script/script_execution_context.h>
+
+#include <cassert>
+#include <vector>
+
+/// Build a token transfer-like tx: every input and output carries `nRefsPerScript` push refs followed
+/// by an OP_STATESEPARATOR and a small code script, and spends coins that look the same. If `introspect`,
+/// the Radiant summaries (which are computed on first use) are queried too.
+static void ScriptExecutionContextCreate(benchmark::State &state, size_t nIO, size_t nRefsPerScript,
+                                         bool introspect) {
+    FastRandomContext rng(true);
+    std::vector<uint288> refs;
+    for (size_t i = 0; i < nRefsPerScript * 4; ++i) {
+        refs.emplace_back(rng.randbytes(uint288::size()));
+    }
+    auto makeScript = [&](size_t n) {
+        CScript script;
+        for (size_t i = 0; i < nRefsPerScript; ++i) {
+            const uint288 &ref = refs[(n + i) % refs.size()];
+            script << OP_PUSHINPUTREF;
+            script.insert(script.end(), ref.begin(), ref.end());
+            script << OP_DROP;
+        }
+        script << OP_STATESEPARATOR << OP_DUP << OP_HASH160 << std::vector<uint8_t>(20, n & 0xff)
+               << OP_EQUALVERIFY << OP_CHECKSIG;
+        return script;
+    };
+
+    CCoinsView dummy;
+    CCoinsViewCache coins(&dummy);
+    CMutableTransaction mtx;
+    for (size_t i = 0; i < nIO; ++i) {
+        const COutPoint prevout(TxId(rng.rand256()), i);
+        mtx.vin.emplace_back(prevout);
+        mtx.vout.emplace_back(int64_t(i + 1) * SATOSHI, makeScript(i));
+        coins.AddCoin(prevout, Coin(CTxOut(int64_t(i + 1) * SATOSHI, makeScript(i + 1)), 1, false), false);
+    }
+    const CTransaction tx(mtx);
+
+    auto run = [&]() {
+        auto contexts = ScriptExecutionContext::createForAllInputs(tx, coins);
+        assert(contexts.size() == nIO);
+        if (introspect) {
+            const Amount sum = contexts.front().getRefValueSumOutputs(uint288());
+            assert(sum >= Amount::zero());
+        }
+    };
+    while (state.KeepRunning()) {
+        run();
+    }
+
+    // Allocations per tx, which the flat summaries keep down; only bench_allocations counts them.
+    if (benchmark::g_allocations) {
+        const uint64_t allocations = benchmark::g_allocations->load();
+        run();
+        state.m_counters.emplace_back("allocations", benchmark::g_allocations->load() - allocations);
+    }
+}
+
+static void ScriptExecutionContext_P2PKH(benchmark::State &state) {
+    ScriptExecutionContextCreate(state, 10, 0, false);
+}
+static void ScriptExecutionContext_P2PKH_Introspect(benchmark::State &state) {
+    ScriptExecutionContextCreate(state, 10, 0, true);
+}
+static void ScriptExecutionContext_TokenTransfer(benchmark::State &state) {
+    ScriptExecutionContextCreate(state, 10, 1, true);
+}
+static void ScriptExecutionContext_ManyRefs(benchmark::State &state) {
+    ScriptExecutionContextCreate(state, 100, 8, true);
+}
+
+BENCHMARK(ScriptExecutionContext_P2PKH, 20000);
+BENCHMARK(ScriptExecutionContext_P2PKH_Introspect, 20000);
+BENCHMARK(ScriptExecutionContext_TokenTransfer, 10000);
+BENCHMARK(ScriptExecutionContext_ManyRefs, 100);
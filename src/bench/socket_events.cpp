@@ -0,0 +1,160 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <compat.h>
+
+#ifdef USE_EPOLL
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+//! Number of peers connected
+static constexpr size_t NUM_PEERS = 1000;
+//! With active peers, one in ACTIVE_RATIO has sent something each time round
+static constexpr size_t ACTIVE_RATIO = 10;
+
+/**
+ * NUM_PEERS connected socket pairs, whose first sockets stand for the peers
+ * and second ones for our end of the connections.
+ */
+class SocketPairs {
+public:
+    std::vector<int> peers;
+    std::vector<int> ours;
+
+    SocketPairs() {
+        for (size_t i = 0; i < NUM_PEERS; ++i) {
+            int fds[2];
+            int ret{socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds)};
+            assert(ret == 0);
+            peers.push_back(fds[0]);
+            ours.push_back(fds[1]);
+        }
+    }
+
+    ~SocketPairs() {
+        for (size_t i = 0; i < NUM_PEERS; ++i) {
+            close(peers[i]);
+            close(ours[i]);
+        }
+    }
+
+    /** Have every ACTIVE_RATIO-th peer, starting at the offset, send a byte. */
+    void Send(size_t offset) {
+        const char byte = 0;
+        for (size_t i = offset % ACTIVE_RATIO; i < NUM_PEERS; i += ACTIVE_RATIO) {
+            ssize_t ret{send(peers[i], &byte, 1, 0)};
+            assert(ret == 1);
+        }
+    }
+};
+
+static void Receive(int fd) {
+    char buf[64];
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+    }
+}
+
+/**
+ * What CConnman::SocketEvents does with poll: build the set of sockets, the
+ * pollfds out of it, and poll them all.
+ */
+static void PollRound(const SocketPairs &sockets) {
+    std::set<int> recv_set;
+    for (int fd : sockets.ours) {
+        recv_set.insert(fd);
+    }
+    std::unordered_map<int, struct pollfd> pollfds;
+    for (int fd : recv_set) {
+        pollfds[fd].fd = fd;
+        pollfds[fd].events |= POLLIN;
+    }
+    std::vector<struct pollfd> vpollfds;
+    vpollfds.reserve(pollfds.size());
+    for (const auto &it : pollfds) {
+        vpollfds.push_back(it.second);
+    }
+    if (poll(vpollfds.data(), vpollfds.size(), 0) <= 0) {
+        return;
+    }
+    for (const struct pollfd &entry : vpollfds) {
+        if (entry.revents & POLLIN) {
+            Receive(entry.fd);
+        }
+    }
+}
+
+/** What the epoll socket handler does, with the sockets registered once. */
+static void EpollRound(int epoll_fd, std::vector<struct epoll_event> &events) {
+    int n = epoll_wait(epoll_fd, events.data(), events.size(), 0);
+    for (int i = 0; i < n; ++i) {
+        Receive(events[i].data.fd);
+    }
+}
+
+static int RegisterEpoll(const SocketPairs &sockets) {
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    assert(epoll_fd >= 0);
+    for (int fd : sockets.ours) {
+        struct epoll_event ev {};
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.fd = fd;
+        int ret{epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev)};
+        assert(ret == 0);
+    }
+    return epoll_fd;
+}
+
+static void SocketEventsPollIdle(benchmark::State &state) {
+    SocketPairs sockets;
+    while (state.KeepRunning()) {
+        PollRound(sockets);
+    }
+}
+
+static void SocketEventsEpollIdle(benchmark::State &state) {
+    SocketPairs sockets;
+    int epoll_fd = RegisterEpoll(sockets);
+    std::vector<struct epoll_event> events(256);
+    while (state.KeepRunning()) {
+        EpollRound(epoll_fd, events);
+    }
+    close(epoll_fd);
+}
+
+static void SocketEventsPollActive(benchmark::State &state) {
+    SocketPairs sockets;
+    size_t round = 0;
+    while (state.KeepRunning()) {
+        sockets.Send(round++);
+        PollRound(sockets);
+    }
+}
+
+static void SocketEventsEpollActive(benchmark::State &state) {
+    SocketPairs sockets;
+    int epoll_fd = RegisterEpoll(sockets);
+    std::vector<struct epoll_event> events(256);
+    size_t round = 0;
+    while (state.KeepRunning()) {
+        sockets.Send(round++);
+        EpollRound(epoll_fd, events);
+    }
+    close(epoll_fd);
+}
+
+BENCHMARK(SocketEventsPollIdle, 200);
+BENCHMARK(SocketEventsEpollIdle, 200);
+BENCHMARK(SocketEventsPollActive, 200);
+BENCHMARK(SocketEventsEpollActive, 200);
+
+#endif // USE_EPOLL
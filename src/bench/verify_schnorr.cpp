@@ -0,0 +1,52 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <key.h>
+#include <pubkey.h>
+#include <random.h>
+
+#include <cassert>
+#include <vector>
+
+//! About the number of signatures a script check thread verifies at once.
+static constexpr size_t BATCH_SIZE = 128;
+
+static std::vector<SchnorrBatchEntry> MakeSignatures() {
+    std::vector<SchnorrBatchEntry> entries(BATCH_SIZE);
+    for (SchnorrBatchEntry &entry : entries) {
+        CKey key;
+        key.MakeNewKey(true);
+        entry.pubkey = key.GetPubKey();
+        entry.hash = GetRandHash();
+        bool ret{key.SignSchnorr(entry.hash, entry.vchSig)};
+        assert(ret);
+    }
+    return entries;
+}
+
+static void VerifySchnorrOneByOne(benchmark::State &state) {
+    const std::vector<SchnorrBatchEntry> entries = MakeSignatures();
+    while (state.KeepRunning()) {
+        for (const SchnorrBatchEntry &entry : entries) {
+            bool ret{entry.pubkey.VerifySchnorr(entry.hash, entry.vchSig)};
+            assert(ret);
+        }
+    }
+}
+
+static void VerifySchnorrBatch(benchmark::State &state) {
+    const std::vector<SchnorrBatchEntry> entries = MakeSignatures();
+    std::vector<const SchnorrBatchEntry *> batch;
+    for (const SchnorrBatchEntry &entry : entries) {
+        batch.push_back(&entry);
+    }
+    while (state.KeepRunning()) {
+        bool ret{CPubKey::VerifySchnorrBatch(batch)};
+        assert(ret);
+    }
+}
+
+BENCHMARK(VerifySchnorrOneByOne, 20);
+BENCHMARK(VerifySchnorrBatch, 20);
@@ -9,6 +9,10 @@
 #include <script/script.h>
 #include <streams.h>
 
+#include <map>
+#include <mutex>
+#include <sstream>
+
 /// SerType used to serialize parameters in GCS filter encoding.
 static constexpr int GCS_SER_TYPE = SER_NETWORK;
 
@@ -215,6 +219,40 @@ bool BlockFilterTypeByName(const std::string &name,
     return false;
 }
 
+const std::vector<BlockFilterType> &AllBlockFilterTypes() {
+    static std::vector<BlockFilterType> types;
+
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+        types.reserve(g_filter_types.size());
+        for (const auto &entry : g_filter_types) {
+            types.push_back(entry.first);
+        }
+    });
+
+    return types;
+}
+
+const std::string &ListBlockFilterTypes() {
+    static std::string type_list;
+
+    static std::once_flag flag;
+    std::call_once(flag, []() {
+        std::stringstream ret;
+        bool first = true;
+        for (const auto &entry : g_filter_types) {
+            if (!first) {
+                ret << ", ";
+            }
+            ret << entry.second;
+            first = false;
+        }
+        type_list = ret.str();
+    });
+
+    return type_list;
+}
+
 static GCSFilter::ElementSet BasicFilterElements(const CBlock &block,
                                                  const CBlockUndo &block_undo) {
     GCSFilter::ElementSet elements;
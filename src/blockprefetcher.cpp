@@ -0,0 +1,209 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockprefetcher.h>
+
+#include <chain.h>
+#include <consensus/validation.h>
+#include <logging.h>
+#include <primitives/block.h>
+#include <serialize.h>
+#include <tinyformat.h>
+#include <txdb.h>
+#include <util/threadnames.h>
+#include <util/time.h>
+#include <version.h>
+
+#include <exception>
+
+void BlockPrefetcher::Start(int threads_num, size_t depth,
+                            uint64_t max_bytes) {
+    assert(m_threads.empty());
+    {
+        LOCK(cs);
+        m_depth = depth;
+        m_max_bytes = max_bytes;
+    }
+    for (int n = 0; n < threads_num; ++n) {
+        m_threads.emplace_back([this, n]() {
+            util::ThreadRename(strprintf("prefetch.%i", n));
+            ThreadPrefetch();
+        });
+    }
+}
+
+void BlockPrefetcher::Stop() {
+    WITH_LOCK(cs, m_request_stop = true);
+    m_work_cv.notify_all();
+    for (std::thread &t : m_threads) {
+        t.join();
+    }
+    m_threads.clear();
+    LOCK(cs);
+    m_jobs.clear();
+    m_depth = 0;
+    m_max_bytes = 0;
+    m_bytes = 0;
+    m_request_stop = false;
+}
+
+void BlockPrefetcher::Prefetch(const std::vector<const CBlockIndex *> &blocks,
+                               const Consensus::Params &params,
+                               const BlockValidationOptions &options,
+                               CCoinsViewDB *coins_db) {
+    AssertLockHeld(cs_main);
+    LOCK(cs);
+    std::map<int, std::shared_ptr<Job>> jobs;
+    for (const CBlockIndex *pindex : blocks) {
+        if (jobs.size() >= m_depth) {
+            break;
+        }
+        auto it = m_jobs.find(pindex->nHeight);
+        if (it != m_jobs.end() && it->second->pindex == pindex) {
+            jobs.emplace(*it);
+            continue;
+        }
+        jobs.emplace(pindex->nHeight,
+                     std::make_shared<Job>(pindex, pindex->GetBlockPos(),
+                                           params, options, coins_db));
+    }
+    // Those being prefetched already are let finish, and then dropped.
+    for (auto &entry : m_jobs) {
+        auto it = jobs.find(entry.first);
+        if (it == jobs.end() || it->second != entry.second) {
+            Uncount(*entry.second);
+        }
+    }
+    m_jobs.swap(jobs);
+    m_work_cv.notify_all();
+}
+
+std::shared_ptr<PrefetchedBlock>
+BlockPrefetcher::Take(const CBlockIndex *pindex) {
+    WAIT_LOCK(cs, lock);
+    auto it = m_jobs.find(pindex->nHeight);
+    if (it == m_jobs.end() || it->second->pindex != pindex) {
+        return nullptr;
+    }
+    std::shared_ptr<Job> job = std::move(it->second);
+    m_jobs.erase(it);
+    Uncount(*job);
+    m_work_cv.notify_all();
+    if (!job->started) {
+        // Reading it ourselves is as quick as waiting for a thread to.
+        return nullptr;
+    }
+    while (!job->result) {
+        m_done_cv.wait(lock);
+    }
+    return job->result;
+}
+
+void BlockPrefetcher::Clear() {
+    LOCK(cs);
+    for (auto &entry : m_jobs) {
+        Uncount(*entry.second);
+    }
+    m_jobs.clear();
+}
+
+void BlockPrefetcher::Uncount(Job &job) {
+    if (job.counted) {
+        m_bytes -= job.result->size;
+        job.counted = false;
+    }
+}
+
+void BlockPrefetcher::ThreadPrefetch() {
+    while (true) {
+        std::shared_ptr<Job> job;
+        {
+            WAIT_LOCK(cs, lock);
+            while (!m_request_stop) {
+                // The next block to connect first, unless enough of them are
+                // waiting to be taken.
+                for (const auto &entry : m_jobs) {
+                    if (m_bytes >= m_max_bytes) {
+                        break;
+                    }
+                    if (!entry.second->started) {
+                        job = entry.second;
+                        break;
+                    }
+                }
+                if (job) {
+                    break;
+                }
+                m_work_cv.wait(lock);
+            }
+            if (m_request_stop) {
+                return;
+            }
+            job->started = true;
+        }
+
+        std::shared_ptr<PrefetchedBlock> result = Run(*job);
+        {
+            LOCK(cs);
+            job->result = std::move(result);
+            // Unless it was dropped meanwhile.
+            auto it = m_jobs.find(job->pindex->nHeight);
+            if (it != m_jobs.end() && it->second == job) {
+                m_bytes += job->result->size;
+                job->counted = true;
+            }
+        }
+        m_done_cv.notify_all();
+    }
+}
+
+std::shared_ptr<PrefetchedBlock> BlockPrefetcher::Run(const Job &job) {
+    auto result = std::make_shared<PrefetchedBlock>();
+
+    int64_t nTime1 = GetTimeMicros();
+    auto pblock = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*pblock, job.pos, job.params) ||
+        pblock->GetHash() != job.pindex->GetBlockHash()) {
+        // Left for ConnectTip to read again, and fail on.
+        result->time_read = GetTimeMicros() - nTime1;
+        return result;
+    }
+    int64_t nTime2 = GetTimeMicros();
+    result->time_read = nTime2 - nTime1;
+    result->size = ::GetSerializeSize(*pblock, PROTOCOL_VERSION);
+
+    // ConnectBlock does not check it again if it passes, as it marks the
+    // block checked. If it does not, ConnectBlock fails on it the same way.
+    CValidationState state;
+    CheckBlock(*pblock, state, job.params, job.options);
+    int64_t nTime3 = GetTimeMicros();
+    result->time_check = nTime3 - nTime2;
+
+    // The coins created by the blocks before this one are not found, and
+    // ConnectBlock gets them from the coins cache, as it does those the cache
+    // has an entry for already.
+    result->coins_sequence = job.coins_db->GetWriteSequence();
+    try {
+        for (const CTransactionRef &tx : pblock->vtx) {
+            if (tx->IsCoinBase()) {
+                continue;
+            }
+            for (const CTxIn &in : tx->vin) {
+                ++result->inputs;
+                Coin coin;
+                if (job.coins_db->GetCoin(in.prevout, coin)) {
+                    result->coins.emplace_back(in.prevout, std::move(coin));
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        LogPrintf("%s: Failed to fetch the coins of block %s: %s\n", __func__,
+                  job.pindex->GetBlockHash().ToString(), e.what());
+        result->coins.clear();
+    }
+    result->time_coins = GetTimeMicros() - nTime3;
+
+    result->block = std::move(pblock);
+    return result;
+}
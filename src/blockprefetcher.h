@@ -0,0 +1,130 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <coins.h>
+#include <flatfile.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <validation.h>
+
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CCoinsViewDB;
+
+namespace Consensus {
+struct Params;
+}
+
+/** A block read, checked, and with its inputs fetched ahead of connecting it. */
+struct PrefetchedBlock {
+    //! The block, null if it could not be read
+    std::shared_ptr<const CBlock> block;
+    //! The coins the block spends which were found in the coins database
+    std::vector<std::pair<COutPoint, Coin>> coins;
+    //! Number of inputs of the block
+    size_t inputs = 0;
+    //! Size of the block on disk
+    uint64_t size = 0;
+    //! Write sequence of the coins database when the coins were read
+    uint64_t coins_sequence = 1;
+
+    //! Time spent reading, checking the block and fetching its coins (µs)
+    int64_t time_read = 0;
+    int64_t time_check = 0;
+    int64_t time_coins = 0;
+};
+
+/**
+ * Reads the blocks about to be connected from disk, runs the checks which do
+ * not depend on the chain on them, and fetches the coins they spend from the
+ * coins database on worker threads, so that this overlaps with connecting the
+ * blocks before them.
+ *
+ * The coins can be added to the coins cache as long as the database was not
+ * written to since they were read, and not over what the cache holds already.
+ *
+ * The window of blocks prefetched is bounded both by a number of blocks and by
+ * the size on disk of the blocks which are done and not taken yet.
+ */
+class BlockPrefetcher {
+public:
+    ~BlockPrefetcher() { assert(m_threads.empty()); }
+
+    /**
+     * Start prefetching up to depth blocks ahead on threads_num threads. No
+     * more blocks are started on while the ones done and not taken yet take
+     * up max_bytes or more on disk.
+     */
+    void Start(int threads_num, size_t depth, uint64_t max_bytes);
+    void Stop();
+
+    /**
+     * Prefetch the blocks to connect next, in the order they are connected
+     * in. The blocks from previous calls which are not among the first ones
+     * of these are dropped.
+     */
+    void Prefetch(const std::vector<const CBlockIndex *> &blocks,
+                  const Consensus::Params &params,
+                  const BlockValidationOptions &options, CCoinsViewDB *coins_db)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * The prefetched block, waiting for it if it is being prefetched. Null if
+     * it was not started on, in which case it is not anymore either.
+     */
+    std::shared_ptr<PrefetchedBlock> Take(const CBlockIndex *pindex);
+
+    /** Drop all the blocks, which are not going to be taken. */
+    void Clear();
+
+private:
+    struct Job {
+        const CBlockIndex *pindex;
+        FlatFilePos pos;
+        const Consensus::Params &params;
+        BlockValidationOptions options;
+        CCoinsViewDB *coins_db;
+
+        Job(const CBlockIndex *pindexIn, const FlatFilePos &posIn,
+            const Consensus::Params &paramsIn,
+            const BlockValidationOptions &optionsIn, CCoinsViewDB *coins_dbIn)
+            : pindex(pindexIn), pos(posIn), params(paramsIn),
+              options(optionsIn), coins_db(coins_dbIn) {}
+
+        bool started = false;
+        //! Set once done
+        std::shared_ptr<PrefetchedBlock> result;
+        //! Whether result->size is counted in m_bytes
+        bool counted = false;
+    };
+
+    Mutex cs;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+    //! The blocks to connect next, by height
+    std::map<int, std::shared_ptr<Job>> m_jobs GUARDED_BY(cs);
+    size_t m_depth GUARDED_BY(cs) = 0;
+    uint64_t m_max_bytes GUARDED_BY(cs) = 0;
+    //! Size on disk of the blocks of m_jobs which are done
+    uint64_t m_bytes GUARDED_BY(cs) = 0;
+    bool m_request_stop GUARDED_BY(cs) = false;
+    std::vector<std::thread> m_threads;
+
+    /** Stop counting the size of a job being dropped from m_jobs. */
+    void Uncount(Job &job) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void ThreadPrefetch();
+    static std::shared_ptr<PrefetchedBlock> Run(const Job &job);
+};
@@ -0,0 +1,117 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockservecache.h>
+
+#include <net.h>
+
+#include <algorithm>
+#include <exception>
+
+void BlockServeCache::SetMaxBytes(size_t max_bytes) {
+    LOCK(cs);
+    m_max_bytes = max_bytes;
+    Evict();
+}
+
+BlockServeCache::Payload BlockServeCache::Get(const BlockHash &hash, bool compact) {
+    LOCK(cs);
+    auto it = m_entries.find({hash, compact});
+    if (it == m_entries.end() || it->second.size == 0) {
+        return nullptr;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    return it->second.payload.get();
+}
+
+void BlockServeCache::Insert(const BlockHash &hash, bool compact, Payload payload) {
+    const Key key{hash, compact};
+    LOCK(cs);
+    if (m_entries.count(key)) {
+        return;
+    }
+    std::promise<Payload> promise;
+    promise.set_value(payload);
+    m_lru.push_front(key);
+    auto it = m_entries.emplace(key, Entry{promise.get_future().share(), 0, m_lru.begin()}).first;
+    Ready(it, payload);
+}
+
+BlockServeCache::Payload BlockServeCache::GetOrMake(const BlockHash &hash, bool compact,
+                                                    const std::function<Payload()> &make) {
+    const Key key{hash, compact};
+    std::shared_future<Payload> pending;
+    std::promise<Payload> promise;
+    {
+        LOCK(cs);
+        auto it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            pending = it->second.payload;
+        } else {
+            m_lru.push_front(key);
+            m_entries.emplace(key, Entry{promise.get_future().share(), 0, m_lru.begin()});
+        }
+    }
+    if (pending.valid()) {
+        // Made already, or being made by another caller.
+        return pending.get();
+    }
+
+    // Only entries which are ready get evicted, so ours stays until we are done.
+    Payload payload;
+    try {
+        payload = make();
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        LOCK(cs);
+        Erase(m_entries.find(key));
+        throw;
+    }
+    promise.set_value(payload);
+    LOCK(cs);
+    auto it = m_entries.find(key);
+    if (payload) {
+        Ready(it, payload);
+    } else {
+        Erase(it);
+    }
+    return payload;
+}
+
+size_t BlockServeCache::GetBytes() const {
+    LOCK(cs);
+    return m_bytes;
+}
+
+size_t BlockServeCache::GetCount() const {
+    LOCK(cs);
+    return m_entries.size();
+}
+
+void BlockServeCache::Ready(std::map<Key, Entry>::iterator it, const Payload &payload) {
+    // A serialized block is never empty, so a size of 0 marks pending entries.
+    it->second.size = std::max<size_t>(payload->data.size(), 1);
+    m_bytes += it->second.size;
+    Evict();
+}
+
+void BlockServeCache::Evict() {
+    auto lru = m_lru.end();
+    while ((m_bytes > m_max_bytes || m_entries.size() > MAX_BLOCK_SERVE_CACHE_COUNT) &&
+           lru != m_lru.begin()) {
+        --lru;
+        auto it = m_entries.find(*lru);
+        if (it->second.size > 0) {
+            lru = Erase(it);
+        }
+    }
+}
+
+std::list<BlockServeCache::Key>::iterator BlockServeCache::Erase(std::map<Key, Entry>::iterator it) {
+    m_bytes -= it->second.size;
+    auto next = m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+    return next;
+}
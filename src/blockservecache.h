@@ -0,0 +1,93 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <primitives/blockhash.h>
+#include <sync.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+
+struct SharedNetMsgPayload;
+
+//! -maxblockservecachesize default, in MiB: the largest default block and its compact block fit
+static constexpr int64_t DEFAULT_MAX_BLOCK_SERVE_CACHE_SIZE = 512;
+//! Maximum -maxblockservecachesize
+static constexpr int64_t MAX_MAX_BLOCK_SERVE_CACHE_SIZE = 16384;
+//! Maximum number of payloads cached: a block and its compact block for each
+//! of the few blocks near the tip, with room to spare for a reorg
+static constexpr size_t MAX_BLOCK_SERVE_CACHE_COUNT = 16;
+
+/**
+ * Serialized blocks and compact blocks served to peers, kept so that a block
+ * many peers ask for at once (a new one, typically) is serialized and hashed
+ * once and its bytes shared by the messages to all of them.
+ *
+ * The payloads are evicted least recently used first to keep their total size
+ * within a bound, and their number within MAX_BLOCK_SERVE_CACHE_COUNT. Blocks
+ * read from disk are counted too although they point into the mapping of their
+ * block file, which they keep open, so callers only cache blocks near the tip.
+ */
+class BlockServeCache {
+public:
+    using Payload = std::shared_ptr<const SharedNetMsgPayload>;
+
+    explicit BlockServeCache(size_t max_bytes) : m_max_bytes(max_bytes) {}
+
+    void SetMaxBytes(size_t max_bytes);
+
+    /** The payload of a block or compact block, if it is cached and ready. */
+    Payload Get(const BlockHash &hash, bool compact);
+
+    /** Cache the payload of a block or compact block, unless it is already. */
+    void Insert(const BlockHash &hash, bool compact, Payload payload);
+
+    /**
+     * The payload of a block or compact block, which make() is called for if
+     * it is not cached. Callers asking for the same payload meanwhile wait for
+     * that call rather than making it again, so this must not be called with
+     * locks make() takes held. A null payload, for a block which could not be
+     * read, is returned but not cached.
+     */
+    Payload GetOrMake(const BlockHash &hash, bool compact, const std::function<Payload()> &make);
+
+    /** Total size of the cached payloads. */
+    size_t GetBytes() const;
+    size_t GetCount() const;
+
+private:
+    using Key = std::pair<BlockHash, bool>;
+
+    struct Entry {
+        std::shared_future<Payload> payload;
+        //! Size of the payload, 0 while it is being made
+        size_t size = 0;
+        //! Position in m_lru
+        std::list<Key>::iterator lru;
+    };
+
+    mutable Mutex cs;
+    size_t m_max_bytes GUARDED_BY(cs);
+    size_t m_bytes GUARDED_BY(cs) = 0;
+    std::map<Key, Entry> m_entries GUARDED_BY(cs);
+    //! Keys of m_entries, most recently used first
+    std::list<Key> m_lru GUARDED_BY(cs);
+
+    /** Account for a payload now ready, and evict others to make room for it. */
+    void Ready(std::map<Key, Entry>::iterator it, const Payload &payload) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /**
+     * Evict ready payloads, least recently used first, until within
+     * m_max_bytes and MAX_BLOCK_SERVE_CACHE_COUNT.
+     */
+    void Evict() EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** @returns the position in m_lru after that of the erased entry */
+    std::list<Key>::iterator Erase(std::map<Key, Entry>::iterator it) EXCLUSIVE_LOCKS_REQUIRED(cs);
+};
@@ -327,7 +327,7 @@ public:
         READWRITE(obj.nNonce);
     }
 
-    BlockHash GetBlockHash() const {
+    CBlockHeader GetBlockHeader() const {
         CBlockHeader block;
         block.nVersion = nVersion;
         block.hashPrevBlock = hashPrev;
@@ -335,9 +335,11 @@ public:
         block.nTime = nTime;
         block.nBits = nBits;
         block.nNonce = nNonce;
-        return block.GetHash();
+        return block;
     }
 
+    BlockHash GetBlockHash() const { return GetBlockHeader().GetHash(); }
+
     std::string ToString() const {
         std::string str = "CDiskBlockIndex(";
         str += CBlockIndex::ToString();
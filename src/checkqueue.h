@@ -9,10 +9,26 @@
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 template <typename T> class CCheckQueueControl;
 
+/** Whether check type T has a FinishBatch, see CCheckQueue. */
+template <typename T, typename = void>
+struct CheckHasFinishBatch : std::false_type {};
+template <typename T>
+struct CheckHasFinishBatch<T, std::void_t<decltype(T::FinishBatch(
+                                  std::declval<std::vector<T> &>()))>>
+    : std::true_type {};
+
 /**
  * Queue for verifications that have to be performed.
  * The verifications are represented by a type T, which must provide an
@@ -22,9 +38,32 @@ template <typename T> class CCheckQueueControl;
  * queue, where they are processed by N-1 worker threads. When the master is
  * done adding work, it temporarily joins the worker pool as an N'th worker,
  * until all jobs are done.
+ *
+ * Each thread has a queue of its own, which the batches added are spread over.
+ * A thread takes its checks from the back of its own queue, and once that is
+ * empty steals from the front of the queues of the others, so that threads
+ * only contend for a queue when it runs low. The number of checks taken at
+ * once adapts to how long checks take to run.
+ *
+ * T may also provide a static bool FinishBatch(std::vector<T> &), to complete
+ * work that its operator() deferred, for many checks at once. Each thread
+ * keeps the checks it ran successfully until it has nBatchSize of them or
+ * runs out of checks, and then passes them to FinishBatch, which fails them
+ * all by returning false.
  */
 template <typename T> class CCheckQueue {
 private:
+    //! The checks queued for one of the threads.
+    struct WorkerQueue {
+        Mutex m_mutex;
+        std::deque<T> checks GUARDED_BY(m_mutex);
+    };
+
+    //! How long a batch of checks should take to run, in nanoseconds. Batches
+    //! are kept short so that the threads finish at about the same time when
+    //! the checks of a block vary in cost.
+    static constexpr int64_t TARGET_BATCH_NS = 200 * 1000;
+
     //! Mutex to protect the inner state
     Mutex m_mutex;
 
@@ -34,103 +73,178 @@ private:
     //! Master thread blocks on this when out of work
     std::condition_variable m_master_cv;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue GUARDED_BY(m_mutex);
+    //! The queues of the threads, the first one being the master's. Only
+    //! resized while no worker thread runs.
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle GUARDED_BY(m_mutex){0};
+    //! The queue the next checks added go to, used by the master only.
+    size_t m_next_queue{0};
 
-    //! The total number of workers (including the master).
-    int nTotal GUARDED_BY(m_mutex){0};
+    //! The number of checks in the queues, not taken by any thread yet.
+    std::atomic<unsigned int> m_queued{0};
 
     //! The temporary evaluation result.
-    bool fAllOk GUARDED_BY(m_mutex){true};
+    std::atomic<bool> fAllOk{true};
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo GUARDED_BY(m_mutex){0};
+    std::atomic<unsigned int> nTodo{0};
 
     //! The maximum number of elements to be processed in one batch
     const unsigned int nBatchSize;
 
+    //! Moving average of the time a check takes to run, in nanoseconds, 0
+    //! until measured.
+    std::atomic<int64_t> m_check_cost_ns{0};
+
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
+    /** The number of checks to take at once, given their measured cost. */
+    unsigned int GetBatchSize() const {
+        const int64_t cost = m_check_cost_ns.load(std::memory_order_relaxed);
+        if (cost <= 0) {
+            return nBatchSize;
+        }
+        return std::clamp<int64_t>(TARGET_BATCH_NS / cost, 1, nBatchSize);
+    }
+
+    /** Account for a batch of nChecks which took nElapsed nanoseconds. */
+    void UpdateCheckCost(int64_t nElapsed, size_t nChecks) {
+        // Concurrent updates may get lost, which is fine for an estimate.
+        const int64_t sample = std::max<int64_t>(1, nElapsed / nChecks);
+        const int64_t cost = m_check_cost_ns.load(std::memory_order_relaxed);
+        m_check_cost_ns.store(cost > 0 ? cost + (sample - cost) / 8 : sample,
+                              std::memory_order_relaxed);
+    }
+
+    /**
+     * Move a batch of checks to vChecks, from the back of the queue of thread
+     * self or else from the front of another one. Returns false if there
+     * are none.
+     */
+    bool TakeChecks(size_t self, std::vector<T> &vChecks) {
+        if (m_queued.load() == 0) {
+            return false;
+        }
+        const unsigned int nBatch = GetBatchSize();
+        for (size_t i = 0; i < m_queues.size(); ++i) {
+            WorkerQueue &q = *m_queues[(self + i) % m_queues.size()];
+            LOCK(q.m_mutex);
+            if (q.checks.empty()) {
+                continue;
+            }
+            // Leave half of the queue to the threads which may steal from it,
+            // so that batches get smaller as the work runs out.
+            const size_t nNow = std::max<size_t>(
+                1, std::min<size_t>(nBatch, q.checks.size() / 2));
+            vChecks.resize(nNow);
+            for (T &check : vChecks) {
+                // We want the lock on the queue to be as short as possible, so
+                // swap jobs from it to the local batch vector instead of
+                // copying.
+                if (i == 0) {
+                    check.swap(q.checks.back());
+                    q.checks.pop_back();
+                } else {
+                    check.swap(q.checks.front());
+                    q.checks.pop_front();
+                }
+            }
+            m_queued -= nNow;
+            return true;
+        }
+        return false;
+    }
+
+    /** Account for checks which completed, and get rid of them. */
+    void CompleteChecks(std::vector<T> &vChecks, bool fMaster) {
+        const unsigned int nNow = vChecks.size();
+        // The checks must be gone before the master may return.
+        vChecks.clear();
+        if (nTodo.fetch_sub(nNow) == nNow && !fMaster) {
+            // We processed the last element; inform the master it can
+            // exit and return the result
+            LOCK(m_mutex);
+            m_master_cv.notify_one();
+        }
+    }
+
+    /** Run FinishBatch on the checks which were kept for it. */
+    void FinishChecks(std::vector<T> &vFinish, bool fMaster) {
+        if constexpr (CheckHasFinishBatch<T>::value) {
+            if (fAllOk && !T::FinishBatch(vFinish)) {
+                fAllOk = false;
+            }
+        }
+        CompleteChecks(vFinish, fMaster);
+    }
+
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster) {
-        std::condition_variable& cond = fMaster ? m_master_cv : m_worker_cv;
+    bool Loop(size_t self, bool fMaster) {
+        std::condition_variable &cond = fMaster ? m_master_cv : m_worker_cv;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
+        // Checks which ran successfully, waiting for FinishBatch.
+        std::vector<T> vFinish;
         do {
-            {
-                WAIT_LOCK(m_mutex, lock);
-                // first do the clean-up of the previous loop run (allowing us
-                // to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster) {
-                        // We processed the last element; inform the master it
-                        // can exit and return the result
-                        m_master_cv.notify_one();
-                    }
-                } else {
-                    // first iteration
-                    nTotal++;
+            if (!TakeChecks(self, vChecks)) {
+                if (!vFinish.empty()) {
+                    // Others may be waiting for these, so finish them before
+                    // looking for more work.
+                    FinishChecks(vFinish, fMaster);
+                    continue;
                 }
-                // logically, the do loop starts here
-                while (queue.empty() && !m_request_stop) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        fAllOk = true;
-                        // return the current status
-                        return fRet;
+                WAIT_LOCK(m_mutex, lock);
+                while (m_queued.load() == 0 && !m_request_stop) {
+                    if (fMaster && nTodo.load() == 0) {
+                        // reset the status for new work later, and return the
+                        // current status
+                        return fAllOk.exchange(true);
                     }
-                    nIdle++;
                     cond.wait(lock); // wait
-                    nIdle--;
                 }
                 if (m_request_stop) {
                     return false;
                 }
-
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for
-                // increasingly smaller batches so all workers finish
-                // approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start
-                // helping.
-                // * Don't do batches smaller than 1 (duh), or larger than
-                // nBatchSize.
-                nNow = std::max(
-                    1U, std::min(nBatchSize, (unsigned int)queue.size() /
-                                                 (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible,
-                    // so swap jobs from the global queue to the local batch
-                    // vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                continue;
             }
+
+            // Check whether we need to do work at all
+            bool fOk = fAllOk;
             // execute work
+            const auto start = std::chrono::steady_clock::now();
             for (T &check : vChecks) {
                 if (fOk) {
                     fOk = check();
                 }
             }
-            vChecks.clear();
+            if (fOk) {
+                UpdateCheckCost(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count(),
+                    vChecks.size());
+            } else {
+                fAllOk = false;
+            }
+            if constexpr (CheckHasFinishBatch<T>::value) {
+                if (fOk) {
+                    for (T &check : vChecks) {
+                        vFinish.emplace_back();
+                        vFinish.back().swap(check);
+                    }
+                    vChecks.clear();
+                    if (vFinish.size() >= nBatchSize) {
+                        FinishChecks(vFinish, fMaster);
+                    }
+                    continue;
+                }
+            }
+            CompleteChecks(vChecks, fMaster);
         } while (true);
     }
 
@@ -140,41 +254,56 @@ public:
 
     //! Create a new check queue
     explicit CCheckQueue(unsigned int nBatchSizeIn)
-        : nBatchSize(nBatchSizeIn) {}
+        : nBatchSize(nBatchSizeIn) {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
+    }
 
-    //! Create a pool of new worker threads.
-    void StartWorkerThreads(const int threads_num)
+    //! Create a pool of new worker threads, named after thread_name.
+    void StartWorkerThreads(const int threads_num,
+                            const std::string &thread_name = "scriptch")
     {
-        {
-             LOCK(m_mutex);
-             nIdle = 0;
-             nTotal = 0;
-             fAllOk = true;
-         }
-         assert(m_worker_threads.empty());
-         for (int n = 0; n < threads_num; ++n) {
-             m_worker_threads.emplace_back([this, n]() {
-                 util::ThreadRename(strprintf("scriptch.%i", n));
-                 Loop(false /* worker thread */);
-             });
-         }
+        fAllOk = true;
+        assert(m_worker_threads.empty());
+        m_queues.resize(1);
+        for (int n = 0; n < threads_num; ++n) {
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (int n = 0; n < threads_num; ++n) {
+            m_worker_threads.emplace_back([this, n, thread_name]() {
+                util::ThreadRename(strprintf("%s.%i", thread_name, n));
+                Loop(n + 1, false /* worker thread */);
+            });
+        }
     }
 
     //! Wait until execution finishes, and return whether all evaluations were
     //! successful.
-    bool Wait() { return Loop(true /* master thread */); }
+    bool Wait() { return Loop(0, true /* master thread */); }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T> &vChecks) {
-        LOCK(m_mutex);
-        for (T &check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
+        if (vChecks.empty()) {
+            return;
         }
         nTodo += vChecks.size();
+        // Spread the checks over the queues, in runs which keep checks added
+        // together (such as the inputs of a transaction) next to each other.
+        const size_t nChunk =
+            (vChecks.size() + m_queues.size() - 1) / m_queues.size();
+        for (size_t i = 0; i < vChecks.size(); i += nChunk) {
+            WorkerQueue &q = *m_queues[m_next_queue++ % m_queues.size()];
+            const size_t nEnd = std::min(i + nChunk, vChecks.size());
+            LOCK(q.m_mutex);
+            for (size_t j = i; j < nEnd; ++j) {
+                q.checks.emplace_back();
+                q.checks.back().swap(vChecks[j]);
+            }
+            m_queued += nEnd - i;
+        }
+        LOCK(m_mutex);
         if (vChecks.size() == 1) {
             m_worker_cv.notify_one();
-        } else if (vChecks.size() > 1) {
+        } else {
             m_worker_cv.notify_all();
         }
     }
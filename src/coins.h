@@ -227,6 +227,13 @@ public:
     void AddCoin(const COutPoint &outpoint, Coin coin,
                  bool potential_overwrite);
 
+    /**
+     * Add a coin read from the base view beforehand, as fetching it would
+     * have, unless the cache has an entry for it already. The base view must
+     * not have been written to since the coin was read from it.
+     */
+    void AddFetchedCoin(const COutPoint &outpoint, Coin coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call has no
@@ -22,6 +22,7 @@ class CTransaction;
 struct PartiallySignedTransaction;
 class uint160;
 class uint256;
+class uint288;
 
 // core_read.cpp
 CScript ParseScript(const std::string &s);
@@ -47,6 +48,23 @@ bool ParseHashStr(const std::string &strHex, uint256 &result);
  * @returns true if successful, false if not
  */
 bool ParseHashStr(const std::string &strHex, uint160 &result);
+/**
+ * Parse a hex string into a 36-byte ref, in the byte order in which it
+ * follows OP_PUSHINPUTREF and the like in a script (the txid in internal byte
+ * order followed by the little-endian output index).
+ * @param[in] strHex a hex-formatted, 72-character string
+ * @param[out] result the result of the parsing
+ * @returns true if successful, false if not
+ */
+bool ParseRefStr(const std::string &strHex, uint288 &result);
+/**
+ * Parse a hex string into a codeScriptHash, in the byte order in which it is
+ * pushed in scripts (for OP_CODESCRIPTHASHVALUESUM_UTXOS and the like).
+ * @param[in] strHex a hex-formatted, 64-character string
+ * @param[out] result the result of the parsing
+ * @returns true if successful, false if not
+ */
+bool ParseCodeScriptHashStr(const std::string &strHex, uint256 &result);
 std::vector<uint8_t> ParseHexUV(const UniValue &v, const std::string &strName);
 [[nodiscard]] bool DecodePSBT(PartiallySignedTransaction &psbt,
                               const std::string &base64_tx, std::string &error);
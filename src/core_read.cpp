@@ -262,6 +262,22 @@ bool ParseHashStr(const std::string &strHex, uint160 &result) {
     return true;
 }
 
+bool ParseRefStr(const std::string &strHex, uint288 &result) {
+    if ((strHex.size() != 72) || !IsHex(strHex)) {
+        return false;
+    }
+    result = uint288(ParseHex(strHex));
+    return true;
+}
+
+bool ParseCodeScriptHashStr(const std::string &strHex, uint256 &result) {
+    if ((strHex.size() != 64) || !IsHex(strHex)) {
+        return false;
+    }
+    result = uint256(ParseHex(strHex));
+    return true;
+}
+
 std::vector<uint8_t> ParseHexUV(const UniValue &v, const std::string &strName) {
     std::string strHex;
     if (v.isStr()) {
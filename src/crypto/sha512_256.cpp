@@ -4,10 +4,21 @@
 
 #include <crypto/sha512_256.h>
 
+#include <compat/cpuid.h>
 #include <crypto/common.h>
 
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 
+namespace sha512_256d_avx2 {
+void Transform_4way(uint8_t *out, const uint8_t *in, size_t len);
+}
+
+namespace sha512_256d_avx512 {
+void Transform_8way(uint8_t *out, const uint8_t *in, size_t len);
+}
+
 // Internal implementation code.
 namespace {
 /// Internal SHA-512/256 implementation.
@@ -235,10 +246,195 @@ namespace sha512_256 {
         s[7] += h;
     }
 
+    /**
+     * Compute the double SHA-512/256 of a message of len bytes, where len
+     * is small enough for the padded message to fit a single chunk.
+     */
+    void TransformD(uint8_t *out, const uint8_t *in, size_t len) {
+        uint64_t s[8];
+        uint8_t buffer[128] = {0};
+        memcpy(buffer, in, len);
+        buffer[len] = 0x80;
+        WriteBE64(buffer + 120, uint64_t(len) << 3);
+        Initialize(s);
+        Transform(s, buffer);
+
+        // Second round: hash the 32-byte digest.
+        std::fill(buffer, buffer + 128, 0);
+        WriteBE64(buffer + 0, s[0]);
+        WriteBE64(buffer + 8, s[1]);
+        WriteBE64(buffer + 16, s[2]);
+        WriteBE64(buffer + 24, s[3]);
+        buffer[32] = 0x80;
+        WriteBE64(buffer + 120, 256);
+        Initialize(s);
+        Transform(s, buffer);
+        WriteBE64(out + 0, s[0]);
+        WriteBE64(out + 8, s[1]);
+        WriteBE64(out + 16, s[2]);
+        WriteBE64(out + 24, s[3]);
+    }
+
 } // namespace sha512_256
 
+typedef void (*TransformDType)(uint8_t *, const uint8_t *, size_t);
+
+TransformDType TransformD_4way = nullptr;
+TransformDType TransformD_8way = nullptr;
+
+/**
+ * Double SHA-512/256 of `blocks` consecutive messages of len bytes each,
+ * using the widest kernels available.
+ */
+void TransformDMulti(uint8_t *out, const uint8_t *in, size_t len,
+                     size_t blocks) {
+    if (TransformD_8way) {
+        while (blocks >= 8) {
+            TransformD_8way(out, in, len);
+            out += 256;
+            in += 8 * len;
+            blocks -= 8;
+        }
+    }
+    if (TransformD_4way) {
+        while (blocks >= 4) {
+            TransformD_4way(out, in, len);
+            out += 128;
+            in += 4 * len;
+            blocks -= 4;
+        }
+    }
+    while (blocks) {
+        sha512_256::TransformD(out, in, len);
+        out += 32;
+        in += len;
+        --blocks;
+    }
+}
+
+bool SelfTest() {
+    // Some random input data to test with
+    static const uint8_t data[641] =
+        "-" // Intentionally not aligned
+        "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+        "eiusmod tempor incididunt ut labore et dolore magna aliqua. Et m"
+        "olestie ac feugiat sed lectus vestibulum mattis ullamcorper. Mor"
+        "bi blandit cursus risus at ultrices mi tempus imperdiet nulla. N"
+        "unc congue nisi vita suscipit tellus mauris. Imperdiet proin fer"
+        "mentum leo vel orci. Massa tempor nec feugiat nisl pretium fusce"
+        " id velit. Telus in metus vulputate eu scelerisque felis. Mi tem"
+        "pus imperdiet nulla malesuada pellentesque. Tristique magna sit.";
+    // Expected double SHA-512/256 of the first 64 and 80 input bytes.
+    static const uint8_t result_d64[32] = {
+        0xa5, 0x2d, 0xcf, 0xfe, 0x73, 0xfa, 0x29, 0x1c, 0x46, 0x56, 0x2f,
+        0xda, 0xa6, 0x2a, 0xe7, 0x5d, 0xb9, 0xea, 0xed, 0x5e, 0x92, 0xea,
+        0xbf, 0xae, 0xc6, 0xeb, 0x68, 0xab, 0x6e, 0xb6, 0x9f, 0xeb};
+    static const uint8_t result_d80[32] = {
+        0x8d, 0x67, 0x3d, 0x81, 0xfb, 0x6d, 0x27, 0x27, 0xc0, 0x30, 0xc4,
+        0x93, 0x12, 0x8b, 0xbe, 0x47, 0x65, 0x8a, 0xe7, 0xcd, 0x54, 0xb2,
+        0x93, 0xad, 0x17, 0x82, 0xd9, 0xae, 0x7d, 0xf8, 0xa4, 0x6b};
+
+    // Test the scalar implementation against the known answers.
+    uint8_t expected[256];
+    sha512_256::TransformD(expected, data + 1, 64);
+    if (!std::equal(expected, expected + 32, result_d64)) {
+        return false;
+    }
+    sha512_256::TransformD(expected, data + 1, 80);
+    if (!std::equal(expected, expected + 32, result_d80)) {
+        return false;
+    }
+
+    // Test the multi-way implementations, if available, against the scalar
+    // one on eight 64-byte messages, and on eight 80-byte ones, the size of
+    // the block headers they hash.
+    for (size_t len : {64, 80}) {
+        for (size_t i = 0; i < 8; ++i) {
+            sha512_256::TransformD(expected + 32 * i, data + 1 + len * i, len);
+        }
+
+        if (TransformD_4way) {
+            uint8_t out[128];
+            TransformD_4way(out, data + 1, len);
+            if (!std::equal(out, out + 128, expected)) {
+                return false;
+            }
+        }
+
+        if (TransformD_8way) {
+            uint8_t out[256];
+            TransformD_8way(out, data + 1, len);
+            if (!std::equal(out, out + 256, expected)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+#if defined(USE_ASM) &&                                                        \
+    (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Return the OS-enabled extended register state (XCR0). */
+uint32_t GetXCR0() {
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return a;
+}
+#endif
 } // namespace
 
+std::string SHA512_256AutoDetect() {
+    std::string ret = "standard";
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+    bool have_xsave = false;
+    bool have_avx = false;
+    bool have_avx2 = false;
+    bool have_avx512 = false;
+    bool enabled_avx = false;
+    bool enabled_avx512 = false;
+
+    (void)have_avx2;
+    (void)have_avx512;
+    (void)enabled_avx;
+    (void)enabled_avx512;
+
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    have_xsave = (ecx >> 27) & 1;
+    have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        const uint32_t xcr0 = GetXCR0();
+        // XMM and YMM state, plus opmask and both halves of the ZMM state.
+        enabled_avx = (xcr0 & 0x06) == 0x06;
+        enabled_avx512 = (xcr0 & 0xe6) == 0xe6;
+    }
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    if (eax >= 7) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+        have_avx512 = (ebx >> 16) & 1;
+    }
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && enabled_avx) {
+        TransformD_4way = sha512_256d_avx2::Transform_4way;
+        ret = "avx2(4way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX512) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx512 && enabled_avx512) {
+        TransformD_8way = sha512_256d_avx512::Transform_8way;
+        ret += ",avx512(8way)";
+    }
+#endif
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
 ////// SHA-512/256
 
 CSHA512_256::CSHA512_256() : bytes(0) {
@@ -307,3 +503,11 @@ CSHA512_256 &CSHA512_256::Reset() {
     sha512_256::Initialize(s);
     return *this;
 }
+
+void SHA512_256D64(uint8_t *out, const uint8_t *in, size_t blocks) {
+    TransformDMulti(out, in, 64, blocks);
+}
+
+void SHA512_256D80(uint8_t *out, const uint8_t *in, size_t blocks) {
+    TransformDMulti(out, in, 80, blocks);
+}
@@ -6,6 +6,7 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <string>
 
 /** A hasher class for SHA-512/256. */
 class CSHA512_256 {
@@ -22,3 +23,26 @@ public:
     void Finalize(uint8_t hash[OUTPUT_SIZE]);
     CSHA512_256 &Reset();
 };
+
+/**
+ * Autodetect the best available multi-buffer SHA-512/256 implementation.
+ * Returns the name of the implementation.
+ */
+std::string SHA512_256AutoDetect();
+
+/**
+ * Compute multiple double-SHA512/256's of 64-byte blobs.
+ * output:  pointer to a blocks*32 byte output buffer
+ * input:   pointer to a blocks*64 byte input buffer
+ * blocks:  the number of hashes to compute.
+ */
+void SHA512_256D64(uint8_t *output, const uint8_t *input, size_t blocks);
+
+/**
+ * Compute multiple double-SHA512/256's of 80-byte blobs, i.e. serialized
+ * block headers.
+ * output:  pointer to a blocks*32 byte output buffer
+ * input:   pointer to a blocks*80 byte input buffer
+ * blocks:  the number of hashes to compute.
+ */
+void SHA512_256D80(uint8_t *output, const uint8_t *input, size_t blocks);
@@ -121,6 +121,7 @@ public:
  *  Read Operations:
  *      - contains() for `erase=false`
  *      - get() for `erase=false`
+ *      - for_each()
  *
  *  Read+Erase Operations:
  *      - contains() for `erase=true`
@@ -540,6 +541,20 @@ public:
         return false;
     }
 
+    /**
+     * for_each calls f on each element of the table which has not been
+     * erased, in table order. It is a Read operation.
+     *
+     * @param f a callable taking a const Element &
+     */
+    template <typename F> void for_each(F &&f) const {
+        for (uint32_t i = 0; i < size; ++i) {
+            if (!collection_flags.bit_is_set(i)) {
+                f(table[i]);
+            }
+        }
+    }
+
 private:
     const Element *find(const Key &k, const bool erase) const {
         std::array<uint32_t, 8> locs = compute_hashes(k);
@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <compat.h>
 #include <flatfile.h>
 #include <logging.h>
 #include <tinyformat.h>
@@ -10,6 +11,10 @@
 
 #include <stdexcept>
 
+#ifdef WIN32
+#include <io.h> /* for _get_osfhandle */
+#endif
+
 FlatFileSeq::FlatFileSeq(fs::path dir, const char *prefix, size_t chunk_size)
     : m_dir(std::move(dir)), m_prefix(prefix), m_chunk_size(chunk_size) {
     if (chunk_size == 0) {
@@ -50,6 +55,67 @@ FILE *FlatFileSeq::Open(const FlatFilePos &pos, bool read_only) {
     return file;
 }
 
+std::shared_ptr<const MappedFlatFile> FlatFileSeq::Map(const FlatFilePos &pos) const {
+    if (pos.IsNull()) {
+        return nullptr;
+    }
+    return MappedFlatFile::Map(FileName(pos));
+}
+
+std::shared_ptr<const MappedFlatFile> MappedFlatFile::Map(const fs::path &path) {
+    FILE *file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        LogPrintf("Unable to open file %s\n", path.string());
+        return nullptr;
+    }
+    if (fseek(file, 0, SEEK_END)) {
+        LogPrintf("Unable to seek to the end of %s\n", path.string());
+        fclose(file);
+        return nullptr;
+    }
+    const long size = ftell(file);
+    if (size <= 0) {
+        // Nothing to map (mapping an empty file fails on most platforms).
+        fclose(file);
+        return std::shared_ptr<const MappedFlatFile>(new MappedFlatFile(nullptr, 0));
+    }
+
+    const void *data = nullptr;
+#ifdef WIN32
+    HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(file));
+    HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (hMapping) {
+        data = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, size);
+        // The view keeps the mapping object alive.
+        CloseHandle(hMapping);
+    }
+#else
+    data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileno(file), 0);
+    if (data == MAP_FAILED) {
+        data = nullptr;
+    }
+#endif
+    // The mapping does not need the file to stay open.
+    fclose(file);
+    if (!data) {
+        LogPrintf("Unable to map file %s\n", path.string());
+        return nullptr;
+    }
+    return std::shared_ptr<const MappedFlatFile>(
+        new MappedFlatFile(static_cast<const uint8_t *>(data), size_t(size)));
+}
+
+MappedFlatFile::~MappedFlatFile() {
+    if (!m_data) {
+        return;
+    }
+#ifdef WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+}
+
 size_t FlatFileSeq::Allocate(const FlatFilePos &pos, size_t add_size,
                              bool &out_of_space) {
     out_of_space = false;
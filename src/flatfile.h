@@ -7,7 +7,10 @@
 
 #include <fs.h>
 #include <serialize.h>
+#include <span.h>
 
+#include <cstdint>
+#include <memory>
 #include <string>
 
 struct FlatFilePos {
@@ -38,6 +41,32 @@ struct FlatFilePos {
     std::string ToString() const;
 };
 
+/**
+ * A read-only memory mapping of a whole flat file. Reading through the mapping
+ * lets the OS page the data in on demand, without it ever being copied into
+ * the heap. The mapping stays valid for the lifetime of the object, even if
+ * the file is unlinked in the meantime (on POSIX systems).
+ */
+class MappedFlatFile {
+private:
+    const uint8_t *m_data;
+    size_t m_size;
+
+    MappedFlatFile(const uint8_t *data, size_t size)
+        : m_data(data), m_size(size) {}
+
+public:
+    /** Map the file at path, returning nullptr on failure. */
+    static std::shared_ptr<const MappedFlatFile> Map(const fs::path &path);
+
+    ~MappedFlatFile();
+    MappedFlatFile(const MappedFlatFile &) = delete;
+    MappedFlatFile &operator=(const MappedFlatFile &) = delete;
+
+    /** The contents of the file at the time it was mapped. */
+    Span<const uint8_t> Data() const { return {m_data, m_size}; }
+};
+
 /**
  * FlatFileSeq represents a sequence of numbered files storing raw data. This
  * class facilitates access to and efficient management of these files.
@@ -65,6 +94,9 @@ public:
     /** Open a handle to the file at the given position. */
     FILE *Open(const FlatFilePos &pos, bool read_only = false);
 
+    /** Map the whole file at the given position read-only into memory. */
+    std::shared_ptr<const MappedFlatFile> Map(const FlatFilePos &pos) const;
+
     /**
      * Allocate additional space in a file after the given starting position.
      * The amount allocated will be the minimum multiple of the sequence chunk
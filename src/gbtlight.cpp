@@ -3,12 +3,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <gbtlight.h>
+#include <crypto/sha256.h>
 #include <logging.h>
 #include <scheduler.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
 #include <limits>
 
 namespace gbtl {
@@ -86,6 +89,70 @@ void Initialize(CScheduler &scheduler) {
     }
 }
 
+void MerkleBranchTree::Append(const uint256 &txid) {
+    levels.front().push_back(txid);
+    Rehash(levels.front().size() - 1);
+}
+
+void MerkleBranchTree::Erase(size_t pos) {
+    assert(pos < size());
+    auto &leaves = levels.front();
+    leaves.erase(leaves.begin() + pos + 1);
+    Rehash(pos + 1);
+}
+
+size_t MerkleBranchTree::Assign(const std::vector<uint256> &txids) {
+    auto &leaves = levels.front();
+    const auto mismatch = std::mismatch(txids.begin(), txids.end(), leaves.begin() + 1, leaves.end());
+    const size_t pos = mismatch.first - txids.begin();
+    if (pos == txids.size() && pos == size()) {
+        return pos;
+    }
+    leaves.resize(txids.size() + 1);
+    std::copy(mismatch.first, txids.end(), leaves.begin() + pos + 1);
+    Rehash(pos + 1);
+    return pos;
+}
+
+void MerkleBranchTree::Rehash(size_t first) {
+    size_t k = 0;
+    for (; levels[k].size() > 1; ++k, first /= 2) {
+        if (levels.size() == k + 1) {
+            levels.emplace_back();
+        }
+        const auto &level = levels[k];
+        const size_t nParents = (level.size() + 1) / 2;
+        auto &parents = levels[k + 1];
+        parents.resize(nParents);
+        // Parent 0 depends on the coinbase; the pairs below `first` did not change.
+        size_t p = std::max<size_t>(first / 2, 1);
+        // Hash the complete pairs in one go, they are contiguous in memory.
+        const size_t nPairs = level.size() / 2;
+        if (p < nPairs) {
+            SHA256D64(parents[p].begin(), level[2 * p].begin(), nPairs - p);
+            p = nPairs;
+        }
+        // An odd node out at the end is paired with itself.
+        if (p < nParents) {
+            uint8_t pair[64];
+            std::copy(level.back().begin(), level.back().end(), pair);
+            std::copy(level.back().begin(), level.back().end(), pair + 32);
+            SHA256D64(parents[p].begin(), pair, 1);
+        }
+    }
+    // The root level has been reached, drop any levels left over from a larger tree.
+    levels.resize(k + 1);
+}
+
+std::vector<uint256> MerkleBranchTree::GetBranch() const {
+    std::vector<uint256> steps;
+    steps.reserve(levels.size() - 1);
+    for (size_t k = 0; k + 1 < levels.size(); ++k) {
+        steps.push_back(levels[k][1]);
+    }
+    return steps;
+}
+
 const fs::path &GetJobDataDir() { return config.storeDir; }
 const fs::path &GetJobDataTrashDir() { return config.trashDir; }
 size_t GetJobCacheSize() { return size_t(config.cacheSize); }
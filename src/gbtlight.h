@@ -9,6 +9,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 class CScheduler;
 
@@ -32,6 +33,44 @@ size_t GetJobCacheSize();
 /// Returns the job data dir file expiry time in seconds.  From arg -gbtstoretime=<n>
 int64_t GetJobDataExpiry();
 
+/// An incrementally maintained merkle tree over the non-coinbase txids of a block template, from which the merkle
+/// branch of the (as yet unknown) coinbase can be read off -- see MakeMerkleBranch() in rpc/mining.h, which computes
+/// the same branch from scratch.
+///
+/// Every node that does not depend on the coinbase is kept, so appending or erasing the last txid rehashes one node
+/// per level of the tree (O(log n) hashes), and in general a change at position i only rehashes the nodes to the right
+/// of i.  The txids are kept in the order given (the consensus order of the block).
+class MerkleBranchTree {
+public:
+    MerkleBranchTree() : levels(1, std::vector<uint256>(1)) {}
+    explicit MerkleBranchTree(const std::vector<uint256> &txids) : MerkleBranchTree() { Assign(txids); }
+
+    /// Returns the number of txids (leaves, not counting the coinbase) in the tree.
+    size_t size() const { return levels.front().size() - 1; }
+    /// Returns the txid at position pos (0 being the first tx after the coinbase).
+    const uint256 &operator[](size_t pos) const { return levels.front()[pos + 1]; }
+
+    /// Append a txid. Rehashes one node per level.
+    void Append(const uint256 &txid);
+    /// Erase the txid at position pos. Rehashes the nodes to the right of pos.
+    void Erase(size_t pos);
+    /// Replace the txids in the tree with `txids`, rehashing only the nodes to the right of the first txid that
+    /// changed. Returns the position of that txid (size() if nothing changed).
+    size_t Assign(const std::vector<uint256> &txids);
+
+    /// Returns the merkle branch for the coinbase: the same result as MakeMerkleBranch() of the txids.
+    std::vector<uint256> GetBranch() const;
+
+private:
+    /// levels[0] is the leaves, levels.back() the root level. Node 0 of every level depends on the coinbase and is
+    /// left null; all the other nodes are kept up to date.
+    std::vector<std::vector<uint256>> levels;
+
+    /// Recompute the nodes of every level above the leaves, given that the leaves from position `first` (counting
+    /// the coinbase as position 0) onward may have changed.
+    void Rehash(size_t first);
+};
+
 extern const int DEFAULT_JOB_CACHE_SIZE; /**< = 10 */
 extern const char * const DEFAULT_JOB_DATA_SUBDIR; /**< = "gbt" */
 extern const int64_t DEFAULT_JOB_DATA_EXPIRY_SECS; /**< = 3600 */
@@ -11,6 +11,7 @@
 #include <httpserver.h>
 #include <key_io.h>
 #include <random.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <sync.h>
@@ -86,6 +87,14 @@ static void JSONErrorReply(HTTPRequest* req, JSONRPCError&& error, UniValue&& id
     req->WriteReply(nStatus, strReply);
 }
 
+static bool AbortChunkedReply(HTTPRequest *req, const JSONRPCRequest &jreq, const std::string &reason) {
+    // Part of the result has already been sent, so there is no way left to report the error to the client other than
+    // cutting the reply short.
+    LogPrintf("RPC %s failed while streaming its result: %s\n", jreq.strMethod, reason);
+    req->EndChunkedReply();
+    return false;
+}
+
 /*
  * This function checks username and password against -rpcauth entries from
  * config file.
@@ -316,6 +325,8 @@ bool HTTPRPCRequestProcessor::ProcessHTTPRequest(HTTPRequest *req) {
         return false;
     }
 
+    // Set once a singleton reply outgrows its buffer and is being sent as a chunked reply.
+    bool chunked = false;
     try {
         // Parse request
         UniValue valRequest;
@@ -331,9 +342,38 @@ bool HTTPRPCRequestProcessor::ProcessHTTPRequest(HTTPRequest *req) {
         if (valRequest.isObject()) {
             jreq.parse(std::move(valRequest));
 
-            // Send reply
-            // (id is copied rather than moved, so it's still there for exception handlers below)
-            strReply = JSONRPCReply(rpcServer.ExecuteCommand(config, jreq), UniValue(), UniValue(jreq.id));
+            // The reply is produced with a JSONStreamWriter, which the command may also use to stream a large result
+            // (see JSONRPCRequest::stream). Only replies which outgrow the writer's buffer are sent chunked.
+            JSONStreamWriter writer([req, &chunked](std::string &&chunk) {
+                if (!chunked) {
+                    req->WriteHeader("Content-Type", "application/json");
+                    req->StartChunkedReply(HTTP_OK);
+                    chunked = true;
+                }
+                if (!req->WriteReplyChunk(chunk)) {
+                    throw std::runtime_error("connection closed");
+                }
+            });
+            jreq.stream = &writer;
+            writer.BeginObject();
+            writer.Key("result");
+            UniValue result = rpcServer.ExecuteCommand(config, jreq);
+            if (writer.AwaitingValue()) {
+                // the command returned its result rather than streaming it
+                writer.Value(result);
+            }
+            writer.Key("error");
+            writer.Value(UniValue());
+            writer.Key("id");
+            writer.Value(jreq.id);
+            writer.EndObject();
+
+            strReply = writer.TakeBuffer() + '\n';
+            if (chunked) {
+                req->WriteReplyChunk(strReply);
+                req->EndChunkedReply();
+                return true;
+            }
         } else if (valRequest.isArray()) {
             // array of requests
             strReply = JSONRPCExecBatch(config, rpcServer, jreq, std::move(valRequest.get_array()));
@@ -344,9 +384,15 @@ bool HTTPRPCRequestProcessor::ProcessHTTPRequest(HTTPRequest *req) {
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strReply);
     } catch (JSONRPCError &error) {
+        if (chunked) {
+            return AbortChunkedReply(req, jreq, error.message);
+        }
         JSONErrorReply(req, std::move(error), std::move(jreq.id));
         return false;
     } catch (const std::exception &e) {
+        if (chunked) {
+            return AbortChunkedReply(req, jreq, e.what());
+        }
         JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), std::move(jreq.id));
         return false;
     }
@@ -40,6 +40,8 @@
 #include <csignal>
 #include <cstdio>
 #include <cstdlib>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <deque>
 #include <memory>
@@ -559,9 +561,57 @@ void HTTPEvent::trigger(struct timeval *tv) {
         evtimer_add(ev, tv);
     }
 }
+/** Re-enable reading from the socket of a request that has been replied to.
+ *  This is the second part of the libevent workaround in http_request_cb(). */
+static void EnableReadAfterReply(evhttp_request *req) {
+    if (event_get_version_number() >= 0x02010600 &&
+        event_get_version_number() < 0x02010900) {
+        evhttp_connection *conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent *bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
+/** State of a chunked reply, shared between the worker thread producing it
+ *  and the main http thread sending it. */
+struct HTTPChunkedReply {
+    Mutex cs;
+    std::condition_variable cond;
+    /** A chunk has been handed to libevent and not fully written out yet. */
+    bool chunkPending GUARDED_BY(cs) = false;
+    /** The connection went away. */
+    bool closed GUARDED_BY(cs) = false;
+
+    void SetChunkWritten() {
+        WITH_LOCK(cs, chunkPending = false);
+        cond.notify_all();
+    }
+    void SetClosed() {
+        WITH_LOCK(cs, closed = true);
+        cond.notify_all();
+    }
+};
+
+static void http_chunk_written_cb(evhttp_connection *, void *arg) {
+    static_cast<HTTPChunkedReply *>(arg)->SetChunkWritten();
+}
+
+static void http_chunked_reply_close_cb(evhttp_connection *, void *arg) {
+    static_cast<HTTPChunkedReply *>(arg)->SetClosed();
+}
+
 HTTPRequest::HTTPRequest(struct evhttp_request *_req)
     : req(_req), replySent(false) {}
 HTTPRequest::~HTTPRequest() {
+    if (chunkedReply && !replySent) {
+        // A chunked reply was started but not finished (e.g. the worker threw
+        // halfway through). All we can do is end it.
+        EndChunkedReply();
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -670,18 +720,107 @@ void HTTPRequest::WriteReply(int nStatus, const std::string &strReply) {
     auto req_copy = req;
     HTTPEvent *ev = new HTTPEvent(eventBase, true, [req_copy, nStatus] {
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the
-        // libevent workaround above.
-        if (event_get_version_number() >= 0x02010600 &&
-            event_get_version_number() < 0x02010900) {
-            evhttp_connection *conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent *bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
+        EnableReadAfterReply(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    // transferred back to main thread.
+    req = nullptr;
+}
+
+void HTTPRequest::StartChunkedReply(int nStatus) {
+    assert(!replySent && req && !chunkedReply);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+
+    if (LogAcceptCategory(BCLog::HTTPTRACE)) {
+        const auto headersVec = GetAllOutputHeaders();
+        const std::string headers = Join(headersVec, "\n", [] (const auto &nvp) {
+            return strprintf("%s: %s", nvp.first, nvp.second);
+        });
+        LogPrintf("<httptrace> Starting chunked reply to %s, status: %d, headers: %u\n--- HEADERS ---\n%s\n",
+                  GetPeer().ToString(), nStatus, headersVec.size(), headers);
+    }
+
+    chunkedReply = std::make_shared<HTTPChunkedReply>();
+    auto req_copy = req;
+    auto state = chunkedReply;
+    HTTPEvent *ev = new HTTPEvent(eventBase, true, [req_copy, nStatus, state] {
+        evhttp_connection *conn = evhttp_request_get_connection(req_copy);
+        if (!conn) {
+            state->SetClosed();
+            return;
+        }
+        // Lets a worker waiting for a chunk to be written out know that it
+        // never will be. Unset again in EndChunkedReply().
+        evhttp_connection_set_closecb(conn, http_chunked_reply_close_cb, state.get());
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+}
+
+bool HTTPRequest::WriteReplyChunk(const std::string &chunk) {
+    assert(!replySent && req && chunkedReply);
+    if (chunk.empty()) {
+        // libevent would not call us back for an empty chunk.
+        return true;
+    }
+    auto state = chunkedReply;
+    {
+        WAIT_LOCK(state->cs, lock);
+        while (state->chunkPending && !state->closed) {
+            if (ShutdownRequested()) {
+                return false;
             }
+            state->cond.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        if (state->closed) {
+            return false;
+        }
+        state->chunkPending = true;
+    }
+
+    if (LogAcceptCategory(BCLog::HTTPTRACE)) {
+        LogPrintf("<httptrace> Writing reply chunk to %s, content: %u bytes\n--- CONTENT ---\n%s\n",
+                  GetPeer().ToString(), chunk.size(), chunk);
+    }
+
+    struct evbuffer *evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, chunk.data(), chunk.size());
+    auto req_copy = req;
+    HTTPEvent *ev = new HTTPEvent(eventBase, true, [req_copy, evb, state] {
+        if (!evhttp_request_get_connection(req_copy)) {
+            state->SetClosed();
+        } else {
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+            evhttp_send_reply_chunk_with_cb(req_copy, evb, http_chunk_written_cb, state.get());
+#else
+            // Without a callback there is no way to tell when the chunk was
+            // written out, so we do not wait for it.
+            evhttp_send_reply_chunk(req_copy, evb);
+            state->SetChunkWritten();
+#endif
+        }
+        evbuffer_free(evb);
+    });
+    ev->trigger(nullptr);
+    return true;
+}
+
+void HTTPRequest::EndChunkedReply() {
+    assert(!replySent && req && chunkedReply);
+    auto req_copy = req;
+    auto state = chunkedReply;
+    HTTPEvent *ev = new HTTPEvent(eventBase, true, [req_copy, state] {
+        if (evhttp_connection *conn = evhttp_request_get_connection(req_copy)) {
+            // state goes away with this closure.
+            evhttp_connection_set_closecb(conn, nullptr, nullptr);
         }
+        EnableReadAfterReply(req_copy);
+        // If the connection was closed, this frees the request.
+        evhttp_send_reply_end(req_copy);
     });
     ev->trigger(nullptr);
     replySent = true;
@@ -7,6 +7,7 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <utility>
@@ -22,6 +23,7 @@ struct event_base;
 class Config;
 class CService;
 class HTTPRequest;
+struct HTTPChunkedReply;
 
 /**
  * Initialize HTTP server.
@@ -77,6 +79,7 @@ struct event_base *EventBase();
 class HTTPRequest {
     struct evhttp_request *req;
     bool replySent;
+    std::shared_ptr<HTTPChunkedReply> chunkedReply;
 
 public:
     explicit HTTPRequest(struct evhttp_request *req);
@@ -145,6 +148,29 @@ public:
      */
     void WriteReply(int nStatus, const std::string &strReply = "");
 
+    /**
+     * Start a chunked HTTP reply, for a body which is sent piecewise with
+     * WriteReplyChunk() while it is being produced. The headers must have
+     * been written already. Finish with EndChunkedReply().
+     */
+    void StartChunkedReply(int nStatus);
+
+    /**
+     * Send the next piece of a chunked reply body. To bound the memory used
+     * for a slow client, this waits until the previous chunk has been
+     * written out to the connection. Empty chunks are ignored.
+     *
+     * @return false if the connection was closed or shutdown was requested,
+     * in which case the remainder of the reply should not be produced.
+     */
+    bool WriteReplyChunk(const std::string &chunk);
+
+    /**
+     * Finish a chunked reply. Like WriteReply(), this gives the request back
+     * to the main thread.
+     */
+    void EndChunkedReply();
+
 private:
     std::vector<NameValuePair> GetAllHeaders(bool input) const;
 };
@@ -10,13 +10,21 @@
 #include <tinyformat.h>
 #include <ui_interface.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <validation.h>
 #include <warnings.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 constexpr char DB_BEST_BLOCK = 'B';
 
 constexpr int64_t SYNC_LOG_INTERVAL = 30;           // seconds
 constexpr int64_t SYNC_LOCATOR_WRITE_INTERVAL = 30; // seconds
+//! Size of the batch of index entries above which the sync thread writes it
+constexpr size_t SYNC_BATCH_SIZE = 16 << 20;
 
 template <typename... Args>
 static void FatalError(const char *fmt, const Args &... args) {
@@ -60,6 +68,11 @@ bool BaseIndex::Init() {
     LOCK(cs_main);
     if (locator.IsNull()) {
         m_best_block_index = nullptr;
+    } else if (const CBlockIndex *pindex = LookupBlockIndex(locator.vHave.front());
+               pindex && pindex->nStatus.hasData()) {
+        // Start from the block the index was written up to, even if it has
+        // since been reorganized away from, so that ThreadSync rewinds it.
+        m_best_block_index = pindex;
     } else {
         m_best_block_index = FindForkInGlobalIndex(::ChainActive(), locator);
     }
@@ -67,6 +80,134 @@ bool BaseIndex::Init() {
     return true;
 }
 
+/**
+ * Reads blocks from disk and prepares them for an index on a pool of threads,
+ * handing them back in the order they were queued in.
+ */
+class BaseIndex::SyncPrefetcher {
+public:
+    struct Item {
+        const CBlockIndex *pindex;
+        CBlock block;
+        std::unique_ptr<PreparedBlock> prepared;
+        //! Empty on success
+        std::string error;
+        bool done = false;
+    };
+
+private:
+    const BaseIndex &m_index;
+    const Consensus::Params &m_params;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    //! All the items queued and not handed back yet, in order
+    std::deque<std::shared_ptr<Item>> m_items GUARDED_BY(m_mutex);
+    //! The items no thread has started on yet
+    std::deque<std::shared_ptr<Item>> m_jobs GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex) = false;
+    std::vector<std::thread> m_threads;
+
+    void Loop() {
+        while (true) {
+            std::shared_ptr<Item> item;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+                    return m_stop || !m_jobs.empty();
+                });
+                if (m_stop) {
+                    return;
+                }
+                item = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+
+            std::string error;
+            try {
+                if (!ReadBlockFromDisk(item->block, item->pindex, m_params)) {
+                    error = "Failed to read block from disk";
+                } else if (!m_index.PrepareBlock(item->block, item->pindex,
+                                                 item->prepared)) {
+                    error = "Failed to prepare block";
+                }
+            } catch (const std::exception &e) {
+                error = e.what();
+            }
+
+            {
+                LOCK(m_mutex);
+                item->error = std::move(error);
+                item->done = true;
+            }
+            m_cond.notify_all();
+        }
+    }
+
+public:
+    SyncPrefetcher(const BaseIndex &index, const Consensus::Params &params,
+                   int n_threads)
+        : m_index(index), m_params(params) {
+        for (int i = 0; i < n_threads; ++i) {
+            m_threads.emplace_back([this, name = std::string(index.GetName()), i]() {
+                util::ThreadRename(strprintf("idxsync.%d", i));
+                LogPrint(BCLog::BENCH, "%s: reader thread %d started\n", name, i);
+                Loop();
+            });
+        }
+    }
+
+    ~SyncPrefetcher() {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        for (std::thread &thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    size_t Size() {
+        LOCK(m_mutex);
+        return m_items.size();
+    }
+
+    /** Queue a block to be read and prepared. */
+    void Push(const CBlockIndex *pindex) {
+        auto item = std::make_shared<Item>();
+        item->pindex = pindex;
+        {
+            LOCK(m_mutex);
+            m_items.push_back(item);
+            m_jobs.push_back(std::move(item));
+        }
+        m_cond.notify_all();
+    }
+
+    /** Wait for the first block queued to be ready, and hand it back. */
+    std::shared_ptr<Item> Pop() {
+        WAIT_LOCK(m_mutex, lock);
+        assert(!m_items.empty());
+        m_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+            return m_items.front()->done;
+        });
+        std::shared_ptr<Item> item = std::move(m_items.front());
+        m_items.pop_front();
+        return item;
+    }
+};
+
+/** The number of threads reading blocks ahead for each index sync. */
+static int GetIndexSyncThreads() {
+    int n_threads =
+        gArgs.GetArg("-indexsyncthreads", DEFAULT_INDEX_SYNC_THREADS);
+    if (n_threads <= 0) {
+        n_threads = GetNumCores();
+    }
+    return std::clamp(n_threads, 1, MAX_INDEX_SYNC_THREADS);
+}
+
 static const CBlockIndex *NextSyncBlock(const CBlockIndex *pindex_prev)
     EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
     AssertLockHeld(cs_main);
@@ -88,10 +229,24 @@ void BaseIndex::ThreadSync() {
     if (!m_synced) {
         auto &consensus_params = GetConfig().GetChainParams().GetConsensus();
 
+        const int n_threads = GetIndexSyncThreads();
+        // Enough blocks in flight to keep every reader busy while the first
+        // ones wait to be written.
+        const size_t max_in_flight = 2 * n_threads;
+        SyncPrefetcher prefetcher(*this, consensus_params, n_threads);
+        // The last block queued, or pindex if none is in flight.
+        const CBlockIndex *pindex_queued = pindex;
+        CDBBatch batch(GetDB());
+
         int64_t last_log_time = 0;
         int64_t last_locator_write_time = 0;
         while (true) {
             if (m_interrupt) {
+                // Blocks still in flight are dropped, they will be read again
+                // on restart.
+                if (!WriteSyncBatch(batch)) {
+                    return;
+                }
                 m_best_block_index = pindex;
                 // No need to handle errors in Commit. If it fails, the error
                 // will be already be logged. The best way to recover is to
@@ -101,45 +256,95 @@ void BaseIndex::ThreadSync() {
                 return;
             }
 
+            const CBlockIndex *pindex_fork = nullptr;
+            int chain_height;
             {
                 LOCK(cs_main);
-                const CBlockIndex *pindex_next = NextSyncBlock(pindex);
-                if (!pindex_next) {
-                    m_best_block_index = pindex;
-                    m_synced = true;
-                    // No need to handle errors in Commit. See rationale above.
-                    Commit();
-                    break;
+                chain_height = ::ChainActive().Height();
+                if (prefetcher.Size() == 0 && pindex &&
+                    !::ChainActive().Contains(pindex)) {
+                    pindex_fork = ::ChainActive().FindFork(pindex);
+                } else {
+                    // Queue the blocks which follow the last one queued, as
+                    // long as that one is on the active chain. If it was
+                    // reorganized away from, the blocks in flight still extend
+                    // pindex: they get written, and rewound once all are.
+                    while (prefetcher.Size() < max_in_flight &&
+                           (!pindex_queued ||
+                            ::ChainActive().Contains(pindex_queued))) {
+                        const CBlockIndex *pindex_next =
+                            NextSyncBlock(pindex_queued);
+                        if (!pindex_next) {
+                            break;
+                        }
+                        prefetcher.Push(pindex_next);
+                        pindex_queued = pindex_next;
+                    }
+                    if (prefetcher.Size() == 0) {
+                        if (!WriteSyncBatch(batch)) {
+                            return;
+                        }
+                        m_best_block_index = pindex;
+                        m_synced = true;
+                        // No need to handle errors in Commit. See rationale
+                        // above.
+                        Commit();
+                        break;
+                    }
                 }
-                pindex = pindex_next;
+            }
+            if (pindex_fork) {
+                // The index is on a stale branch, take its blocks out before
+                // following the active chain.
+                if (!WriteSyncBatch(batch)) {
+                    return;
+                }
+                if (!Rewind(pindex, pindex_fork)) {
+                    FatalError("%s: Failed to rewind %s to block %s", __func__,
+                               GetName(), pindex_fork->GetBlockHash().ToString());
+                    return;
+                }
+                pindex = pindex_queued = pindex_fork;
+                continue;
+            }
+
+            const std::shared_ptr<SyncPrefetcher::Item> item = prefetcher.Pop();
+            if (!item->error.empty()) {
+                FatalError("%s: Failed to read block %s for %s: %s", __func__,
+                           item->pindex->GetBlockHash().ToString(), GetName(),
+                           item->error);
+                return;
+            }
+            if (!WritePreparedBlock(item->block, item->pindex,
+                                    std::move(item->prepared), batch)) {
+                FatalError("%s: Failed to write block %s to index database",
+                           __func__, item->pindex->GetBlockHash().ToString());
+                return;
+            }
+            pindex = item->pindex;
+            if (batch.SizeEstimate() > SYNC_BATCH_SIZE &&
+                !WriteSyncBatch(batch)) {
+                return;
             }
 
             int64_t current_time = GetTime();
             if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
-                LogPrintf("Syncing %s with block chain from height %d\n",
-                          GetName(), pindex->nHeight);
+                LogPrintf("Syncing %s with block chain at height %d of %d "
+                          "(%d reader threads)\n",
+                          GetName(), pindex->nHeight, chain_height, n_threads);
                 last_log_time = current_time;
             }
 
             if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL <
                 current_time) {
+                if (!WriteSyncBatch(batch)) {
+                    return;
+                }
                 m_best_block_index = pindex;
                 last_locator_write_time = current_time;
                 // No need to handle errors in Commit. See rationale above.
                 Commit();
             }
-
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-                FatalError("%s: Failed to read block %s from disk", __func__,
-                           pindex->GetBlockHash().ToString());
-                return;
-            }
-            if (!WriteBlock(block, pindex)) {
-                FatalError("%s: Failed to write block %s to index database",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
-            }
         }
     }
 
@@ -150,6 +355,41 @@ void BaseIndex::ThreadSync() {
     }
 }
 
+bool BaseIndex::WriteSyncBatch(CDBBatch &batch) {
+    if (batch.SizeEstimate() == 0) {
+        return true;
+    }
+    if (!GetDB().WriteBatch(batch)) {
+        FatalError("%s: Failed to write batch to %s database", __func__,
+                   GetName());
+        return false;
+    }
+    batch.Clear();
+    return true;
+}
+
+bool BaseIndex::Rewind(const CBlockIndex *current_tip,
+                       const CBlockIndex *new_tip) {
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+    const auto &consensus_params = GetConfig().GetChainParams().GetConsensus();
+    for (const CBlockIndex *pindex = current_tip; pindex != new_tip;
+         pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            return error("%s: Failed to read block %s from disk", __func__,
+                         pindex->GetBlockHash().ToString());
+        }
+        if (!DisconnectBlock(block, pindex)) {
+            return error("%s: Failed to disconnect block %s from %s", __func__,
+                         pindex->GetBlockHash().ToString(), GetName());
+        }
+    }
+    m_best_block_index = new_tip;
+    // The index must not be left pointing at the disconnected blocks, see
+    // the comment on Commit().
+    return Commit();
+}
+
 bool BaseIndex::Commit() {
     CDBBatch batch(GetDB());
     if (!CommitInternal(batch) || !GetDB().WriteBatch(batch)) {
@@ -199,7 +439,11 @@ void BaseIndex::BlockConnected(
         }
     }
 
-    if (WriteBlock(*block, pindex)) {
+    std::unique_ptr<PreparedBlock> prepared;
+    CDBBatch batch(GetDB());
+    if (PrepareBlock(*block, pindex, prepared) &&
+        WritePreparedBlock(*block, pindex, std::move(prepared), batch) &&
+        GetDB().WriteBatch(batch)) {
         m_best_block_index = pindex;
     } else {
         FatalError("%s: Failed to write block %s to index", __func__,
@@ -208,6 +452,32 @@ void BaseIndex::BlockConnected(
     }
 }
 
+void BaseIndex::BlockDisconnected(const std::shared_ptr<const CBlock> &block) {
+    if (!m_synced) {
+        return;
+    }
+
+    const CBlockIndex *pindex =
+        WITH_LOCK(cs_main, return LookupBlockIndex(block->GetHash()));
+    const CBlockIndex *best_block_index = m_best_block_index.load();
+    if (!pindex || pindex != best_block_index) {
+        // As in BlockConnected, this may happen for blocks in the
+        // ValidationInterface queue backlog right after the sync thread caught
+        // up, which it will already have rewound.
+        LogPrintf("%s: WARNING: Block %s is not the best block of %s; not "
+                  "updating index\n",
+                  __func__, block->GetHash().ToString(), GetName());
+        return;
+    }
+
+    if (!DisconnectBlock(*block, pindex)) {
+        FatalError("%s: Failed to disconnect block %s from index", __func__,
+                   pindex->GetBlockHash().ToString());
+        return;
+    }
+    m_best_block_index = pindex->pprev;
+}
+
 void BaseIndex::ChainStateFlushed(const CBlockLocator &locator) {
     if (!m_synced) {
         return;
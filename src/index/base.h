@@ -11,8 +11,15 @@
 #include <uint256.h>
 #include <validationinterface.h>
 
+#include <memory>
+
 class CBlockIndex;
 
+/** Default for -indexsyncthreads, 0 = as many as there are cores */
+static constexpr int DEFAULT_INDEX_SYNC_THREADS = 0;
+/** Maximum number of threads reading blocks ahead for each index sync */
+static constexpr int MAX_INDEX_SYNC_THREADS = 16;
+
 /**
  * Base class for indices of blockchain data. This implements
  * CValidationInterface and ensures blocks are indexed sequentially according
@@ -32,7 +39,16 @@ protected:
         void WriteBestBlock(CDBBatch &batch, const CBlockLocator &locator);
     };
 
+    /// What an index computes for a block ahead of writing it, see
+    /// PrepareBlock().
+    class PreparedBlock {
+    public:
+        virtual ~PreparedBlock() {}
+    };
+
 private:
+    class SyncPrefetcher;
+
     /// Whether the index is in sync with the main chain. The flag is flipped
     /// from false to true once, after which point this starts processing
     /// ValidationInterface notifications to stay in sync.
@@ -44,13 +60,22 @@ private:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    /// Undo the index entries of the blocks from current_tip back to (but not
+    /// including) new_tip, an ancestor of it, reading them from disk.
+    bool Rewind(const CBlockIndex *current_tip, const CBlockIndex *new_tip);
+
     /// Sync the index with the block index starting from the current best
     /// block. Intended to be run in its own thread, m_thread_sync, and can be
-    /// interrupted with m_interrupt. Once the index gets in sync, the m_synced
-    /// flag is set and the BlockConnected ValidationInterface callback takes
-    /// over and the sync thread exits.
+    /// interrupted with m_interrupt. Blocks are read and prepared ahead by a
+    /// SyncPrefetcher, and written in order by this thread. Once the index gets
+    /// in sync, the m_synced flag is set and the BlockConnected
+    /// ValidationInterface callback takes over and the sync thread exits.
     void ThreadSync();
 
+    /// Write the entries batched by WritePreparedBlock to the database, which
+    /// must happen before the locator covering them is committed.
+    bool WriteSyncBatch(CDBBatch &batch);
+
     /// Write the current index state (eg. chain block locator and
     /// subclass-specific items) to disk.
     ///
@@ -69,6 +94,8 @@ protected:
                    const CBlockIndex *pindex,
                    const std::vector<CTransactionRef> &txn_conflicted) override;
 
+    void BlockDisconnected(const std::shared_ptr<const CBlock> &block) override;
+
     void ChainStateFlushed(const CBlockLocator &locator) override;
 
     /// Initialize internal state from the database and block index.
@@ -79,6 +106,35 @@ protected:
         return true;
     }
 
+    /// Compute the part of the index entries of a block which does not depend
+    /// on the blocks before it, such as its undo data. While catching up, the
+    /// sync thread has this done on a pool of threads for the blocks ahead of
+    /// the one it writes. May leave prepared null.
+    virtual bool PrepareBlock(const CBlock &block, const CBlockIndex *pindex,
+                              std::unique_ptr<PreparedBlock> &prepared) const {
+        return true;
+    }
+
+    /// Write the index entries of a block, given what PrepareBlock() computed
+    /// for it. Blocks are written in chain order. Entries may be added to
+    /// batch, which the sync thread fills with several blocks before writing
+    /// it, so indices which read back the entries of earlier blocks must write
+    /// them to the database directly, as WriteBlock does by default.
+    virtual bool WritePreparedBlock(const CBlock &block,
+                                    const CBlockIndex *pindex,
+                                    std::unique_ptr<PreparedBlock> prepared,
+                                    CDBBatch &batch) {
+        return WriteBlock(block, pindex);
+    }
+
+    /// Undo the index entries of a block being disconnected from the best
+    /// chain. Indices whose entries are only ever added, and remain correct for
+    /// a block on a stale branch (such as the txindex), need not override this.
+    virtual bool DisconnectBlock(const CBlock &block,
+                                 const CBlockIndex *pindex) {
+        return true;
+    }
+
     /// Virtual method called internally by Commit that can be overridden to
     /// atomically commit more index state.
     virtual bool CommitInternal(CDBBatch &batch);
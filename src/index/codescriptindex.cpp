@@ -0,0 +1,188 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/codescriptindex.h>
+
+#include <chain.h>
+#include <script/script.h>
+#include <script/script_execution_context.h>
+#include <serialize.h>
+#include <util/system.h>
+
+#include <map>
+#include <utility>
+
+constexpr uint8_t DB_CODESCRIPT = 'c';
+constexpr uint8_t DB_OUTPUT = 'o';
+constexpr uint8_t DB_BLOCK_UNDO = 'U';
+
+std::unique_ptr<CodeScriptIndex> g_codescriptindex;
+
+namespace {
+
+/**
+ * Key of an unspent output with a given codeScriptHash, with the output index
+ * big-endian so that the outputs of a transaction are in order.
+ */
+struct CodeScriptKey {
+    uint256 codeScriptHash;
+    TxId txid;
+    uint32_t n;
+
+    SERIALIZE_METHODS(CodeScriptKey, obj) {
+        uint8_t prefix = DB_CODESCRIPT;
+        READWRITE(prefix, obj.codeScriptHash, obj.txid, Using<BigEndianFormatter<4>>(obj.n));
+        SER_READ(obj, if (prefix != DB_CODESCRIPT) throw std::ios_base::failure("wrong key prefix"));
+    }
+};
+
+struct CodeScriptValue {
+    Amount value;
+    uint32_t height;
+
+    SERIALIZE_METHODS(CodeScriptValue, obj) { READWRITE(obj.value, VARINT(obj.height)); }
+};
+
+/** An indexed output, keyed by outpoint (so that its spender can find it) or in the undo data of a block. */
+struct IndexedOutput {
+    uint256 codeScriptHash;
+    CodeScriptValue value;
+
+    SERIALIZE_METHODS(IndexedOutput, obj) { READWRITE(obj.codeScriptHash, obj.value); }
+};
+
+/** Get the codeScriptHash of a contract output, returning false for other outputs. */
+bool GetContractCodeScriptHash(const CScript &script, uint256 &codeScriptHash) {
+    std::vector<uint288> pushRefs, requireRefs, disallowedSiblingsRefs, singletonRefs;
+    uint32_t stateSeparatorByteIndex;
+    if (!script.GetPushRefs(pushRefs, requireRefs, disallowedSiblingsRefs, singletonRefs, stateSeparatorByteIndex)) {
+        return false;
+    }
+    if (stateSeparatorByteIndex == 0 && pushRefs.empty() && requireRefs.empty() && disallowedSiblingsRefs.empty() &&
+        singletonRefs.empty()) {
+        return false;
+    }
+    codeScriptHash = RefScriptsSummary::codeScriptHash(script, stateSeparatorByteIndex);
+    return true;
+}
+
+} // namespace
+
+/**
+ * Access to the codescriptindex database (indexes/codescriptindex/)
+ *
+ * Besides the unspent outputs by codeScriptHash, and the codeScriptHash of
+ * each by outpoint, this stores, for each block, the indexed outputs it
+ * spent, so that they can be restored when the block is disconnected.
+ */
+class CodeScriptIndex::DB : public BaseIndex::DB {
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false,
+                bool f_wipe = false);
+};
+
+CodeScriptIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex::DB(GetDataDir() / "indexes" / "codescriptindex", n_cache_size,
+                    f_memory, f_wipe) {}
+
+CodeScriptIndex::CodeScriptIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(std::make_unique<CodeScriptIndex::DB>(n_cache_size, f_memory, f_wipe)) {}
+
+CodeScriptIndex::~CodeScriptIndex() {}
+
+static void WriteOutput(CDBBatch &batch, const COutPoint &outpoint, const IndexedOutput &output) {
+    batch.Write(CodeScriptKey{output.codeScriptHash, outpoint.GetTxId(), outpoint.GetN()}, output.value);
+    batch.Write(std::make_pair(DB_OUTPUT, outpoint), output);
+}
+
+static void EraseOutput(CDBBatch &batch, const COutPoint &outpoint, const IndexedOutput &output) {
+    batch.Erase(CodeScriptKey{output.codeScriptHash, outpoint.GetTxId(), outpoint.GetN()});
+    batch.Erase(std::make_pair(DB_OUTPUT, outpoint));
+}
+
+bool CodeScriptIndex::WriteBlock(const CBlock &block, const CBlockIndex *pindex) {
+    const uint32_t height = pindex->nHeight;
+    CDBBatch batch(*m_db);
+    // Outputs created by this block; those which the block also spends never
+    // make it to the database.
+    std::map<COutPoint, IndexedOutput> created;
+    std::vector<std::pair<COutPoint, IndexedOutput>> spent;
+    for (const auto &tx : block.vtx) {
+        if (!tx->IsCoinBase()) {
+            for (const CTxIn &txin : tx->vin) {
+                if (created.erase(txin.prevout)) {
+                    continue;
+                }
+                IndexedOutput output;
+                if (m_db->Read(std::make_pair(DB_OUTPUT, txin.prevout), output)) {
+                    EraseOutput(batch, txin.prevout, output);
+                    spent.emplace_back(txin.prevout, std::move(output));
+                }
+            }
+        }
+        for (uint32_t n = 0; n < tx->vout.size(); ++n) {
+            const CTxOut &txout = tx->vout[n];
+            IndexedOutput output{uint256(), {txout.nValue, height}};
+            if (GetContractCodeScriptHash(txout.scriptPubKey, output.codeScriptHash)) {
+                created.emplace(COutPoint(tx->GetId(), n), std::move(output));
+            }
+        }
+    }
+    for (const auto &[outpoint, output] : created) {
+        WriteOutput(batch, outpoint, output);
+    }
+    if (!spent.empty()) {
+        batch.Write(std::make_pair(DB_BLOCK_UNDO, pindex->GetBlockHash()), spent);
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool CodeScriptIndex::DisconnectBlock(const CBlock &block, const CBlockIndex *pindex) {
+    CDBBatch batch(*m_db);
+    for (const auto &tx : block.vtx) {
+        for (uint32_t n = 0; n < tx->vout.size(); ++n) {
+            const COutPoint outpoint(tx->GetId(), n);
+            IndexedOutput output;
+            if (m_db->Read(std::make_pair(DB_OUTPUT, outpoint), output)) {
+                EraseOutput(batch, outpoint, output);
+            }
+        }
+    }
+    const auto undoKey = std::make_pair(DB_BLOCK_UNDO, pindex->GetBlockHash());
+    std::vector<std::pair<COutPoint, IndexedOutput>> spent;
+    if (m_db->Read(undoKey, spent)) {
+        for (const auto &[outpoint, output] : spent) {
+            WriteOutput(batch, outpoint, output);
+        }
+        batch.Erase(undoKey);
+    }
+    return m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB &CodeScriptIndex::GetDB() const {
+    return *m_db;
+}
+
+bool CodeScriptIndex::FindOutputs(const uint256 &codeScriptHash, const std::optional<COutPoint> &start, size_t limit,
+                                  std::vector<CodeScriptIndexEntry> &entries) const {
+    CodeScriptKey key{codeScriptHash, start ? start->GetTxId() : TxId(), start ? start->GetN() : 0};
+    std::unique_ptr<CDBIterator> it(m_db->NewIterator());
+    size_t found = 0;
+    for (it->Seek(key); it->Valid() && found < limit; it->Next()) {
+        if (!it->GetKey(key) || key.codeScriptHash != codeScriptHash) {
+            break;
+        }
+        const COutPoint outpoint(key.txid, key.n);
+        if (start && outpoint == *start) {
+            continue;
+        }
+        CodeScriptValue value;
+        if (!it->GetValue(value)) {
+            return error("%s: cannot parse codescriptindex record", __func__);
+        }
+        entries.push_back({outpoint, value.value, int(value.height)});
+        ++found;
+    }
+    return true;
+}
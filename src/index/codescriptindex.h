@@ -0,0 +1,75 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <amount.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+/** An unspent output, as returned by CodeScriptIndex::FindOutputs(). */
+struct CodeScriptIndexEntry {
+    COutPoint outpoint;
+    Amount value = Amount::zero();
+    /** Height of the block which created the output. */
+    int height = -1;
+};
+
+/**
+ * CodeScriptIndex maps codeScriptHashes (the hash of the part of an output
+ * script after its OP_STATESEPARATOR, see RefScriptsSummary::codeScriptHash)
+ * to the unspent outputs with that code, so that all the live instances of a
+ * contract can be listed without scanning the UTXO set.
+ *
+ * Only contract outputs, i.e. those whose script has an OP_STATESEPARATOR or
+ * carries refs, are indexed. The index is written to a LevelDB database,
+ * together with undo data for the outputs each block spent, so that it
+ * follows reorgs.
+ */
+class CodeScriptIndex final : public BaseIndex {
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock &block, const CBlockIndex *pindex) override;
+
+    bool DisconnectBlock(const CBlock &block,
+                         const CBlockIndex *pindex) override;
+
+    BaseIndex::DB &GetDB() const override;
+
+    const char *GetName() const override { return "codescriptindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit CodeScriptIndex(size_t n_cache_size, bool f_memory = false,
+                             bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an
+    // incomplete type.
+    virtual ~CodeScriptIndex() override;
+
+    /// Look up the unspent outputs with the given codeScriptHash, ordered by
+    /// outpoint.
+    ///
+    /// @param[in]   codeScriptHash  The hash, as computed by consensus.
+    /// @param[in]   start  If set, only return outputs after this one.
+    /// @param[in]   limit  The maximum number of outputs to return.
+    /// @param[out]  entries  The outputs found.
+    /// @return  false if the database could not be read.
+    bool FindOutputs(const uint256 &codeScriptHash,
+                     const std::optional<COutPoint> &start, size_t limit,
+                     std::vector<CodeScriptIndexEntry> &entries) const;
+};
+
+/// The global codescript index. May be null.
+extern std::unique_ptr<CodeScriptIndex> g_codescriptindex;
@@ -0,0 +1,268 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/refindex.h>
+
+#include <chain.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+constexpr uint8_t DB_REF_HISTORY = 'h';
+constexpr uint8_t DB_REF_UNSPENT = 'u';
+constexpr uint8_t DB_REF_OUTPUT = 'o';
+
+std::unique_ptr<RefIndex> g_refindex;
+
+namespace {
+
+/**
+ * Key of the entry of a ref output: the ref followed by the output's height
+ * and outpoint, big-endian so that the entries of a ref are in the order they
+ * were confirmed.
+ */
+struct RefHistoryKey {
+    uint288 ref;
+    uint32_t height;
+    TxId txid;
+    uint32_t n;
+
+    SERIALIZE_METHODS(RefHistoryKey, obj) {
+        uint8_t prefix = DB_REF_HISTORY;
+        READWRITE(prefix, obj.ref, Using<BigEndianFormatter<4>>(obj.height),
+                  obj.txid, Using<BigEndianFormatter<4>>(obj.n));
+        SER_READ(obj, if (prefix != DB_REF_HISTORY) throw std::ios_base::failure("wrong key prefix"));
+    }
+};
+
+struct RefHistoryValue {
+    uint8_t types;
+    Amount value;
+    TxId spentTxId;
+    uint32_t spentHeight;
+
+    SERIALIZE_METHODS(RefHistoryValue, obj) {
+        READWRITE(obj.types, obj.value, obj.spentTxId, VARINT(obj.spentHeight));
+    }
+};
+
+/** Key of the unspent outputs of a ref, whose values are RefUnspentValue. */
+struct RefUnspentKey {
+    uint288 ref;
+    TxId txid;
+    uint32_t n;
+
+    SERIALIZE_METHODS(RefUnspentKey, obj) {
+        uint8_t prefix = DB_REF_UNSPENT;
+        READWRITE(prefix, obj.ref, obj.txid, Using<BigEndianFormatter<4>>(obj.n));
+        SER_READ(obj, if (prefix != DB_REF_UNSPENT) throw std::ios_base::failure("wrong key prefix"));
+    }
+};
+
+struct RefUnspentValue {
+    uint8_t types;
+    Amount value;
+    uint32_t height;
+
+    SERIALIZE_METHODS(RefUnspentValue, obj) {
+        READWRITE(obj.types, obj.value, VARINT(obj.height));
+    }
+};
+
+/**
+ * The refs of an output, keyed by its outpoint, so that the inputs spending
+ * it can be matched to its entries.
+ */
+struct RefOutput {
+    uint32_t height;
+    Amount value;
+    std::vector<std::pair<uint288, uint8_t>> refs;
+
+    SERIALIZE_METHODS(RefOutput, obj) {
+        READWRITE(VARINT(obj.height), obj.value, obj.refs);
+    }
+};
+
+/** Collect the refs of an output script with their RefType flags. */
+bool GetOutputRefs(const CScript &script, std::vector<std::pair<uint288, uint8_t>> &refs) {
+    std::vector<uint288> typed[4];
+    uint32_t stateSeparatorByteIndex;
+    if (!script.GetPushRefs(typed[0], typed[1], typed[2], typed[3], stateSeparatorByteIndex)) {
+        return false;
+    }
+    std::map<uint288, uint8_t> merged;
+    for (int i = 0; i < 4; ++i) {
+        for (const uint288 &ref : typed[i]) {
+            merged[ref] |= uint8_t(1 << i);
+        }
+    }
+    refs.assign(merged.begin(), merged.end());
+    return true;
+}
+
+} // namespace
+
+/**
+ * Access to the refindex database (indexes/refindex/)
+ *
+ * For every output carrying refs, this stores:
+ * - an entry per ref, in the ref's history, updated when the output is spent,
+ * - an entry per ref, in the ref's unspent set, erased when it is spent,
+ * - its refs, keyed by outpoint.
+ */
+class RefIndex::DB : public BaseIndex::DB {
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false,
+                bool f_wipe = false);
+
+    bool ReadOutput(const COutPoint &outpoint, RefOutput &output) const {
+        return Read(std::make_pair(DB_REF_OUTPUT, outpoint), output);
+    }
+};
+
+RefIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex::DB(GetDataDir() / "indexes" / "refindex", n_cache_size,
+                    f_memory, f_wipe) {}
+
+RefIndex::RefIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(std::make_unique<RefIndex::DB>(n_cache_size, f_memory, f_wipe)) {}
+
+RefIndex::~RefIndex() {}
+
+/** Write the entries of an output, spent by spentTxId at spentHeight if that is not null. */
+static void WriteRefOutput(CDBBatch &batch, const COutPoint &outpoint, const RefOutput &output,
+                           const TxId &spentTxId, uint32_t spentHeight) {
+    for (const auto &[ref, types] : output.refs) {
+        batch.Write(RefHistoryKey{ref, output.height, outpoint.GetTxId(), outpoint.GetN()},
+                    RefHistoryValue{types, output.value, spentTxId, spentHeight});
+        const RefUnspentKey unspentKey{ref, outpoint.GetTxId(), outpoint.GetN()};
+        if (spentTxId.IsNull()) {
+            batch.Write(unspentKey, RefUnspentValue{types, output.value, output.height});
+        } else {
+            batch.Erase(unspentKey);
+        }
+    }
+}
+
+bool RefIndex::WriteBlock(const CBlock &block, const CBlockIndex *pindex) {
+    const uint32_t height = pindex->nHeight;
+    CDBBatch batch(*m_db);
+    // Outputs created by this block, which are not in the database yet when
+    // spent by a later transaction of the block.
+    std::map<COutPoint, RefOutput> created;
+    for (const auto &tx : block.vtx) {
+        if (!tx->IsCoinBase()) {
+            for (const CTxIn &txin : tx->vin) {
+                RefOutput output;
+                if (auto it = created.find(txin.prevout); it != created.end()) {
+                    output = std::move(it->second);
+                    created.erase(it);
+                } else if (!m_db->ReadOutput(txin.prevout, output)) {
+                    continue;
+                }
+                WriteRefOutput(batch, txin.prevout, output, tx->GetId(), height);
+            }
+        }
+        for (uint32_t n = 0; n < tx->vout.size(); ++n) {
+            const CTxOut &txout = tx->vout[n];
+            RefOutput output{height, txout.nValue, {}};
+            if (!GetOutputRefs(txout.scriptPubKey, output.refs) || output.refs.empty()) {
+                continue;
+            }
+            const COutPoint outpoint(tx->GetId(), n);
+            batch.Write(std::make_pair(DB_REF_OUTPUT, outpoint), output);
+            created.emplace(outpoint, std::move(output));
+        }
+    }
+    for (const auto &[outpoint, output] : created) {
+        WriteRefOutput(batch, outpoint, output, TxId(), 0);
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool RefIndex::DisconnectBlock(const CBlock &block, const CBlockIndex *pindex) {
+    CDBBatch batch(*m_db);
+    // Mark everything the block spent as unspent again, then erase what it
+    // created (including anything it created and spent).
+    for (const auto &tx : block.vtx) {
+        if (tx->IsCoinBase()) {
+            continue;
+        }
+        for (const CTxIn &txin : tx->vin) {
+            RefOutput output;
+            if (m_db->ReadOutput(txin.prevout, output)) {
+                WriteRefOutput(batch, txin.prevout, output, TxId(), 0);
+            }
+        }
+    }
+    for (const auto &tx : block.vtx) {
+        for (uint32_t n = 0; n < tx->vout.size(); ++n) {
+            const COutPoint outpoint(tx->GetId(), n);
+            RefOutput output;
+            if (!m_db->ReadOutput(outpoint, output)) {
+                continue;
+            }
+            for (const auto &ref : output.refs) {
+                batch.Erase(RefHistoryKey{ref.first, output.height, outpoint.GetTxId(), outpoint.GetN()});
+                batch.Erase(RefUnspentKey{ref.first, outpoint.GetTxId(), outpoint.GetN()});
+            }
+            batch.Erase(std::make_pair(DB_REF_OUTPUT, outpoint));
+        }
+    }
+    return m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB &RefIndex::GetDB() const {
+    return *m_db;
+}
+
+bool RefIndex::FindRefOutputs(const uint288 &ref, bool include_spent,
+                              std::vector<RefIndexEntry> &entries) const {
+    std::unique_ptr<CDBIterator> it(m_db->NewIterator());
+    if (include_spent) {
+        RefHistoryKey key{ref, 0, TxId(), 0};
+        for (it->Seek(key); it->Valid(); it->Next()) {
+            RefHistoryValue value;
+            if (!it->GetKey(key) || key.ref != ref) {
+                break;
+            }
+            if (!it->GetValue(value)) {
+                return error("%s: cannot parse refindex record", __func__);
+            }
+            RefIndexEntry &entry = entries.emplace_back();
+            entry.outpoint = COutPoint(key.txid, key.n);
+            entry.height = key.height;
+            entry.value = value.value;
+            entry.types = value.types;
+            entry.spentTxId = value.spentTxId;
+            entry.spentHeight = entry.IsSpent() ? int(value.spentHeight) : -1;
+        }
+        return true;
+    }
+
+    RefUnspentKey key{ref, TxId(), 0};
+    const size_t first = entries.size();
+    for (it->Seek(key); it->Valid(); it->Next()) {
+        RefUnspentValue value;
+        if (!it->GetKey(key) || key.ref != ref) {
+            break;
+        }
+        if (!it->GetValue(value)) {
+            return error("%s: cannot parse refindex record", __func__);
+        }
+        RefIndexEntry &entry = entries.emplace_back();
+        entry.outpoint = COutPoint(key.txid, key.n);
+        entry.height = value.height;
+        entry.value = value.value;
+        entry.types = value.types;
+    }
+    std::stable_sort(entries.begin() + first, entries.end(), [](const RefIndexEntry &a, const RefIndexEntry &b) {
+        return a.height < b.height;
+    });
+    return true;
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <amount.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/** The ways in which an output script may carry a ref. */
+enum RefType : uint8_t {
+    REF_PUSH = 1 << 0,
+    REF_REQUIRE = 1 << 1,
+    REF_DISALLOWED_SIBLING = 1 << 2,
+    REF_SINGLETON = 1 << 3,
+};
+
+/** An output carrying a ref, as returned by RefIndex::FindRefOutputs(). */
+struct RefIndexEntry {
+    COutPoint outpoint;
+    /** Height of the block which created the output. */
+    int height = -1;
+    Amount value = Amount::zero();
+    /** The RefType flags of the ref in the output script. */
+    uint8_t types = 0;
+    /** The transaction spending the output, or null if it is unspent. */
+    TxId spentTxId;
+    int spentHeight = -1;
+
+    bool IsSpent() const { return !spentTxId.IsNull(); }
+};
+
+/**
+ * RefIndex maps the refs carried by output scripts (OP_PUSHINPUTREF,
+ * OP_REQUIREINPUTREF, OP_DISALLOWPUSHINPUTREFSIBLING and
+ * OP_PUSHINPUTREFSINGLETON, as found by CScript::GetPushRefs) to the outputs
+ * carrying them and, once spent, the transactions spending them. It is
+ * written to a LevelDB database, and is kept in step with reorgs.
+ */
+class RefIndex final : public BaseIndex {
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool WriteBlock(const CBlock &block, const CBlockIndex *pindex) override;
+
+    bool DisconnectBlock(const CBlock &block,
+                         const CBlockIndex *pindex) override;
+
+    BaseIndex::DB &GetDB() const override;
+
+    const char *GetName() const override { return "refindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit RefIndex(size_t n_cache_size, bool f_memory = false,
+                      bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an
+    // incomplete type.
+    virtual ~RefIndex() override;
+
+    /// Look up the outputs carrying a ref, in the order in which they were
+    /// confirmed.
+    ///
+    /// @param[in]   ref  The ref, as it appears in the output scripts.
+    /// @param[in]   include_spent  Whether to also return spent outputs.
+    /// @param[out]  entries  The outputs found.
+    /// @return  false if the database could not be read.
+    bool FindRefOutputs(const uint288 &ref, bool include_spent,
+                        std::vector<RefIndexEntry> &entries) const;
+};
+
+/// The global ref index. May be null.
+extern std::unique_ptr<RefIndex> g_refindex;
@@ -0,0 +1,228 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/scripthashindex.h>
+
+#include <chain.h>
+#include <crypto/sha256.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+constexpr uint8_t DB_HISTORY = 'h';
+constexpr uint8_t DB_UNSPENT = 'u';
+
+std::unique_ptr<ScriptHashIndex> g_scripthashindex;
+
+namespace {
+
+/**
+ * Key of a transaction in the history of a script, with the height
+ * big-endian so that the history is in the order it was confirmed.
+ */
+struct HistoryKey {
+    uint256 scripthash;
+    uint32_t height;
+    TxId txid;
+
+    SERIALIZE_METHODS(HistoryKey, obj) {
+        uint8_t prefix = DB_HISTORY;
+        READWRITE(prefix, obj.scripthash, Using<BigEndianFormatter<4>>(obj.height), obj.txid);
+        SER_READ(obj, if (prefix != DB_HISTORY) throw std::ios_base::failure("wrong key prefix"));
+    }
+};
+
+struct UnspentKey {
+    uint256 scripthash;
+    TxId txid;
+    uint32_t n;
+
+    SERIALIZE_METHODS(UnspentKey, obj) {
+        uint8_t prefix = DB_UNSPENT;
+        READWRITE(prefix, obj.scripthash, obj.txid, Using<BigEndianFormatter<4>>(obj.n));
+        SER_READ(obj, if (prefix != DB_UNSPENT) throw std::ios_base::failure("wrong key prefix"));
+    }
+};
+
+struct UnspentValue {
+    Amount value;
+    uint32_t height;
+
+    SERIALIZE_METHODS(UnspentValue, obj) { READWRITE(obj.value, VARINT(obj.height)); }
+};
+
+/** An empty value, for keys which carry all the information. */
+struct Empty {
+    SERIALIZE_METHODS(Empty, obj) {}
+};
+
+} // namespace
+
+/**
+ * Access to the scripthashindex database (indexes/scripthashindex/)
+ */
+class ScriptHashIndex::DB : public BaseIndex::DB {
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false,
+                bool f_wipe = false);
+};
+
+ScriptHashIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex::DB(GetDataDir() / "indexes" / "scripthashindex", n_cache_size,
+                    f_memory, f_wipe) {}
+
+ScriptHashIndex::ScriptHashIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(std::make_unique<ScriptHashIndex::DB>(n_cache_size, f_memory, f_wipe)) {}
+
+ScriptHashIndex::~ScriptHashIndex() {}
+
+uint256 ScriptHashIndex::GetScriptHash(const CScript &script) {
+    uint256 scripthash;
+    CSHA256().Write(script.data(), script.size()).Finalize(scripthash.begin());
+    return scripthash;
+}
+
+/** Read the undo data of a block, which holds the coins spent by each of its transactions but the coinbase. */
+static bool ReadBlockUndo(const CBlock &block, const CBlockIndex *pindex, CBlockUndo &blockundo) {
+    if (pindex->nHeight == 0) {
+        return true;
+    }
+    if (!UndoReadFromDisk(blockundo, pindex)) {
+        return false;
+    }
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size()) {
+        return error("%s: undo data of block %s does not match the block", __func__,
+                     pindex->GetBlockHash().ToString());
+    }
+    return true;
+}
+
+/** The undo data of a block, read ahead of writing it. */
+class ScriptHashIndex::PreparedUndo : public BaseIndex::PreparedBlock {
+public:
+    CBlockUndo blockundo;
+};
+
+bool ScriptHashIndex::PrepareBlock(const CBlock &block, const CBlockIndex *pindex,
+                                   std::unique_ptr<PreparedBlock> &prepared) const {
+    auto prepared_undo = std::make_unique<PreparedUndo>();
+    if (!ReadBlockUndo(block, pindex, prepared_undo->blockundo)) {
+        return false;
+    }
+    prepared = std::move(prepared_undo);
+    return true;
+}
+
+bool ScriptHashIndex::WritePreparedBlock(const CBlock &block, const CBlockIndex *pindex,
+                                         std::unique_ptr<PreparedBlock> prepared, CDBBatch &batch) {
+    const CBlockUndo &blockundo = static_cast<const PreparedUndo &>(*prepared).blockundo;
+    const uint32_t height = pindex->nHeight;
+    // Nothing is read back from the database, so the entries may be batched
+    // with those of the blocks before: the batch applies them in order.
+    // Outputs are written before the inputs of later transactions erase them,
+    // so outputs created and spent within the block end up erased.
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction &tx = *block.vtx[i];
+        if (i > 0) {
+            const CTxUndo &txundo = blockundo.vtxundo[i - 1];
+            for (size_t j = 0; j < tx.vin.size(); ++j) {
+                const uint256 scripthash = GetScriptHash(txundo.vprevout[j].GetTxOut().scriptPubKey);
+                batch.Erase(UnspentKey{scripthash, tx.vin[j].prevout.GetTxId(), tx.vin[j].prevout.GetN()});
+                batch.Write(HistoryKey{scripthash, height, tx.GetId()}, Empty());
+            }
+        }
+        for (uint32_t n = 0; n < tx.vout.size(); ++n) {
+            const CTxOut &txout = tx.vout[n];
+            if (txout.scriptPubKey.IsUnspendable()) {
+                continue;
+            }
+            const uint256 scripthash = GetScriptHash(txout.scriptPubKey);
+            batch.Write(UnspentKey{scripthash, tx.GetId(), n}, UnspentValue{txout.nValue, height});
+            batch.Write(HistoryKey{scripthash, height, tx.GetId()}, Empty());
+        }
+    }
+    return true;
+}
+
+bool ScriptHashIndex::DisconnectBlock(const CBlock &block, const CBlockIndex *pindex) {
+    CBlockUndo blockundo;
+    if (!ReadBlockUndo(block, pindex, blockundo)) {
+        return false;
+    }
+
+    const uint32_t height = pindex->nHeight;
+    CDBBatch batch(*m_db);
+    // Restore the spent outputs first, so that those the block itself created
+    // are erased again below.
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        const CTransaction &tx = *block.vtx[i];
+        const CTxUndo &txundo = blockundo.vtxundo[i - 1];
+        for (size_t j = 0; j < tx.vin.size(); ++j) {
+            const Coin &coin = txundo.vprevout[j];
+            const uint256 scripthash = GetScriptHash(coin.GetTxOut().scriptPubKey);
+            batch.Write(UnspentKey{scripthash, tx.vin[j].prevout.GetTxId(), tx.vin[j].prevout.GetN()},
+                        UnspentValue{coin.GetTxOut().nValue, coin.GetHeight()});
+            batch.Erase(HistoryKey{scripthash, height, tx.GetId()});
+        }
+    }
+    for (const auto &tx : block.vtx) {
+        for (uint32_t n = 0; n < tx->vout.size(); ++n) {
+            const CTxOut &txout = tx->vout[n];
+            if (txout.scriptPubKey.IsUnspendable()) {
+                continue;
+            }
+            const uint256 scripthash = GetScriptHash(txout.scriptPubKey);
+            batch.Erase(UnspentKey{scripthash, tx->GetId(), n});
+            batch.Erase(HistoryKey{scripthash, height, tx->GetId()});
+        }
+    }
+    return m_db->WriteBatch(batch);
+}
+
+BaseIndex::DB &ScriptHashIndex::GetDB() const {
+    return *m_db;
+}
+
+bool ScriptHashIndex::FindHistory(const uint256 &scripthash, const std::optional<ScriptHashHistoryEntry> &start,
+                                  size_t limit, std::vector<ScriptHashHistoryEntry> &entries) const {
+    HistoryKey key{scripthash, start ? uint32_t(start->height) : 0, start ? start->txid : TxId()};
+    std::unique_ptr<CDBIterator> it(m_db->NewIterator());
+    size_t found = 0;
+    for (it->Seek(key); it->Valid() && found < limit; it->Next()) {
+        if (!it->GetKey(key) || key.scripthash != scripthash) {
+            break;
+        }
+        if (start && int(key.height) == start->height && key.txid == start->txid) {
+            continue;
+        }
+        entries.push_back({int(key.height), key.txid});
+        ++found;
+    }
+    return true;
+}
+
+bool ScriptHashIndex::FindUnspent(const uint256 &scripthash, const std::optional<COutPoint> &start, size_t limit,
+                                  std::vector<ScriptHashUnspentEntry> &entries) const {
+    UnspentKey key{scripthash, start ? start->GetTxId() : TxId(), start ? start->GetN() : 0};
+    std::unique_ptr<CDBIterator> it(m_db->NewIterator());
+    size_t found = 0;
+    for (it->Seek(key); it->Valid() && found < limit; it->Next()) {
+        if (!it->GetKey(key) || key.scripthash != scripthash) {
+            break;
+        }
+        const COutPoint outpoint(key.txid, key.n);
+        if (start && outpoint == *start) {
+            continue;
+        }
+        UnspentValue value;
+        if (!it->GetValue(value)) {
+            return error("%s: cannot parse scripthashindex record", __func__);
+        }
+        entries.push_back({outpoint, value.value, int(value.height)});
+        ++found;
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <amount.h>
+#include <index/base.h>
+#include <primitives/transaction.h>
+#include <uint256.h>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+class CScript;
+
+/** A transaction which spent from or paid to a script. */
+struct ScriptHashHistoryEntry {
+    int height = -1;
+    TxId txid;
+};
+
+/** An unspent output paying to a script. */
+struct ScriptHashUnspentEntry {
+    COutPoint outpoint;
+    Amount value = Amount::zero();
+    int height = -1;
+};
+
+/**
+ * ScriptHashIndex maps the SHA256 of output scripts (the "scripthash" of the
+ * Electrum protocol) to the confirmed transactions which paid to or spent from
+ * them, and to their unspent outputs. It is written to a LevelDB database and
+ * follows reorgs, using the block undo data to find the scripts of the spent
+ * outputs.
+ */
+class ScriptHashIndex final : public BaseIndex {
+protected:
+    class DB;
+
+private:
+    class PreparedUndo;
+
+    const std::unique_ptr<DB> m_db;
+
+protected:
+    bool PrepareBlock(const CBlock &block, const CBlockIndex *pindex,
+                      std::unique_ptr<PreparedBlock> &prepared) const override;
+
+    bool WritePreparedBlock(const CBlock &block, const CBlockIndex *pindex,
+                            std::unique_ptr<PreparedBlock> prepared,
+                            CDBBatch &batch) override;
+
+    bool DisconnectBlock(const CBlock &block,
+                         const CBlockIndex *pindex) override;
+
+    BaseIndex::DB &GetDB() const override;
+
+    const char *GetName() const override { return "scripthashindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit ScriptHashIndex(size_t n_cache_size, bool f_memory = false,
+                             bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an
+    // incomplete type.
+    virtual ~ScriptHashIndex() override;
+
+    /// The scripthash of a script.
+    static uint256 GetScriptHash(const CScript &script);
+
+    /// Look up the transactions which paid to or spent from a script, in the
+    /// order in which they were confirmed (and by txid within a block).
+    ///
+    /// @param[in]   scripthash  The scripthash, see GetScriptHash().
+    /// @param[in]   start  If set, only return transactions after this one.
+    /// @param[in]   limit  The maximum number of transactions to return.
+    /// @param[out]  entries  The transactions found.
+    /// @return  false if the database could not be read.
+    bool FindHistory(const uint256 &scripthash,
+                     const std::optional<ScriptHashHistoryEntry> &start,
+                     size_t limit,
+                     std::vector<ScriptHashHistoryEntry> &entries) const;
+
+    /// Look up the unspent outputs paying to a script, ordered by outpoint.
+    ///
+    /// @param[in]   scripthash  The scripthash, see GetScriptHash().
+    /// @param[in]   start  If set, only return outputs after this one.
+    /// @param[in]   limit  The maximum number of outputs to return.
+    /// @param[out]  entries  The outputs found.
+    /// @return  false if the database could not be read.
+    bool FindUnspent(const uint256 &scripthash,
+                     const std::optional<COutPoint> &start, size_t limit,
+                     std::vector<ScriptHashUnspentEntry> &entries) const;
+};
+
+/// The global scripthash index. May be null.
+extern std::unique_ptr<ScriptHashIndex> g_scripthashindex;
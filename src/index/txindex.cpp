@@ -55,8 +55,9 @@ public:
     /// Returns false if the transaction ID is not indexed.
     bool ReadTxPos(const TxId &txid, CDiskTxPos &pos) const;
 
-    /// Write a batch of transaction positions to the DB.
-    bool WriteTxs(const std::vector<std::pair<TxId, CDiskTxPos>> &v_pos);
+    /// Add transaction positions to a batch to be written to the DB.
+    void WriteTxs(const std::vector<std::pair<TxId, CDiskTxPos>> &v_pos,
+                  CDBBatch &batch);
 
     /// Migrate txindex data from the block tree DB, where it may be for older
     /// nodes that have not been upgraded yet to the new database.
@@ -72,13 +73,11 @@ bool TxIndex::DB::ReadTxPos(const TxId &txid, CDiskTxPos &pos) const {
     return Read(std::make_pair(DB_TXINDEX, txid), pos);
 }
 
-bool TxIndex::DB::WriteTxs(
-    const std::vector<std::pair<TxId, CDiskTxPos>> &v_pos) {
-    CDBBatch batch(*this);
+void TxIndex::DB::WriteTxs(
+    const std::vector<std::pair<TxId, CDiskTxPos>> &v_pos, CDBBatch &batch) {
     for (const auto &tuple : v_pos) {
         batch.Write(std::make_pair(DB_TXINDEX, tuple.first), tuple.second);
     }
-    return WriteBatch(batch);
 }
 
 /*
@@ -242,7 +241,9 @@ bool TxIndex::Init() {
     return BaseIndex::Init();
 }
 
-bool TxIndex::WriteBlock(const CBlock &block, const CBlockIndex *pindex) {
+bool TxIndex::WritePreparedBlock(const CBlock &block, const CBlockIndex *pindex,
+                                 std::unique_ptr<PreparedBlock> prepared,
+                                 CDBBatch &batch) {
     // Exclude genesis block transaction because outputs are not spendable.
     if (pindex->nHeight == 0) {
         return true;
@@ -256,7 +257,8 @@ bool TxIndex::WriteBlock(const CBlock &block, const CBlockIndex *pindex) {
         vPos.emplace_back(tx->GetId(), pos);
         pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
     }
-    return m_db->WriteTxs(vPos);
+    m_db->WriteTxs(vPos, batch);
+    return true;
 }
 
 BaseIndex::DB &TxIndex::GetDB() const {
@@ -25,7 +25,9 @@ protected:
     /// Override base class init to migrate from old database.
     bool Init() override;
 
-    bool WriteBlock(const CBlock &block, const CBlockIndex *pindex) override;
+    bool WritePreparedBlock(const CBlock &block, const CBlockIndex *pindex,
+                            std::unique_ptr<PreparedBlock> prepared,
+                            CDBBatch &batch) override;
 
     BaseIndex::DB &GetDB() const override;
 
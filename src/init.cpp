@@ -13,6 +13,8 @@
 #include <addrman.h>
 #include <amount.h>
 #include <banman.h>
+#include <blockfilter.h>
+#include <blockservecache.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -28,6 +30,10 @@
 #include <hash.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/blockfilterindex.h>
+#include <index/codescriptindex.h>
+#include <index/refindex.h>
+#include <index/scripthashindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <key.h>
@@ -44,6 +50,7 @@
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <scheduler.h>
+#include <script/refsummarycache.h>
 #include <script/scriptcache.h>
 #include <script/sigcache.h>
 #include <script/standard.h>
@@ -80,6 +87,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <memory>
+#include <set>
 
 #ifdef ENABLE_WALLET
 #include <db_cxx.h> // DbEnv::version
@@ -91,6 +99,8 @@ static constexpr bool DEFAULT_PROXYRANDOMIZE = true;
 static constexpr bool DEFAULT_REST_ENABLE = false;
 /** Default for -stopafterblockimport */
 static constexpr bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
+/** Default for -blockfilterindex */
+static const char *const DEFAULT_BLOCKFILTERINDEX = "0";
 
 // Dump addresses to banlist.dat every 15 minutes (900s)
 static constexpr int DUMP_BANS_INTERVAL = 60 * 15;
@@ -99,6 +109,9 @@ std::unique_ptr<CConnman> g_connman;
 std::unique_ptr<PeerLogicValidation> peerLogic;
 std::unique_ptr<BanMan> g_banman;
 
+/** The block filter types enabled with -blockfilterindex. */
+static std::set<BlockFilterType> g_enabled_filter_types;
+
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for accessing
 // block files don't count towards the fd_set size limit anyway.
@@ -206,6 +219,16 @@ void Interrupt() {
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_refindex) {
+        g_refindex->Interrupt();
+    }
+    if (g_codescriptindex) {
+        g_codescriptindex->Interrupt();
+    }
+    if (g_scripthashindex) {
+        g_scripthashindex->Interrupt();
+    }
+    ForEachBlockFilterIndex([](BlockFilterIndex &index) { index.Interrupt(); });
 }
 
 void Shutdown(NodeContext &node) {
@@ -243,6 +266,16 @@ void Shutdown(NodeContext &node) {
     if (g_txindex) {
         g_txindex->Stop();
     }
+    if (g_refindex) {
+        g_refindex->Stop();
+    }
+    if (g_codescriptindex) {
+        g_codescriptindex->Stop();
+    }
+    if (g_scripthashindex) {
+        g_scripthashindex->Stop();
+    }
+    ForEachBlockFilterIndex([](BlockFilterIndex &index) { index.Stop(); });
 
     StopTorControl();
 
@@ -251,6 +284,7 @@ void Shutdown(NodeContext &node) {
     threadGroup.interrupt_all();
     threadGroup.join_all();
     StopScriptCheckWorkerThreads();
+    StopBlockPrefetchThreads();
 
     // After the threads that potentially access these pointers have been
     // stopped, destruct and reset all to nullptr.
@@ -258,10 +292,15 @@ void Shutdown(NodeContext &node) {
     g_connman.reset();
     g_banman.reset();
     g_txindex.reset();
+    g_refindex.reset();
+    g_codescriptindex.reset();
+    g_scripthashindex.reset();
+    DestroyAllBlockFilterIndexes();
 
     if (::g_mempool.IsLoaded() &&
         gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool(::g_mempool);
+        DumpSignatureCaches();
         if (DoubleSpendProof::IsEnabled()) {
             DumpDSProofs(::g_mempool);
         }
@@ -548,8 +587,9 @@ void SetupServerArgs() {
                            DEFAULT_PARK_DEEP_REORG),
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool",
-                 strprintf("Whether to save the mempool on shutdown and load "
-                           "on restart (default: %u)",
+                 strprintf("Whether to save the mempool, along with the "
+                           "signature and script caches, on shutdown and load "
+                           "them on restart (default: %u)",
                            DEFAULT_PERSIST_MEMPOOL),
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>",
@@ -557,6 +597,20 @@ void SetupServerArgs() {
                            "by a net-specific datadir location. (default: %s)",
                            BITCOIN_PID_FILENAME),
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-prefetchblocks=<n>",
+                 strprintf("Read, check and fetch the inputs of up to <n> of "
+                           "the blocks to connect next while connecting the "
+                           "one before them, as during initial block download "
+                           "(up to %d, 0 to disable, default: %d)",
+                           MAX_BLOCK_PREFETCH_DEPTH,
+                           DEFAULT_BLOCK_PREFETCH_DEPTH),
+                 ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-prefetchthreads=<n>",
+                 strprintf("Set the number of threads prefetching blocks (up "
+                           "to %d, default: %d)",
+                           MAX_BLOCK_PREFETCH_THREADS,
+                           DEFAULT_BLOCK_PREFETCH_THREADS),
+                 ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg(
         "-prune=<n>",
         strprintf("Reduce storage requirements by enabling pruning (deleting) "
@@ -593,6 +647,40 @@ void SetupServerArgs() {
                            "getrawtransaction rpc call (default: %d)",
                            DEFAULT_TXINDEX),
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-refindex",
+                 strprintf("Maintain an index of the outputs carrying each "
+                           "ref, used by the getrefoutputs rpc call (default: "
+                           "%d)",
+                           DEFAULT_REFINDEX),
+                 ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-codescriptindex",
+                 strprintf("Maintain an index of the unspent contract outputs "
+                           "by codescript hash, used by the "
+                           "getcodescriptoutputs rpc call (default: %d)",
+                           DEFAULT_CODESCRIPTINDEX),
+                 ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-scripthashindex",
+                 strprintf("Maintain an index of the confirmed history and "
+                           "unspent outputs of each output script, used by the "
+                           "getscripthashhistory and getscripthashunspent rpc "
+                           "calls (default: %d)",
+                           DEFAULT_SCRIPTHASHINDEX),
+                 ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockfilterindex=<type>",
+                 strprintf("Maintain an index of compact filters by block "
+                           "(default: %s, values: %s).",
+                           DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
+                     " If <type> is not supplied or if <type> = 1, indexes "
+                     "for all known types are enabled.",
+                 ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-indexsyncthreads=<n>",
+                 strprintf("Set the number of threads reading and preparing "
+                           "blocks ahead while an index catches up with the "
+                           "chain (%u to %d, 0 = as many as there are cores, "
+                           "default: %d)",
+                           1, MAX_INDEX_SYNC_THREADS,
+                           DEFAULT_INDEX_SYNC_THREADS),
+                 ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-addnode=<ip>",
                  "Add a node to connect to and attempt to keep the connection "
                  "open (see the `addnode` RPC command help for more info)",
@@ -691,6 +779,11 @@ void SetupServerArgs() {
                            "bloom filters (default: %d)",
                            DEFAULT_PEERBLOOMFILTERS),
                  ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-peerblockfilters",
+                 strprintf("Serve compact block filters to peers per BIP 157 "
+                           "(default: %d)",
+                           DEFAULT_PEERBLOCKFILTERS),
+                 ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-port=<port>",
                  strprintf("Listen for connections on <port> (default: %u, "
                            "testnet: %u, testnet4: %u, scalenet: %u, regtest: %u)",
@@ -722,6 +815,21 @@ void SetupServerArgs() {
                   "the connection to it is dropped. (minimum: 1, default: %d)",
                   DEFAULT_PEER_CONNECT_TIMEOUT),
         ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::CONNECTION);
+    gArgs.AddArg(
+        "-netthreads=<n>",
+        strprintf("Number of threads to send to and receive from peers with, "
+                  "each servicing its share of the connections. Only used "
+                  "where epoll is available (maximum: %d, default: %d)",
+                  MAX_NET_THREADS, DEFAULT_NET_THREADS),
+        ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg(
+        "-msghandthreads=<n>",
+        strprintf("Number of threads to process the messages of peers with, "
+                  "each processing those of its share of the connections. "
+                  "Blocks and headers are still processed one at a time "
+                  "(maximum: %d, default: %d)",
+                  MAX_MSGHAND_THREADS, DEFAULT_MSGHAND_THREADS),
+        ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg(
         "-torcontrol=<ip>:<port>",
         strprintf(
@@ -835,6 +943,11 @@ void SetupServerArgs() {
             defaultChainParams->DefaultConsistencyChecks(),
             regtestChainParams->DefaultConsistencyChecks()),
         ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg("-batchschnorr",
+                 strprintf("Verify the Schnorr signatures of blocks by batch, "
+                           "on the script verification threads (default: %d)",
+                           DEFAULT_BATCH_SCHNORR_VERIFICATION),
+                 ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-checkpoints",
                  strprintf("Only accept block chain matching built-in "
                            "checkpoints (default: %d)",
@@ -899,6 +1012,17 @@ void SetupServerArgs() {
         strprintf("Limit size of script cache to <n> MiB (0 to %d, default: %d)",
                   MAX_MAX_SCRIPT_CACHE_SIZE, DEFAULT_MAX_SCRIPT_CACHE_SIZE),
         ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg(
+        "-maxblockservecachesize=<n>",
+        strprintf("Limit size of the cache of serialized blocks and compact blocks served to peers to <n> MiB "
+                  "(0 to %d, default: %d)",
+                  MAX_MAX_BLOCK_SERVE_CACHE_SIZE, DEFAULT_MAX_BLOCK_SERVE_CACHE_SIZE),
+        ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    gArgs.AddArg(
+        "-maxrefsummarycachesize=<n>",
+        strprintf("Limit size of the cache of output ref summaries to <n> MiB (0 to %d, default: %d)",
+                  MAX_MAX_REF_SUMMARY_CACHE_SIZE, DEFAULT_MAX_REF_SUMMARY_CACHE_SIZE),
+        ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-maxtipage=<n>",
                  strprintf("Maximum tip age in seconds to consider node in "
                            "initial block download (default: %u)",
@@ -952,6 +1076,13 @@ void SetupServerArgs() {
                            "relay and mining (default: %u)",
                            DEFAULT_BYTES_PER_SIGCHECK),
                  ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::NODE_RELAY);
+    gArgs.AddArg("-mempoolparallelinputs=<n>",
+                 strprintf("Check the scripts of transactions with at least "
+                           "this many inputs on the script verification "
+                           "threads when accepting them to the mempool (0 to "
+                           "disable, default: %u)",
+                           DEFAULT_MEMPOOL_PARALLEL_INPUTS),
+                 ArgsManager::ALLOW_ANY, OptionsCategory::NODE_RELAY);
     gArgs.AddArg("-bytespersigop=<n>",
                  strprintf("(Deprecated) Alias for -bytespersigcheck (default: %u)",
                            DEFAULT_BYTES_PER_SIGCHECK),
@@ -1044,6 +1175,12 @@ void SetupServerArgs() {
                            "on individual gbt calls by specifying the \"checkvalidity\": boolean key in the "
                            "template_request object given to gbt. (default: %d)", DEFAULT_GBT_CHECK_VALIDITY),
                  ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-gbtincremental",
+                 strprintf("Set whether getblocktemplate and getblocktemplatelight update the previous block template "
+                           "with the transactions that entered the mempool since, rather than assembling a new one "
+                           "from the whole mempool, while the chain tip is unchanged. (default: %d)",
+                           DEFAULT_GBT_INCREMENTAL),
+                 ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
 
     gArgs.AddArg("-blockmintxfee=<amt>",
                  strprintf("Set lowest fee rate (in %s/kB) for transactions to "
@@ -1655,11 +1792,42 @@ bool AppInitParameterInteraction(Config &config) {
                 strprintf("Error creating index directory: %s", e.what()));
     }
 
+    const std::string blockfilterindex_value =
+        gArgs.GetArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    if (blockfilterindex_value == "" || blockfilterindex_value == "1") {
+        g_enabled_filter_types.insert(AllBlockFilterTypes().begin(),
+                                      AllBlockFilterTypes().end());
+    } else if (blockfilterindex_value != "0") {
+        for (const auto &name : gArgs.GetArgs("-blockfilterindex")) {
+            BlockFilterType filter_type;
+            if (!BlockFilterTypeByName(name, filter_type)) {
+                return InitError(
+                    strprintf(_("Unknown -blockfilterindex value %s."), name));
+            }
+            g_enabled_filter_types.insert(filter_type);
+        }
+    }
+
     // if using block pruning, then disallow txindex
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
             return InitError(_("Prune mode is incompatible with -txindex."));
         }
+        if (gArgs.GetBoolArg("-refindex", DEFAULT_REFINDEX)) {
+            return InitError(_("Prune mode is incompatible with -refindex."));
+        }
+        if (gArgs.GetBoolArg("-codescriptindex", DEFAULT_CODESCRIPTINDEX)) {
+            return InitError(
+                _("Prune mode is incompatible with -codescriptindex."));
+        }
+        if (gArgs.GetBoolArg("-scripthashindex", DEFAULT_SCRIPTHASHINDEX)) {
+            return InitError(
+                _("Prune mode is incompatible with -scripthashindex."));
+        }
+        if (!g_enabled_filter_types.empty()) {
+            return InitError(
+                _("Prune mode is incompatible with -blockfilterindex."));
+        }
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1738,6 +1906,8 @@ bool AppInitParameterInteraction(Config &config) {
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex",
                                         chainparams.DefaultConsistencyChecks());
+    g_batch_schnorr_verification =
+        gArgs.GetBoolArg("-batchschnorr", DEFAULT_BATCH_SCHNORR_VERIFICATION);
     fCheckpointsEnabled =
         gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
     if (fCheckpointsEnabled) {
@@ -1938,6 +2108,13 @@ bool AppInitParameterInteraction(Config &config) {
         nBytesPerSigCheck = gArgs.GetArg("-bytespersigop", nBytesPerSigCheck);
     }
 
+    const int64_t mempool_parallel_inputs = gArgs.GetArg(
+        "-mempoolparallelinputs", DEFAULT_MEMPOOL_PARALLEL_INPUTS);
+    if (mempool_parallel_inputs < 0) {
+        return InitError(_("-mempoolparallelinputs must not be negative"));
+    }
+    nMempoolParallelInputs = mempool_parallel_inputs;
+
     if (!g_wallet_init_interface.ParameterInteraction()) {
         return false;
     }
@@ -1952,6 +2129,16 @@ bool AppInitParameterInteraction(Config &config) {
         nLocalServices = ServiceFlags(nLocalServices | NODE_BLOOM);
     }
 
+    // Signal NODE_CF if peerblockfilters and basic filters index are both
+    // enabled.
+    if (gArgs.GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (g_enabled_filter_types.count(BlockFilterType::BASIC) != 1) {
+            return InitError(
+                _("Cannot set -peerblockfilters without -blockfilterindex."));
+        }
+        nLocalServices = ServiceFlags(nLocalServices | NODE_CF);
+    }
+
     // Signal Radiant support.
     // TODO: remove some time after the hardfork when no longer needed
     // to differentiate the network nodes.
@@ -1995,6 +2182,8 @@ bool AppInitSanityChecks() {
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string sha512_256_algo = SHA512_256AutoDetect();
+    LogPrintf("Using the '%s' SHA512/256 implementation\n", sha512_256_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -2105,6 +2294,12 @@ bool AppInitMain(Config &config, RPCServer &rpcServer,
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    // Warm the caches up with what they held at shutdown, so that blocks
+    // mined out of the reloaded mempool need not be checked all over again.
+    if (gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+        LoadSignatureCaches();
+    }
+    InitRefSummaryCache();
 
     int script_threads = gArgs.GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
     if (script_threads <= 0) {
@@ -2124,6 +2319,20 @@ bool AppInitMain(Config &config, RPCServer &rpcServer,
         StartScriptCheckWorkerThreads(script_threads);
     }
 
+    const int prefetch_depth =
+        std::clamp<int>(gArgs.GetArg("-prefetchblocks",
+                                     DEFAULT_BLOCK_PREFETCH_DEPTH),
+                        0, MAX_BLOCK_PREFETCH_DEPTH);
+    const int prefetch_threads =
+        std::clamp<int>(gArgs.GetArg("-prefetchthreads",
+                                     DEFAULT_BLOCK_PREFETCH_THREADS),
+                        0, MAX_BLOCK_PREFETCH_THREADS);
+    if (prefetch_depth >= 1 && prefetch_threads >= 1) {
+        LogPrintf("Prefetching up to %d blocks on %d threads\n",
+                  prefetch_depth, prefetch_threads);
+        StartBlockPrefetchThreads(prefetch_threads, prefetch_depth);
+    }
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop =
         std::bind(&CScheduler::serviceQueue, &scheduler);
@@ -2415,6 +2624,31 @@ bool AppInitMain(Config &config, RPCServer &rpcServer,
                                       ? nMaxTxIndexCache << 20
                                       : 0);
     nTotalCache -= nTxIndexCache;
+    int64_t nRefIndexCache =
+        std::min(nTotalCache / 8, gArgs.GetBoolArg("-refindex", DEFAULT_REFINDEX)
+                                      ? nMaxRefIndexCache << 20
+                                      : 0);
+    nTotalCache -= nRefIndexCache;
+    int64_t nCodeScriptIndexCache = std::min(
+        nTotalCache / 8,
+        gArgs.GetBoolArg("-codescriptindex", DEFAULT_CODESCRIPTINDEX)
+            ? nMaxCodeScriptIndexCache << 20
+            : 0);
+    nTotalCache -= nCodeScriptIndexCache;
+    int64_t nScriptHashIndexCache = std::min(
+        nTotalCache / 8,
+        gArgs.GetBoolArg("-scripthashindex", DEFAULT_SCRIPTHASHINDEX)
+            ? nMaxScriptHashIndexCache << 20
+            : 0);
+    nTotalCache -= nScriptHashIndexCache;
+    int64_t filter_index_cache = 0;
+    if (!g_enabled_filter_types.empty()) {
+        size_t n_indexes = g_enabled_filter_types.size();
+        int64_t max_cache =
+            std::min(nTotalCache / 8, nMaxFilterIndexCache << 20);
+        filter_index_cache = max_cache / n_indexes;
+        nTotalCache -= filter_index_cache * n_indexes;
+    }
     // use 25%-50% of the remainder for disk cache
     int64_t nCoinDBCache =
         std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23));
@@ -2431,6 +2665,23 @@ bool AppInitMain(Config &config, RPCServer &rpcServer,
         LogPrintf("* Using %.1fMiB for transaction index database\n",
                   nTxIndexCache * (1.0 / 1024 / 1024));
     }
+    if (gArgs.GetBoolArg("-refindex", DEFAULT_REFINDEX)) {
+        LogPrintf("* Using %.1fMiB for ref index database\n",
+                  nRefIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-codescriptindex", DEFAULT_CODESCRIPTINDEX)) {
+        LogPrintf("* Using %.1fMiB for codescript index database\n",
+                  nCodeScriptIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-scripthashindex", DEFAULT_SCRIPTHASHINDEX)) {
+        LogPrintf("* Using %.1fMiB for scripthash index database\n",
+                  nScriptHashIndexCache * (1.0 / 1024 / 1024));
+    }
+    for (BlockFilterType filter_type : g_enabled_filter_types) {
+        LogPrintf("* Using %.1f MiB for %s block filter index database\n",
+                  filter_index_cache * (1.0 / 1024 / 1024),
+                  BlockFilterTypeName(filter_type));
+    }
     LogPrintf("* Using %.1fMiB for chain state database\n",
               nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of "
@@ -2641,6 +2892,24 @@ bool AppInitMain(Config &config, RPCServer &rpcServer,
         g_txindex = std::make_unique<TxIndex>(nTxIndexCache, false, fReindex);
         g_txindex->Start();
     }
+    if (gArgs.GetBoolArg("-refindex", DEFAULT_REFINDEX)) {
+        g_refindex = std::make_unique<RefIndex>(nRefIndexCache, false, fReindex);
+        g_refindex->Start();
+    }
+    if (gArgs.GetBoolArg("-codescriptindex", DEFAULT_CODESCRIPTINDEX)) {
+        g_codescriptindex = std::make_unique<CodeScriptIndex>(
+            nCodeScriptIndexCache, false, fReindex);
+        g_codescriptindex->Start();
+    }
+    if (gArgs.GetBoolArg("-scripthashindex", DEFAULT_SCRIPTHASHINDEX)) {
+        g_scripthashindex = std::make_unique<ScriptHashIndex>(
+            nScriptHashIndexCache, false, fReindex);
+        g_scripthashindex->Start();
+    }
+    for (const auto &filter_type : g_enabled_filter_types) {
+        InitBlockFilterIndex(filter_type, filter_index_cache, false, fReindex);
+        GetBlockFilterIndex(filter_type)->Start();
+    }
 
     // Step 9: load wallet
     for (const auto &client : node.chain_clients) {
@@ -2763,6 +3032,10 @@ bool AppInitMain(Config &config, RPCServer &rpcServer,
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
+    connOptions.nNetThreads = std::clamp<int64_t>(
+        gArgs.GetArg("-netthreads", DEFAULT_NET_THREADS), 1, MAX_NET_THREADS);
+    connOptions.nMsgHandThreads = std::clamp<int64_t>(
+        gArgs.GetArg("-msghandthreads", DEFAULT_MSGHAND_THREADS), 1, MAX_MSGHAND_THREADS);
 
     for (const std::string &bind_arg : gArgs.GetArgs("-bind")) {
         CService bind_addr;
@@ -186,24 +186,7 @@ BlockAssembler::CreateNewBlock(const CScript &scriptPubKeyIn, double timeLimitSe
     nLastBlockTx = nBlockTx;
     nLastBlockSize = nBlockSize;
 
-    // Create coinbase transaction.
-    CMutableTransaction coinbaseTx;
-    coinbaseTx.vin.resize(1);
-    coinbaseTx.vin[0].prevout = COutPoint();
-    coinbaseTx.vout.resize(1);
-    coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
-    coinbaseTx.vout[0].nValue = nFees + GetBlockSubsidy(nHeight, consensusParams);
-    coinbaseTx.vin[0].scriptSig = CScript() << ScriptInt::fromIntUnchecked(nHeight); // << OP_0;
-
-    // Make sure the coinbase is big enough.
-    uint64_t coinbaseSize = ::GetSerializeSize(coinbaseTx, PROTOCOL_VERSION);
-    if (coinbaseSize < MIN_TX_SIZE) {
-        coinbaseTx.vin[0].scriptSig << std::vector<uint8_t>(MIN_TX_SIZE - coinbaseSize - 1);
-    }
-
-    pblocktemplate->entries[0].tx = MakeTransactionRef(coinbaseTx);
-    pblocktemplate->entries[0].fees = -1 * nFees;
-    pblock->vtx[0] = pblocktemplate->entries[0].tx;
+    FinalizeBlock(scriptPubKeyIn, pindexPrev);
 
     const uint64_t nByteSize =
             checkValidity ? GetSerializeSize(*pblock, PROTOCOL_VERSION)
@@ -212,13 +195,6 @@ BlockAssembler::CreateNewBlock(const CScript &scriptPubKeyIn, double timeLimitSe
     LogPrintf("CreateNewBlock(): %s: %u txs: %u fees: %ld sigchecks %d\n",
               checkValidity ? "total size" : "estimated size", nByteSize, nBlockTx, nFees, nBlockSigChecks);
 
-    // Fill in header.
-    pblock->hashPrevBlock = pindexPrev->GetBlockHash();
-    UpdateTime(pblock, consensusParams, pindexPrev);
-    pblock->nBits = GetNextWorkRequired(pindexPrev, pblock, consensusParams);
-    pblock->nNonce = 0;
-    pblocktemplate->entries[0].sigChecks = 0;
-
     if (checkValidity) {
         CValidationState state;
         if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev,
@@ -251,6 +227,37 @@ BlockAssembler::CreateNewBlock(const CScript &scriptPubKeyIn, double timeLimitSe
     return std::move(pblocktemplate);
 }
 
+void BlockAssembler::FinalizeBlock(const CScript &scriptPubKeyIn,
+                                   const CBlockIndex *pindexPrev) {
+    const Consensus::Params &consensusParams = chainparams.GetConsensus();
+
+    // Create coinbase transaction.
+    CMutableTransaction coinbaseTx;
+    coinbaseTx.vin.resize(1);
+    coinbaseTx.vin[0].prevout = COutPoint();
+    coinbaseTx.vout.resize(1);
+    coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
+    coinbaseTx.vout[0].nValue = nFees + GetBlockSubsidy(nHeight, consensusParams);
+    coinbaseTx.vin[0].scriptSig = CScript() << ScriptInt::fromIntUnchecked(nHeight); // << OP_0;
+
+    // Make sure the coinbase is big enough.
+    uint64_t coinbaseSize = ::GetSerializeSize(coinbaseTx, PROTOCOL_VERSION);
+    if (coinbaseSize < MIN_TX_SIZE) {
+        coinbaseTx.vin[0].scriptSig << std::vector<uint8_t>(MIN_TX_SIZE - coinbaseSize - 1);
+    }
+
+    pblocktemplate->entries[0].tx = MakeTransactionRef(coinbaseTx);
+    pblocktemplate->entries[0].fees = -1 * nFees;
+    pblock->vtx[0] = pblocktemplate->entries[0].tx;
+
+    // Fill in header.
+    pblock->hashPrevBlock = pindexPrev->GetBlockHash();
+    UpdateTime(pblock, consensusParams, pindexPrev);
+    pblock->nBits = GetNextWorkRequired(pindexPrev, pblock, consensusParams);
+    pblock->nNonce = 0;
+    pblocktemplate->entries[0].sigChecks = 0;
+}
+
 bool BlockAssembler::TestTx(uint64_t txSize, int64_t txSigChecks) const {
     if (nBlockSize + txSize >= nMaxGeneratedBlockSize) {
         return false;
@@ -411,6 +418,185 @@ void BlockAssembler::addTxs(int64_t nLimitTimePoint) {
             }
         }
     }
+
+    fAddTxsTimedOut = TimedOut();
+}
+
+IncrementalBlockAssembler::IncrementalBlockAssembler(const Config &_config, CTxMemPool &_mempool)
+    : config(_config), mempool(_mempool) {
+    connEntryAdded = mempool.NotifyEntryAdded.connect(
+        std::bind(&IncrementalBlockAssembler::TransactionAddedToMempool, this, std::placeholders::_1));
+    connEntryRemoved = mempool.NotifyEntryRemoved.connect(
+        std::bind(&IncrementalBlockAssembler::TransactionRemovedFromMempool, this, std::placeholders::_1,
+                  std::placeholders::_2));
+}
+
+IncrementalBlockAssembler::~IncrementalBlockAssembler() {}
+
+void IncrementalBlockAssembler::TransactionAddedToMempool(CTransactionRef tx) {
+    // Don't let the backlog grow without bounds if no templates are requested.
+    const size_t MAX_PENDING = 100000;
+    LOCK(cs_pending);
+    if (fInvalidated) {
+        return;
+    }
+    if (vPending.size() >= MAX_PENDING) {
+        fInvalidated = true;
+        vPending.clear();
+        return;
+    }
+    vPending.push_back(std::move(tx));
+}
+
+void IncrementalBlockAssembler::TransactionRemovedFromMempool(CTransactionRef tx, MemPoolRemovalReason reason) {
+    // Called with mempool.cs held, which guards setInBlock.
+    if (reason == MemPoolRemovalReason::BLOCK || setInBlock.count(tx->GetId())) {
+        LOCK(cs_pending);
+        fInvalidated = true;
+        vPending.clear();
+    }
+}
+
+std::unique_ptr<CBlockTemplate>
+IncrementalBlockAssembler::CreateNewBlock(const CScript &scriptPubKeyIn, double timeLimitSecs, bool checkValidity) {
+    const int64_t nTimeStart = GetTimeMicros();
+
+    LOCK2(cs_main, mempool.cs);
+    std::vector<CTransactionRef> txs;
+    bool fRebuild;
+    {
+        LOCK(cs_pending);
+        txs.swap(vPending);
+        fRebuild = fInvalidated;
+        fInvalidated = false;
+    }
+    fRebuild = fRebuild || !pblocktemplate || pindexPrev != ::ChainActive().Tip() || !fComplete ||
+               (checkValidity && !fChecked) || nExcessiveBlockSize != config.GetExcessiveBlockSize() ||
+               nGeneratedBlockSize != config.GetGeneratedBlockSize();
+
+    if (!fRebuild) {
+        int64_t nLimitTimePoint = 0;
+        if (timeLimitSecs > 0.) {
+            // limit to 1e3 secs, to prevent int64 overflow below
+            nLimitTimePoint = nTimeStart + static_cast<int64_t>(std::min(timeLimitSecs, 1e3) * 1e6);
+        }
+        Extend(scriptPubKeyIn, txs, nLimitTimePoint);
+        fRebuild = RebuildDue();
+    }
+    if (fRebuild) {
+        Rebuild(scriptPubKeyIn, timeLimitSecs, checkValidity);
+    } else {
+        LogPrint(BCLog::BENCH, "IncrementalBlockAssembler: considered %u new txs, %u txs in block: %.2fms\n",
+                 txs.size(), assembler->nBlockTx, 0.001 * (GetTimeMicros() - nTimeStart));
+    }
+
+    return std::make_unique<CBlockTemplate>(*pblocktemplate);
+}
+
+void IncrementalBlockAssembler::Rebuild(const CScript &scriptPubKeyIn, double timeLimitSecs, bool checkValidity) {
+    // Make sure a failed build is not extended next time.
+    pblocktemplate.reset();
+    setInBlock.clear();
+    pcoins.reset();
+    // The rebuild considers the whole mempool, including any txs that Extend
+    // ran out of time for.
+    WITH_LOCK(cs_pending, vPending.clear());
+
+    assembler.emplace(config, mempool);
+    nExcessiveBlockSize = config.GetExcessiveBlockSize();
+    nGeneratedBlockSize = config.GetGeneratedBlockSize();
+    pblocktemplate = assembler->CreateNewBlock(scriptPubKeyIn, timeLimitSecs, checkValidity);
+    pindexPrev = ::ChainActive().Tip();
+    fChecked = checkValidity;
+    fComplete = !assembler->fAddTxsTimedOut;
+    nRebuildTime = GetTime();
+    nSkippedFees = Amount::zero();
+
+    if (fChecked) {
+        pcoins = std::make_unique<CCoinsViewCache>(pcoinsTip.get());
+    }
+    const auto &vtx = pblocktemplate->block.vtx;
+    setInBlock.reserve(vtx.size());
+    for (size_t i = 1; i < vtx.size(); ++i) {
+        setInBlock.insert(vtx[i]->GetId());
+        if (pcoins) {
+            UpdateCoins(*pcoins, *vtx[i], assembler->nHeight);
+        }
+    }
+}
+
+void IncrementalBlockAssembler::Extend(const CScript &scriptPubKeyIn, const std::vector<CTransactionRef> &txs,
+                                       int64_t nLimitTimePoint) {
+    assembler->pblocktemplate = std::move(pblocktemplate);
+    assembler->pblock = &assembler->pblocktemplate->block;
+
+    // Parents enter the mempool before their children, so txs is in a valid
+    // block order.
+    for (auto it = txs.begin(); it != txs.end(); ++it) {
+        if (nLimitTimePoint > 0 && GetTimeMicros() >= nLimitTimePoint) {
+            // Out of time: keep the rest, in order, ahead of the txs that
+            // entered the mempool meanwhile.
+            LOCK(cs_pending);
+            if (!fInvalidated) {
+                vPending.insert(vPending.begin(), it, txs.end());
+            }
+            break;
+        }
+
+        const CTransactionRef &tx = *it;
+        const TxId &txid = tx->GetId();
+        auto iter = mempool.mapTx.find(txid);
+        if (iter == mempool.mapTx.end() || setInBlock.count(txid)) {
+            continue;
+        }
+
+        if (iter->GetModifiedFeeRate() < assembler->blockMinFeeRate) {
+            continue;
+        }
+
+        const auto &parents = mempool.GetMemPoolParents(iter);
+        if (!std::all_of(parents.begin(), parents.end(),
+                         [this](const auto &parent) { return setInBlock.count(parent->GetTx().GetId()); })) {
+            continue;
+        }
+
+        // A transaction that doesn't fit might be worth more than the ones
+        // that do, so leave the choice to the next full rebuild.
+        if (!assembler->TestTx(iter->GetTxSize(), iter->GetSigChecks())) {
+            nSkippedFees += iter->GetModifiedFee();
+            continue;
+        }
+
+        if (!assembler->CheckTx(*tx)) {
+            continue;
+        }
+
+        if (pcoins) {
+            CValidationState state;
+            if (!TestBlockTemplateTransaction(state, assembler->chainparams, *pcoins, *tx, pindexPrev)) {
+                throw std::runtime_error(strprintf("%s: TestBlockTemplateTransaction failed for %s: %s", __func__,
+                                                   txid.ToString(), FormatStateMessage(state)));
+            }
+        }
+
+        assembler->AddToBlock(iter);
+        assembler->pblock->vtx.push_back(iter->GetSharedTx());
+        setInBlock.insert(txid);
+    }
+
+    nLastBlockTx = assembler->nBlockTx;
+    nLastBlockSize = assembler->nBlockSize;
+
+    assembler->FinalizeBlock(scriptPubKeyIn, pindexPrev);
+    pblocktemplate = std::move(assembler->pblocktemplate);
+}
+
+bool IncrementalBlockAssembler::RebuildDue() const {
+    if (nSkippedFees <= Amount::zero()) {
+        return false;
+    }
+    return GetTime() - nRebuildTime >= INCREMENTAL_TEMPLATE_REBUILD_INTERVAL ||
+           INCREMENTAL_TEMPLATE_REBUILD_FEE_DIVISOR * nSkippedFees >= assembler->nFees;
 }
 
 static
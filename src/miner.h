@@ -7,15 +7,20 @@
 
 #include <primitives/block.h>
 #include <txmempool.h>
+#include <util/saltedhashers.h>
 
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index_container.hpp>
 
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <unordered_set>
+#include <vector>
 
 class CBlockIndex;
 class CChainParams;
+class CCoinsViewCache;
 class Config;
 class CScript;
 
@@ -25,6 +30,15 @@ struct Params;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
 
+/**
+ * An incremental block template that left out new transactions because they
+ * did not fit is rebuilt from scratch once it is this many seconds old, or
+ * once the fees left out reach 1/INCREMENTAL_TEMPLATE_REBUILD_FEE_DIVISOR of
+ * the template's, whichever comes first.
+ */
+static constexpr int64_t INCREMENTAL_TEMPLATE_REBUILD_INTERVAL = 30;
+static constexpr int64_t INCREMENTAL_TEMPLATE_REBUILD_FEE_DIVISOR = 100;
+
 struct CBlockTemplateEntry {
     CTransactionRef tx;
     Amount fees;
@@ -71,6 +85,11 @@ private:
 
     const bool fPrintPriority;
 
+    // Whether the last addTxs() stopped because it ran out of time
+    bool fAddTxsTimedOut = false;
+
+    friend class IncrementalBlockAssembler;
+
 public:
     struct Options {
         Options();
@@ -105,6 +124,9 @@ private:
     void resetBlock();
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
+    /** Create the coinbase paying the current fees and fill in the header */
+    void FinalizeBlock(const CScript &scriptPubKeyIn,
+                       const CBlockIndex *pindexPrev);
 
     // Methods for how to add transactions to a block.
     /**
@@ -121,6 +143,76 @@ private:
     bool CheckTx(const CTransaction &tx) const;
 };
 
+/**
+ * Keeps the last generated block template up to date with the mempool, so
+ * that a new template only needs to add (and check) the transactions that
+ * entered the mempool since the previous one. The template is rebuilt from
+ * scratch with BlockAssembler whenever the tip changes, one of its
+ * transactions leaves the mempool, or the previous build did not get through
+ * the whole mempool. New transactions that do not fit are left out until the
+ * next rebuild, which they bring forward (see
+ * INCREMENTAL_TEMPLATE_REBUILD_INTERVAL).
+ */
+class IncrementalBlockAssembler {
+private:
+    const Config &config;
+    CTxMemPool &mempool;
+
+    // Created anew for every rebuild, so it picks up changed block size limits
+    std::optional<BlockAssembler> assembler;
+    // The current template; assembler's counters describe its contents
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    const CBlockIndex *pindexPrev = nullptr;
+    uint64_t nExcessiveBlockSize = 0;
+    uint64_t nGeneratedBlockSize = 0;
+    // Whether the template's transactions have been checked for validity
+    bool fChecked = false;
+    // Whether the template considered every mempool transaction
+    bool fComplete = false;
+    // When the template was last built from scratch
+    int64_t nRebuildTime = 0;
+    // Fees of the new transactions left out of the template for lack of room
+    Amount nSkippedFees = Amount::zero();
+
+    // Ids of the transactions in the template, guarded by mempool.cs
+    std::unordered_set<TxId, SaltedTxIdHasher> setInBlock;
+    // Tip coins with the template's transactions applied (if fChecked)
+    std::unique_ptr<CCoinsViewCache> pcoins;
+
+    Mutex cs_pending;
+    // Transactions added to the mempool since the template was built
+    std::vector<CTransactionRef> vPending GUARDED_BY(cs_pending);
+    // Set when the template can no longer be extended
+    bool fInvalidated GUARDED_BY(cs_pending) = true;
+
+    boost::signals2::scoped_connection connEntryAdded;
+    boost::signals2::scoped_connection connEntryRemoved;
+
+public:
+    IncrementalBlockAssembler(const Config &config, CTxMemPool &_mempool);
+    ~IncrementalBlockAssembler();
+
+    /** Same as BlockAssembler::CreateNewBlock(). */
+    std::unique_ptr<CBlockTemplate>
+    CreateNewBlock(const CScript &scriptPubKeyIn, double timeLimitSecs = 0., bool checkValidity = true);
+
+private:
+    void TransactionAddedToMempool(CTransactionRef tx);
+    void TransactionRemovedFromMempool(CTransactionRef tx, MemPoolRemovalReason reason);
+
+    /** Build a new template from the whole mempool */
+    void Rebuild(const CScript &scriptPubKeyIn, double timeLimitSecs, bool checkValidity)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main, mempool.cs);
+    /**
+     * Append txs to the template, skipping the ones that do not fit. Stops at
+     * nLimitTimePoint (if > 0), leaving the remaining txs for the next call.
+     */
+    void Extend(const CScript &scriptPubKeyIn, const std::vector<CTransactionRef> &txs, int64_t nLimitTimePoint)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main, mempool.cs);
+    /** Whether the transactions left out of the template warrant a rebuild */
+    bool RebuildDue() const;
+};
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock *pblock, const CBlockIndex *pindexPrev,
                          uint64_t nExcessiveBlockSize,
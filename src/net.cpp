@@ -38,6 +38,12 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -46,7 +52,9 @@
 #endif
 
 #include <cmath>
+#include <limits>
 #include <unordered_map>
+#include <unordered_set>
 
 // Dump addresses to peers.dat every 15 minutes (900s)
 static constexpr int DUMP_PEERS_INTERVAL = 15 * 60;
@@ -725,8 +733,11 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_vSend) {
     size_t nSentSize = 0;
     size_t nMsgCount = 0;
+    // Whether sending stopped while the socket may still take more
+    bool fRequeue = false;
 
-    for (const auto &data : pnode->vSendMsg) {
+    for (const CSendBuffer &buffer : pnode->vSendMsg) {
+        const Span<const uint8_t> data = buffer.Data();
         assert(data.size() > pnode->nSendOffset);
         int nBytes = 0;
 
@@ -745,6 +756,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
 
         if (nBytes == 0) {
             // couldn't send anything at all
+            fRequeue = true;
             break;
         }
 
@@ -755,6 +767,8 @@ size_t CConnman::SocketSendData(CNode *pnode) const
                 nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
                 LogPrintf("socket send error %s\n", NetworkErrorString(nErr));
                 pnode->CloseSocketDisconnect();
+            } else if (nErr != WSAEWOULDBLOCK) {
+                fRequeue = true;
             }
 
             break;
@@ -767,6 +781,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
         nSentSize += nBytes;
         if (pnode->nSendOffset != data.size()) {
             // could not send full message; stop sending more
+            fRequeue = true;
             break;
         }
 
@@ -782,6 +797,8 @@ size_t CConnman::SocketSendData(CNode *pnode) const
     if (pnode->vSendMsg.empty()) {
         assert(pnode->nSendOffset == 0);
         assert(pnode->nSendSize == 0);
+    } else if (fRequeue) {
+        RequeueSend(pnode);
     }
 
     return nSentSize;
@@ -1097,6 +1114,7 @@ void CConnman::AcceptConnection(const ListenSocket &hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        AddToSocketHandler(pnode);
     }
 }
 
@@ -1133,6 +1151,7 @@ void CConnman::DisconnectNodes() {
                 // hold in disconnected pool until all refs are released
                 pnode->Release();
                 vNodesDisconnected.push_back(pnode);
+                RemoveFromSocketHandler(pnode);
             }
         }
     }
@@ -1208,6 +1227,74 @@ void CConnman::InactivityCheck(CNode *pnode) {
     }
 }
 
+/**
+ * Receive what the socket of pnode holds, up to 64 KiB, and hand the messages
+ * completed to the message handler.
+ *
+ * @returns whether the socket may hold more to receive
+ */
+bool CConnman::ReceiveFromSocket(CNode *pnode) {
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int32_t nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET) {
+            return false;
+        }
+        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    }
+    if (nBytes > 0) {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(*config, pchBuf, nBytes, notify)) {
+            pnode->CloseSocketDisconnect();
+        }
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete()) {
+                    break;
+                }
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(),
+                                          pnode->vRecvMsg,
+                                          pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv =
+                    pnode->nProcessQueueSize > nReceiveFloodSize;
+            }
+            WakeMessageHandler(pnode);
+        }
+        return true;
+    }
+    if (nBytes == 0) {
+        // socket closed gracefully
+        if (!pnode->fDisconnect) {
+            LogPrint(BCLog::NET, "socket closed\n");
+        }
+        pnode->CloseSocketDisconnect();
+        return false;
+    }
+    // error
+    int nErr = WSAGetLastError();
+    if (nErr == WSAEWOULDBLOCK) {
+        return false;
+    }
+    if (nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
+        if (!pnode->fDisconnect) {
+            LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+        }
+        pnode->CloseSocketDisconnect();
+        return false;
+    }
+    return true;
+}
+
 bool CConnman::GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set) {
     for (const ListenSocket &hListenSocket : vhListenSocket) {
         recv_set.insert(hListenSocket.socket);
@@ -1420,62 +1507,7 @@ void CConnman::SocketHandler()
             errorSet = error_set.count(pnode->hSocket) > 0;
         }
         if (recvSet || errorSet) {
-            // typical socket buffer is 8K-64K
-            char pchBuf[0x10000];
-            int32_t nBytes = 0;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET) {
-                    continue;
-                }
-                nBytes =
-                    recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-            }
-            if (nBytes > 0) {
-                bool notify = false;
-                if (!pnode->ReceiveMsgBytes(*config, pchBuf, nBytes, notify)) {
-                    pnode->CloseSocketDisconnect();
-                }
-                RecordBytesRecv(nBytes);
-                if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        if (!it->complete()) {
-                            break;
-                        }
-                        nSizeAdded +=
-                            it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(),
-                                                  pnode->vRecvMsg,
-                                                  pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv =
-                            pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
-                    WakeMessageHandler();
-                }
-            } else if (nBytes == 0) {
-                // socket closed gracefully
-                if (!pnode->fDisconnect) {
-                    LogPrint(BCLog::NET, "socket closed\n");
-                }
-                pnode->CloseSocketDisconnect();
-            } else if (nBytes < 0) {
-                // error
-                int nErr = WSAGetLastError();
-                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE &&
-                    nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
-                    if (!pnode->fDisconnect) {
-                        LogPrintf("socket recv error %s\n",
-                                  NetworkErrorString(nErr));
-                    }
-                    pnode->CloseSocketDisconnect();
-                }
-            }
+            ReceiveFromSocket(pnode);
         }
 
         //
@@ -1507,12 +1539,311 @@ void CConnman::ThreadSocketHandler() {
     }
 }
 
-void CConnman::WakeMessageHandler() {
+#ifdef USE_EPOLL
+//! epoll data of the event which wakes a socket handler thread up
+static constexpr uint64_t EPOLL_WAKE_DATA = std::numeric_limits<uint64_t>::max();
+//! epoll data of listen sockets, or'ed with their index in vhListenSocket.
+//! That of peer sockets is the id of the peer.
+static constexpr uint64_t EPOLL_LISTEN_DATA = uint64_t(1) << 63;
+//! Number of events taken out of epoll at once
+static constexpr int EPOLL_MAX_EVENTS = 256;
+
+struct CConnman::SocketHandlerThread {
+    const int epoll_fd;
+    //! eventfd written to to wake the thread up out of epoll_wait
+    const int wake_fd;
+    const std::string name;
+    std::thread thread;
+
+    Mutex cs_changes;
+    //! Peers to start servicing, each with a reference taken for the thread
+    std::vector<CNode *> vAdded GUARDED_BY(cs_changes);
+    //! Peers disconnected, whose reference the thread is to release
+    std::vector<NodeId> vRemoved GUARDED_BY(cs_changes);
+    //! Peers to try sending to again
+    std::vector<NodeId> vSendAgain GUARDED_BY(cs_changes);
+
+    SocketHandlerThread(int epoll_fd_in, int wake_fd_in, std::string name_in)
+        : epoll_fd(epoll_fd_in), wake_fd(wake_fd_in), name(std::move(name_in)) {}
+
+    ~SocketHandlerThread() {
+        close(wake_fd);
+        close(epoll_fd);
+    }
+
+    void Wake() {
+        const uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {
+            // The counter is already set if it is full.
+        }
+    }
+};
+
+bool CConnman::StartSocketHandlers() {
+    m_socket_handlers.clear();
+    for (int i = 0; i < nNetThreads; ++i) {
+        const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            LogPrintf("Failed to create epoll instance: %s\n",
+                      NetworkErrorString(errno));
+            return false;
+        }
+        const int wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd < 0) {
+            LogPrintf("Failed to create eventfd: %s\n",
+                      NetworkErrorString(errno));
+            close(epoll_fd);
+            return false;
+        }
+        m_socket_handlers.push_back(std::make_unique<SocketHandlerThread>(
+            epoll_fd, wake_fd, i == 0 ? "net" : strprintf("net.%d", i)));
+
+        struct epoll_event ev {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = EPOLL_WAKE_DATA;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) != 0) {
+            LogPrintf("Failed to register eventfd with epoll: %s\n",
+                      NetworkErrorString(errno));
+            return false;
+        }
+    }
+
+    // The first thread accepts the connections. Listen sockets are left
+    // level-triggered, so that those not accepted at once come up again.
+    for (size_t i = 0; i < vhListenSocket.size(); ++i) {
+        struct epoll_event ev {};
+        ev.events = EPOLLIN;
+        ev.data.u64 = EPOLL_LISTEN_DATA | i;
+        if (epoll_ctl(m_socket_handlers[0]->epoll_fd, EPOLL_CTL_ADD,
+                      vhListenSocket[i].socket, &ev) != 0) {
+            LogPrintf("Failed to register listen socket with epoll: %s\n",
+                      NetworkErrorString(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+void CConnman::ThreadSocketHandlerEpoll(SocketHandlerThread &handler,
+                                        bool fMain) {
+    //! Peers serviced by this thread, each with a reference held
+    std::unordered_map<NodeId, CNode *> mapNodes;
+    //! Peers whose socket may have more to receive
+    std::unordered_set<NodeId> setReadable;
+    std::vector<struct epoll_event> events(EPOLL_MAX_EVENTS);
+    bool fMoreToRead = false;
+    int64_t nLastInactivityCheck = 0;
+
+    while (!interruptNet) {
+        if (fMain) {
+            DisconnectNodes();
+            NotifyNumConnectionsChanged();
+        }
+
+        std::vector<CNode *> vAdded;
+        std::vector<NodeId> vRemoved;
+        std::vector<NodeId> vSendAgain;
+        {
+            LOCK(handler.cs_changes);
+            vAdded.swap(handler.vAdded);
+            vRemoved.swap(handler.vRemoved);
+            vSendAgain.swap(handler.vSendAgain);
+        }
+        for (CNode *pnode : vAdded) {
+            // Sockets are registered edge-triggered, for as long as the peer
+            // is connected: an event comes once each time a socket gets data
+            // to receive or room to send, and setReadable keeps track of the
+            // sockets which may have more to receive.
+            struct epoll_event ev {};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            ev.data.u64 = uint64_t(pnode->GetId());
+            bool fRegistered = true;
+            {
+                LOCK(pnode->cs_hSocket);
+                if (pnode->hSocket != INVALID_SOCKET) {
+                    fRegistered = epoll_ctl(handler.epoll_fd, EPOLL_CTL_ADD,
+                                            pnode->hSocket, &ev) == 0;
+                }
+            }
+            if (!fRegistered) {
+                LogPrintf("socket epoll registration error %s\n",
+                          NetworkErrorString(errno));
+                pnode->CloseSocketDisconnect();
+            }
+            mapNodes.emplace(pnode->GetId(), pnode);
+        }
+        for (NodeId id : vRemoved) {
+            // The socket was closed on disconnection, which took it out of the
+            // epoll set.
+            auto it = mapNodes.find(id);
+            if (it != mapNodes.end()) {
+                it->second->Release();
+                mapNodes.erase(it);
+                setReadable.erase(id);
+            }
+        }
+
+        int nEvents = epoll_wait(handler.epoll_fd, events.data(), events.size(),
+                                 fMoreToRead ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+        if (interruptNet) {
+            return;
+        }
+        if (nEvents < 0) {
+            if (errno != EINTR) {
+                LogPrintf("socket epoll error %s\n", NetworkErrorString(errno));
+                interruptNet.sleep_for(
+                    std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+            }
+            nEvents = 0;
+        }
+
+        for (int i = 0; i < nEvents; ++i) {
+            const uint64_t data = events[i].data.u64;
+            if (data == EPOLL_WAKE_DATA) {
+                uint64_t count;
+                if (read(handler.wake_fd, &count, sizeof(count)) < 0) {
+                    // Woken up by someone else meanwhile.
+                }
+                continue;
+            }
+            if (data & EPOLL_LISTEN_DATA) {
+                AcceptConnection(vhListenSocket[data & ~EPOLL_LISTEN_DATA]);
+                continue;
+            }
+            auto it = mapNodes.find(NodeId(data));
+            if (it == mapNodes.end()) {
+                // Left over from a peer disconnected meanwhile.
+                continue;
+            }
+            CNode *pnode = it->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                // As with poll, errors are found out by receiving.
+                if (ReceiveFromSocket(pnode)) {
+                    setReadable.insert(pnode->GetId());
+                }
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+                setReadable.insert(pnode->GetId());
+            }
+            if (events[i].events & EPOLLOUT) {
+                vSendAgain.push_back(pnode->GetId());
+            }
+        }
+
+        // Those whose sending stopped short of the socket being full are
+        // requeued by SocketSendData, which wakes this thread up again.
+        for (NodeId id : vSendAgain) {
+            auto it = mapNodes.find(id);
+            if (it == mapNodes.end()) {
+                continue;
+            }
+            CNode *pnode = it->second;
+            LOCK(pnode->cs_vSend);
+            if (!pnode->vSendMsg.empty()) {
+                size_t nBytes = SocketSendData(pnode);
+                if (nBytes) {
+                    RecordBytesSent(nBytes);
+                }
+            }
+        }
+
+        fMoreToRead = false;
+        for (auto it = setReadable.begin(); it != setReadable.end();) {
+            if (interruptNet) {
+                return;
+            }
+            CNode *pnode = mapNodes.at(*it);
+            // As with poll, peers are not received from while their messages
+            // wait to be processed, nor while what is to be sent to them could
+            // not be, so that TCP flow control holds them back.
+            const bool fSendPending = WITH_LOCK(
+                pnode->cs_vSend, return !pnode->vSendMsg.empty());
+            if (pnode->fPauseRecv || fSendPending) {
+                ++it;
+                continue;
+            }
+            if (ReceiveFromSocket(pnode)) {
+                fMoreToRead = true;
+                ++it;
+            } else {
+                it = setReadable.erase(it);
+            }
+        }
+
+        const int64_t nNow = GetSystemTimeInSeconds();
+        if (nNow != nLastInactivityCheck) {
+            nLastInactivityCheck = nNow;
+            for (const auto &entry : mapNodes) {
+                InactivityCheck(entry.second);
+            }
+        }
+    }
+}
+#endif
+
+void CConnman::AddToSocketHandler(CNode *pnode) {
+#ifdef USE_EPOLL
+    if (m_socket_handlers.empty()) {
+        return;
+    }
+    SocketHandlerThread &handler =
+        *m_socket_handlers[pnode->GetId() % m_socket_handlers.size()];
+    pnode->AddRef();
+    {
+        LOCK(handler.cs_changes);
+        handler.vAdded.push_back(pnode);
+    }
+    handler.Wake();
+#endif
+}
+
+void CConnman::RemoveFromSocketHandler(CNode *pnode) {
+#ifdef USE_EPOLL
+    if (m_socket_handlers.empty()) {
+        return;
+    }
+    SocketHandlerThread &handler =
+        *m_socket_handlers[pnode->GetId() % m_socket_handlers.size()];
     {
-        std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        LOCK(handler.cs_changes);
+        handler.vRemoved.push_back(pnode->GetId());
     }
-    condMsgProc.notify_one();
+    handler.Wake();
+#endif
+}
+
+void CConnman::RequeueSend(CNode *pnode) const {
+#ifdef USE_EPOLL
+    if (m_socket_handlers.empty()) {
+        return;
+    }
+    SocketHandlerThread &handler =
+        *m_socket_handlers[pnode->GetId() % m_socket_handlers.size()];
+    {
+        LOCK(handler.cs_changes);
+        handler.vSendAgain.push_back(pnode->GetId());
+    }
+    handler.Wake();
+#endif
+}
+
+void CConnman::WakeMessageHandler() {
+    LOCK(mutexMsgProc);
+    for (const auto &handler : m_msghand_threads) {
+        handler->fMsgProcWake = true;
+        handler->condMsgProc.notify_one();
+    }
+}
+
+void CConnman::WakeMessageHandler(const CNode *pnode) {
+    LOCK(mutexMsgProc);
+    if (m_msghand_threads.empty()) {
+        return;
+    }
+    MessageHandlerThread &handler = *m_msghand_threads[pnode->GetId() % m_msghand_threads.size()];
+    handler.fMsgProcWake = true;
+    handler.condMsgProc.notify_one();
 }
 
 #ifdef USE_UPNP
@@ -2095,17 +2426,22 @@ void CConnman::OpenNetworkConnection(const CAddress &addrConnect,
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        AddToSocketHandler(pnode);
     }
 }
 
-void CConnman::ThreadMessageHandler() {
+void CConnman::ThreadMessageHandler(MessageHandlerThread &handler, int nThread) {
     while (!flagInterruptMsgProc) {
+        // Each peer is processed by a single thread, so that its messages are
+        // processed in order and the state of the peer which only its own
+        // processing touches (vRecvGetData, hashContinue...) needs no lock.
         std::vector<CNode *> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (CNode *pnode : vNodesCopy) {
-                pnode->AddRef();
+            for (CNode *pnode : vNodes) {
+                if (pnode->GetId() % nMsgHandThreads == nThread) {
+                    vNodesCopy.push_back(pnode->AddRef());
+                }
             }
         }
 
@@ -2149,9 +2485,9 @@ void CConnman::ThreadMessageHandler() {
             auto nSleepFor =
                 std::max(std::chrono::microseconds{0}, std::min(std::chrono::microseconds{100000},
                                                                 nSleepUntil - GetTime<std::chrono::microseconds>()));
-            condMsgProc.wait_for(lock, nSleepFor, [this] { return fMsgProcWake; });
+            handler.condMsgProc.wait_for(lock, nSleepFor, [&handler] { return handler.fMsgProcWake; });
         }
-        fMsgProcWake = false;
+        handler.fMsgProcWake = false;
     }
 }
 
@@ -2422,14 +2758,44 @@ bool CConnman::Start(CScheduler &scheduler, const Options &connOptions) {
     flagInterruptMsgProc = false;
 
     {
+        // Set up before the socket handlers start, as they wake these up.
         LOCK(mutexMsgProc);
-        fMsgProcWake = false;
+        m_msghand_threads.clear();
+        for (int i = 0; i < nMsgHandThreads; ++i) {
+            auto handler = std::make_unique<MessageHandlerThread>();
+            handler->name = i == 0 ? "msghand" : strprintf("msghand.%d", i);
+            m_msghand_threads.push_back(std::move(handler));
+        }
     }
 
     // Send and receive from sockets, accept connections
+#ifdef USE_EPOLL
+    if (!StartSocketHandlers()) {
+        if (clientInterface) {
+            clientInterface->ThreadSafeMessageBox(
+                _("Failed to set up the socket handler threads."), "",
+                CClientUIInterface::MSG_ERROR);
+        }
+        return false;
+    }
+    for (size_t i = 1; i < m_socket_handlers.size(); ++i) {
+        SocketHandlerThread &handler = *m_socket_handlers[i];
+        handler.thread = std::thread(
+            &TraceThread<std::function<void()>>, handler.name.c_str(),
+            std::function<void()>(
+                std::bind(&CConnman::ThreadSocketHandlerEpoll, this,
+                          std::ref(handler), false)));
+    }
+    threadSocketHandler = std::thread(
+        &TraceThread<std::function<void()>>, "net",
+        std::function<void()>(std::bind(&CConnman::ThreadSocketHandlerEpoll,
+                                        this, std::ref(*m_socket_handlers[0]),
+                                        true)));
+#else
     threadSocketHandler = std::thread(
         &TraceThread<std::function<void()>>, "net",
         std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
+#endif
 
     if (!gArgs.GetBoolArg("-dnsseed", true)) {
         LogPrintf("DNS seeding disabled\n");
@@ -2465,10 +2831,15 @@ bool CConnman::Start(CScheduler &scheduler, const Options &connOptions) {
     }
 
     // Process messages
-    threadMessageHandler =
-        std::thread(&TraceThread<std::function<void()>>, "msghand",
-                    std::function<void()>(
-                        std::bind(&CConnman::ThreadMessageHandler, this)));
+    {
+        LOCK(mutexMsgProc);
+        for (int i = 0; i < nMsgHandThreads; ++i) {
+            MessageHandlerThread &handler = *m_msghand_threads[i];
+            handler.thread = std::thread(&TraceThread<std::function<void()>>, handler.name.c_str(),
+                                         std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this,
+                                                                         std::ref(handler), i)));
+        }
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(
@@ -2495,12 +2866,19 @@ public:
 
 void CConnman::Interrupt() {
     {
-        std::lock_guard<std::mutex> lock(mutexMsgProc);
+        LOCK(mutexMsgProc);
         flagInterruptMsgProc = true;
+        for (const auto &handler : m_msghand_threads) {
+            handler->condMsgProc.notify_all();
+        }
     }
-    condMsgProc.notify_all();
 
     interruptNet();
+#ifdef USE_EPOLL
+    for (const auto &handler : m_socket_handlers) {
+        handler->Wake();
+    }
+#endif
     InterruptSocks5(true);
 
     if (semOutbound) {
@@ -2517,8 +2895,17 @@ void CConnman::Interrupt() {
 }
 
 void CConnman::Stop() {
-    if (threadMessageHandler.joinable()) {
-        threadMessageHandler.join();
+    std::vector<std::thread *> msghand_threads;
+    {
+        LOCK(mutexMsgProc);
+        for (const auto &handler : m_msghand_threads) {
+            msghand_threads.push_back(&handler->thread);
+        }
+    }
+    for (std::thread *thread : msghand_threads) {
+        if (thread->joinable()) {
+            thread->join();
+        }
     }
     if (threadOpenConnections.joinable()) {
         threadOpenConnections.join();
@@ -2532,6 +2919,20 @@ void CConnman::Stop() {
     if (threadSocketHandler.joinable()) {
         threadSocketHandler.join();
     }
+#ifdef USE_EPOLL
+    for (const auto &handler : m_socket_handlers) {
+        if (handler->thread.joinable()) {
+            handler->thread.join();
+        }
+    }
+    // The references the threads held go with the nodes deleted below.
+    m_socket_handlers.clear();
+#endif
+    {
+        // Only now that the socket handlers, which wake them up, are stopped.
+        LOCK(mutexMsgProc);
+        m_msghand_threads.clear();
+    }
 
     if (fAddressesInitialized) {
         DumpAddresses();
@@ -2893,15 +3294,25 @@ bool CConnman::NodeFullyConnected(const CNode *pnode) {
     return pnode && pnode->fSuccessfullyConnected && !pnode->fDisconnect;
 }
 
+SharedNetMsgPayload::SharedNetMsgPayload(std::vector<uint8_t> &&buffer) {
+    auto buffer_ptr = std::make_shared<const std::vector<uint8_t>>(std::move(buffer));
+    data = MakeSpan(*buffer_ptr);
+    owner = std::move(buffer_ptr);
+    hash = Hash(data);
+}
+
+SharedNetMsgPayload::SharedNetMsgPayload(std::shared_ptr<const void> ownerIn, Span<const uint8_t> dataIn)
+    : owner(std::move(ownerIn)), data(dataIn), hash(Hash(dataIn)) {}
+
 void CConnman::PushMessage(CNode *pnode, CSerializedNetMsg &&msg) {
-    size_t nMessageSize = msg.data.size();
+    size_t nMessageSize = msg.Payload().size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n", SanitizeString(msg.m_type.c_str()), nMessageSize,
              pnode->GetId());
 
     std::vector<uint8_t> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(MakeSpan(msg.data).first(nMessageSize));
+    uint256 hash = msg.shared ? msg.shared->hash : Hash(msg.data);
     CMessageHeader hdr(config->GetChainParams().NetMagic(), msg.m_type.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
@@ -2919,9 +3330,13 @@ void CConnman::PushMessage(CNode *pnode, CSerializedNetMsg &&msg) {
         if (pnode->nSendSize > nSendBufferMaxSize) {
             pnode->fPauseSend = true;
         }
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
+        pnode->vSendMsg.emplace_back(std::move(serializedHeader));
         if (nMessageSize) {
-            pnode->vSendMsg.push_back(std::move(msg.data));
+            if (msg.shared) {
+                pnode->vSendMsg.emplace_back(std::move(msg.shared));
+            } else {
+                pnode->vSendMsg.emplace_back(std::move(msg.data));
+            }
         }
 
         // If write queue empty, attempt "optimistic write"
@@ -2951,7 +3366,8 @@ int64_t CConnman::PoissonNextSendInbound(int64_t now, int average_interval_ms) {
         // If this function were called from multiple threads simultaneously
         // it would be possible that both update the next send variable, and
         // return a different result to their caller. This is not possible in
-        // practice as only the net processing thread invokes this function.
+        // practice as the message handler threads invoke this function with
+        // cs_main held.
         m_next_send_inv_to_incoming =
             PoissonNextSend(now, average_interval_ms);
     }
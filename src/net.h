@@ -22,11 +22,13 @@
 #include <netaddress.h>
 #include <protocol.h>
 #include <random.h>
+#include <span.h>
 #include <streams.h>
 #include <sync.h>
 #include <threadinterrupt.h>
 #include <uint256.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
@@ -95,6 +97,14 @@ static const uint64_t MAX_UPLOAD_TIMEFRAME = 60 * 60 * 24;
 static const bool DEFAULT_BLOCKSONLY = false;
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
+/** -netthreads default */
+static const int DEFAULT_NET_THREADS = 1;
+/** Maximum number of socket handler threads */
+static const int MAX_NET_THREADS = 16;
+/** -msghandthreads default */
+static const int DEFAULT_MSGHAND_THREADS = 1;
+/** Maximum number of message handler threads */
+static const int MAX_MSGHAND_THREADS = 16;
 
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
@@ -110,6 +120,22 @@ struct AddedNodeInfo {
 struct CNodeStats;
 class CClientUIInterface;
 
+/**
+ * The serialized payload of a message which is sent as it is to several peers,
+ * such as a recent block, so that it is neither copied nor hashed for each of
+ * them. data points into memory kept alive by owner: the buffer it was
+ * serialized into, or the mapping of the block file it was read from.
+ */
+struct SharedNetMsgPayload {
+    std::shared_ptr<const void> owner;
+    Span<const uint8_t> data;
+    //! Double SHA256 of data, the start of which is the message checksum
+    uint256 hash;
+
+    explicit SharedNetMsgPayload(std::vector<uint8_t> &&buffer);
+    SharedNetMsgPayload(std::shared_ptr<const void> ownerIn, Span<const uint8_t> dataIn);
+};
+
 struct CSerializedNetMsg {
     CSerializedNetMsg() = default;
     CSerializedNetMsg(CSerializedNetMsg &&) = default;
@@ -119,7 +145,22 @@ struct CSerializedNetMsg {
     CSerializedNetMsg &operator=(const CSerializedNetMsg &) = delete;
 
     std::vector<uint8_t> data;
+    //! If set, the payload, in place of data
+    std::shared_ptr<const SharedNetMsgPayload> shared;
     std::string m_type;
+
+    Span<const uint8_t> Payload() const { return shared ? shared->data : MakeSpan(data); }
+};
+
+/** Bytes queued to be sent to a peer, either its own or shared with other peers. */
+struct CSendBuffer {
+    std::vector<uint8_t> owned;
+    std::shared_ptr<const SharedNetMsgPayload> shared;
+
+    explicit CSendBuffer(std::vector<uint8_t> &&ownedIn) : owned(std::move(ownedIn)) {}
+    explicit CSendBuffer(std::shared_ptr<const SharedNetMsgPayload> sharedIn) : shared(std::move(sharedIn)) {}
+
+    Span<const uint8_t> Data() const { return shared ? shared->data : MakeSpan(owned); }
 };
 
 class NetEventsInterface;
@@ -147,6 +188,8 @@ public:
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        int nNetThreads = DEFAULT_NET_THREADS;
+        int nMsgHandThreads = DEFAULT_MSGHAND_THREADS;
         std::vector<std::string> vSeedNodes;
         std::vector<NetWhitelistPermissions> vWhitelistedRange;
         std::vector<NetWhitebindPermissions> vWhiteBinds;
@@ -173,6 +216,8 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        nNetThreads = std::clamp(connOptions.nNetThreads, 1, MAX_NET_THREADS);
+        nMsgHandThreads = std::clamp(connOptions.nMsgHandThreads, 1, MAX_MSGHAND_THREADS);
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -330,7 +375,10 @@ public:
 
     unsigned int GetReceiveFloodSize() const;
 
+    /** Wake all the message handler threads up. */
     void WakeMessageHandler();
+    /** Wake the message handler thread which processes the messages of pnode up. */
+    void WakeMessageHandler(const CNode *pnode);
 
     /**
      * Attempts to obfuscate tx time through exponentially distributed emitting.
@@ -365,15 +413,30 @@ private:
     void AddOneShot(const std::string &strDest);
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
-    void ThreadMessageHandler();
+    struct MessageHandlerThread;
+    void ThreadMessageHandler(MessageHandlerThread &handler, int nThread);
     void AcceptConnection(const ListenSocket &hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
+    bool ReceiveFromSocket(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketHandler();
     void ThreadSocketHandler();
+    void AddToSocketHandler(CNode *pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_vNodes);
+    void RemoveFromSocketHandler(CNode *pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_vNodes);
+    /**
+     * Have the socket handler thread of the peer try sending to it again,
+     * for when sending stopped with more to send while the socket could still
+     * take some: no edge-triggered EPOLLOUT event may come for it then.
+     */
+    void RequeueSend(CNode *pnode) const;
+#ifdef USE_EPOLL
+    struct SocketHandlerThread;
+    bool StartSocketHandlers();
+    void ThreadSocketHandlerEpoll(SocketHandlerThread &handler, bool fMain);
+#endif
     void ThreadDNSAddressSeed();
 
     uint64_t CalculateKeyedNetGroup(const CAddress &ad) const;
@@ -420,6 +483,12 @@ private:
     // P2P timeout in seconds
     int64_t m_peer_connect_timeout;
 
+    // Number of threads servicing the sockets of peers
+    int nNetThreads{DEFAULT_NET_THREADS};
+
+    // Number of threads processing the messages of peers
+    int nMsgHandThreads{DEFAULT_MSGHAND_THREADS};
+
     // Whitelisted ranges. Any node connecting from these is automatically
     // whitelisted (as well as those connecting to whitelisted binds).
     std::vector<NetWhitelistPermissions> vWhitelistedRange;
@@ -487,20 +556,37 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /**
+     * A thread processing the messages of the peers whose id falls to it, in
+     * the order they were received in, and sending messages to them.
+     */
+    struct MessageHandlerThread {
+        //! Thread name, as given to TraceThread
+        std::string name;
+        std::thread thread;
+        std::condition_variable condMsgProc;
+        //! flag for waking the message processor, guarded by mutexMsgProc.
+        bool fMsgProcWake{false};
+    };
 
-    std::condition_variable condMsgProc;
     Mutex mutexMsgProc;
+    std::vector<std::unique_ptr<MessageHandlerThread>> m_msghand_threads GUARDED_BY(mutexMsgProc);
     std::atomic<bool> flagInterruptMsgProc{false};
 
     CThreadInterrupt interruptNet;
 
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
+#ifdef USE_EPOLL
+    /**
+     * With epoll, each socket handler thread services the peers whose id
+     * falls to it, the first one also accepting connections and disconnecting
+     * peers. threadSocketHandler runs the first one.
+     */
+    std::vector<std::unique_ptr<SocketHandlerThread>> m_socket_handlers;
+#endif
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
 
     /**
      * Flag for deciding to connect to an extra outbound peer, in excess of
@@ -700,7 +786,7 @@ public:
     // Offset inside the first vSendMsg already sent.
     size_t nSendOffset{0};
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<uint8_t>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<CSendBuffer> vSendMsg GUARDED_BY(cs_vSend);
     mutable RecursiveMutex cs_vSend;
     RecursiveMutex cs_hSocket;
     RecursiveMutex cs_vRecv;
@@ -788,8 +874,10 @@ public:
     std::atomic<int> nStartingHeight{-1};
 
     // flood relay
-    std::vector<CAddress> vAddrToSend;
-    CRollingBloomFilter addrKnown;
+    // Addresses are pushed to a peer while processing the messages of others.
+    Mutex cs_addrToSend;
+    std::vector<CAddress> vAddrToSend GUARDED_BY(cs_addrToSend);
+    CRollingBloomFilter addrKnown GUARDED_BY(cs_addrToSend);
     bool fGetAddr{false};
     std::chrono::microseconds m_next_addr_send GUARDED_BY(cs_sendProcessing){0};
     std::chrono::microseconds m_next_local_addr_send GUARDED_BY(cs_sendProcessing){0};
@@ -893,6 +981,7 @@ public:
     void Release() { nRefCount--; }
 
     void AddAddressKnown(const CAddress &_addr) {
+        LOCK(cs_addrToSend);
         addrKnown.insert(_addr.GetKey());
     }
 
@@ -905,6 +994,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_addrToSend);
         if (_addr.IsValid() && !addrKnown.contains(_addr.GetKey()) && addr_format_supported) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand.randrange(vAddrToSend.size())] =
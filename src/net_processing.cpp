@@ -11,7 +11,9 @@
 #include <addrman.h>
 #include <arith_uint256.h>
 #include <banman.h>
+#include <blockfilter.h>
 #include <blockencodings.h>
+#include <blockservecache.h>
 #include <blockvalidity.h>
 #include <chain.h>
 #include <chainparams.h>
@@ -21,6 +23,7 @@
 #include <dsproof/storage.h>
 #include <extversion.h>
 #include <hash.h>
+#include <index/blockfilterindex.h>
 #include <merkleblock.h>
 #include <net.h>
 #include <netbase.h>
@@ -36,6 +39,7 @@
 #include <tinyformat.h>
 #include <txmempool.h>
 #include <ui_interface.h>
+#include <util/defer.h>
 #include <util/moneystr.h>
 #include <util/strencodings.h>
 #include <util/system.h>
@@ -97,6 +101,16 @@ static constexpr int STALE_RELAY_AGE_LIMIT = 30 * 24 * 60 * 60;
 /// Age after which a block is considered historical for purposes of rate
 /// limiting block relay. Set to one week, denominated in seconds.
 static constexpr int HISTORICAL_BLOCK_AGE = 7 * 24 * 60 * 60;
+/**
+ * Maximum number of cf hashes that may be requested with one getcfheaders. See
+ * BIP 157.
+ */
+static constexpr uint32_t MAX_GETCFHEADERS_SIZE = 2000;
+/**
+ * Maximum number of compact filters that may be requested with one getcfilters.
+ * See BIP 157.
+ */
+static constexpr uint32_t MAX_GETCFILTERS_SIZE = 1000;
 /** Maximum number of in-flight transactions from a peer */
 static constexpr int32_t MAX_PEER_TX_IN_FLIGHT = 100;
 /** Maximum number of announced transactions from a peer */
@@ -238,6 +252,19 @@ std::deque<std::pair<int64_t, MapRelay::iterator>>
 // Used only to inform the wallet of when we last received a block
 std::atomic<int64_t> nTimeBestReceived(0);
 
+/**
+ * Held while processing the messages which carry blocks or headers, so that
+ * those are processed one at a time and in the order they were taken in, even
+ * with several message handler threads. Acquired before cs_main.
+ */
+Mutex g_cs_block_processing;
+
+/**
+ * Serialized blocks and compact blocks, shared by the messages to all the
+ * peers they are sent to. Sized by -maxblockservecachesize.
+ */
+BlockServeCache g_block_serve_cache(DEFAULT_MAX_BLOCK_SERVE_CACHE_SIZE << 20);
+
 static size_t vExtraTxnForCompactIt GUARDED_BY(internal::g_cs_orphans) = 0;
 static std::vector<std::pair<TxHash, CTransactionRef>>
     vExtraTxnForCompact GUARDED_BY(internal::g_cs_orphans);
@@ -1193,6 +1220,10 @@ PeerLogicValidation::PeerLogicValidation(CConnman *connmanIn, BanMan *banman,
       m_enable_bip61(enable_bip61) {
     // Initialize global variables that cannot be constructed at startup.
     recentRejects.reset(new CRollingBloomFilter(120000, 0.000001));
+    g_block_serve_cache.SetMaxBytes(
+        std::clamp<int64_t>(gArgs.GetArg("-maxblockservecachesize", DEFAULT_MAX_BLOCK_SERVE_CACHE_SIZE), 0,
+                            MAX_MAX_BLOCK_SERVE_CACHE_SIZE)
+        << 20);
 
     const Consensus::Params &consensusParams = Params().GetConsensus();
     // Stale tip checking and peer eviction are on two different timers, but we
@@ -1272,6 +1303,8 @@ void PeerLogicValidation::NewPoWValidBlock(
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> pcmpctblock =
         std::make_shared<const CBlockHeaderAndShortTxIDs>(*pblock);
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    // Serialized once for all the peers it gets announced and sent to.
+    auto cmpctblock_payload = msgMaker.MakePayload(*pcmpctblock);
 
     LOCK(cs_main);
 
@@ -1289,12 +1322,12 @@ void PeerLogicValidation::NewPoWValidBlock(
         most_recent_block = pblock;
         most_recent_compact_block = pcmpctblock;
     }
+    g_block_serve_cache.Insert(pblock->GetHash(), true, cmpctblock_payload);
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker,
+    connman->ForEachNode([this, &cmpctblock_payload, pindex, &msgMaker,
                           &hashBlock](CNode *pnode) {
         AssertLockHeld(cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect) {
             return;
         }
@@ -1308,7 +1341,7 @@ void PeerLogicValidation::NewPoWValidBlock(
                      "PeerLogicValidation::NewPoWValidBlock",
                      hashBlock.ToString(), pnode->GetId());
             connman->PushMessage(
-                pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+                pnode, msgMaker.MakeShared(NetMsgType::CMPCTBLOCK, cmpctblock_payload));
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1492,6 +1525,20 @@ static void RelayAddress(const CAddress &addr, bool fReachable, const CConnman &
     connman.ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/** A block, which is the recent one if it matches, or is read from disk. */
+static std::shared_ptr<const CBlock> ReadBlock(const CBlockIndex *pindex,
+                                               const std::shared_ptr<const CBlock> &recent_block,
+                                               const Consensus::Params &params) {
+    if (recent_block && recent_block->GetHash() == pindex->GetBlockHash()) {
+        return recent_block;
+    }
+    auto pblockRead = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*pblockRead, pindex, params)) {
+        return nullptr;
+    }
+    return pblockRead;
+}
+
 static void ProcessGetBlockData(const Config &config, CNode *pfrom,
                                 const CInv &inv, CConnman *connman,
                                 const std::atomic<bool> &interruptMsgProc) {
@@ -1534,135 +1581,174 @@ static void ProcessGetBlockData(const Config &config, CNode *pfrom,
         }
     }
 
-    LOCK(cs_main);
-    const CBlockIndex *pindex = LookupBlockIndex(hash);
-    if (pindex) {
-        send = BlockRequestAllowed(pindex, consensusParams);
-        if (!send) {
+    const CBlockIndex *pindex;
+    // Whether a block asked for as a compact block is recent enough to send as one
+    bool fSendCompact;
+    // Whether the block is recent enough for many peers to ask for it at once,
+    // and so to keep in g_block_serve_cache
+    bool fNearTip;
+    BlockHash hashTip;
+    {
+        LOCK(cs_main);
+        pindex = LookupBlockIndex(hash);
+        if (pindex) {
+            send = BlockRequestAllowed(pindex, consensusParams);
+            if (!send) {
+                LogPrint(BCLog::NET,
+                         "%s: ignoring request from peer=%i for old "
+                         "block that isn't in the main chain\n",
+                         __func__, pfrom->GetId());
+            }
+        }
+        // Disconnect node in case we have reached the outbound limit for serving
+        // historical blocks.
+        // Never disconnect whitelisted nodes.
+        if (send && connman->OutboundTargetReached(true) &&
+            (((pindexBestHeader != nullptr) &&
+              (pindexBestHeader->GetBlockTime() - pindex->GetBlockTime() >
+               HISTORICAL_BLOCK_AGE)) ||
+             inv.type == MSG_FILTERED_BLOCK) &&
+            !pfrom->HasPermission(PF_NOBAN)) {
+            LogPrint(BCLog::NET,
+                     "historical block serving limit reached, disconnect peer=%d\n",
+                     pfrom->GetId());
+
+            // disconnect node
+            pfrom->fDisconnect = true;
+            send = false;
+        }
+        // Avoid leaking prune-height by never sending blocks below the
+        // NODE_NETWORK_LIMITED threshold.
+        // Add two blocks buffer extension for possible races
+        if (send && !pfrom->HasPermission(PF_NOBAN) &&
+            ((((pfrom->GetLocalServices() & NODE_NETWORK_LIMITED) ==
+               NODE_NETWORK_LIMITED) &&
+              ((pfrom->GetLocalServices() & NODE_NETWORK) != NODE_NETWORK) &&
+              (::ChainActive().Tip()->nHeight - pindex->nHeight >
+               (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2)))) {
             LogPrint(BCLog::NET,
-                     "%s: ignoring request from peer=%i for old "
-                     "block that isn't in the main chain\n",
-                     __func__, pfrom->GetId());
+                     "Ignore block request below NODE_NETWORK_LIMITED "
+                     "threshold from peer=%d\n",
+                     pfrom->GetId());
+
+            // disconnect node and prevent it from stalling (would otherwise wait
+            // for the missing block)
+            pfrom->fDisconnect = true;
+            send = false;
+        }
+        // Pruned nodes may have deleted the block, so check whether it's available
+        // before trying to send.
+        if (!send || !pindex->nStatus.hasData()) {
+            return;
         }
+        fNearTip = pindex->nHeight >= ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH;
+        fSendCompact = CanDirectFetch(consensusParams) && fNearTip;
+        hashTip = ::ChainActive().Tip()->GetBlockHash();
     }
-    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
-    // Disconnect node in case we have reached the outbound limit for serving
-    // historical blocks.
-    // Never disconnect whitelisted nodes.
-    if (send && connman->OutboundTargetReached(true) &&
-        (((pindexBestHeader != nullptr) &&
-          (pindexBestHeader->GetBlockTime() - pindex->GetBlockTime() >
-           HISTORICAL_BLOCK_AGE)) ||
-         inv.type == MSG_FILTERED_BLOCK) &&
-        !pfrom->HasPermission(PF_NOBAN)) {
-        LogPrint(BCLog::NET,
-                 "historical block serving limit reached, disconnect peer=%d\n",
-                 pfrom->GetId());
 
-        // disconnect node
-        pfrom->fDisconnect = true;
-        send = false;
-    }
-    // Avoid leaking prune-height by never sending blocks below the
-    // NODE_NETWORK_LIMITED threshold.
-    // Add two blocks buffer extension for possible races
-    if (send && !pfrom->HasPermission(PF_NOBAN) &&
-        ((((pfrom->GetLocalServices() & NODE_NETWORK_LIMITED) ==
-           NODE_NETWORK_LIMITED) &&
-          ((pfrom->GetLocalServices() & NODE_NETWORK) != NODE_NETWORK) &&
-          (::ChainActive().Tip()->nHeight - pindex->nHeight >
-           (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2)))) {
-        LogPrint(BCLog::NET,
-                 "Ignore block request below NODE_NETWORK_LIMITED "
-                 "threshold from peer=%d\n",
+    // The block is read and sent without cs_main, so that the message handler
+    // threads serve blocks to their peers at the same time. It may get pruned
+    // meanwhile, in which case the peer is disconnected as it would otherwise
+    // wait for the block.
+    auto blockReadFailed = [&]() {
+        if (WITH_LOCK(cs_main, return pindex->nStatus.hasData())) {
+            assert(!"cannot load block from disk");
+        }
+        LogPrint(BCLog::NET, "Block was pruned before it could be read, disconnect peer=%d\n",
                  pfrom->GetId());
-
-        // disconnect node and prevent it from stalling (would otherwise wait
-        // for the missing block)
         pfrom->fDisconnect = true;
-        send = false;
-    }
-    // Pruned nodes may have deleted the block, so check whether it's available
-    // before trying to send.
-    if (send && pindex->nStatus.hasData()) {
-        std::shared_ptr<const CBlock> pblock;
-        if (a_recent_block &&
-            a_recent_block->GetHash() == pindex->GetBlockHash()) {
-            pblock = a_recent_block;
-        } else {
-            // Send block from disk
-            std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-            if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams)) {
-                assert(!"cannot load block from disk");
+    };
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    // If a peer is asking for old blocks, we're almost guaranteed they
+    // won't have a useful mempool to match against a compact block, and
+    // we don't feel like constructing the object for them, so instead
+    // we respond with the full, non-compact block.
+    if (inv.type == MSG_CMPCT_BLOCK && fSendCompact) {
+        // Made once for all the peers which ask for it.
+        auto payload = g_block_serve_cache.GetOrMake(hash, true, [&]() -> BlockServeCache::Payload {
+            if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == hash) {
+                return CNetMsgMaker(PROTOCOL_VERSION).MakePayload(*a_recent_compact_block);
             }
-            pblock = pblockRead;
-        }
-        if (inv.type == MSG_BLOCK) {
-            connman->PushMessage(pfrom,
-                                 msgMaker.Make(NetMsgType::BLOCK, *pblock));
-        } else if (inv.type == MSG_FILTERED_BLOCK) {
-            bool sendMerkleBlock = false;
-            CMerkleBlock merkleBlock;
-            {
-                LOCK(pfrom->cs_filter);
-                if (pfrom->pfilter) {
-                    sendMerkleBlock = true;
-                    merkleBlock = CMerkleBlock(*pblock, *pfrom->pfilter);
-                }
+            std::shared_ptr<const CBlock> pblock = ReadBlock(pindex, a_recent_block, consensusParams);
+            if (!pblock) {
+                return nullptr;
             }
-            if (sendMerkleBlock) {
-                connman->PushMessage(
-                    pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
-                // CMerkleBlock just contains hashes, so also push any
-                // transactions in the block the client did not see. This avoids
-                // hurting performance by pointlessly requiring a round-trip.
-                // Note that there is currently no way for a node to request any
-                // single transactions we didn't send here - they must either
-                // disconnect and retry or request the full block. Thus, the
-                // protocol spec specified allows for us to provide duplicate
-                // txn here, however we MUST always provide at least what the
-                // remote peer needs.
-                typedef std::pair<size_t, uint256> PairType;
-                for (PairType &pair : merkleBlock.vMatchedTxn) {
-                    connman->PushMessage(
-                        pfrom, msgMaker.Make(NetMsgType::TX,
-                                             *pblock->vtx[pair.first]));
-                }
+            return CNetMsgMaker(PROTOCOL_VERSION).MakePayload(CBlockHeaderAndShortTxIDs(*pblock));
+        });
+        if (!payload) {
+            blockReadFailed();
+            return;
+        }
+        connman->PushMessage(pfrom, msgMaker.MakeShared(NetMsgType::CMPCTBLOCK, std::move(payload)));
+    } else if (inv.type == MSG_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
+        // The most recent block gets serialized once, any other one is sent
+        // straight from the mapped block file. Only the blocks near the tip
+        // are shared through the cache by all the peers which ask for them, as
+        // each one read from disk keeps the mapping of its whole block file.
+        auto make = [&]() -> BlockServeCache::Payload {
+            if (a_recent_block && a_recent_block->GetHash() == hash) {
+                return CNetMsgMaker(PROTOCOL_VERSION).MakePayload(*a_recent_block);
             }
-            // else
-            // no response
-        } else if (inv.type == MSG_CMPCT_BLOCK) {
-            // If a peer is asking for old blocks, we're almost guaranteed they
-            // won't have a useful mempool to match against a compact block, and
-            // we don't feel like constructing the object for them, so instead
-            // we respond with the full, non-compact block.
-            int nSendFlags = 0;
-            if (CanDirectFetch(consensusParams) &&
-                pindex->nHeight >=
-                    ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH) {
-                CBlockHeaderAndShortTxIDs cmpctblock(*pblock);
-                connman->PushMessage(
-                    pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK,
-                                         cmpctblock));
-            } else {
+            RawBlock rawBlock;
+            if (!ReadRawBlockFromDisk(rawBlock, pindex, consensusParams)) {
+                return nullptr;
+            }
+            return std::make_shared<const SharedNetMsgPayload>(std::move(rawBlock.file), rawBlock.data);
+        };
+        auto payload = fNearTip ? g_block_serve_cache.GetOrMake(hash, false, make) : make();
+        if (!payload) {
+            blockReadFailed();
+            return;
+        }
+        connman->PushMessage(pfrom, msgMaker.MakeShared(NetMsgType::BLOCK, std::move(payload)));
+    } else if (inv.type == MSG_FILTERED_BLOCK) {
+        std::shared_ptr<const CBlock> pblock = ReadBlock(pindex, a_recent_block, consensusParams);
+        if (!pblock) {
+            blockReadFailed();
+            return;
+        }
+        bool sendMerkleBlock = false;
+        CMerkleBlock merkleBlock;
+        {
+            LOCK(pfrom->cs_filter);
+            if (pfrom->pfilter) {
+                sendMerkleBlock = true;
+                merkleBlock = CMerkleBlock(*pblock, *pfrom->pfilter);
+            }
+        }
+        if (sendMerkleBlock) {
+            connman->PushMessage(
+                pfrom, msgMaker.Make(NetMsgType::MERKLEBLOCK, merkleBlock));
+            // CMerkleBlock just contains hashes, so also push any
+            // transactions in the block the client did not see. This avoids
+            // hurting performance by pointlessly requiring a round-trip.
+            // Note that there is currently no way for a node to request any
+            // single transactions we didn't send here - they must either
+            // disconnect and retry or request the full block. Thus, the
+            // protocol spec specified allows for us to provide duplicate
+            // txn here, however we MUST always provide at least what the
+            // remote peer needs.
+            typedef std::pair<size_t, uint256> PairType;
+            for (PairType &pair : merkleBlock.vMatchedTxn) {
                 connman->PushMessage(
-                    pfrom,
-                    msgMaker.Make(nSendFlags, NetMsgType::BLOCK, *pblock));
+                    pfrom, msgMaker.Make(NetMsgType::TX,
+                                         *pblock->vtx[pair.first]));
             }
         }
+        // else
+        // no response
+    }
 
-        // Trigger the peer node to send a getblocks request for the next batch
-        // of inventory.
-        if (hash == pfrom->hashContinue) {
-            // Bypass PushInventory, this must send even if redundant, and we
-            // want it right after the last block so they don't wait for other
-            // stuff first.
-            std::vector<CInv> vInv;
-            vInv.emplace_back(
-                MSG_BLOCK, ::ChainActive().Tip()->GetBlockHash());
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::INV, vInv));
-            pfrom->hashContinue = BlockHash();
-        }
+    // Trigger the peer node to send a getblocks request for the next batch
+    // of inventory.
+    if (hash == pfrom->hashContinue) {
+        // Bypass PushInventory, this must send even if redundant, and we
+        // want it right after the last block so they don't wait for other
+        // stuff first.
+        std::vector<CInv> vInv;
+        vInv.emplace_back(MSG_BLOCK, hashTip);
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::INV, vInv));
+        pfrom->hashContinue = BlockHash();
     }
 }
 
@@ -2082,6 +2168,248 @@ static void PushVerACK(CConnman *connman, CNode *pfrom, int nVersion = 0 /* 0 =
     connman->PushMessage(pfrom, msg_maker.Make(NetMsgType::VERACK));
 }
 
+/**
+ * Validation logic for compact filters request handling.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ *
+ * @param[in]   pfrom           The peer that we received the request from
+ * @param[in]   chain_params    Chain parameters
+ * @param[in]   filter_type     The filter type the request is for. Must be
+ *                              basic filters.
+ * @param[in]   start_height    The start height for the request
+ * @param[in]   stop_hash       The stop_hash for the request
+ * @param[in]   max_height_diff The maximum number of items permitted to request,
+ *                              as specified in BIP 157
+ * @param[out]  stop_index      The CBlockIndex for the stop_hash block, if the
+ *                              request can be serviced.
+ * @param[out]  filter_index    The filter index, if the request can be
+ *                              serviced.
+ * @return                      True if the request can be serviced.
+ */
+static bool PrepareBlockFilterRequest(
+    CNode *pfrom, const CChainParams &chain_params,
+    BlockFilterType filter_type, uint32_t start_height,
+    const BlockHash &stop_hash, uint32_t max_height_diff,
+    const CBlockIndex *&stop_index, BlockFilterIndex *&filter_index) {
+    const bool supported_filter_type =
+        (filter_type == BlockFilterType::BASIC &&
+         (pfrom->GetLocalServices() & NODE_CF));
+    if (!supported_filter_type) {
+        LogPrint(BCLog::NET,
+                 "peer %d requested unsupported block filter type: %d\n",
+                 pfrom->GetId(), static_cast<uint8_t>(filter_type));
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    {
+        LOCK(cs_main);
+        stop_index = LookupBlockIndex(stop_hash);
+
+        // Check that the stop block exists and the peer would be allowed to
+        // fetch it.
+        if (!stop_index ||
+            !BlockRequestAllowed(stop_index, chain_params.GetConsensus())) {
+            LogPrint(BCLog::NET, "peer %d requested invalid block hash: %s\n",
+                     pfrom->GetId(), stop_hash.ToString());
+            pfrom->fDisconnect = true;
+            return false;
+        }
+    }
+
+    uint32_t stop_height = stop_index->nHeight;
+    if (start_height > stop_height) {
+        LogPrint(BCLog::NET,
+                 "peer %d sent invalid getcfilters/getcfheaders with "
+                 "start height %d and stop height %d\n",
+                 pfrom->GetId(), start_height, stop_height);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+    if (stop_height - start_height >= max_height_diff) {
+        LogPrint(BCLog::NET,
+                 "peer %d requested too many cfilters/cfheaders: %d / %d\n",
+                 pfrom->GetId(), stop_height - start_height + 1,
+                 max_height_diff);
+        pfrom->fDisconnect = true;
+        return false;
+    }
+
+    filter_index = GetBlockFilterIndex(filter_type);
+    if (!filter_index) {
+        LogPrint(BCLog::NET, "Filter index for supported type %s not found\n",
+                 BlockFilterTypeName(filter_type));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Handle a cfilters request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ *
+ * @param[in]   pfrom           The peer that we received the request from
+ * @param[in]   vRecv           The raw message received
+ * @param[in]   chain_params    Chain parameters
+ * @param[in]   connman         Pointer to the connection manager
+ */
+static void ProcessGetCFilters(CNode *pfrom, CDataStream &vRecv,
+                               const CChainParams &chain_params,
+                               CConnman *connman) {
+    uint8_t filter_type_ser;
+    uint32_t start_height;
+    BlockHash stop_hash;
+
+    vRecv >> filter_type_ser >> start_height >> stop_hash;
+
+    const BlockFilterType filter_type =
+        static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex *stop_index;
+    BlockFilterIndex *filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, chain_params, filter_type,
+                                   start_height, stop_hash,
+                                   MAX_GETCFILTERS_SIZE, stop_index,
+                                   filter_index)) {
+        return;
+    }
+
+    std::vector<BlockFilter> filters;
+    if (!filter_index->LookupFilterRange(start_height, stop_index, filters)) {
+        LogPrint(BCLog::NET,
+                 "Failed to find block filter in index: filter_type=%s, "
+                 "start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filter_type), start_height,
+                 stop_hash.ToString());
+        return;
+    }
+
+    const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
+    for (const auto &filter : filters) {
+        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CFILTER, filter));
+    }
+}
+
+/**
+ * Handle a cfheaders request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ *
+ * @param[in]   pfrom           The peer that we received the request from
+ * @param[in]   vRecv           The raw message received
+ * @param[in]   chain_params    Chain parameters
+ * @param[in]   connman         Pointer to the connection manager
+ */
+static void ProcessGetCFHeaders(CNode *pfrom, CDataStream &vRecv,
+                                const CChainParams &chain_params,
+                                CConnman *connman) {
+    uint8_t filter_type_ser;
+    uint32_t start_height;
+    BlockHash stop_hash;
+
+    vRecv >> filter_type_ser >> start_height >> stop_hash;
+
+    const BlockFilterType filter_type =
+        static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex *stop_index;
+    BlockFilterIndex *filter_index;
+    if (!PrepareBlockFilterRequest(pfrom, chain_params, filter_type,
+                                   start_height, stop_hash,
+                                   MAX_GETCFHEADERS_SIZE, stop_index,
+                                   filter_index)) {
+        return;
+    }
+
+    uint256 prev_header;
+    if (start_height > 0) {
+        const CBlockIndex *const prev_block =
+            stop_index->GetAncestor(static_cast<int>(start_height - 1));
+        if (!filter_index->LookupFilterHeader(prev_block, prev_header)) {
+            LogPrint(BCLog::NET,
+                     "Failed to find block filter header in index: "
+                     "filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filter_type),
+                     prev_block->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    std::vector<uint256> filter_hashes;
+    if (!filter_index->LookupFilterHashRange(start_height, stop_index,
+                                             filter_hashes)) {
+        LogPrint(BCLog::NET,
+                 "Failed to find block filter hashes in index: "
+                 "filter_type=%s, start_height=%d, stop_hash=%s\n",
+                 BlockFilterTypeName(filter_type), start_height,
+                 stop_hash.ToString());
+        return;
+    }
+
+    connman->PushMessage(
+        pfrom, CNetMsgMaker(pfrom->GetSendVersion())
+                   .Make(NetMsgType::CFHEADERS, filter_type_ser,
+                         stop_index->GetBlockHash(), prev_header,
+                         filter_hashes));
+}
+
+/**
+ * Handle a getcfcheckpt request.
+ *
+ * May disconnect from the peer in the case of a bad request.
+ *
+ * @param[in]   pfrom           The peer that we received the request from
+ * @param[in]   vRecv           The raw message received
+ * @param[in]   chain_params    Chain parameters
+ * @param[in]   connman         Pointer to the connection manager
+ */
+static void ProcessGetCFCheckPt(CNode *pfrom, CDataStream &vRecv,
+                                const CChainParams &chain_params,
+                                CConnman *connman) {
+    uint8_t filter_type_ser;
+    BlockHash stop_hash;
+
+    vRecv >> filter_type_ser >> stop_hash;
+
+    const BlockFilterType filter_type =
+        static_cast<BlockFilterType>(filter_type_ser);
+
+    const CBlockIndex *stop_index;
+    BlockFilterIndex *filter_index;
+    if (!PrepareBlockFilterRequest(
+            pfrom, chain_params, filter_type, /*start_height=*/0, stop_hash,
+            /*max_height_diff=*/std::numeric_limits<uint32_t>::max(),
+            stop_index, filter_index)) {
+        return;
+    }
+
+    std::vector<uint256> headers(stop_index->nHeight / CFCHECKPT_INTERVAL);
+
+    // Populate headers.
+    const CBlockIndex *block_index = stop_index;
+    for (int i = headers.size() - 1; i >= 0; i--) {
+        int height = (i + 1) * CFCHECKPT_INTERVAL;
+        block_index = block_index->GetAncestor(height);
+
+        if (!filter_index->LookupFilterHeader(block_index, headers[i])) {
+            LogPrint(BCLog::NET,
+                     "Failed to find block filter header in index: "
+                     "filter_type=%s, block_hash=%s\n",
+                     BlockFilterTypeName(filter_type),
+                     block_index->GetBlockHash().ToString());
+            return;
+        }
+    }
+
+    connman->PushMessage(
+        pfrom, CNetMsgMaker(pfrom->GetSendVersion())
+                   .Make(NetMsgType::CFCHECKPT, filter_type_ser,
+                         stop_index->GetBlockHash(), headers));
+}
+
 static bool ProcessMessage(const Config &config, CNode *pfrom,
                            const std::string &msg_type, CDataStream &vRecv,
                            int64_t nTimeReceived, CConnman *connman,
@@ -2910,17 +3238,37 @@ static bool ProcessMessage(const Config &config, CNode *pfrom,
         CInv inv(MSG_TX, txid);
         pfrom->AddInventoryKnown(inv);
 
+        // Do what needs neither cs_main nor the mempool lock first, so that
+        // AcceptToMemoryPool holds them for a short while only. Transactions
+        // already known, or rejected before, are not worth checking again.
+        CValidationState state;
+        std::vector<COutPoint> coins_to_uncache;
+        if (!WITH_LOCK(cs_main, return AlreadyHave(inv))) {
+            PreCheckTransactionForMempool(config, g_mempool, state, ptx,
+                                          &coins_to_uncache);
+        }
+
         LOCK2(cs_main, internal::g_cs_orphans);
 
+        // The coins the precheck brought into the UTXO cache are left there
+        // for AcceptToMemoryPool, and only as long as it takes the transaction.
+        Defer uncache([&coins_to_uncache, &txid]() {
+            AssertLockHeld(cs_main);
+            if (!coins_to_uncache.empty() && !g_mempool.exists(txid)) {
+                for (const COutPoint &outpoint : coins_to_uncache) {
+                    pcoinsTip->Uncache(outpoint);
+                }
+            }
+        });
+
         bool fMissingInputs = false;
-        CValidationState state;
 
         CNodeState *nodestate = State(pfrom->GetId());
         nodestate->m_tx_download.m_tx_announced.erase(txid);
         nodestate->m_tx_download.m_tx_in_flight.erase(txid);
         EraseTxRequest(txid);
 
-        if (!AlreadyHave(inv) &&
+        if (!AlreadyHave(inv) && state.IsValid() &&
             AcceptToMemoryPool(config, g_mempool, state, ptx, &fMissingInputs,
                                false /* bypass_limits */,
                                Amount::zero() /* nAbsurdFee */)) {
@@ -3613,7 +3961,7 @@ static bool ProcessMessage(const Config &config, CNode *pfrom,
         }
         pfrom->fSentAddr = true;
 
-        pfrom->vAddrToSend.clear();
+        WITH_LOCK(pfrom->cs_addrToSend, pfrom->vAddrToSend.clear());
         std::vector<CAddress> vAddr;
         if (pfrom->HasPermission(PF_ADDR)) {
             vAddr = connman->GetAddresses(MAX_ADDR_TO_SEND, MAX_PCT_ADDR_TO_SEND);
@@ -3807,6 +4155,21 @@ static bool ProcessMessage(const Config &config, CNode *pfrom,
         return true;
     }
 
+    if (msg_type == NetMsgType::GETCFILTERS) {
+        ProcessGetCFilters(pfrom, vRecv, chainparams, connman);
+        return true;
+    }
+
+    if (msg_type == NetMsgType::GETCFHEADERS) {
+        ProcessGetCFHeaders(pfrom, vRecv, chainparams, connman);
+        return true;
+    }
+
+    if (msg_type == NetMsgType::GETCFCHECKPT) {
+        ProcessGetCFCheckPt(pfrom, vRecv, chainparams, connman);
+        return true;
+    }
+
     if (msg_type == NetMsgType::DSPROOF) {
         LogPrint(BCLog::DSPROOF, "Received a Double Spend Proof from peer %d\n", pfrom->GetId());
         if (!DoubleSpendProof::IsEnabled()) {
@@ -4040,8 +4403,15 @@ bool PeerLogicValidation::ProcessMessages(const Config &config, CNode *pfrom,
     // Process message
     bool fRet = false;
     try {
-        fRet = ProcessMessage(config, pfrom, msg_type, vRecv, msg.nTime,
-                              connman, interruptMsgProc, m_enable_bip61);
+        if (msg_type == NetMsgType::BLOCK || msg_type == NetMsgType::CMPCTBLOCK ||
+            msg_type == NetMsgType::BLOCKTXN || msg_type == NetMsgType::HEADERS) {
+            LOCK(g_cs_block_processing);
+            fRet = ProcessMessage(config, pfrom, msg_type, vRecv, msg.nTime,
+                                  connman, interruptMsgProc, m_enable_bip61);
+        } else {
+            fRet = ProcessMessage(config, pfrom, msg_type, vRecv, msg.nTime,
+                                  connman, interruptMsgProc, m_enable_bip61);
+        }
         if (interruptMsgProc) {
             return false;
         }
@@ -4352,6 +4722,7 @@ bool PeerLogicValidation::SendMessages(const Config &config, CNode *pto,
     //
     if (pto->m_next_addr_send < current_time) {
         pto->m_next_addr_send = PoissonNextSend(current_time, AVG_ADDRESS_BROADCAST_INTERVAL);
+        LOCK(pto->cs_addrToSend);
         std::vector<CAddress> vAddr;
         vAddr.reserve(pto->vAddrToSend.size());
 
@@ -4518,31 +4889,31 @@ bool PeerLogicValidation::SendMessages(const Config &config, CNode *pto,
                          "%s sending header-and-ids %s to peer=%d\n", __func__,
                          vHeaders.front().GetHash().ToString(), pto->GetId());
 
-                int nSendFlags = 0;
-
-                bool fGotBlockFromCache = false;
-                {
-                    LOCK(cs_most_recent_block);
-                    if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                        CBlockHeaderAndShortTxIDs cmpctblock(
-                            *most_recent_block);
-                        connman->PushMessage(
-                            pto,
-                            msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK,
-                                          cmpctblock));
-                        fGotBlockFromCache = true;
+                // The compact block is cached, to be shared by all the peers
+                // it gets announced to. It is not waited for here, with
+                // cs_main held, should another thread be making it.
+                auto payload = g_block_serve_cache.Get(pBestIndex->GetBlockHash(), true);
+                if (!payload) {
+                    std::shared_ptr<const CBlock> pblock;
+                    {
+                        LOCK(cs_most_recent_block);
+                        if (most_recent_block_hash == pBestIndex->GetBlockHash()) {
+                            pblock = most_recent_block;
+                        }
                     }
+                    if (!pblock) {
+                        auto pblockRead = std::make_shared<CBlock>();
+                        bool ret = ReadBlockFromDisk(*pblockRead, pBestIndex,
+                                                     consensusParams);
+                        assert(ret);
+                        pblock = std::move(pblockRead);
+                    }
+                    payload = CNetMsgMaker(PROTOCOL_VERSION)
+                                  .MakePayload(CBlockHeaderAndShortTxIDs(*pblock));
+                    g_block_serve_cache.Insert(pBestIndex->GetBlockHash(), true, payload);
                 }
-                if (!fGotBlockFromCache) {
-                    CBlock block;
-                    bool ret =
-                        ReadBlockFromDisk(block, pBestIndex, consensusParams);
-                    assert(ret);
-                    CBlockHeaderAndShortTxIDs cmpctblock(block);
-                    connman->PushMessage(
-                        pto, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK,
-                                           cmpctblock));
-                }
+                connman->PushMessage(
+                    pto, msgMaker.MakeShared(NetMsgType::CMPCTBLOCK, std::move(payload)));
                 state.pindexBestHeaderSent = pBestIndex;
             } else if (state.fPreferHeaders) {
                 if (vHeaders.size() > 1) {
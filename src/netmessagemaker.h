@@ -8,6 +8,8 @@
 #include <net.h>
 #include <serialize.h>
 
+#include <memory>
+
 class CNetMsgMaker {
 public:
     explicit CNetMsgMaker(int nVersionIn) : nVersion(nVersionIn) {}
@@ -27,6 +29,21 @@ public:
         return Make(0, std::move(msg_type), std::forward<Args>(args)...);
     }
 
+    /** Serialize a payload once, to send it to several peers with MakeShared. */
+    template <typename... Args>
+    std::shared_ptr<const SharedNetMsgPayload> MakePayload(Args &&... args) const {
+        std::vector<uint8_t> data;
+        CVectorWriter{SER_NETWORK, nVersion, data, 0, std::forward<Args>(args)...};
+        return std::make_shared<const SharedNetMsgPayload>(std::move(data));
+    }
+
+    CSerializedNetMsg MakeShared(std::string msg_type, std::shared_ptr<const SharedNetMsgPayload> payload) const {
+        CSerializedNetMsg msg;
+        msg.m_type = std::move(msg_type);
+        msg.shared = std::move(payload);
+        return msg;
+    }
+
 private:
     const int nVersion;
 };
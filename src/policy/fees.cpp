@@ -20,7 +20,8 @@ FeeFilterRounder::FeeFilterRounder(const CFeeRate &minIncrementalFee) {
 
 Amount FeeFilterRounder::round(const Amount currentMinFee) {
     auto it = feeset.lower_bound(currentMinFee);
-    if ((it != feeset.begin() && insecure_rand.rand32() % 3 != 0) ||
+    if ((it != feeset.begin() &&
+         WITH_LOCK(m_insecure_rand_mutex, return insecure_rand.rand32()) % 3 != 0) ||
         it == feeset.end()) {
         it--;
     }
@@ -6,6 +6,7 @@
 
 #include <amount.h>
 #include <random.h>
+#include <sync.h>
 #include <uint256.h>
 
 #include <map>
@@ -29,10 +30,14 @@ public:
     /** Create new FeeFilterRounder */
     explicit FeeFilterRounder(const CFeeRate &minIncrementalFee);
 
-    /** Quantize a minimum fee for privacy purpose before broadcast **/
+    /**
+     * Quantize a minimum fee for privacy purpose before broadcast. May be
+     * called from several message handler threads at once.
+     **/
     Amount round(const Amount currentMinFee);
 
 private:
     std::set<Amount> feeset;
-    FastRandomContext insecure_rand;
+    Mutex m_insecure_rand_mutex;
+    FastRandomContext insecure_rand GUARDED_BY(m_insecure_rand_mutex);
 };
@@ -138,6 +138,7 @@ bool AreInputsStandard(const CTransaction &tx, const CCoinsViewCache &mapInputs,
 
 CFeeRate dustRelayFee = CFeeRate(DUST_RELAY_TX_FEE);
 uint32_t nBytesPerSigCheck = DEFAULT_BYTES_PER_SIGCHECK;
+uint32_t nMempoolParallelInputs = DEFAULT_MEMPOOL_PARALLEL_INPUTS;
 
 int64_t GetVirtualTransactionSize(int64_t nSize, int64_t nSigChecks,
                                   unsigned int bytes_per_sigcheck) {
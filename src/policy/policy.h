@@ -37,6 +37,11 @@ static constexpr Amount DEFAULT_BLOCK_MIN_TX_FEE_PER_KB(1000000 * SATOSHI);
  * TestBlockValidity() on the generated block template.
  */
 static constexpr bool DEFAULT_GBT_CHECK_VALIDITY = true;
+/**
+ * Default for -gbtincremental, which determines whether getblocktemplate keeps
+ * its block template up to date with the mempool instead of rebuilding it.
+ */
+static constexpr bool DEFAULT_GBT_INCREMENTAL = true;
 /**
  * The maximum size for transactions we're willing to relay/mine.
  */
@@ -67,6 +72,12 @@ static constexpr CFeeRate MEMPOOL_FULL_FEE_INCREMENT(100 * SATOSHI);
  * Default for -bytespersigocheck.
  */
 static constexpr unsigned int DEFAULT_BYTES_PER_SIGCHECK = 1;
+/**
+ * Default for -mempoolparallelinputs, the number of inputs from which the
+ * scripts of a transaction entering the mempool are checked on several
+ * threads.
+ */
+static constexpr unsigned int DEFAULT_MEMPOOL_PARALLEL_INPUTS = 200;
 /**
  * Min feerate for defining dust. Historically this has been the same as the
  * minRelayTxFee, however changing the dust limit changes which transactions are
@@ -160,6 +171,7 @@ bool AreInputsStandard(const CTransaction &tx, const CCoinsViewCache &mapInputs,
 
 extern CFeeRate dustRelayFee;
 extern uint32_t nBytesPerSigCheck;
+extern uint32_t nMempoolParallelInputs;
 
 /**
  * Compute the virtual transaction size (size, or more if sigchecks is too large).
@@ -6,10 +6,53 @@
 #include <primitives/block.h>
 
 #include <crypto/common.h>
+#include <crypto/sha512_256.h>
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 #include <key_io.h>
+#include <version.h>
+
+/** Size of a serialized block header; a single SHA-512/256 chunk once padded. */
+static constexpr size_t BLOCK_HEADER_SIZE = 80;
+
+uint256 BlockHashCalculator::CalculateBlockHashFromHeader_sha512_256(const CBlockHeader& header) {
+    std::vector<uint8_t> raw;
+    raw.reserve(BLOCK_HEADER_SIZE);
+    CVectorWriter(SER_GETHASH, PROTOCOL_VERSION, raw, 0, header);
+    assert(raw.size() == BLOCK_HEADER_SIZE);
+    // Double sha512/256 of the blockheader
+    uint256 blockhash;
+    SHA512_256D80(blockhash.begin(), raw.data(), 1);
+    if (ENABLE_SHA512_256_HEADER_DEBUG) {
+        std::cerr << "Checking Blockheader: " << HexStr(raw) << std::endl;
+        std::cerr << "Checking Blockhash Hex: " << blockhash.GetHex() << std::endl;
+    }
+    return blockhash;
+}
+
+std::vector<BlockHash> BlockHashCalculator::CalculateBlockHashesFromHeaders_sha512_256(const std::vector<CBlockHeader>& headers) {
+    std::vector<BlockHash> hashes(headers.size());
+    CalculateBlockHashesFromHeaders_sha512_256(headers.data(), headers.size(), hashes.data());
+    return hashes;
+}
+
+void BlockHashCalculator::CalculateBlockHashesFromHeaders_sha512_256(const CBlockHeader* headers, size_t count, BlockHash* hashes) {
+    std::vector<uint8_t> raw;
+    raw.reserve(count * BLOCK_HEADER_SIZE);
+    CVectorWriter writer(SER_GETHASH, PROTOCOL_VERSION, raw, 0);
+    for (size_t i = 0; i < count; ++i) {
+        writer << headers[i];
+    }
+    assert(raw.size() == count * BLOCK_HEADER_SIZE);
+
+    std::vector<uint8_t> digests(count * CSHA512_256::OUTPUT_SIZE);
+    SHA512_256D80(digests.data(), raw.data(), count);
+    for (size_t i = 0; i < count; ++i) {
+        std::copy_n(digests.begin() + i * CSHA512_256::OUTPUT_SIZE, CSHA512_256::OUTPUT_SIZE, hashes[i].begin());
+    }
+}
 
 BlockHash CBlockHeader::GetHash() const {
     uint256 hash = BlockHashCalculator::CalculateBlockHashFromHeader_sha512_256(*this);
@@ -125,20 +125,14 @@ class BlockHashCalculator {
  
 public:
  
-    static uint256 CalculateBlockHashFromHeader_sha512_256(const CBlockHeader& header) {
-        std::stringstream ss;
-        ::Serialize(ss, header);
-        std::string rawByteStr = ss.str();
-        // Double sha512/256 of the blockheader
-        std::string sha512_256dHash = sha512_256(boost::algorithm::unhex(sha512_256(rawByteStr)));
-        std::string sha512_256dHashHex = boost::algorithm::unhex(sha512_256dHash);
-        std::string reversed = std::string(sha512_256dHashHex.rbegin(), sha512_256dHashHex.rend());
-        uint256 blockhash = uint256S(boost::algorithm::hex(reversed));
-        if (ENABLE_SHA512_256_HEADER_DEBUG) {
-            std::cerr << "Checking Blockheader: " << boost::algorithm::hex(rawByteStr) << std::endl; 
-            std::cerr << "Checking Blockhash Hex: " << blockhash.GetHex() << std::endl;
-        }
-        return blockhash;
-    }
+    static uint256 CalculateBlockHashFromHeader_sha512_256(const CBlockHeader& header);
+
+    /**
+     * Calculate the hashes of many block headers at once. This uses the
+     * multi-buffer SHA-512/256 kernels where the CPU supports them, so prefer
+     * it whenever headers are hashed in bulk.
+     */
+    static std::vector<BlockHash> CalculateBlockHashesFromHeaders_sha512_256(const std::vector<CBlockHeader>& headers);
+    static void CalculateBlockHashesFromHeaders_sha512_256(const CBlockHeader* headers, size_t count, BlockHash* hashes);
 
 };
@@ -445,8 +445,9 @@ struct RefHashDataSummary {
     uint256 refsHash;
 };
 
+template <typename RefSet>
 static inline RefHashDataSummary getRefHashDataSummary(
-    const std::set<uint288> &pushRefSet,
+    const RefSet &pushRefSet, // any sorted container of uint288: std::set or a sorted std::vector
     const CScript& script, 
     const Amount& amount, 
     const uint256& zeroRefHash
@@ -463,9 +464,8 @@ static inline RefHashDataSummary getRefHashDataSummary(
          // Get the hash of the concatentation of all of the refs in the output
         CHashWriter hashWriterScriptPubKeyColorPushRefs(SER_GETHASH, 0);
         // Then output all colors
-        std::set<uint288>::const_iterator outputIt;
-        for (outputIt = pushRefSet.begin(); outputIt != pushRefSet.end(); outputIt++) {
-            hashWriterScriptPubKeyColorPushRefs << *outputIt;
+        for (const auto &ref : pushRefSet) {
+            hashWriterScriptPubKeyColorPushRefs << ref;
         }
         outputDataSummary.refsHash = hashWriterScriptPubKeyColorPushRefs.GetHash();
     }
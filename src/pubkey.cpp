@@ -12,6 +12,42 @@
 namespace {
 /* Global secp256k1_context object used for verification. */
 secp256k1_context *secp256k1_context_verify = nullptr;
+
+/**
+ * Size of the scratch space of batch verification, enough for a few hundred
+ * signatures per multiplication.
+ */
+constexpr size_t SCHNORR_BATCH_SCRATCH_SIZE = 1 << 20;
+
+/**
+ * The scratch space of batch verification, allocated once per thread (the
+ * script check threads) rather than once per batch. It is created with the
+ * static context, which outlives the threads, unlike secp256k1_context_verify.
+ */
+class SchnorrBatchScratch {
+    secp256k1_scratch_space *scratch = nullptr;
+
+public:
+    SchnorrBatchScratch() = default;
+    SchnorrBatchScratch(const SchnorrBatchScratch &) = delete;
+    SchnorrBatchScratch &operator=(const SchnorrBatchScratch &) = delete;
+    ~SchnorrBatchScratch() {
+        if (scratch) {
+            secp256k1_scratch_space_destroy(secp256k1_context_no_precomp,
+                                            scratch);
+        }
+    }
+
+    secp256k1_scratch_space *Get() {
+        if (!scratch) {
+            scratch = secp256k1_scratch_space_create(
+                secp256k1_context_no_precomp, SCHNORR_BATCH_SCRATCH_SIZE);
+        }
+        return scratch;
+    }
+};
+
+thread_local SchnorrBatchScratch schnorr_batch_scratch;
 } // namespace
 
 /**
@@ -215,6 +251,37 @@ bool CPubKey::VerifySchnorr(const uint256 &hash,
                                     hash.begin(), &pubkey);
 }
 
+bool CPubKey::VerifySchnorrBatch(
+    const std::vector<const SchnorrBatchEntry *> &batch) {
+    if (batch.size() == 1) {
+        return batch[0]->pubkey.VerifySchnorr(batch[0]->hash, batch[0]->vchSig);
+    }
+
+    std::vector<secp256k1_pubkey> pubkeys(batch.size());
+    std::vector<const secp256k1_pubkey *> pubkeyptrs(batch.size());
+    std::vector<const uint8_t *> sigs(batch.size());
+    std::vector<const uint8_t *> hashes(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const SchnorrBatchEntry &entry = *batch[i];
+        if (!entry.pubkey.IsValid() || entry.vchSig.size() != 64 ||
+            !secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkeys[i],
+                                       entry.pubkey.data(),
+                                       entry.pubkey.size())) {
+            return false;
+        }
+        pubkeyptrs[i] = &pubkeys[i];
+        sigs[i] = entry.vchSig.data();
+        hashes[i] = entry.hash.begin();
+    }
+
+    // The scratch space lets the multiplication use Strauss' or Pippenger's
+    // algorithm, which is where the speedup comes from. The multiplication
+    // leaves it empty again when it returns.
+    return secp256k1_schnorr_verify_batch(
+        secp256k1_context_verify, schnorr_batch_scratch.Get(), sigs.data(),
+        hashes.data(), pubkeyptrs.data(), batch.size());
+}
+
 bool CPubKey::RecoverCompact(const uint256 &hash,
                              const std::vector<uint8_t> &vchSig) {
     if (vchSig.size() != COMPACT_SIGNATURE_SIZE) {
@@ -27,6 +27,8 @@ public:
 typedef uint256 ChainCode;
 
 /** An encapsulated public key. */
+struct SchnorrBatchEntry;
+
 class CPubKey {
 public:
     /**
@@ -165,6 +167,14 @@ public:
     bool VerifySchnorr(const uint256 &hash,
                        const std::vector<uint8_t> &vchSig) const;
 
+    /**
+     * Verify a batch of Schnorr signatures at once, which is faster than
+     * verifying them one by one for large batches. The return value is true
+     * only if all of them are valid, and says nothing about which are not.
+     */
+    static bool
+    VerifySchnorrBatch(const std::vector<const SchnorrBatchEntry *> &batch);
+
     /**
      * Check whether a DER-serialized ECDSA signature is normalized (lower-S).
      */
@@ -186,6 +196,13 @@ public:
                 const ChainCode &cc) const;
 };
 
+/** A Schnorr signature to verify with CPubKey::VerifySchnorrBatch. */
+struct SchnorrBatchEntry {
+    CPubKey pubkey;
+    uint256 hash;
+    std::vector<uint8_t> vchSig;
+};
+
 struct CExtPubKey {
     uint8_t nDepth = 0;
     uint8_t vchFingerprint[4] = {};
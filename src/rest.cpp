@@ -10,6 +10,9 @@
 #include <config.h>
 #include <core_io.h>
 #include <httpserver.h>
+#include <index/codescriptindex.h>
+#include <index/scripthashindex.h>
+#include <index/refindex.h>
 #include <index/txindex.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
@@ -221,6 +224,10 @@ static bool rest_block(const Config &config, HTTPRequest *req,
     const BlockHash hash(rawHash);
 
     CBlock block;
+    // The binary and hex formats are served straight from the mapped block
+    // file, without deserializing the block.
+    const bool fRaw = rf == RetFormat::BINARY || rf == RetFormat::HEX;
+    std::string strRaw;
     CBlockIndex *pblockindex = nullptr;
     CBlockIndex *tip = nullptr;
     {
@@ -236,30 +243,35 @@ static bool rest_block(const Config &config, HTTPRequest *req,
                            hashStr + " not available (pruned data)");
         }
 
-        if (!ReadBlockFromDisk(block, pblockindex,
-                               config.GetChainParams().GetConsensus())) {
+        if (fRaw) {
+            // Copy out of the mapping while still holding cs_main, so that the
+            // block file cannot be pruned while it is mapped.
+            RawBlock rawBlock;
+            if (!ReadRawBlockFromDisk(rawBlock, pblockindex,
+                                      config.GetChainParams().GetConsensus())) {
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+            }
+            if (rf == RetFormat::BINARY) {
+                strRaw.assign(rawBlock.data.begin(), rawBlock.data.end());
+            } else {
+                strRaw = HexStr(rawBlock.data) + "\n";
+            }
+        } else if (!ReadBlockFromDisk(block, pblockindex,
+                                      config.GetChainParams().GetConsensus())) {
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
         }
     }
 
     switch (rf) {
         case RetFormat::BINARY: {
-            CDataStream ssBlock(SER_NETWORK,
-                                PROTOCOL_VERSION | RPCSerializationFlags());
-            ssBlock << block;
-            std::string binaryBlock = ssBlock.str();
             req->WriteHeader("Content-Type", "application/octet-stream");
-            req->WriteReply(HTTP_OK, binaryBlock);
+            req->WriteReply(HTTP_OK, strRaw);
             return true;
         }
 
         case RetFormat::HEX: {
-            CDataStream ssBlock(SER_NETWORK,
-                                PROTOCOL_VERSION | RPCSerializationFlags());
-            ssBlock << block;
-            std::string strHex = HexStr(ssBlock) + "\n";
             req->WriteHeader("Content-Type", "text/plain");
-            req->WriteReply(HTTP_OK, strHex);
+            req->WriteReply(HTTP_OK, strRaw);
             return true;
         }
 
@@ -365,6 +377,199 @@ static bool rest_mempool_contents(Config &config, HTTPRequest *req,
     }
 }
 
+static bool rest_ref(HTTPRequest *req, const std::string &strURIPart,
+                     bool include_spent) {
+    if (!CheckWarmup(req)) {
+        return false;
+    }
+
+    std::string refStr;
+    const RetFormat rf = ParseDataFormat(refStr, strURIPart);
+
+    uint288 ref;
+    if (!ParseRefStr(refStr, ref)) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid ref: " + refStr);
+    }
+
+    if (!g_refindex) {
+        return RESTERR(req, HTTP_NOT_FOUND, "Ref index is disabled (use -refindex)");
+    }
+    if (!g_refindex->BlockUntilSyncedToCurrentChain()) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Ref index is still syncing");
+    }
+
+    std::vector<RefIndexEntry> entries;
+    if (!g_refindex->FindRefOutputs(ref, include_spent, entries)) {
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Failed to read the ref index");
+    }
+
+    switch (rf) {
+        case RetFormat::JSON: {
+            std::string strJSON = UniValue::stringify(RefIndexEntriesToJSON(entries)) + "\n";
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, strJSON);
+            return true;
+        }
+        default: {
+            return RESTERR(req, HTTP_NOT_FOUND,
+                           "output format not found (available: json)");
+        }
+    }
+}
+
+static bool rest_ref_unspent(Config &, HTTPRequest *req,
+                             const std::string &strURIPart) {
+    return rest_ref(req, strURIPart, false);
+}
+
+static bool rest_ref_history(Config &, HTTPRequest *req,
+                             const std::string &strURIPart) {
+    return rest_ref(req, strURIPart, true);
+}
+
+static bool rest_codescript(Config &, HTTPRequest *req,
+                            const std::string &strURIPart) {
+    static constexpr size_t MAX_REST_CODESCRIPT_OUTPUTS = 1000;
+
+    if (!CheckWarmup(req)) {
+        return false;
+    }
+
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    Split(path, param, "/");
+
+    uint256 codeScriptHash;
+    if (path.empty() || path.size() > 2 || !ParseCodeScriptHashStr(path[0], codeScriptHash)) {
+        return RESTERR(req, HTTP_BAD_REQUEST,
+                       "Invalid request. Use /rest/codescript/<hash>.<ext> or "
+                       "/rest/codescript/<hash>/<txid>-<n>.<ext>.");
+    }
+    std::optional<COutPoint> start;
+    if (path.size() == 2) {
+        const std::string::size_type sep = path[1].find('-');
+        uint256 txid;
+        int32_t n;
+        if (sep == std::string::npos || !ParseHashStr(path[1].substr(0, sep), txid) ||
+            !ParseInt32(path[1].substr(sep + 1), &n) || n < 0) {
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid outpoint: " + path[1]);
+        }
+        start = COutPoint(TxId(txid), n);
+    }
+
+    if (!g_codescriptindex) {
+        return RESTERR(req, HTTP_NOT_FOUND, "Codescript index is disabled (use -codescriptindex)");
+    }
+    if (!g_codescriptindex->BlockUntilSyncedToCurrentChain()) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Codescript index is still syncing");
+    }
+
+    std::vector<CodeScriptIndexEntry> entries;
+    if (!g_codescriptindex->FindOutputs(codeScriptHash, start, MAX_REST_CODESCRIPT_OUTPUTS + 1, entries)) {
+        return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Failed to read the codescript index");
+    }
+
+    switch (rf) {
+        case RetFormat::JSON: {
+            std::string strJSON =
+                UniValue::stringify(CodeScriptIndexEntriesToJSON(entries, MAX_REST_CODESCRIPT_OUTPUTS)) + "\n";
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, strJSON);
+            return true;
+        }
+        default: {
+            return RESTERR(req, HTTP_NOT_FOUND,
+                           "output format not found (available: json)");
+        }
+    }
+}
+
+static bool rest_scripthash(HTTPRequest *req, const std::string &strURIPart, bool history) {
+    static constexpr size_t MAX_REST_SCRIPTHASH_ENTRIES = 1000;
+
+    if (!CheckWarmup(req)) {
+        return false;
+    }
+
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    Split(path, param, "/");
+
+    const std::string kind = history ? "history" : "unspent";
+    uint256 scripthash;
+    if (path.empty() || path.size() > 2 || !ParseHashStr(path[0], scripthash)) {
+        return RESTERR(req, HTTP_BAD_REQUEST,
+                       "Invalid request. Use /rest/scripthash/" + kind + "/<scripthash>.<ext> or "
+                       "/rest/scripthash/" + kind + (history ? "/<scripthash>/<height>-<txid>.<ext>."
+                                                             : "/<scripthash>/<txid>-<n>.<ext>."));
+    }
+    // The start of the page: a position in the history, or an outpoint.
+    std::optional<ScriptHashHistoryEntry> historyStart;
+    std::optional<COutPoint> unspentStart;
+    if (path.size() == 2) {
+        const std::string::size_type sep = history ? path[1].find('-') : path[1].rfind('-');
+        uint256 txid;
+        int32_t n;
+        if (sep == std::string::npos ||
+            !ParseHashStr(history ? path[1].substr(sep + 1) : path[1].substr(0, sep), txid) ||
+            !ParseInt32(history ? path[1].substr(0, sep) : path[1].substr(sep + 1), &n) || n < 0) {
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid start: " + path[1]);
+        }
+        if (history) {
+            historyStart = ScriptHashHistoryEntry{n, TxId(txid)};
+        } else {
+            unspentStart = COutPoint(TxId(txid), n);
+        }
+    }
+
+    if (!g_scripthashindex) {
+        return RESTERR(req, HTTP_NOT_FOUND, "Scripthash index is disabled (use -scripthashindex)");
+    }
+    if (!g_scripthashindex->BlockUntilSyncedToCurrentChain()) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Scripthash index is still syncing");
+    }
+
+    UniValue::Object result;
+    if (history) {
+        std::vector<ScriptHashHistoryEntry> entries;
+        if (!g_scripthashindex->FindHistory(scripthash, historyStart, MAX_REST_SCRIPTHASH_ENTRIES + 1, entries)) {
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Failed to read the scripthash index");
+        }
+        result = ScriptHashHistoryToJSON(entries, MAX_REST_SCRIPTHASH_ENTRIES);
+    } else {
+        std::vector<ScriptHashUnspentEntry> entries;
+        if (!g_scripthashindex->FindUnspent(scripthash, unspentStart, MAX_REST_SCRIPTHASH_ENTRIES + 1, entries)) {
+            return RESTERR(req, HTTP_INTERNAL_SERVER_ERROR, "Failed to read the scripthash index");
+        }
+        result = ScriptHashUnspentToJSON(entries, MAX_REST_SCRIPTHASH_ENTRIES);
+    }
+
+    switch (rf) {
+        case RetFormat::JSON: {
+            std::string strJSON = UniValue::stringify(result) + "\n";
+            req->WriteHeader("Content-Type", "application/json");
+            req->WriteReply(HTTP_OK, strJSON);
+            return true;
+        }
+        default: {
+            return RESTERR(req, HTTP_NOT_FOUND,
+                           "output format not found (available: json)");
+        }
+    }
+}
+
+static bool rest_scripthash_history(Config &, HTTPRequest *req,
+                                    const std::string &strURIPart) {
+    return rest_scripthash(req, strURIPart, true);
+}
+
+static bool rest_scripthash_unspent(Config &, HTTPRequest *req,
+                                    const std::string &strURIPart) {
+    return rest_scripthash(req, strURIPart, false);
+}
+
 static bool rest_tx(Config &config, HTTPRequest *req,
                     const std::string &strURIPart) {
     if (!CheckWarmup(req)) {
@@ -661,6 +866,11 @@ static const struct {
     {"/rest/mempool/contents", rest_mempool_contents},
     {"/rest/headers/", rest_headers},
     {"/rest/getutxos", rest_getutxos},
+    {"/rest/ref/history/", rest_ref_history},
+    {"/rest/ref/", rest_ref_unspent},
+    {"/rest/codescript/", rest_codescript},
+    {"/rest/scripthash/history/", rest_scripthash_history},
+    {"/rest/scripthash/unspent/", rest_scripthash_unspent},
 };
 
 void StartREST() {
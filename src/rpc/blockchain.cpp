@@ -15,13 +15,21 @@
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
+#include <index/blockfilterindex.h>
+#include <index/codescriptindex.h>
+#include <index/refindex.h>
+#include <index/scripthashindex.h>
 #include <index/txindex.h>
 #include <key_io.h>
 #include <policy/policy.h>
 #include <primitives/transaction.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
+#include <script/scriptcache.h>
+#include <script/shardedcache.h>
+#include <script/sigcache.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -111,20 +119,47 @@ UniValue::Object blockheaderToJSON(const CBlockIndex *tip, const CBlockIndex *bl
     return result;
 }
 
-UniValue::Object blockToJSON(const Config &config, const CBlock &block, const CBlockIndex *tip, const CBlockIndex *blockindex, bool txDetails) {
+/// The members of blockToJSON() that come before and after "tx".
+static std::pair<UniValue::Object, UniValue::Object> blockFieldsToJSON(const CBlock &block, const CBlockIndex *tip,
+                                                                        const CBlockIndex *blockindex) {
     const CBlockIndex *pnext;
     int confirmations = ComputeNextBlockAndDepth(tip, blockindex, pnext);
     bool previousblockhash = blockindex->pprev;
     bool nextblockhash = pnext;
+    UniValue::Object before;
+    before.reserve(7);
+    before.emplace_back("hash", blockindex->GetBlockHash().GetHex());
+    before.emplace_back("confirmations", confirmations);
+    before.emplace_back("size", ::GetSerializeSize(block, PROTOCOL_VERSION));
+    before.emplace_back("height", blockindex->nHeight);
+    before.emplace_back("version", block.nVersion);
+    before.emplace_back("versionHex", strprintf("%08x", block.nVersion));
+    before.emplace_back("merkleroot", block.hashMerkleRoot.GetHex());
+    UniValue::Object after;
+    after.reserve(7 + previousblockhash + nextblockhash);
+    after.emplace_back("time", block.GetBlockTime());
+    after.emplace_back("mediantime", blockindex->GetMedianTimePast());
+    after.emplace_back("nonce", block.nNonce);
+    after.emplace_back("bits", strprintf("%08x", block.nBits));
+    after.emplace_back("difficulty", GetDifficulty(blockindex));
+    after.emplace_back("chainwork", blockindex->nChainWork.GetHex());
+    after.emplace_back("nTx", blockindex->nTx);
+    if (previousblockhash) {
+        after.emplace_back("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
+    }
+    if (nextblockhash) {
+        after.emplace_back("nextblockhash", pnext->GetBlockHash().GetHex());
+    }
+    return {std::move(before), std::move(after)};
+}
+
+UniValue::Object blockToJSON(const Config &config, const CBlock &block, const CBlockIndex *tip, const CBlockIndex *blockindex, bool txDetails) {
+    auto [before, after] = blockFieldsToJSON(block, tip, blockindex);
     UniValue::Object result;
-    result.reserve(15 + previousblockhash + nextblockhash);
-    result.emplace_back("hash", blockindex->GetBlockHash().GetHex());
-    result.emplace_back("confirmations", confirmations);
-    result.emplace_back("size", ::GetSerializeSize(block, PROTOCOL_VERSION));
-    result.emplace_back("height", blockindex->nHeight);
-    result.emplace_back("version", block.nVersion);
-    result.emplace_back("versionHex", strprintf("%08x", block.nVersion));
-    result.emplace_back("merkleroot", block.hashMerkleRoot.GetHex());
+    result.reserve(before.size() + 1 + after.size());
+    for (auto &[key, value] : before) {
+        result.emplace_back(std::move(key), std::move(value));
+    }
     UniValue::Array txs;
     txs.reserve(block.vtx.size());
     for (const auto &tx : block.vtx) {
@@ -135,22 +170,31 @@ UniValue::Object blockToJSON(const Config &config, const CBlock &block, const CB
         }
     }
     result.emplace_back("tx", std::move(txs));
-    result.emplace_back("time", block.GetBlockTime());
-    result.emplace_back("mediantime", blockindex->GetMedianTimePast());
-    result.emplace_back("nonce", block.nNonce);
-    result.emplace_back("bits", strprintf("%08x", block.nBits));
-    result.emplace_back("difficulty", GetDifficulty(blockindex));
-    result.emplace_back("chainwork", blockindex->nChainWork.GetHex());
-    result.emplace_back("nTx", blockindex->nTx);
-    if (previousblockhash) {
-        result.emplace_back("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
-    }
-    if (nextblockhash) {
-        result.emplace_back("nextblockhash", pnext->GetBlockHash().GetHex());
+    for (auto &[key, value] : after) {
+        result.emplace_back(std::move(key), std::move(value));
     }
     return result;
 }
 
+void blockToJSON(JSONStreamWriter &writer, const Config &config, const CBlock &block, const CBlockIndex *tip,
+                 const CBlockIndex *blockindex, bool txDetails) {
+    const auto [before, after] = blockFieldsToJSON(block, tip, blockindex);
+    writer.BeginObject();
+    writer.Members(before);
+    writer.Key("tx");
+    writer.BeginArray();
+    for (const auto &tx : block.vtx) {
+        if (txDetails) {
+            writer.Value(TxToUniv(config, *tx, uint256(), true, RPCSerializationFlags()));
+        } else {
+            writer.Value(UniValue(tx->GetId().GetHex()));
+        }
+    }
+    writer.EndArray();
+    writer.Members(after);
+    writer.EndObject();
+}
+
 static UniValue getblockcount(const Config &config,
                               const JSONRPCRequest &request) {
     if (request.fHelp || request.params.size() != 0) {
@@ -506,6 +550,34 @@ UniValue MempoolToJSON(const CTxMemPool &pool, bool verbose) {
     return ret;
 }
 
+void MempoolToJSON(JSONStreamWriter &writer, const CTxMemPool &pool) {
+    // Entries are looked up in batches, and written out without holding pool.cs so that a slow client cannot hold up
+    // the mempool. Transactions which leave the mempool in the meantime are skipped.
+    static constexpr size_t BATCH_SIZE = 1000;
+    std::vector<uint256> vtxids;
+    pool.queryHashes(vtxids);
+    std::vector<std::pair<std::string, UniValue::Object>> batch;
+    batch.reserve(std::min(vtxids.size(), BATCH_SIZE));
+    writer.BeginObject();
+    for (size_t i = 0; i < vtxids.size(); i += BATCH_SIZE) {
+        batch.clear();
+        {
+            LOCK(pool.cs);
+            for (size_t j = i; j < std::min(i + BATCH_SIZE, vtxids.size()); ++j) {
+                const auto it = pool.mapTx.find(TxId(vtxids[j]));
+                if (it != pool.mapTx.end()) {
+                    batch.emplace_back(vtxids[j].ToString(), entryToJSON(pool, *it));
+                }
+            }
+        }
+        for (const auto &[txid, entry] : batch) {
+            writer.Key(txid);
+            writer.Value(entry);
+        }
+    }
+    writer.EndObject();
+}
+
 static UniValue getrawmempool(const Config &config,
                               const JSONRPCRequest &request) {
     if (request.fHelp || request.params.size() > 1) {
@@ -538,6 +610,10 @@ static UniValue getrawmempool(const Config &config,
         fVerbose = request.params[0].get_bool();
     }
 
+    if (fVerbose && request.stream) {
+        MempoolToJSON(*request.stream, ::g_mempool);
+        return UniValue();
+    }
     return MempoolToJSON(::g_mempool, fVerbose);
 }
 
@@ -873,6 +949,24 @@ static CBlock ReadBlockChecked(const Config &config, const CBlockIndex *pblockin
     return block;
 }
 
+/// Like ReadBlockChecked(), but returns the hex of the serialized block, straight from its mapped block file.
+static std::string ReadBlockHexChecked(const Config &config, const CBlockIndex *pblockindex) {
+    auto doRead = [&] {
+        RawBlock block;
+        if (!ReadRawBlockFromDisk(block, pblockindex, config.GetChainParams().GetConsensus())) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+        }
+        return HexStr(block.data);
+    };
+    if (fPruneMode) {
+        // Note: as in ReadBlockChecked(), but the mapping also stops the file from being removed on Windows, so we
+        // also have to hold cs_main until we are done with it.
+        LOCK(cs_main);
+        return doRead();
+    }
+    return doRead();
+}
+
 static UniValue getblock(const Config &config, const JSONRPCRequest &request) {
     if (request.fHelp || request.params.size() < 1 ||
         request.params.size() > 2) {
@@ -959,16 +1053,18 @@ static UniValue getblock(const Config &config, const JSONRPCRequest &request) {
         ThrowIfPrunedBlock(pblockindex);
     }
 
-    const CBlock block = ReadBlockChecked(config, pblockindex);
-
     if (verbosity <= 0) {
-        CDataStream ssBlock(SER_NETWORK,
-                            PROTOCOL_VERSION | RPCSerializationFlags());
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock);
-        return strHex;
+        // The serialization of a block does not depend on RPCSerializationFlags(), so return its bytes as they are on
+        // disk.
+        return ReadBlockHexChecked(config, pblockindex);
     }
 
+    const CBlock block = ReadBlockChecked(config, pblockindex);
+
+    if (request.stream) {
+        blockToJSON(*request.stream, config, block, ::ChainActive().Tip(), pblockindex, verbosity >= 2);
+        return UniValue();
+    }
     return blockToJSON(config, block, ::ChainActive().Tip(), pblockindex, verbosity >= 2);
 }
 
@@ -1534,6 +1630,57 @@ static UniValue getmempoolinfo(const Config &config,
     return MempoolInfoToJSON(config, ::g_mempool);
 }
 
+static UniValue::Object CacheStatsToJSON(const CacheStats &stats) {
+    UniValue::Object ret;
+    ret.reserve(6);
+    ret.emplace_back("capacity", stats.capacity);
+    ret.emplace_back("shards", stats.shards);
+    ret.emplace_back("hits", stats.hits);
+    ret.emplace_back("misses", stats.misses);
+    ret.emplace_back("inserts", stats.inserts);
+    ret.emplace_back("contended", stats.contended);
+    return ret;
+}
+
+static UniValue getsigcacheinfo(const Config &config,
+                                const JSONRPCRequest &request) {
+    if (request.fHelp || request.params.size() != 0) {
+        throw std::runtime_error(
+            RPCHelpMan{"getsigcacheinfo",
+                "\nReturns counters of the signature and script-execution "
+                "caches since they were set up.\n", {}}
+                .ToString() +
+            "\nResult:\n"
+            "{\n"
+            "  \"signatures\": {           (json object) The signature cache\n"
+            "    \"capacity\": xxxxx,      (numeric) Number of entries the "
+            "cache can hold\n"
+            "    \"shards\": xxxxx,        (numeric) Number of separately "
+            "locked parts of the cache\n"
+            "    \"hits\": xxxxx,          (numeric) Lookups which found "
+            "their entry\n"
+            "    \"misses\": xxxxx,        (numeric) Lookups which did not\n"
+            "    \"inserts\": xxxxx,       (numeric) Entries added\n"
+            "    \"contended\": xxxxx      (numeric) Lookups and inserts "
+            "which waited for another thread to release a shard\n"
+            "  },\n"
+            "  \"scripts\": {              (json object) The script-execution "
+            "cache, with the same fields\n"
+            "    ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getsigcacheinfo", "") +
+            HelpExampleRpc("getsigcacheinfo", ""));
+    }
+
+    UniValue::Object ret;
+    ret.reserve(2);
+    ret.emplace_back("signatures", CacheStatsToJSON(GetSignatureCacheStats()));
+    ret.emplace_back("scripts", CacheStatsToJSON(GetScriptCacheStats()));
+    return ret;
+}
+
 static UniValue preciousblock(const Config &config,
                               const JSONRPCRequest &request) {
     if (request.fHelp || request.params.size() != 1) {
@@ -2536,6 +2683,473 @@ static UniValue scantxoutset(const Config &config,
     throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid command");
 }
 
+UniValue::Array RefIndexEntriesToJSON(const std::vector<RefIndexEntry> &entries) {
+    static const std::pair<uint8_t, const char *> typeNames[] = {
+        {REF_PUSH, "push"},
+        {REF_REQUIRE, "require"},
+        {REF_DISALLOWED_SIBLING, "disallowsiblings"},
+        {REF_SINGLETON, "singleton"},
+    };
+    UniValue::Array ret;
+    ret.reserve(entries.size());
+    for (const RefIndexEntry &entry : entries) {
+        UniValue::Object obj;
+        obj.reserve(6);
+        obj.emplace_back("txid", entry.outpoint.GetTxId().GetHex());
+        obj.emplace_back("vout", entry.outpoint.GetN());
+        obj.emplace_back("height", entry.height);
+        obj.emplace_back("value", ValueFromAmount(entry.value));
+        UniValue::Array types;
+        for (const auto &[type, name] : typeNames) {
+            if (entry.types & type) {
+                types.emplace_back(name);
+            }
+        }
+        obj.emplace_back("types", std::move(types));
+        if (entry.IsSpent()) {
+            UniValue::Object spent;
+            spent.reserve(2);
+            spent.emplace_back("txid", entry.spentTxId.GetHex());
+            spent.emplace_back("height", entry.spentHeight);
+            obj.emplace_back("spent", std::move(spent));
+        }
+        ret.emplace_back(std::move(obj));
+    }
+    return ret;
+}
+
+static UniValue getrefoutputs(const Config &, const JSONRPCRequest &request) {
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
+        throw std::runtime_error(
+            RPCHelpMan{"getrefoutputs",
+                "\nReturns the confirmed outputs whose script carries the given ref, oldest first.\n"
+                "Requires -refindex.\n",
+                {
+                    {"ref", RPCArg::Type::STR_HEX, /* opt */ false, /* default_val */ "",
+                     "The 36-byte ref, as it appears in output scripts (txid bytes followed by the little-endian "
+                     "output index)"},
+                    {"include_spent", RPCArg::Type::BOOL, /* opt */ true, /* default_val */ "false",
+                     "Whether to also return spent outputs"},
+                }}
+                .ToString() +
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"txid\" : \"hash\",       (string) The transaction id of the output\n"
+            "    \"vout\" : n,              (numeric) The output index\n"
+            "    \"height\" : n,            (numeric) The height of the block containing the transaction\n"
+            "    \"value\" : x.xxx,         (numeric) The value of the output in " + CURRENCY_UNIT + "\n"
+            "    \"types\" : [\"push\",...], (array of strings) How the script carries the ref: \"push\", "
+            "\"require\", \"disallowsiblings\" and/or \"singleton\"\n"
+            "    \"spent\" : {             (json object, only for spent outputs)\n"
+            "      \"txid\" : \"hash\",     (string) The transaction id of the spending transaction\n"
+            "      \"height\" : n           (numeric) The height of the block containing it\n"
+            "    }\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getrefoutputs", "\"<ref>\"") +
+            HelpExampleRpc("getrefoutputs", "\"<ref>\", true"));
+    }
+
+    if (!g_refindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The ref index is disabled. Use -refindex to enable it.");
+    }
+
+    uint288 ref;
+    if (!ParseRefStr(request.params[0].get_str(), ref)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "ref must be a 72-character hexadecimal string");
+    }
+    const bool include_spent = !request.params[1].isNull() && request.params[1].get_bool();
+
+    if (!g_refindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The ref index is still syncing. Try again later.");
+    }
+
+    std::vector<RefIndexEntry> entries;
+    if (!g_refindex->FindRefOutputs(ref, include_spent, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the ref index");
+    }
+    return RefIndexEntriesToJSON(entries);
+}
+
+UniValue::Object CodeScriptIndexEntriesToJSON(const std::vector<CodeScriptIndexEntry> &entries, size_t count) {
+    UniValue::Object ret;
+    ret.reserve(2);
+    UniValue::Array outputs;
+    outputs.reserve(std::min(entries.size(), count));
+    for (size_t i = 0; i < entries.size() && i < count; ++i) {
+        UniValue::Object obj;
+        obj.reserve(4);
+        obj.emplace_back("txid", entries[i].outpoint.GetTxId().GetHex());
+        obj.emplace_back("vout", entries[i].outpoint.GetN());
+        obj.emplace_back("value", ValueFromAmount(entries[i].value));
+        obj.emplace_back("height", entries[i].height);
+        outputs.emplace_back(std::move(obj));
+    }
+    ret.emplace_back("outputs", std::move(outputs));
+    if (entries.size() > count) {
+        UniValue::Object next;
+        next.reserve(2);
+        next.emplace_back("txid", entries[count - 1].outpoint.GetTxId().GetHex());
+        next.emplace_back("vout", entries[count - 1].outpoint.GetN());
+        ret.emplace_back("next", std::move(next));
+    }
+    return ret;
+}
+
+static UniValue getcodescriptoutputs(const Config &, const JSONRPCRequest &request) {
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3) {
+        throw std::runtime_error(
+            RPCHelpMan{"getcodescriptoutputs",
+                "\nReturns the unspent contract outputs whose code script (the part of the script after "
+                "OP_STATESEPARATOR) has the given hash, ordered by outpoint.\n"
+                "Only outputs with an OP_STATESEPARATOR or carrying refs are indexed. Requires -codescriptindex.\n",
+                {
+                    {"codescripthash", RPCArg::Type::STR_HEX, /* opt */ false, /* default_val */ "",
+                     "The codescript hash, in the byte order in which it is pushed in scripts"},
+                    {"count", RPCArg::Type::NUM, /* opt */ true, /* default_val */ "1000",
+                     "The maximum number of outputs to return"},
+                    {"start", RPCArg::Type::OBJ, /* opt */ true, /* default_val */ "",
+                     "Only return outputs after this one (the \"next\" of a previous call)",
+                     {
+                         {"txid", RPCArg::Type::STR_HEX, /* opt */ false, /* default_val */ "", "The transaction id"},
+                         {"vout", RPCArg::Type::NUM, /* opt */ false, /* default_val */ "", "The output number"},
+                     },
+                    },
+                }}
+                .ToString() +
+            "\nResult:\n"
+            "{\n"
+            "  \"outputs\" : [\n"
+            "    {\n"
+            "      \"txid\" : \"hash\",     (string) The transaction id\n"
+            "      \"vout\" : n,            (numeric) The output number\n"
+            "      \"value\" : x.xxx,       (numeric) The value of the output in " + CURRENCY_UNIT + "\n"
+            "      \"height\" : n           (numeric) The height of the block containing the transaction\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"next\" : {                (json object, only if there are more outputs) The start of the next "
+            "page\n"
+            "    \"txid\" : \"hash\",\n"
+            "    \"vout\" : n\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getcodescriptoutputs", "\"<codescripthash>\"") +
+            HelpExampleRpc("getcodescriptoutputs", "\"<codescripthash>\", 100"));
+    }
+
+    if (!g_codescriptindex) {
+        throw JSONRPCError(RPC_MISC_ERROR,
+                           "The codescript index is disabled. Use -codescriptindex to enable it.");
+    }
+
+    uint256 codeScriptHash;
+    if (!ParseCodeScriptHashStr(request.params[0].get_str(), codeScriptHash)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "codescripthash must be a 64-character hexadecimal string");
+    }
+    size_t count = 1000;
+    if (!request.params[1].isNull()) {
+        const int64_t n = request.params[1].get_int64();
+        if (n <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be positive");
+        }
+        count = n;
+    }
+    std::optional<COutPoint> start;
+    if (!request.params[2].isNull()) {
+        const UniValue::Object &o = request.params[2].get_obj();
+        RPCTypeCheckObj(o, {{"txid", UniValue::VSTR}, {"vout", UniValue::VNUM}});
+        const int vout = o["vout"].get_int();
+        if (vout < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "vout must be positive");
+        }
+        start = COutPoint(TxId(ParseHashO(o, "txid")), vout);
+    }
+
+    if (!g_codescriptindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The codescript index is still syncing. Try again later.");
+    }
+
+    // Ask for one more to know whether there is a next page.
+    std::vector<CodeScriptIndexEntry> entries;
+    if (!g_codescriptindex->FindOutputs(codeScriptHash, start, count + 1, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the codescript index");
+    }
+    return CodeScriptIndexEntriesToJSON(entries, count);
+}
+
+UniValue::Object ScriptHashHistoryToJSON(const std::vector<ScriptHashHistoryEntry> &entries, size_t count) {
+    UniValue::Object ret;
+    ret.reserve(2);
+    UniValue::Array history;
+    history.reserve(std::min(entries.size(), count));
+    for (size_t i = 0; i < entries.size() && i < count; ++i) {
+        UniValue::Object obj;
+        obj.reserve(2);
+        obj.emplace_back("txid", entries[i].txid.GetHex());
+        obj.emplace_back("height", entries[i].height);
+        history.emplace_back(std::move(obj));
+    }
+    ret.emplace_back("history", std::move(history));
+    if (entries.size() > count) {
+        UniValue::Object next;
+        next.reserve(2);
+        next.emplace_back("height", entries[count - 1].height);
+        next.emplace_back("txid", entries[count - 1].txid.GetHex());
+        ret.emplace_back("next", std::move(next));
+    }
+    return ret;
+}
+
+UniValue::Object ScriptHashUnspentToJSON(const std::vector<ScriptHashUnspentEntry> &entries, size_t count) {
+    UniValue::Object ret;
+    ret.reserve(2);
+    UniValue::Array unspent;
+    unspent.reserve(std::min(entries.size(), count));
+    for (size_t i = 0; i < entries.size() && i < count; ++i) {
+        UniValue::Object obj;
+        obj.reserve(4);
+        obj.emplace_back("txid", entries[i].outpoint.GetTxId().GetHex());
+        obj.emplace_back("vout", entries[i].outpoint.GetN());
+        obj.emplace_back("value", ValueFromAmount(entries[i].value));
+        obj.emplace_back("height", entries[i].height);
+        unspent.emplace_back(std::move(obj));
+    }
+    ret.emplace_back("unspent", std::move(unspent));
+    if (entries.size() > count) {
+        UniValue::Object next;
+        next.reserve(2);
+        next.emplace_back("txid", entries[count - 1].outpoint.GetTxId().GetHex());
+        next.emplace_back("vout", entries[count - 1].outpoint.GetN());
+        ret.emplace_back("next", std::move(next));
+    }
+    return ret;
+}
+
+/** Parse the scripthash and count parameters of getscripthashhistory and getscripthashunspent. */
+static std::pair<uint256, size_t> ParseScriptHashParams(const JSONRPCRequest &request) {
+    if (!g_scripthashindex) {
+        throw JSONRPCError(RPC_MISC_ERROR,
+                           "The scripthash index is disabled. Use -scripthashindex to enable it.");
+    }
+    const uint256 scripthash = ParseHashV(request.params[0], "scripthash");
+    size_t count = 1000;
+    if (!request.params[1].isNull()) {
+        const int64_t n = request.params[1].get_int64();
+        if (n <= 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "count must be positive");
+        }
+        count = n;
+    }
+    return {scripthash, count};
+}
+
+static void BlockUntilScriptHashIndexSynced() {
+    if (!g_scripthashindex->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "The scripthash index is still syncing. Try again later.");
+    }
+}
+
+static UniValue getscripthashhistory(const Config &, const JSONRPCRequest &request) {
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3) {
+        throw std::runtime_error(
+            RPCHelpMan{"getscripthashhistory",
+                "\nReturns the confirmed transactions which paid to or spent from an output script, oldest first.\n"
+                "Requires -scripthashindex.\n",
+                {
+                    {"scripthash", RPCArg::Type::STR_HEX, /* opt */ false, /* default_val */ "",
+                     "The SHA256 hash of the output script, in reverse byte order (as in the Electrum protocol)"},
+                    {"count", RPCArg::Type::NUM, /* opt */ true, /* default_val */ "1000",
+                     "The maximum number of transactions to return"},
+                    {"start", RPCArg::Type::OBJ, /* opt */ true, /* default_val */ "",
+                     "Only return transactions after this one (the \"next\" of a previous call)",
+                     {
+                         {"height", RPCArg::Type::NUM, /* opt */ false, /* default_val */ "", "The block height"},
+                         {"txid", RPCArg::Type::STR_HEX, /* opt */ false, /* default_val */ "", "The transaction id"},
+                     },
+                    },
+                }}
+                .ToString() +
+            "\nResult:\n"
+            "{\n"
+            "  \"history\" : [\n"
+            "    {\n"
+            "      \"txid\" : \"hash\",     (string) The transaction id\n"
+            "      \"height\" : n           (numeric) The height of the block containing the transaction\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"next\" : {                (json object, only if there are more transactions) The start of the "
+            "next page\n"
+            "    \"height\" : n,\n"
+            "    \"txid\" : \"hash\"\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getscripthashhistory", "\"<scripthash>\"") +
+            HelpExampleRpc("getscripthashhistory", "\"<scripthash>\", 100"));
+    }
+
+    const auto [scripthash, count] = ParseScriptHashParams(request);
+    std::optional<ScriptHashHistoryEntry> start;
+    if (!request.params[2].isNull()) {
+        const UniValue::Object &o = request.params[2].get_obj();
+        RPCTypeCheckObj(o, {{"height", UniValue::VNUM}, {"txid", UniValue::VSTR}});
+        const int height = o["height"].get_int();
+        if (height < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "height must be positive");
+        }
+        start = ScriptHashHistoryEntry{height, TxId(ParseHashO(o, "txid"))};
+    }
+    BlockUntilScriptHashIndexSynced();
+
+    // Ask for one more to know whether there is a next page.
+    std::vector<ScriptHashHistoryEntry> entries;
+    if (!g_scripthashindex->FindHistory(scripthash, start, count + 1, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the scripthash index");
+    }
+    return ScriptHashHistoryToJSON(entries, count);
+}
+
+static UniValue getscripthashunspent(const Config &, const JSONRPCRequest &request) {
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 3) {
+        throw std::runtime_error(
+            RPCHelpMan{"getscripthashunspent",
+                "\nReturns the confirmed unspent outputs paying to an output script, ordered by outpoint.\n"
+                "Requires -scripthashindex.\n",
+                {
+                    {"scripthash", RPCArg::Type::STR_HEX, /* opt */ false, /* default_val */ "",
+                     "The SHA256 hash of the output script, in reverse byte order (as in the Electrum protocol)"},
+                    {"count", RPCArg::Type::NUM, /* opt */ true, /* default_val */ "1000",
+                     "The maximum number of outputs to return"},
+                    {"start", RPCArg::Type::OBJ, /* opt */ true, /* default_val */ "",
+                     "Only return outputs after this one (the \"next\" of a previous call)",
+                     {
+                         {"txid", RPCArg::Type::STR_HEX, /* opt */ false, /* default_val */ "", "The transaction id"},
+                         {"vout", RPCArg::Type::NUM, /* opt */ false, /* default_val */ "", "The output number"},
+                     },
+                    },
+                }}
+                .ToString() +
+            "\nResult:\n"
+            "{\n"
+            "  \"unspent\" : [\n"
+            "    {\n"
+            "      \"txid\" : \"hash\",     (string) The transaction id\n"
+            "      \"vout\" : n,            (numeric) The output number\n"
+            "      \"value\" : x.xxx,       (numeric) The value of the output in " + CURRENCY_UNIT + "\n"
+            "      \"height\" : n           (numeric) The height of the block containing the transaction\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"next\" : {                (json object, only if there are more outputs) The start of the next "
+            "page\n"
+            "    \"txid\" : \"hash\",\n"
+            "    \"vout\" : n\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getscripthashunspent", "\"<scripthash>\"") +
+            HelpExampleRpc("getscripthashunspent", "\"<scripthash>\", 100"));
+    }
+
+    const auto [scripthash, count] = ParseScriptHashParams(request);
+    std::optional<COutPoint> start;
+    if (!request.params[2].isNull()) {
+        const UniValue::Object &o = request.params[2].get_obj();
+        RPCTypeCheckObj(o, {{"txid", UniValue::VSTR}, {"vout", UniValue::VNUM}});
+        const int vout = o["vout"].get_int();
+        if (vout < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "vout must be positive");
+        }
+        start = COutPoint(TxId(ParseHashO(o, "txid")), vout);
+    }
+    BlockUntilScriptHashIndexSynced();
+
+    std::vector<ScriptHashUnspentEntry> entries;
+    if (!g_scripthashindex->FindUnspent(scripthash, start, count + 1, entries)) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the scripthash index");
+    }
+    return ScriptHashUnspentToJSON(entries, count);
+}
+
+static UniValue getblockfilter(const Config &, const JSONRPCRequest &request) {
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2) {
+        throw std::runtime_error(
+            RPCHelpMan{"getblockfilter",
+                "\nRetrieve a BIP 157 content filter for a particular block.\n",
+                {
+                    {"blockhash", RPCArg::Type::STR_HEX, /* opt */ false, /* default_val */ "", "The hash of the block"},
+                    {"filtertype", RPCArg::Type::STR, /* opt */ true, /* default_val */ "basic",
+                     "The type name of the filter"},
+                }}
+                .ToString() +
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\" : (string) the hex-encoded filter data\n"
+            "  \"header\" : (string) the hex-encoded filter header\n"
+            "}\n"
+            "\nExamples:\n" +
+            HelpExampleCli("getblockfilter",
+                           "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\" \"basic\""));
+    }
+
+    const BlockHash block_hash(ParseHashV(request.params[0], "blockhash"));
+    std::string filtertype_name = "basic";
+    if (!request.params[1].isNull()) {
+        filtertype_name = request.params[1].get_str();
+    }
+
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(filtertype_name, filtertype)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+    }
+
+    BlockFilterIndex *index = GetBlockFilterIndex(filtertype);
+    if (!index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + filtertype_name);
+    }
+
+    const CBlockIndex *block_index;
+    bool block_was_connected;
+    {
+        LOCK(cs_main);
+        block_index = LookupBlockIndex(block_hash);
+        if (!block_index) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        }
+        block_was_connected = block_index->IsValid(BlockValidity::SCRIPTS);
+    }
+
+    bool index_ready = index->BlockUntilSyncedToCurrentChain();
+
+    BlockFilter filter;
+    uint256 filter_header;
+    if (!index->LookupFilter(block_index, filter) || !index->LookupFilterHeader(block_index, filter_header)) {
+        RPCErrorCode err_code;
+        std::string errmsg = "Filter not found.";
+
+        if (!block_was_connected) {
+            err_code = RPC_INVALID_ADDRESS_OR_KEY;
+            errmsg += " Block was not connected to active chain.";
+        } else if (!index_ready) {
+            err_code = RPC_MISC_ERROR;
+            errmsg += " Block filters are still in the process of being indexed.";
+        } else {
+            err_code = RPC_INTERNAL_ERROR;
+            errmsg += " This error is unexpected and indicates index corruption.";
+        }
+
+        throw JSONRPCError(err_code, errmsg);
+    }
+
+    UniValue::Object ret;
+    ret.reserve(2);
+    ret.emplace_back("filter", HexStr(filter.GetEncodedFilter()));
+    ret.emplace_back("header", filter_header.GetHex());
+    return ret;
+}
+
 // clang-format off
 static const ContextFreeRPCCommand commands[] = {
     //  category            name                      actor (function)        argNames
@@ -2546,10 +3160,12 @@ static const ContextFreeRPCCommand commands[] = {
     { "blockchain",         "getblockchaininfo",      getblockchaininfo,      {} },
     { "blockchain",         "getblockcount",          getblockcount,          {} },
     { "blockchain",         "getblockhash",           getblockhash,           {"height"} },
+    { "blockchain",         "getblockfilter",         getblockfilter,         {"blockhash", "filtertype"} },
     { "blockchain",         "getblockheader",         getblockheader,         {"blockhash|hash_or_height","verbose"} },
     { "blockchain",         "getblockstats",          getblockstats,          {"hash_or_height","stats"} },
     { "blockchain",         "getchaintips",           getchaintips,           {} },
     { "blockchain",         "getchaintxstats",        getchaintxstats,        {"nblocks", "blockhash"} },
+    { "blockchain",         "getcodescriptoutputs",   getcodescriptoutputs,   {"codescripthash","count","start"} },
     { "blockchain",         "getdifficulty",          getdifficulty,          {} },
     { "blockchain",         "getfinalizedblockhash",  getfinalizedblockhash,  {} },
     { "blockchain",         "getmempoolancestors",    getmempoolancestors,    {"txid","verbose"} },
@@ -2557,6 +3173,10 @@ static const ContextFreeRPCCommand commands[] = {
     { "blockchain",         "getmempoolentry",        getmempoolentry,        {"txid"} },
     { "blockchain",         "getmempoolinfo",         getmempoolinfo,         {} },
     { "blockchain",         "getrawmempool",          getrawmempool,          {"verbose"} },
+    { "blockchain",         "getrefoutputs",          getrefoutputs,          {"ref","include_spent"} },
+    { "blockchain",         "getscripthashhistory",   getscripthashhistory,   {"scripthash","count","start"} },
+    { "blockchain",         "getscripthashunspent",   getscripthashunspent,   {"scripthash","count","start"} },
+    { "blockchain",         "getsigcacheinfo",        getsigcacheinfo,        {} },
     { "blockchain",         "gettxout",               gettxout,               {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        gettxoutsetinfo,        {} },
     { "blockchain",         "invalidateblock",        invalidateblock,        {"blockhash"} },
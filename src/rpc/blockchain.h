@@ -14,6 +14,11 @@ class CBlockIndex;
 class Config;
 class CTxMemPool;
 class JSONRPCRequest;
+class JSONStreamWriter;
+struct CodeScriptIndexEntry;
+struct RefIndexEntry;
+struct ScriptHashHistoryEntry;
+struct ScriptHashUnspentEntry;
 
 UniValue getblockchaininfo(const Config &config, const JSONRPCRequest &request);
 
@@ -32,12 +37,28 @@ void RPCNotifyBlockChange(bool ibd, const CBlockIndex *pindex);
 
 /** Block description to JSON */
 UniValue::Object blockToJSON(const Config &config, const CBlock &block, const CBlockIndex *tip, const CBlockIndex *blockindex, bool txDetails = false);
+/** Block description to JSON, written to a stream as it is produced */
+void blockToJSON(JSONStreamWriter &writer, const Config &config, const CBlock &block, const CBlockIndex *tip,
+                 const CBlockIndex *blockindex, bool txDetails = false);
 
 /** Mempool information to JSON */
 UniValue::Object MempoolInfoToJSON(const Config &config, const CTxMemPool &pool);
 
 /** Mempool to JSON */
 UniValue MempoolToJSON(const CTxMemPool &pool, bool verbose = false);
+/** Verbose mempool to JSON, written to a stream as it is produced. Unlike MempoolToJSON(), this is not an atomic
+ *  snapshot of the mempool. */
+void MempoolToJSON(JSONStreamWriter &writer, const CTxMemPool &pool);
+
+/** Outputs found in the ref index to JSON */
+UniValue::Array RefIndexEntriesToJSON(const std::vector<RefIndexEntry> &entries);
+
+/** The first count outputs found in the codescript index to JSON, with a "next" cursor if there are more */
+UniValue::Object CodeScriptIndexEntriesToJSON(const std::vector<CodeScriptIndexEntry> &entries, size_t count);
+
+/** The first count entries found in the scripthash index to JSON, with a "next" cursor if there are more */
+UniValue::Object ScriptHashHistoryToJSON(const std::vector<ScriptHashHistoryEntry> &entries, size_t count);
+UniValue::Object ScriptHashUnspentToJSON(const std::vector<ScriptHashUnspentEntry> &entries, size_t count);
 
 /** Block header to JSON */
 UniValue::Object blockheaderToJSON(const CBlockIndex *tip, const CBlockIndex *blockindex);
@@ -115,6 +115,13 @@ static const CRPCConvertParam vRPCConvertParams[] = {
     {"converttopsbt", 1, "permitsigdata"},
     {"gettxout", 1, "n"},
     {"gettxout", 2, "include_mempool"},
+    {"getrefoutputs", 1, "include_spent"},
+    {"getcodescriptoutputs", 1, "count"},
+    {"getcodescriptoutputs", 2, "start"},
+    {"getscripthashhistory", 1, "count"},
+    {"getscripthashhistory", 2, "start"},
+    {"getscripthashunspent", 1, "count"},
+    {"getscripthashunspent", 2, "start"},
     {"gettxoutproof", 0, "txids"},
     {"lockunspent", 0, "unlock"},
     {"lockunspent", 1, "transactions"},
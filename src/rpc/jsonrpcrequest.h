@@ -8,6 +8,8 @@
 
 #include <univalue.h>
 
+class JSONStreamWriter;
+
 class JSONRPCRequest {
 public:
     UniValue id;
@@ -16,6 +18,13 @@ public:
     bool fHelp = false;
     std::string URI;
     std::string authUser;
+    /**
+     * Set by the HTTP server when the result may be streamed to the client.
+     * A handler producing a very large result can then write it here as it
+     * goes instead of returning it, in which case the value it returns is
+     * ignored. Handlers must not throw once they have started writing.
+     */
+    JSONStreamWriter *stream = nullptr;
 
     void parse(UniValue&& valRequest);
 };
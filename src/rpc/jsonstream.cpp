@@ -0,0 +1,98 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <cassert>
+#include <utility>
+
+JSONStreamWriter::JSONStreamWriter(Sink sinkIn, size_t flushSizeIn)
+    : sink(std::move(sinkIn)), flushSize(flushSizeIn) {
+    buffer.reserve(flushSize);
+}
+
+void JSONStreamWriter::BeginValue() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (levels.empty()) {
+        return;
+    }
+    // Values in objects must be preceded by a key.
+    Level &level = levels.back();
+    assert(!level.isObject);
+    if (!level.empty) {
+        buffer += ',';
+    }
+    level.empty = false;
+}
+
+void JSONStreamWriter::EndValue() {
+    if (buffer.size() >= flushSize) {
+        Flush();
+    }
+}
+
+void JSONStreamWriter::BeginObject() {
+    BeginValue();
+    buffer += '{';
+    levels.push_back({true, true});
+}
+
+void JSONStreamWriter::EndObject() {
+    assert(!levels.empty() && levels.back().isObject && !afterKey);
+    levels.pop_back();
+    buffer += '}';
+    EndValue();
+}
+
+void JSONStreamWriter::BeginArray() {
+    BeginValue();
+    buffer += '[';
+    levels.push_back({false, true});
+}
+
+void JSONStreamWriter::EndArray() {
+    assert(!levels.empty() && !levels.back().isObject);
+    levels.pop_back();
+    buffer += ']';
+    EndValue();
+}
+
+void JSONStreamWriter::Key(std::string_view key) {
+    assert(!levels.empty() && levels.back().isObject && !afterKey);
+    Level &level = levels.back();
+    if (!level.empty) {
+        buffer += ',';
+    }
+    level.empty = false;
+    buffer += UniValue::stringify(key);
+    buffer += ':';
+    afterKey = true;
+}
+
+void JSONStreamWriter::Members(const UniValue::Object &obj) {
+    for (const auto &[key, value] : obj) {
+        Key(key);
+        Value(value);
+    }
+}
+
+void JSONStreamWriter::Flush() {
+    if (buffer.empty()) {
+        return;
+    }
+    std::string chunk;
+    chunk.reserve(flushSize);
+    chunk.swap(buffer);
+    flushed = true;
+    sink(std::move(chunk));
+}
+
+std::string JSONStreamWriter::TakeBuffer() {
+    std::string ret;
+    ret.swap(buffer);
+    return ret;
+}
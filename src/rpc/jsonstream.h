@@ -0,0 +1,81 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <univalue.h>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Writes a JSON document incrementally, handing it to a sink in chunks as it
+ * grows. This lets RPC results which are too large to build as a UniValue
+ * tree (e.g. a block with all of its transactions) be sent as they are
+ * produced, with only the current chunk and the value being written in
+ * memory.
+ *
+ * Values are written either piecewise (BeginObject() / Key() / ... /
+ * EndObject()) or whole, from a UniValue. Separators are inserted
+ * automatically. The sink is called from within the writing methods whenever
+ * at least flushSize bytes are buffered, and may block (e.g. to wait for a
+ * slow client).
+ */
+class JSONStreamWriter {
+public:
+    using Sink = std::function<void(std::string &&chunk)>;
+
+    static constexpr size_t DEFAULT_FLUSH_SIZE = 1 << 20;
+
+    explicit JSONStreamWriter(Sink sinkIn, size_t flushSizeIn = DEFAULT_FLUSH_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    /** Write the key of the next member of the current object. */
+    void Key(std::string_view key);
+
+    /** Write a complete value: a UniValue, UniValue::Object or UniValue::Array. */
+    template <typename T> void Value(const T &value) {
+        BeginValue();
+        buffer += UniValue::stringify(value);
+        EndValue();
+    }
+
+    /** Write all the members of obj to the current object. */
+    void Members(const UniValue::Object &obj);
+
+    /** True if the last thing written was a key, so a value must follow. */
+    bool AwaitingValue() const { return afterKey; }
+
+    /** True if the sink has been called. */
+    bool Flushed() const { return flushed; }
+
+    /** Hand everything buffered to the sink. */
+    void Flush();
+
+    /** Return and clear everything buffered, without calling the sink. */
+    std::string TakeBuffer();
+
+private:
+    struct Level {
+        bool isObject;
+        bool empty;
+    };
+
+    Sink sink;
+    const size_t flushSize;
+    std::string buffer;
+    std::vector<Level> levels;
+    bool afterKey = false;
+    bool flushed = false;
+
+    void BeginValue();
+    void EndValue();
+};
@@ -547,8 +547,13 @@ static UniValue getblocktemplatecommon(bool fLight, const Config &config, const
 
         // Create new block
         CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate =
-            BlockAssembler(config, g_mempool).CreateNewBlock(scriptDummy, timeLimitSecs, checkValidity);
+        if (gArgs.GetBoolArg("-gbtincremental", DEFAULT_GBT_INCREMENTAL)) {
+            static IncrementalBlockAssembler incrementalAssembler(config, g_mempool);
+            pblocktemplate = incrementalAssembler.CreateNewBlock(scriptDummy, timeLimitSecs, checkValidity);
+        } else {
+            pblocktemplate =
+                BlockAssembler(config, g_mempool).CreateNewBlock(scriptDummy, timeLimitSecs, checkValidity);
+        }
         plightresult.reset();
         if (!pblocktemplate) {
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
@@ -626,16 +631,32 @@ static UniValue getblocktemplatecommon(bool fLight, const Config &config, const
         } else {
             // merkle cached result not available (new template) or we have additional_txs and can't use cached result
             LogPrint(BCLog::RPC, "Calculating new merkle result\n");
+            // The merkle tree of the template's txs is kept across calls, and brought up to date here by rehashing
+            // only the part of it to the right of the first tx that changed. With the incremental block assembler the
+            // template usually just grows, so this costs O(log n) hashes per added tx.
+            static gbtl::MerkleBranchTree templateMerkleTree;
             std::vector<uint256> vtxIdsNoCoinbase; // txs without coinbase
-            // we reserve 1 more than we need, because makeMerkleBranch may use a little more space
-            vtxIdsNoCoinbase.reserve(pvtx->size());
-            for (const auto &tx : *pvtx) {
+            vtxIdsNoCoinbase.reserve(pblock->vtx.size());
+            for (const auto &tx : pblock->vtx) {
                 if (tx->IsCoinBase())
                     continue;
                 vtxIdsNoCoinbase.push_back(tx->GetId());
             }
+            templateMerkleTree.Assign(vtxIdsNoCoinbase);
             // make merkleSteps and merkle branch
-            const auto merkleSteps = gbtl::MakeMerkleBranch(std::move(vtxIdsNoCoinbase));
+            std::vector<uint256> merkleSteps;
+            if (pvtx == &pblock->vtx) {
+                merkleSteps = templateMerkleTree.GetBranch();
+            } else {
+                // additional_txs come after the template's txs, so extend a private copy of the template's tree
+                gbtl::MerkleBranchTree merkleTree(templateMerkleTree);
+                for (size_t i = pblock->vtx.size(); i < pvtx->size(); ++i) {
+                    if ((*pvtx)[i]->IsCoinBase())
+                        continue;
+                    merkleTree.Append((*pvtx)[i]->GetId());
+                }
+                merkleSteps = merkleTree.GetBranch();
+            }
             merkle.reserve(merkleSteps.size());
             // hash source is Hash160(hashPrevBlock + concatenation_of_all_merkle_step_hashes)
             std::vector<uint8_t> hashSource;
@@ -0,0 +1,92 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <script/refsummarycache.h>
+
+#include <logging.h>
+#include <memusage.h>
+#include <util/system.h>
+
+#include <algorithm>
+
+RefSummaryCache g_refSummaryCache;
+
+size_t RefSummaryCache::EntryUsage(const PushRefScriptSummary &summary) {
+    return memusage::MallocUsage(sizeof(std::pair<const COutPoint, PushRefScriptSummaryRef>) + sizeof(void *)) +
+           memusage::MallocUsage(sizeof(PushRefScriptSummary)) +
+           memusage::MallocUsage(sizeof(memusage::stl_shared_counter)) +
+           memusage::DynamicUsage(summary.pushRefSet) + memusage::DynamicUsage(summary.requireRefSet) +
+           memusage::DynamicUsage(summary.disallowSiblingRefSet) + memusage::DynamicUsage(summary.singletonRefSet) +
+           sizeof(COutPoint); // fifo entry
+}
+
+void RefSummaryCache::SetMaxBytes(size_t maxBytes) {
+    LOCK(cs);
+    nMaxBytes = maxBytes;
+    while (nUsage > nMaxBytes && !fifo.empty()) {
+        auto it = map.find(fifo.front());
+        if (it != map.end()) {
+            nUsage -= EntryUsage(*it->second);
+            map.erase(it);
+        }
+        fifo.pop_front();
+    }
+}
+
+PushRefScriptSummaryRef RefSummaryCache::Get(const COutPoint &outpoint) const {
+    LOCK(cs);
+    auto it = map.find(outpoint);
+    if (it == map.end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+void RefSummaryCache::Add(const COutPoint &outpoint, PushRefScriptSummaryRef summary) {
+    const size_t usage = EntryUsage(*summary);
+    LOCK(cs);
+    if (usage > nMaxBytes) {
+        return;
+    }
+    while (nUsage + usage > nMaxBytes && !fifo.empty()) {
+        auto it = map.find(fifo.front());
+        if (it != map.end()) {
+            nUsage -= EntryUsage(*it->second);
+            map.erase(it);
+        }
+        fifo.pop_front();
+    }
+    if (map.emplace(outpoint, std::move(summary)).second) {
+        fifo.push_back(outpoint);
+        nUsage += usage;
+    }
+}
+
+void RefSummaryCache::Clear() {
+    LOCK(cs);
+    map.clear();
+    fifo.clear();
+    nUsage = 0;
+}
+
+size_t RefSummaryCache::Size() const {
+    LOCK(cs);
+    return map.size();
+}
+
+size_t RefSummaryCache::DynamicMemoryUsage() const {
+    LOCK(cs);
+    return nUsage;
+}
+
+void InitRefSummaryCache() {
+    const size_t nMaxCacheSize =
+        std::min(std::max(int64_t(0),
+                          gArgs.GetArg("-maxrefsummarycachesize", DEFAULT_MAX_REF_SUMMARY_CACHE_SIZE)),
+                 MAX_MAX_REF_SUMMARY_CACHE_SIZE) *
+        (size_t(1) << 20);
+    g_refSummaryCache.Clear();
+    g_refSummaryCache.SetMaxBytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB for the ref summary cache\n", nMaxCacheSize >> 20);
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <primitives/transaction.h>
+#include <script/script_execution_context.h>
+#include <sync.h>
+#include <util/saltedhashers.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+
+/**
+ * A size-bounded cache of the PushRefScriptSummary of transaction outputs, keyed by outpoint.
+ *
+ * ScriptExecutionContext adds the summaries it computes on a miss, so that it finds them when it needs them
+ * again for the same outputs as spent coins (when a child tx enters the mempool, and during ConnectBlock).
+ * The summary of an output is a pure function of the output, which the txid commits to, so the outpoint is a
+ * sufficient key -- provided the coin looked up really is the one the outpoint refers to. Only callers that take their coins from the validated UTXO view may therefore use it.
+ *
+ * The hash table is salted. Entries are evicted oldest-first once the memory limit is reached.
+ */
+class RefSummaryCache {
+    mutable Mutex cs;
+    std::unordered_map<COutPoint, PushRefScriptSummaryRef, SaltedOutpointHasher> map GUARDED_BY(cs);
+    /// Insertion order, for eviction
+    std::deque<COutPoint> fifo GUARDED_BY(cs);
+    size_t nMaxBytes GUARDED_BY(cs);
+    size_t nUsage GUARDED_BY(cs) = 0;
+
+    static size_t EntryUsage(const PushRefScriptSummary &summary);
+
+public:
+    explicit RefSummaryCache(size_t maxBytes = 0) : nMaxBytes(maxBytes) {}
+
+    /// Change the memory limit, evicting entries as needed. A limit of 0 disables the cache.
+    void SetMaxBytes(size_t maxBytes);
+
+    /// The cached summary, or null if there is none.
+    PushRefScriptSummaryRef Get(const COutPoint &outpoint) const;
+
+    void Add(const COutPoint &outpoint, PushRefScriptSummaryRef summary);
+
+    void Clear();
+
+    size_t Size() const;
+    size_t DynamicMemoryUsage() const;
+};
+
+// Default to 16 MiB, which holds the summaries of well over 50,000 outputs.
+static constexpr int64_t DEFAULT_MAX_REF_SUMMARY_CACHE_SIZE = 16;
+// Maximum ref summary cache size allowed
+static constexpr int64_t MAX_MAX_REF_SUMMARY_CACHE_SIZE = 16384;
+
+/** The cache used by validation (CheckInputs). */
+extern RefSummaryCache g_refSummaryCache;
+
+/** Initializes the ref summary cache from -maxrefsummarycachesize */
+void InitRefSummaryCache();
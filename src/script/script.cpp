@@ -546,29 +546,51 @@ bool CScript::IsPushOnly(const_iterator pc) const {
     return true;
 }
 
+namespace {
+void SortAndRemoveDuplicates(std::vector<uint288> &refs) {
+    std::sort(refs.begin(), refs.end());
+    refs.erase(std::unique(refs.begin(), refs.end()), refs.end());
+}
+
+/// Returns true if the two sorted ranges have at least one element in common.
+bool SortedRangesIntersect(const std::vector<uint288> &a, const std::vector<uint288> &b) {
+    auto itA = a.begin(), itB = b.begin();
+    while (itA != a.end() && itB != b.end()) {
+        if (*itA < *itB) {
+            ++itA;
+        } else if (*itB < *itA) {
+            ++itB;
+        } else {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
 bool CScript::GetPushRefs(
-    const_iterator pc, 
-    std::set<uint288> &pushRefSet,
-    std::set<uint288> &requireRefSet,
-    std::set<uint288> &disallowedSiblingsRefSet,
-    std::set<uint288> &singletonRefSet,
+    const_iterator pc,
+    std::vector<uint288> &pushRefs,
+    std::vector<uint288> &requireRefs,
+    std::vector<uint288> &disallowedSiblingsRefs,
+    std::vector<uint288> &singletonRefs,
     uint32_t &stateSeperatorByteIndex
 ) const {
 
-    std::set<uint288> foundDisallowedRefs;
-    std::set<uint288> foundDisallowedSiblingRefs;
-    std::set<uint288> foundPushRefs;
-    std::set<uint288> foundRequiredRefs;
-    std::set<uint288> foundSingletonRefs;
+    std::vector<uint288> foundDisallowedRefs;
+    std::vector<uint288> foundDisallowedSiblingRefs;
+    std::vector<uint288> foundPushRefs;
+    std::vector<uint288> foundRequiredRefs;
+    std::vector<uint288> foundSingletonRefs;
 
     bool isExistingStateSeperator = false;
     bool isExistingOpReturn = false;
     // Track if there is an OP_STATESEPARATOR
     const_iterator startIterator = pc;
     const_iterator stateSeperatorLocatedIt = pc;
+    std::vector<uint8_t> ret;
     while (pc < end()) {
         opcodetype opcode;
-        std::vector<uint8_t> ret;
         if (!GetOp(pc, opcode, ret)) {
             return false;
         }
@@ -582,22 +604,21 @@ bool CScript::GetPushRefs(
             opcode == OP_DISALLOWPUSHINPUTREF ||
             opcode == OP_DISALLOWPUSHINPUTREFSIBLING || 
             opcode == OP_PUSHINPUTREFSINGLETON) {
-            std::vector<unsigned char> refId(ret.cbegin(), ret.cend());
-            uint288 refIdUint288 = uint288(refId);
+            const uint288 refIdUint288 = uint288(ret);
             if (opcode == OP_PUSHINPUTREF) {
-                foundPushRefs.insert(refIdUint288);
+                foundPushRefs.push_back(refIdUint288);
             } else if (opcode == OP_REQUIREINPUTREF) {
-                foundRequiredRefs.insert(refIdUint288);
+                foundRequiredRefs.push_back(refIdUint288);
             } else if (opcode == OP_DISALLOWPUSHINPUTREF) {
-                foundDisallowedRefs.insert(refIdUint288);
+                foundDisallowedRefs.push_back(refIdUint288);
             } else if (opcode == OP_DISALLOWPUSHINPUTREFSIBLING) {
-                foundDisallowedSiblingRefs.insert(refIdUint288);
+                foundDisallowedSiblingRefs.push_back(refIdUint288);
             } else if (opcode == OP_PUSHINPUTREFSINGLETON) {
                 // The singleton op code ensures the reference is passed, and simultaneously disallows other siblings 
                 // from taking on that reference
-                foundPushRefs.insert(refIdUint288);
-                foundDisallowedSiblingRefs.insert(refIdUint288);
-                foundSingletonRefs.insert(refIdUint288);
+                foundPushRefs.push_back(refIdUint288);
+                foundDisallowedSiblingRefs.push_back(refIdUint288);
+                foundSingletonRefs.push_back(refIdUint288);
             } 
         }
         // Cannot process if there is already an existing state seperator
@@ -617,21 +638,21 @@ bool CScript::GetPushRefs(
             }
         } 
     }
+    SortAndRemoveDuplicates(foundDisallowedRefs);
+    SortAndRemoveDuplicates(foundDisallowedSiblingRefs);
+    SortAndRemoveDuplicates(foundPushRefs);
+    SortAndRemoveDuplicates(foundRequiredRefs);
+    SortAndRemoveDuplicates(foundSingletonRefs);
     // Verify that none of the prohibit refs appear in the ref set
-    // Save the set difference into resultSet
-    std::set<uint288> setOfDisallowedRefs;
-    std::insert_iterator< std::set<uint288> > insertIter(setOfDisallowedRefs, setOfDisallowedRefs.begin());
-    std::set_intersection(foundDisallowedRefs.begin(), foundDisallowedRefs.end(), foundPushRefs.begin(), foundPushRefs.end(), insertIter);
     // The rule is fulfilled if there are no prohibited references appearing anywhere
-    // There should be none of the prohibit refs
-    if (setOfDisallowedRefs.size() > 0) {
+    if (SortedRangesIntersect(foundDisallowedRefs, foundPushRefs)) {
         return false;
     }
-    // Merge in the found refs now that they are okay
-    pushRefSet.insert(foundPushRefs.begin(), foundPushRefs.end());
-    requireRefSet.insert(foundRequiredRefs.begin(), foundRequiredRefs.end());
-    disallowedSiblingsRefSet.insert(foundDisallowedSiblingRefs.begin(), foundDisallowedSiblingRefs.end());
-    singletonRefSet.insert(foundSingletonRefs.begin(), foundSingletonRefs.end());
+    // Hand out the found refs now that they are okay
+    pushRefs = std::move(foundPushRefs);
+    requireRefs = std::move(foundRequiredRefs);
+    disallowedSiblingsRefs = std::move(foundDisallowedSiblingRefs);
+    singletonRefs = std::move(foundSingletonRefs);
     // Update the location of the state seperator only if we got this far
     // If there was no OP_STATESEPARATOR, then the index is 0 (ie the start of the script)
     // If there was one OP_STATESEPARATOR, then the index is the location of it in the script
@@ -639,6 +660,36 @@ bool CScript::GetPushRefs(
     return true;
 }
 
+bool CScript::GetPushRefs(
+    std::vector<uint288> &pushRefs,
+    std::vector<uint288> &requireRefs,
+    std::vector<uint288> &disallowedSiblingsRefs,
+    std::vector<uint288> &singletonRefs,
+    uint32_t &stateSeperatorByteIndex
+) const {
+    return this->GetPushRefs(begin(), pushRefs, requireRefs, disallowedSiblingsRefs, singletonRefs, stateSeperatorByteIndex);
+}
+
+bool CScript::GetPushRefs(
+    const_iterator pc, 
+    std::set<uint288> &pushRefSet,
+    std::set<uint288> &requireRefSet,
+    std::set<uint288> &disallowedSiblingsRefSet,
+    std::set<uint288> &singletonRefSet,
+    uint32_t &stateSeperatorByteIndex
+) const {
+    std::vector<uint288> pushRefs, requireRefs, disallowedSiblingsRefs, singletonRefs;
+    if (!GetPushRefs(pc, pushRefs, requireRefs, disallowedSiblingsRefs, singletonRefs, stateSeperatorByteIndex)) {
+        return false;
+    }
+    // Merge in the found refs. The vectors are sorted, so these are hinted end-inserts.
+    pushRefSet.insert(pushRefs.begin(), pushRefs.end());
+    requireRefSet.insert(requireRefs.begin(), requireRefs.end());
+    disallowedSiblingsRefSet.insert(disallowedSiblingsRefs.begin(), disallowedSiblingsRefs.end());
+    singletonRefSet.insert(singletonRefs.begin(), singletonRefs.end());
+    return true;
+}
+
 bool CScript::GetPushRefs(
     std::set<uint288> &pushRefSet,
     std::set<uint288> &requireRefSet,
@@ -831,6 +831,28 @@ public:
         shrink_to_fit();
     }
 
+    /// Get the push, require, disallowed sibling and singleton refs of this script, as well as the byte
+    /// index of its OP_STATESEPARATOR (0 if none). The output vectors are replaced with sorted,
+    /// de-duplicated refs. Returns false (leaving the outputs untouched) if the script cannot be parsed
+    /// or violates the ref rules.
+    bool GetPushRefs(
+        const_iterator pc,
+        std::vector<uint288> &pushRefs,
+        std::vector<uint288> &requireRefs,
+        std::vector<uint288> &disallowedSiblingsRefs,
+        std::vector<uint288> &singletonRefs,
+        uint32_t &stateSeperatorByteIndex
+    ) const;
+
+    bool GetPushRefs(
+        std::vector<uint288> &pushRefs,
+        std::vector<uint288> &requireRefs,
+        std::vector<uint288> &disallowedSiblingsRefs,
+        std::vector<uint288> &singletonRefs,
+        uint32_t &stateSeperatorByteIndex
+    ) const;
+
+    /// As above, but the found refs are merged into the given sets.
     bool GetPushRefs(
         const_iterator pc, 
         std::set<uint288> &pushRefs,
@@ -5,12 +5,200 @@
 #include <script/script_execution_context.h>
 
 #include <psbt.h>
+#include <script/refsummarycache.h>
 
 #include <cassert>
+#include <stdexcept>
 
+void RefScriptsSummary::reserve(size_t nScripts) {
+    scripts.reserve(nScripts);
+    refHashToAmount.reserve(nScripts);
+    codeScriptHashTotals.reserve(nScripts);
+    // Most scripts carry at most one push ref (or none, which still adds an entry for the zero refAssetId)
+    refAssetIdTotals.reserve(nScripts);
+}
+
+/* static */
+PushRefScriptSummary RefScriptsSummary::summarize(const CScript &script, const Amount &nValue) {
+    static const uint256 zeroRefHash;
+
+    // Step 1. Populate the push ref information
+    PushRefScriptSummary scriptSummary;
+    scriptSummary.nValue = nValue;
+    if (!script.GetPushRefs(scriptSummary.pushRefSet, scriptSummary.requireRefSet,
+                            scriptSummary.disallowSiblingRefSet, scriptSummary.singletonRefSet,
+                            scriptSummary.stateSeperatorByteIndex)) {
+        // Fatal error parsing output should never happen
+        throw std::runtime_error("Error: script-execution-context-init");
+    }
+
+    // Step 2. The refHash and data summary hash
+    // Serves:
+    //
+    // - <refHash> OP_REFHASHVALUESUM_UTXOS
+    // - <refHash> OP_REFHASHVALUESUM_OUTPUTS
+    // - <inputIndex> OP_REFHASHDATASUMMARY_UTXO
+    // - <outputIndex> OP_REFHASHDATASUMMARY_OUTPUT
+    RefHashDataSummary dataSummary = getRefHashDataSummary(scriptSummary.pushRefSet, script, nValue, zeroRefHash);
+    scriptSummary.refsHash = dataSummary.refsHash;
+    CHashWriter hashOutputDataSummaryWriter(SER_GETHASH, 0);
+    hashOutputDataSummaryWriter << dataSummary.nValue;
+    hashOutputDataSummaryWriter << dataSummary.scriptPubKeyHash;
+    hashOutputDataSummaryWriter << dataSummary.totalRefs;
+    hashOutputDataSummaryWriter << dataSummary.refsHash;
+    scriptSummary.dataSummaryHash = hashOutputDataSummaryWriter.GetHash();
+
+    // Step 3. The codeScriptHash: the hash of everything after the OP_STATESEPARATOR (or the whole script)
+    scriptSummary.codeScriptHash = codeScriptHash(script, scriptSummary.stateSeperatorByteIndex);
+    return scriptSummary;
+}
+
+/* static */
+uint256 RefScriptsSummary::codeScriptHash(const CScript &script, uint32_t stateSeperatorByteIndex) {
+    CHashWriter hashWriterCodeScriptHashWriter(SER_GETHASH, 0);
+    if (stateSeperatorByteIndex < script.size()) {
+        hashWriterCodeScriptHashWriter.write(reinterpret_cast<const char *>(script.data()) + stateSeperatorByteIndex,
+                                             script.size() - stateSeperatorByteIndex);
+    }
+    return hashWriterCodeScriptHashWriter.GetHash();
+}
+
+void RefScriptsSummary::add(PushRefScriptSummaryRef scriptSummaryRef) {
+    static const uint288 zeroRefAssetId;
+    const PushRefScriptSummary &scriptSummary = *scriptSummaryRef;
+    const auto &pushRefs = scriptSummary.pushRefSet;
+    const Amount nValue = scriptSummary.nValue;
+
+    // Merge in the push refs and singleton refs (sorted and de-duplicated in finalize())
+    pushRefSet.insert(pushRefSet.end(), pushRefs.begin(), pushRefs.end());
+    singletonRefSet.insert(singletonRefSet.end(), scriptSummary.singletonRefSet.begin(),
+                           scriptSummary.singletonRefSet.end());
+
+    refHashToAmount.add(scriptSummary.refsHash, nValue);
+
+    // Populate the maps for refAssetId
+    // Serves:
+    //
+    // - <refAssetId 36 bytes> OP_REFVALUESUM_UTXOS
+    // - <refAssetId 36 bytes> OP_REFVALUESUM_OUTPUTS
+    // - <refAssetId 36 bytes> OP_REFOUTPUTCOUNT_UTXOS
+    // - <refAssetId 36 bytes> OP_REFOUTPUTCOUNT_OUTPUTS
+    // - <refAssetId 36 bytes> OP_REFOUTPUTCOUNTZEROVALUED_UTXOS
+    // - <refAssetId 36 bytes> OP_REFOUTPUTCOUNTZEROVALUED_OUTPUTS
+    const uint32_t isZeroValue = nValue == Amount::zero() ? 1 : 0;
+    if (pushRefs.empty()) {
+        // Scripts without push refs only record their value under the zero refAssetId, and only if that
+        // key was not seen before (consensus: this mirrors the std::map::insert the original code used).
+        refAssetIdTotals.addIfAbsent(zeroRefAssetId, {nValue, 0, 0});
+    } else {
+        for (const auto &ref : pushRefs) {
+            refAssetIdTotals.add(ref, {nValue, 1, isZeroValue});
+        }
+    }
+
+    // Populate the maps for codeScriptHash
+    // Serves:
+    //
+    // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHVALUESUM_UTXOS
+    // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHVALUESUM_OUTPUTS
+    // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHOUTPUTCOUNT_UTXOS
+    // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHOUTPUTCOUNT_OUTPUTS
+    // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHZEROVALUEDOUTPUTCOUNT_UTXOS
+    // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHZEROVALUEDOUTPUTCOUNT_OUTPUTS
+    codeScriptHashTotals.add(scriptSummary.codeScriptHash, {nValue, 1, isZeroValue});
+
+    // Serves:
+    //
+    // - OP_STATESEPARATOR
+    // - <inputIndex> OP_STATESEPARATORINDEX_UTXO
+    // - <outputIndex> OP_STATESEPARATORINDEX_OUTPUT
+    // - <inputIndex> OP_REFDATASUMMARY_UTXO
+    // - <outputIndex> OP_REFDATASUMMARY_OUTPUT
+    scripts.push_back(std::move(scriptSummaryRef));
+}
+
+void RefScriptsSummary::finalize() {
+    for (auto *refs : {&pushRefSet, &singletonRefSet}) {
+        std::sort(refs->begin(), refs->end());
+        refs->erase(std::unique(refs->begin(), refs->end()), refs->end());
+    }
+    refHashToAmount.finalize();
+    refAssetIdTotals.finalize();
+    codeScriptHashTotals.finalize();
+}
+
+ScriptExecutionContext::Shared::Shared(std::vector<Coin> &&coins, CTransactionView tx_,
+                                       RefSummaryCache *refSummaryCache_)
+    : inputCoins(std::move(coins)), tx(tx_), refSummaryCache(refSummaryCache_)
+{
+    checkRefs();
+}
+
+void ScriptExecutionContext::Shared::checkRefs() const {
+    // Consensus: a tx spending or creating a script whose refs cannot be parsed is invalid, whether or not
+    // any of its inputs ever looks at the summaries. Only the parsing is done here, and the summaries are
+    // left to computeSummaries(). A script with a summary in the ref summary cache (if any) parsed when that
+    // was computed, so only the scripts that miss it are parsed.
+    std::vector<uint288> pushRefs, requireRefs, disallowSiblingRefs, singletonRefs;
+    uint32_t stateSeperatorByteIndex{};
+    auto check = [&](const COutPoint &outpoint, const CScript &script) {
+        if (refSummaryCache && refSummaryCache->Get(outpoint)) {
+            return;
+        }
+        if (!script.GetPushRefs(pushRefs, requireRefs, disallowSiblingRefs, singletonRefs,
+                                stateSeperatorByteIndex)) {
+            throw std::runtime_error("Error: script-execution-context-init");
+        }
+    };
+    for (size_t i = 0; i < inputCoins.size(); ++i) {
+        check(tx.vin()[i].prevout, inputCoins[i].GetTxOut().scriptPubKey);
+    }
+    const TxId txid = refSummaryCache ? tx.GetId() : TxId();
+    for (size_t i = 0; i < tx.vout().size(); ++i) {
+        check(COutPoint(txid, i), tx.vout()[i].scriptPubKey);
+    }
+}
+
+void ScriptExecutionContext::Shared::computeSummaries() const {
+    // Look up the summary of the script at `outpoint` in the ref summary cache (if any), computing and
+    // caching it on a miss.
+    auto summarize = [this](const COutPoint &outpoint, const CScript &script,
+                            const Amount &nValue) -> PushRefScriptSummaryRef {
+        if (refSummaryCache) {
+            if (auto cached = refSummaryCache->Get(outpoint)) {
+                return cached;
+            }
+        }
+        auto summary = std::make_shared<const PushRefScriptSummary>(RefScriptsSummary::summarize(script, nValue));
+        if (refSummaryCache) {
+            refSummaryCache->Add(outpoint, summary);
+        }
+        return summary;
+    };
+
+    // Build into temporaries first so that nothing is left half-done should a script fail to parse
+    RefScriptsSummary inputs, outputs;
+    inputs.reserve(inputCoins.size());
+    for (size_t i = 0; i < inputCoins.size(); ++i) {
+        const CTxOut &txout = inputCoins[i].GetTxOut();
+        inputs.add(summarize(tx.vin()[i].prevout, txout.scriptPubKey, txout.nValue));
+    }
+    inputs.finalize();
+
+    const TxId txid = refSummaryCache ? tx.GetId() : TxId();
+    outputs.reserve(tx.vout().size());
+    for (size_t i = 0; i < tx.vout().size(); ++i) {
+        const CTxOut &txout = tx.vout()[i];
+        outputs.add(summarize(COutPoint(txid, i), txout.scriptPubKey, txout.nValue));
+    }
+    outputs.finalize();
+
+    inputSummaryData = std::move(inputs);
+    outputSummaryData = std::move(outputs);
+}
 
 ScriptExecutionContext::ScriptExecutionContext(unsigned input, const CCoinsViewCache &coinsCache,
-                                               CTransactionView tx)
+                                               CTransactionView tx, RefSummaryCache *refSummaryCache)
     : nIn(input)
 {
     assert(input < tx.vin().size());
@@ -20,7 +208,7 @@ ScriptExecutionContext::ScriptExecutionContext(unsigned input, const CCoinsViewC
         const Coin & c = coinsCache.AccessCoin(txin.prevout);
         coins.push_back(c);
     }
-    shared = std::make_shared<Shared>(std::move(coins), tx);
+    shared = std::make_shared<Shared>(std::move(coins), tx, refSummaryCache);
 }
 
 ScriptExecutionContext::ScriptExecutionContext(unsigned input, const std::vector<PSBTInput> &psbtInputs,
@@ -56,13 +244,14 @@ ScriptExecutionContext::ScriptExecutionContext(unsigned input, const CScript &sc
 
 /* static */
 std::vector<ScriptExecutionContext>
-ScriptExecutionContext::createForAllInputs(CTransactionView tx, const CCoinsViewCache &coinsCache)
+ScriptExecutionContext::createForAllInputs(CTransactionView tx, const CCoinsViewCache &coinsCache,
+                                           RefSummaryCache *refSummaryCache)
 {
     std::vector<ScriptExecutionContext> ret;
     ret.reserve(tx.vin().size());
     for (size_t i = 0; i < tx.vin().size(); ++i) {
         if (i == 0) {
-            ret.push_back(ScriptExecutionContext(i, coinsCache, tx)); // private c'tor, must use push_back
+            ret.push_back(ScriptExecutionContext(i, coinsCache, tx, refSummaryCache)); // private c'tor, must use push_back
         } else {
             ret.push_back(ScriptExecutionContext(i, ret.front())); // private c'tor, must use push_back
         }
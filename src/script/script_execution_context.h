@@ -7,27 +7,157 @@
 #include <coins.h>
 #include <primitives/transaction.h>
 
+#include <algorithm>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <utility>
 #include <vector>
 
 struct PSBTInput;
+class RefSummaryCache;
 
 /**
  * @brief Radiant state for push input reference data extracted from a script.
- * 
+ *
+ * All ref vectors are sorted and free of duplicates.
  */
 struct PushRefScriptSummary {
     Amount nValue;
-    std::set<uint288> pushRefSet;
-    std::set<uint288> requireRefSet;
-    std::set<uint288> disallowSiblingRefSet;
-    std::set<uint288> singletonRefSet;
+    std::vector<uint288> pushRefSet;
+    std::vector<uint288> requireRefSet;
+    std::vector<uint288> disallowSiblingRefSet;
+    std::vector<uint288> singletonRefSet;
     uint256 codeScriptHash;
+    /// Hash of the sorted push refs (all zeroes if there are none)
+    uint256 refsHash;
+    /// Hash of (nValue, scriptPubKeyHash, totalRefs, refsHash). Serves OP_REFHASHDATASUMMARY_*.
+    uint256 dataSummaryHash;
     uint32_t stateSeperatorByteIndex;
 };
 
+/// Summaries are immutable once computed, and shared between the contexts and the RefSummaryCache.
+using PushRefScriptSummaryRef = std::shared_ptr<const PushRefScriptSummary>;
+
+/**
+ * @brief A flat, sorted vector of key/value pairs used for the per-transaction Radiant summaries.
+ *
+ * Entries are appended while the scripts of a transaction are summarized, then sorted and merged
+ * once by finalize(). After that, lookups are binary searches. Compared to a std::map this avoids
+ * one node allocation per distinct key.
+ */
+template <typename K, typename V>
+class FlatSummaryMap {
+    struct Entry {
+        K key;
+        V value;
+        bool onlyIfAbsent;
+    };
+    std::vector<Entry> entries;
+
+public:
+    void reserve(size_t n) { entries.reserve(n); }
+
+    /// Add `value` to the value for `key`. Keys that were never seen start out at V{}.
+    void add(const K &key, const V &value) { entries.push_back({key, value, false}); }
+
+    /// Set the value for `key` to `value`, but only if `key` has not been seen yet at this point
+    /// (std::map::insert semantics).
+    void addIfAbsent(const K &key, const V &value) { entries.push_back({key, value, true}); }
+
+    /// Sort and merge the entries added so far. Must be called before find(). The result is
+    /// identical to having applied every add()/addIfAbsent() to a std::map in order.
+    void finalize() {
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const Entry &x, const Entry &y) { return x.key < y.key; });
+        auto out = entries.begin();
+        for (auto it = entries.begin(); it != entries.end();) {
+            // The first entry for a key always takes effect; later ones only if they are additions.
+            Entry merged{it->key, it->value, false};
+            for (++it; it != entries.end() && it->key == merged.key; ++it) {
+                if (!it->onlyIfAbsent) {
+                    merged.value += it->value;
+                }
+            }
+            *out++ = std::move(merged);
+        }
+        entries.erase(out, entries.end());
+    }
+
+    /// Returns nullptr if `key` is not present.
+    const V *find(const K &key) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), key,
+                                   [](const Entry &e, const K &k) { return e.key < k; });
+        if (it == entries.end() || it->key != key) {
+            return nullptr;
+        }
+        return &it->value;
+    }
+
+    size_t size() const { return entries.size(); }
+};
+
+/// Totals for all the scripts (utxos or outputs) of a transaction carrying a given refAssetId or codeScriptHash.
+struct RefSummaryTotals {
+    Amount nValue;
+    uint32_t outputCount{};
+    uint32_t zeroValueOutputCount{};
+
+    RefSummaryTotals &operator+=(const RefSummaryTotals &o) {
+        nValue += o.nValue;
+        outputCount += o.outputCount;
+        zeroValueOutputCount += o.zeroValueOutputCount;
+        return *this;
+    }
+};
+
+/**
+ * @brief The Radiant introspection state for one side (the spent utxos, or the outputs) of a transaction.
+ *
+ * Call add() for each script in index order, then finalize() once. All lookups are on flat sorted vectors.
+ */
+struct RefScriptsSummary {
+    /// Per-script summary, indexed by input or output index
+    std::vector<PushRefScriptSummaryRef> scripts;
+
+    /// Union of the push refs and singleton refs of all the scripts, sorted
+    std::vector<uint288> pushRefSet;
+    std::vector<uint288> singletonRefSet;
+
+    /// Metrics by refHash: total satoshi amount
+    FlatSummaryMap<uint256, Amount> refHashToAmount;
+    /// Metrics by refAssetId
+    FlatSummaryMap<uint288, RefSummaryTotals> refAssetIdTotals;
+    /// Metrics by codeScriptHash
+    FlatSummaryMap<uint256, RefSummaryTotals> codeScriptHashTotals;
+
+    void reserve(size_t nScripts);
+
+    /// Compute the summary of a single script. Throws std::runtime_error if the refs cannot be parsed.
+    static PushRefScriptSummary summarize(const CScript &script, const Amount &nValue);
+
+    /// The codeScriptHash of a script: the hash of everything after its OP_STATESEPARATOR (at
+    /// stateSeperatorByteIndex, as found by CScript::GetPushRefs), or of the whole script if it has none.
+    static uint256 codeScriptHash(const CScript &script, uint32_t stateSeperatorByteIndex);
+
+    /// Add the summary of one more script
+    void add(PushRefScriptSummaryRef scriptSummary);
+
+    /// Summarize and add one more script. Throws std::runtime_error if the refs cannot be parsed.
+    void add(const CScript &script, const Amount &nValue) {
+        add(std::make_shared<const PushRefScriptSummary>(summarize(script, nValue)));
+    }
+
+    void finalize();
+
+    bool hasPushRef(const uint288 &refAssetId) const {
+        return std::binary_search(pushRefSet.begin(), pushRefSet.end(), refAssetId);
+    }
+    bool hasSingletonRef(const uint288 &refAssetId) const {
+        return std::binary_search(singletonRefSet.begin(), singletonRefSet.end(), refAssetId);
+    }
+};
+
 /// An execution context for evaluating a script input. Note that this object contains some shared
 /// data that is shared for all inputs to a tx. This object is given to CScriptCheck as well
 /// as passed down to VerifyScript() and friends (for native introspection).
@@ -51,280 +181,36 @@ class ScriptExecutionContext {
         /// The transaction being evaluated.
         CTransactionView tx;
 
-        /// Extended shared context for Radiant
-        /// 
-        ///
-        std::vector<PushRefScriptSummary> vectorInputsPushRefScriptSummary;
-        std::vector<PushRefScriptSummary> vectorOutputsPushRefScriptSummary;
-
-        std::set<uint288> inputPushRefSet;
-        std::set<uint288> outputPushRefSet;
-        std::set<uint288> inputSingletonRefSet;
-        std::set<uint288> outputSingletonRefSet;
-
-        // Metrics by refHash
-        // Total satoshi amount
-        std::map<uint256, Amount> inputRefHashToAmountMap;
-        std::map<uint256, Amount> outputRefHashToAmountMap;
-        std::vector<uint256> inputIndexToRefHashDataSummaryHash;
-        std::vector<uint256> outputIndexRefHashToDataSummaryHash;
-
-        // Metrics by refAssetId
-        std::map<uint288, Amount> inputRefAssetIdToAmountMap;
-        std::map<uint288, Amount> outputRefAssetIdToAmountMap;
-        std::map<uint288, uint32_t> inputRefAssetIdToOutputCountMap;
-        std::map<uint288, uint32_t> outputRefAssetIdToOutputCountMap;
-        std::map<uint288, uint32_t> inputRefAssetIdToZeroValueOutputCountMap;
-        std::map<uint288, uint32_t> outputRefAssetIdToZeroValueOutputCountMap;
-
-        // Metrics by codeScriptHash
-        std::map<uint256, Amount> inputCodeScriptHashToAmountMap;
-        std::map<uint256, Amount> outputCodeScriptHashToAmountMap;
-        std::map<uint256, uint32_t> inputCodeScriptHashToOutputCountMap;
-        std::map<uint256, uint32_t> outputCodeScriptHashToOutputCountMap;
-        std::map<uint256, uint32_t> inputCodeScriptHashToZeroValueOutputCountMap;
-        std::map<uint256, uint32_t> outputCodeScriptHashToZeroValueOutputCountMap;
-        // State Seperator map
-        std::map<uint32_t, uint32_t> inputIndexToStateSeperatorIndex;
-        std::map<uint32_t, uint32_t> outputIndexToStateSeperatorIndex;
-        ///
-        ///
-        /// End of Extended shared context for Radiant
- 
-        // For std::make_shared to work correctly.
-        Shared(std::vector<Coin> && coins, CTransactionView tx_)
-            : inputCoins(std::move(coins)), tx(tx_) {
-            initializeInputSummary();
-            initializeOutputSummary();
+        /// If not null, per-output summaries are looked up in and added to this cache. Only set this when
+        /// inputCoins come from the validated UTXO view (see RefSummaryCache).
+        RefSummaryCache *refSummaryCache;
+
+        /// For std::make_shared to work correctly. Throws std::runtime_error if the refs of any of the spent
+        /// scripts or of the outputs cannot be parsed, which makes the tx invalid.
+        Shared(std::vector<Coin> && coins, CTransactionView tx_, RefSummaryCache *refSummaryCache_ = nullptr);
+
+        /// Extended shared context for Radiant: the introspection state for the spent utxos and for the
+        /// outputs. It is computed on first use only, since most transactions (e.g. plain P2PKH spends)
+        /// never execute an opcode that needs it. This is thread-safe: the CScriptChecks for the inputs of
+        /// a tx may run concurrently on the script check threads. The refs of the scripts were checked
+        /// to parse by the constructor already.
+        const RefScriptsSummary &inputSummary() const {
+            std::call_once(summariesOnce, &Shared::computeSummaries, this);
+            return inputSummaryData;
         }
-
-        /// Radiant specific extended context
-        void initializeInputSummary(){
- 
-            for (uint64_t i = 0; i < inputCoins.size(); i++) {
-                auto const& coin = inputCoins.at(i);
-                auto const& utxoScript = coin.GetTxOut().scriptPubKey;
-                auto const& nValue = coin.GetTxOut().nValue;
-
-                calculatePrecomputedStateForScript(
-                    utxoScript,
-                    nValue,
-                    i,
-                    inputPushRefSet,
-                    inputSingletonRefSet,
-                    vectorInputsPushRefScriptSummary,
-                    inputIndexToRefHashDataSummaryHash,
-                    inputRefHashToAmountMap,
-                    inputRefAssetIdToAmountMap,
-                    inputRefAssetIdToOutputCountMap,
-                    inputRefAssetIdToZeroValueOutputCountMap,
-                    inputCodeScriptHashToAmountMap,
-                    inputCodeScriptHashToOutputCountMap,
-                    inputCodeScriptHashToZeroValueOutputCountMap,
-                    inputIndexToStateSeperatorIndex
-                );
-            }
+        const RefScriptsSummary &outputSummary() const {
+            std::call_once(summariesOnce, &Shared::computeSummaries, this);
+            return outputSummaryData;
         }
 
-        void initializeOutputSummary(){
-
-            for (uint64_t i = 0; i < tx.vout().size(); i++) {
-                auto const& coinOutput = tx.vout()[i];
-                auto const& outputScript = coinOutput.scriptPubKey;
-                auto const& nValue = coinOutput.nValue;
-
-                calculatePrecomputedStateForScript(
-                    outputScript,
-                    nValue,
-                    i,
-                    outputPushRefSet,
-                    outputSingletonRefSet,
-                    vectorOutputsPushRefScriptSummary,
-                    outputIndexRefHashToDataSummaryHash,
-                    outputRefHashToAmountMap,
-                    outputRefAssetIdToAmountMap,
-                    outputRefAssetIdToOutputCountMap,
-                    outputRefAssetIdToZeroValueOutputCountMap,
-                    outputCodeScriptHashToAmountMap,
-                    outputCodeScriptHashToOutputCountMap,
-                    outputCodeScriptHashToZeroValueOutputCountMap,
-                    outputIndexToStateSeperatorIndex
-                );
-            }
-        }
-
-        static void calculatePrecomputedStateForScript(
-            const CScript &script,
-            const Amount &nValue,
-            uint64_t index,
-            std::set<uint288> &globalPushRefSet,
-            std::set<uint288> &singletonRefSet,
-            std::vector<PushRefScriptSummary> &vectorPushRefScriptSummary,
-            std::vector<uint256> &indexToDataSummaryHash,
-            std::map<uint256, Amount> &refHashToAmountMap,
-            std::map<uint288, Amount> &refAssetIdToAmountMap,
-            std::map<uint288, uint32_t> &refAssetIdToOutputCountMap,
-            std::map<uint288, uint32_t> &refAssetIdToZeroValueOutputCountMap,
-            std::map<uint256, Amount> &codeScriptHashToAmountMap,
-            std::map<uint256, uint32_t> &codeScriptHashToOutputCountMap,
-            std::map<uint256, uint32_t> &codeScriptHashToZeroValueOutputCountMap,
-            std::map<uint32_t, uint32_t> &indexToStateSeperatorIndex 
-        ) {
-            uint256 zeroRefHash(uint256S("0000000000000000000000000000000000000000000000000000000000000000"));
-            uint288 zeroRefAssetId(uint288S("000000000000000000000000000000000000000000000000000000000000000000000000"));
-            // Step 1. Populate the push ref information 
-            std::set<uint288> pushRefSetLocal;
-            std::set<uint288> requireRefSetLocal;
-            std::set<uint288> disallowSiblingRefSetLocal;
-            std::set<uint288> singletonRefSetLocal;
-            uint32_t stateSeperatorByteIndex;
-            if (!script.GetPushRefs(pushRefSetLocal, requireRefSetLocal, disallowSiblingRefSetLocal, singletonRefSetLocal, stateSeperatorByteIndex)) {
-                // Fatal error parsing output should never happen
-                throw std::runtime_error("Error: script-execution-context-init");
-            }
+    private:
+        /// Throws std::runtime_error if the refs of any of the scripts cannot be parsed.
+        void checkRefs() const;
+        void computeSummaries() const;
 
-            PushRefScriptSummary scriptSummary;
-            scriptSummary.nValue = nValue;
-            scriptSummary.pushRefSet = pushRefSetLocal;
-            scriptSummary.requireRefSet = requireRefSetLocal;
-            scriptSummary.disallowSiblingRefSet = disallowSiblingRefSetLocal;
-            scriptSummary.singletonRefSet = singletonRefSetLocal;
-            scriptSummary.stateSeperatorByteIndex = stateSeperatorByteIndex;
-
-            // Merge in the local pushRefSet and singletonRefSet
-            globalPushRefSet.insert(pushRefSetLocal.begin(), pushRefSetLocal.end());
-            singletonRefSet.insert(singletonRefSetLocal.begin(), singletonRefSetLocal.end());
-            // Populate state seperator map
-            // Serves:
-            // 
-            // - OP_STATESEPARATOR
-            // - <inputIndex> OP_STATESEPARATORINDEX_UTXO
-            // - <outputIndex> OP_STATESEPARATORINDEX_OUTPUT
-            indexToStateSeperatorIndex.insert(std::pair(index, stateSeperatorByteIndex));
-            // Populate the maps for refHash
-            // Serves:
-            //
-            // - <refHash> OP_REFHASHVALUESUM_UTXOS
-            // - <refHash> OP_REFHASHVALUESUM_OUTPUTS
-            // - <refHash> OP_REFHASHDATASUMMARY_UTXO
-            // - <refHash> OP_REFHASHDATASUMMARY_OUTPUT 
-            RefHashDataSummary outputSummary = getRefHashDataSummary(pushRefSetLocal, script, nValue, zeroRefHash);
-            auto refsIt = refHashToAmountMap.find(outputSummary.refsHash);
-            if (refsIt == refHashToAmountMap.end()) {
-                // If it doesn't exist, then just initialize it
-                refHashToAmountMap.insert(std::pair(outputSummary.refsHash, Amount::zero()));
-                refsIt = refHashToAmountMap.find(outputSummary.refsHash);
-            }
-            refsIt->second += nValue;
-            CHashWriter hashOutputDataSummaryWriter(SER_GETHASH, 0);
-            hashOutputDataSummaryWriter << outputSummary.nValue;
-            hashOutputDataSummaryWriter << outputSummary.scriptPubKeyHash;
-            hashOutputDataSummaryWriter << outputSummary.totalRefs;
-            hashOutputDataSummaryWriter << outputSummary.refsHash;
-            indexToDataSummaryHash.push_back(hashOutputDataSummaryWriter.GetHash());
-            // Populate the maps for refAssetId
-            // Serves:
-            //
-            // Information by refAssetId
-            // - <refAssetId 36 bytes> OP_REFVALUESUM_UTXOS
-            // - <refAssetId 36 bytes> OP_REFVALUESUM_OUTPUTS
-            // - <refAssetId 36 bytes> OP_REFOUTPUTCOUNT_UTXOS
-            // - <refAssetId 36 bytes> OP_REFOUTPUTCOUNT_OUTPUTS
-            // - <refAssetId 36 bytes> OP_REFOUTPUTCOUNTZEROVALUED_UTXOS
-            // - <refAssetId 36 bytes> OP_REFOUTPUTCOUNTZEROVALUED_OUTPUTS
-            // - <inputIndex> OP_REFDATASUMMARY_UTXO
-            // - <outputIndex> OP_REFDATASUMMARY_OUTPUT
-            // Initial the map of refAssetId to amount
-            // First insert the zeroRefHash if there are no push refs
-            if (pushRefSetLocal.size() == 0) {
-                refAssetIdToAmountMap.insert(std::pair(zeroRefAssetId, nValue));
-            } else {
-                // There is at least one push reference, 
-                std::set<uint288>::const_iterator pushRefsIt;
-                for (pushRefsIt = pushRefSetLocal.begin(); pushRefsIt != pushRefSetLocal.end(); pushRefsIt++) {
-                    // Sum the total value of the outputs
-                    auto foundPushRefMapIt = refAssetIdToAmountMap.find(*pushRefsIt);
-                    if (foundPushRefMapIt == refAssetIdToAmountMap.end()) {
-                        // If it doesn't exist, then just initialize it
-                        refAssetIdToAmountMap.insert(std::pair(*pushRefsIt, Amount::zero()));
-                        foundPushRefMapIt = refAssetIdToAmountMap.find(*pushRefsIt);
-                    }
-                    foundPushRefMapIt->second += nValue;
-                    
-                    //  Count the number of outputs that exist for the given assetId
-                    auto foundRefAssetIdToOutputCountMapIt = refAssetIdToOutputCountMap.find(*pushRefsIt);
-                    if (foundRefAssetIdToOutputCountMapIt == refAssetIdToOutputCountMap.end()) {
-                        // If it doesn't exist, then just initialize it
-                        refAssetIdToOutputCountMap.insert(std::pair(*pushRefsIt, 0));
-                        foundRefAssetIdToOutputCountMapIt = refAssetIdToOutputCountMap.find(*pushRefsIt);
-                    }
-                    foundRefAssetIdToOutputCountMapIt->second++;
-
-                    //  Count the number of zero valued outputs that exist for the given assetId
-                    auto foundRefAssetIdToZeroValueOutputCountMapIt = refAssetIdToZeroValueOutputCountMap.find(*pushRefsIt);
-                    if (foundRefAssetIdToZeroValueOutputCountMapIt == refAssetIdToZeroValueOutputCountMap.end()) {
-                        // If it doesn't exist, then just initialize it
-                        refAssetIdToZeroValueOutputCountMap.insert(std::pair(*pushRefsIt, 0));
-                        foundRefAssetIdToZeroValueOutputCountMapIt = refAssetIdToZeroValueOutputCountMap.find(*pushRefsIt);
-                    }
-                    if (nValue == Amount::zero()) {
-                        foundRefAssetIdToZeroValueOutputCountMapIt->second++;
-                    }
-                }
-            }
-            // Create the codeScriptHash
-            if (stateSeperatorByteIndex >= script.size()) {
-                CHashWriter hashWriterCodeScriptHashWriter(SER_GETHASH, 0);
-                hashWriterCodeScriptHashWriter << CFlatData(CScript(script.end(), script.end()));
-                scriptSummary.codeScriptHash = hashWriterCodeScriptHashWriter.GetHash(); 
-            } else {
-                CScript::const_iterator scriptStateSeperatorIterator = script.begin() + stateSeperatorByteIndex; 
-                CHashWriter hashWriterCodeScriptHashWriter(SER_GETHASH, 0);
-                hashWriterCodeScriptHashWriter << CFlatData(CScript(scriptStateSeperatorIterator, script.end()));
-                scriptSummary.codeScriptHash = hashWriterCodeScriptHashWriter.GetHash(); 
-            }
-            vectorPushRefScriptSummary.push_back(scriptSummary);
-            // Populate the maps for codeScriptHash
-            // Serves:
-            //
-            // Information by codeScriptHash
-            // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHVALUESUM_UTXOS
-            // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHVALUESUM_OUTPUTS
-            // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHOUTPUTCOUNT_UTXOS
-            // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHOUTPUTCOUNT_OUTPUTS
-            // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHZEROVALUEDOUTPUTCOUNT_UTXOS
-            // - <codeScriptHash 32 bytes> OP_CODESCRIPTHASHZEROVALUEDOUTPUTCOUNT_OUTPUTS
-            // - <inputIndex> OP_CODESCRIPTHASH_UTXO
-            // - <outputIndex> OP_CODESCRIPTHASH_OUTPUT
-            // Sum the total value of the outputs
-            auto foundCodeScriptToAmountIt = codeScriptHashToAmountMap.find(scriptSummary.codeScriptHash);
-            if (foundCodeScriptToAmountIt == codeScriptHashToAmountMap.end()) {
-                // If it doesn't exist, then just initialize it
-                codeScriptHashToAmountMap.insert(std::pair(scriptSummary.codeScriptHash, Amount::zero()));
-                foundCodeScriptToAmountIt = codeScriptHashToAmountMap.find(scriptSummary.codeScriptHash);
-            }
-            foundCodeScriptToAmountIt->second += nValue;
-            
-            //  Count the number of outputs that exist for the given assetId
-            auto foundCodeScriptToOutputCountIt = codeScriptHashToOutputCountMap.find(scriptSummary.codeScriptHash);
-            if (foundCodeScriptToOutputCountIt == codeScriptHashToOutputCountMap.end()) {
-                // If it doesn't exist, then just initialize it
-                codeScriptHashToOutputCountMap.insert(std::pair(scriptSummary.codeScriptHash, 0));
-                foundCodeScriptToOutputCountIt = codeScriptHashToOutputCountMap.find(scriptSummary.codeScriptHash);
-            }
-            foundCodeScriptToOutputCountIt->second++;
-
-            //  Count the number of zero valued outputs that exist for the given codeScriptHash
-            auto foundCodeScriptToZeroValueOutputCountMapIt = codeScriptHashToZeroValueOutputCountMap.find(scriptSummary.codeScriptHash);
-            if (foundCodeScriptToZeroValueOutputCountMapIt == codeScriptHashToZeroValueOutputCountMap.end()) {
-                // If it doesn't exist, then just initialize it
-                codeScriptHashToZeroValueOutputCountMap.insert(std::pair(scriptSummary.codeScriptHash, 0));
-                foundCodeScriptToZeroValueOutputCountMapIt = codeScriptHashToZeroValueOutputCountMap.find(scriptSummary.codeScriptHash);
-            }
-            if (nValue == Amount::zero()) {
-                foundCodeScriptToZeroValueOutputCountMapIt->second++;
-            }
-        }
+        mutable std::once_flag summariesOnce;
+        mutable RefScriptsSummary inputSummaryData;
+        mutable RefScriptsSummary outputSummaryData;
     };
 
     using SharedPtr = std::shared_ptr<const Shared>;
@@ -334,7 +220,8 @@ class ScriptExecutionContext {
     /// Construct a specific context for this input, given a tx.
     /// Use this constructor for the first input in a tx.
     /// All of the coins for the tx will get pre-cached and a new internal Shared object will be constructed.
-    ScriptExecutionContext(unsigned input, const CCoinsViewCache &coinsCache, CTransactionView tx);
+    ScriptExecutionContext(unsigned input, const CCoinsViewCache &coinsCache, CTransactionView tx,
+                           RefSummaryCache *refSummaryCache);
 
     /// Construct a specific context for this input, given a tx.
     /// Use this constructor for the first input in a tx.
@@ -348,8 +235,10 @@ class ScriptExecutionContext {
 
 public:
     /// Factory method to create a context for all inputs in a tx.
+    /// Pass `refSummaryCache` only if `coinsCache` is the validated UTXO view (see RefSummaryCache).
     static
-    std::vector<ScriptExecutionContext> createForAllInputs(CTransactionView tx, const CCoinsViewCache &coinsCache);
+    std::vector<ScriptExecutionContext> createForAllInputs(CTransactionView tx, const CCoinsViewCache &coinsCache,
+                                                           RefSummaryCache *refSummaryCache = nullptr);
 
     /// Like the above, but takes a partially-signed bitcoin transacton's inputs as its coin source.
     static
@@ -417,188 +306,124 @@ public:
     const CTransactionView & tx() const { return shared->tx; }
 
     Amount getRefHashValueSumUtxos(const uint256& refHash) const {
-        auto refHashMapIt = shared->inputRefHashToAmountMap.find(refHash);
-        if (refHashMapIt != shared->inputRefHashToAmountMap.end()) {
-            return refHashMapIt->second;
-        }
-        return Amount::zero();
+        return valueOr(shared->inputSummary().refHashToAmount.find(refHash), Amount::zero());
     }
 
     Amount getRefHashValueSumOutputs(const uint256& refHash) const {
-        auto refHashMapIt = shared->outputRefHashToAmountMap.find(refHash);
-        if (refHashMapIt != shared->outputRefHashToAmountMap.end()) {
-            return refHashMapIt->second;
-        }
-        return Amount::zero();
+        return valueOr(shared->outputSummary().refHashToAmount.find(refHash), Amount::zero());
     }
 
     const uint256& getRefHashDataSummaryUtxo(uint32_t inputIndex) const {
-        return shared->inputIndexToRefHashDataSummaryHash[inputIndex];
+        return shared->inputSummary().scripts[inputIndex]->dataSummaryHash;
     }
 
     const uint256& getRefHashDataSummaryOutput(uint32_t outputIndex) const {
-        return shared->outputIndexRefHashToDataSummaryHash[outputIndex];
+        return shared->outputSummary().scripts[outputIndex]->dataSummaryHash;
     }
 
     uint32_t getRefTypeUtxo(const uint288& refAssetId) const {
-        auto foundSingletonIt = shared->inputSingletonRefSet.find(refAssetId);
-        if (foundSingletonIt != shared->inputSingletonRefSet.end()) {
-            return 2; // singleton
-        }
-        auto foundIt = shared->inputPushRefSet.find(refAssetId);
-        if (foundIt != shared->inputPushRefSet.end()) {
-            return 1; // normal
-        }
-        return 0;
+        return getRefType(shared->inputSummary(), refAssetId);
     }
 
     uint32_t getRefTypeOutput(const uint288& refAssetId) const {
-        auto foundSingletonIt = shared->outputSingletonRefSet.find(refAssetId);
-        if (foundSingletonIt != shared->outputSingletonRefSet.end()) {
-            return 2; // singleton
-        }
-        auto foundIt = shared->outputPushRefSet.find(refAssetId);
-        if (foundIt != shared->outputPushRefSet.end()) {
-            return 1; // normal
-        }
-        return 0;
+        return getRefType(shared->outputSummary(), refAssetId);
     }
 
     uint32_t getStateSeperatorIndexUtxo(uint32_t inputIndex) const {
-        auto foundIt = shared->inputIndexToStateSeperatorIndex.find(inputIndex);
-        if (foundIt != shared->inputIndexToStateSeperatorIndex.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        auto const& scripts = shared->inputSummary().scripts;
+        return inputIndex < scripts.size() ? scripts[inputIndex]->stateSeperatorByteIndex : 0;
     }
     uint32_t getStateSeperatorIndexOutput(uint32_t outputIndex) const {
-        auto foundIt = shared->outputIndexToStateSeperatorIndex.find(outputIndex);
-        if (foundIt != shared->outputIndexToStateSeperatorIndex.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        auto const& scripts = shared->outputSummary().scripts;
+        return outputIndex < scripts.size() ? scripts[outputIndex]->stateSeperatorByteIndex : 0;
     }
 
     Amount getRefValueSumUtxos(const uint288& refAssetId) const {
-        auto foundIt = shared->inputRefAssetIdToAmountMap.find(refAssetId);
-        if (foundIt != shared->inputRefAssetIdToAmountMap.end()) {
-            return foundIt->second;
-        }
-        return Amount::zero();
+        return refAssetIdTotals(shared->inputSummary(), refAssetId).nValue;
     }
 
     Amount getRefValueSumOutputs(const uint288& refAssetId) const {
-        auto foundIt = shared->outputRefAssetIdToAmountMap.find(refAssetId);
-        if (foundIt != shared->outputRefAssetIdToAmountMap.end()) {
-            return foundIt->second;
-        }
-        return Amount::zero();
+        return refAssetIdTotals(shared->outputSummary(), refAssetId).nValue;
     }
 
     uint32_t getRefOutputCountUtxos(const uint288& refAssetId) const {
-        auto foundIt = shared->inputRefAssetIdToOutputCountMap.find(refAssetId);
-        if (foundIt != shared->inputRefAssetIdToOutputCountMap.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        return refAssetIdTotals(shared->inputSummary(), refAssetId).outputCount;
     }
 
     uint32_t getRefOutputCountOutputs(const uint288& refAssetId) const {
-        auto foundIt = shared->outputRefAssetIdToOutputCountMap.find(refAssetId);
-        if (foundIt != shared->outputRefAssetIdToOutputCountMap.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        return refAssetIdTotals(shared->outputSummary(), refAssetId).outputCount;
     }
     uint32_t getRefOutputZeroValuedCountUtxos(const uint288& refAssetId) const {
-        auto foundIt = shared->inputRefAssetIdToZeroValueOutputCountMap.find(refAssetId);
-        if (foundIt != shared->inputRefAssetIdToZeroValueOutputCountMap.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        return refAssetIdTotals(shared->inputSummary(), refAssetId).zeroValueOutputCount;
     }
     uint32_t getRefOutputZeroValuedCountOutputs(const uint288& refAssetId) const {
-        auto foundIt = shared->outputRefAssetIdToZeroValueOutputCountMap.find(refAssetId);
-        if (foundIt != shared->outputRefAssetIdToZeroValueOutputCountMap.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        return refAssetIdTotals(shared->outputSummary(), refAssetId).zeroValueOutputCount;
     }
  
     bool getRefsPerUtxo(uint32_t inputIndex, std::vector<uint8_t>& refsVector) const {
-        auto pushRefSetPerInput = shared->vectorInputsPushRefScriptSummary[inputIndex].pushRefSet;
-        if (pushRefSetPerInput.size() <= 0) {
-            return false;
-        }
-        // We know there is at least one element, therefore initialize it
-        std::set<uint288>::const_iterator pushRefsIt;
-        for (pushRefsIt = pushRefSetPerInput.begin(); pushRefsIt != pushRefSetPerInput.end(); pushRefsIt++) {
-            std::move(pushRefsIt->begin(), pushRefsIt->end(), std::back_inserter(refsVector));
-        }
-        return true;
+        return getRefs(*shared->inputSummary().scripts[inputIndex], refsVector);
     }
 
     bool getRefsPerOutput(uint32_t outputIndex, std::vector<uint8_t>& refsVector) const {
-        auto pushRefSetPerOutput= shared->vectorOutputsPushRefScriptSummary[outputIndex].pushRefSet;
-        if (pushRefSetPerOutput.size() <= 0) {
-            return false;
-        }
-        // We know there is at least one element, therefore initialize it
-        
-        std::set<uint288>::const_iterator pushRefsIt;
-        for (pushRefsIt = pushRefSetPerOutput.begin(); pushRefsIt != pushRefSetPerOutput.end(); pushRefsIt++) {
-            std::move(pushRefsIt->begin(), pushRefsIt->end(), std::back_inserter(refsVector));
-        }
-        return true;
+        return getRefs(*shared->outputSummary().scripts[outputIndex], refsVector);
     }
  
     Amount getCodeScriptHashValueSumUtxos(const uint256& codeScriptHash) const {
-        auto foundIt = shared->inputCodeScriptHashToAmountMap.find(codeScriptHash);
-        if (foundIt != shared->inputCodeScriptHashToAmountMap.end()) {
-            return foundIt->second;
-        }
-        return Amount::zero();
+        return codeScriptHashTotals(shared->inputSummary(), codeScriptHash).nValue;
     }
     Amount getCodeScriptHashValueSumOutputs(const uint256& codeScriptHash) const {
-        auto foundIt = shared->outputCodeScriptHashToAmountMap.find(codeScriptHash);
-        if (foundIt != shared->outputCodeScriptHashToAmountMap.end()) {
-            return foundIt->second;
-        }
-        return Amount::zero();
+        return codeScriptHashTotals(shared->outputSummary(), codeScriptHash).nValue;
     }
     uint32_t getCodeScriptHashOutputCountUtxos(const uint256& codeScriptHash) const {
-        auto foundIt = shared->inputCodeScriptHashToOutputCountMap.find(codeScriptHash);
-        if (foundIt != shared->inputCodeScriptHashToOutputCountMap.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        return codeScriptHashTotals(shared->inputSummary(), codeScriptHash).outputCount;
     }
     uint32_t getCodeScriptHashOutputCountOutputs(const uint256& codeScriptHash) const {
-        auto foundIt = shared->outputCodeScriptHashToOutputCountMap.find(codeScriptHash);
-        if (foundIt != shared->outputCodeScriptHashToOutputCountMap.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        return codeScriptHashTotals(shared->outputSummary(), codeScriptHash).outputCount;
     }
     uint32_t getCodeScriptHashOutputZeroValuedCountUtxos(const uint256& codeScriptHash) const {
-        auto foundIt = shared->inputCodeScriptHashToZeroValueOutputCountMap.find(codeScriptHash);
-        if (foundIt != shared->inputCodeScriptHashToZeroValueOutputCountMap.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        return codeScriptHashTotals(shared->inputSummary(), codeScriptHash).zeroValueOutputCount;
     }
     uint32_t getCodeScriptHashOutputZeroValuedCountOutputs(const uint256& codeScriptHash) const {
-        auto foundIt = shared->outputCodeScriptHashToZeroValueOutputCountMap.find(codeScriptHash);
-        if (foundIt != shared->outputCodeScriptHashToZeroValueOutputCountMap.end()) {
-            return foundIt->second;
-        }
-        return 0;
+        return codeScriptHashTotals(shared->outputSummary(), codeScriptHash).zeroValueOutputCount;
     } 
     uint32_t getStateSeparatorByteIndexUtxo(uint32_t inputIndex) const {
-        return shared->vectorInputsPushRefScriptSummary[inputIndex].stateSeperatorByteIndex;
+        return shared->inputSummary().scripts[inputIndex]->stateSeperatorByteIndex;
     }
     uint32_t getStateSeparatorByteIndexOutput(uint32_t outputIndex) const {
-        return shared->vectorOutputsPushRefScriptSummary[outputIndex].stateSeperatorByteIndex;
+        return shared->outputSummary().scripts[outputIndex]->stateSeperatorByteIndex;
+    }
+
+private:
+    template <typename V>
+    static V valueOr(const V *value, V fallback) { return value ? *value : fallback; }
+
+    static RefSummaryTotals refAssetIdTotals(const RefScriptsSummary &summary, const uint288 &refAssetId) {
+        return valueOr(summary.refAssetIdTotals.find(refAssetId), RefSummaryTotals{});
+    }
+
+    static RefSummaryTotals codeScriptHashTotals(const RefScriptsSummary &summary, const uint256 &codeScriptHash) {
+        return valueOr(summary.codeScriptHashTotals.find(codeScriptHash), RefSummaryTotals{});
+    }
+
+    static uint32_t getRefType(const RefScriptsSummary &summary, const uint288 &refAssetId) {
+        if (summary.hasSingletonRef(refAssetId)) {
+            return 2; // singleton
+        }
+        if (summary.hasPushRef(refAssetId)) {
+            return 1; // normal
+        }
+        return 0;
+    }
+
+    static bool getRefs(const PushRefScriptSummary &scriptSummary, std::vector<uint8_t>& refsVector) {
+        if (scriptSummary.pushRefSet.empty()) {
+            return false;
+        }
+        refsVector.reserve(refsVector.size() + scriptSummary.pushRefSet.size() * uint288::size());
+        for (auto const& ref : scriptSummary.pushRefSet) {
+            refsVector.insert(refsVector.end(), ref.begin(), ref.end());
+        }
+        return true;
     }
 };
 #if defined(__GNUG__) && !defined(__clang__)
@@ -8,10 +8,10 @@
 #include <cuckoocache.h>
 #include <primitives/transaction.h>
 #include <random.h>
+#include <script/shardedcache.h>
 #include <script/sigcache.h>
-#include <sync.h>
+#include <streams.h>
 #include <util/system.h>
-#include <validation.h>
 
 /**
  * In future if many more values are added, it should be considered to
@@ -34,6 +34,10 @@ struct ScriptCacheElement {
         : key(keyIn), nSigChecks(nSigChecksIn) {}
 
     const KeyType &getKey() const { return key; }
+
+    SERIALIZE_METHODS(ScriptCacheElement, obj) {
+        READWRITE(obj.key, obj.nSigChecks);
+    }
 };
 
 static_assert(sizeof(ScriptCacheElement) == 32,
@@ -69,7 +73,7 @@ public:
     }
 };
 
-static CuckooCache::cache<ScriptCacheElement, ScriptCacheHasher>
+static ShardedCuckooCache<ScriptCacheElement, ScriptCacheHasher>
     scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
 
@@ -87,6 +91,23 @@ void InitScriptExecutionCache() {
               (nElems * sizeof(uint256)) >> 20, nMaxCacheSize >> 20, nElems);
 }
 
+size_t DumpScriptExecutionCache(CAutoFile &file) {
+    std::vector<ScriptCacheElement> elems;
+    scriptExecutionCache.ForEach(
+        [&](const ScriptCacheElement &elem) { elems.push_back(elem); });
+    file << scriptExecutionCacheNonce << elems;
+    return elems.size();
+}
+
+size_t LoadScriptExecutionCache(CAutoFile &file) {
+    std::vector<ScriptCacheElement> elems;
+    file >> scriptExecutionCacheNonce >> elems;
+    for (const ScriptCacheElement &elem : elems) {
+        scriptExecutionCache.insert(elem);
+    }
+    return elems.size();
+}
+
 ScriptCacheKey::ScriptCacheKey(const CTransaction &tx, uint32_t flags) {
     std::array<uint8_t, 32> hash;
     // We only use the first 19 bytes of nonce to avoid a second SHA round -
@@ -104,10 +125,6 @@ ScriptCacheKey::ScriptCacheKey(const CTransaction &tx, uint32_t flags) {
 }
 
 bool IsKeyInScriptCache(ScriptCacheKey key, bool erase, int &nSigChecksOut) {
-    // TODO: Remove this requirement by making CuckooCache not require external
-    // locks
-    AssertLockHeld(cs_main);
-
     ScriptCacheElement elem(key, 0);
     bool ret = scriptExecutionCache.get(elem, erase);
     nSigChecksOut = elem.nSigChecks;
@@ -115,10 +132,10 @@ bool IsKeyInScriptCache(ScriptCacheKey key, bool erase, int &nSigChecksOut) {
 }
 
 void AddKeyInScriptCache(ScriptCacheKey key, int nSigChecks) {
-    // TODO: Remove this requirement by making CuckooCache not require external
-    // locks
-    AssertLockHeld(cs_main);
-
     ScriptCacheElement elem(key, nSigChecks);
     scriptExecutionCache.insert(elem);
 }
+
+CacheStats GetScriptCacheStats() {
+    return scriptExecutionCache.GetStats();
+}
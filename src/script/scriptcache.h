@@ -4,10 +4,14 @@
 
 #pragma once
 
+#include <serialize.h>
+
 #include <array>
 #include <cstdint>
 
+class CAutoFile;
 class CTransaction;
+struct CacheStats;
 
 /**
  * The script cache is a map using a key/value element, that caches the
@@ -31,6 +35,8 @@ public:
     }
     ScriptCacheKey &operator=(const ScriptCacheKey &) noexcept = default; // prevent -Wdepecated-copy
 
+    SERIALIZE_METHODS(ScriptCacheKey, obj) { READWRITE(obj.data); }
+
     friend class ScriptCacheHasher;
 };
 
@@ -44,9 +50,26 @@ static constexpr int64_t MAX_MAX_SCRIPT_CACHE_SIZE = 16384;
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
+/**
+ * Write the entries of the script-execution cache to file, with the nonce
+ * their keys were computed with. Returns the number of entries written.
+ */
+size_t DumpScriptExecutionCache(CAutoFile &file);
+
+/**
+ * Replace the nonce of the script-execution cache with the one in file and
+ * insert the entries dumped along with it, returning their number. Throws if
+ * file cannot be read. Like InitScriptExecutionCache, this must run before
+ * other threads use the cache.
+ */
+size_t LoadScriptExecutionCache(CAutoFile &file);
+
 /**
  * Check if a given key is in the cache, and if so, return its values.
  * (if not found, nSigChecks may or may not be set to an arbitrary value)
+ *
+ * The cache does its own locking, so this and AddKeyInScriptCache may be
+ * called from any thread.
  */
 bool IsKeyInScriptCache(ScriptCacheKey key, bool erase, int &nSigChecksOut);
 
@@ -54,3 +77,6 @@ bool IsKeyInScriptCache(ScriptCacheKey key, bool erase, int &nSigChecksOut);
  * Add an entry in the cache.
  */
 void AddKeyInScriptCache(ScriptCacheKey key, int nSigChecks);
+
+/** Hit, miss and lock contention counters of the script-execution cache. */
+CacheStats GetScriptCacheStats();
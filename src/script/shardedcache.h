@@ -0,0 +1,158 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cuckoocache.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+
+/** Counters of a cache, summed over its shards. */
+struct CacheStats {
+    //! Number of elements the cache can hold
+    size_t capacity = 0;
+    size_t shards = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    //! Number of lookups and inserts which had to wait for the lock of their shard
+    uint64_t contended = 0;
+};
+
+/**
+ * A CuckooCache::cache split into shards, each behind its own read/write lock,
+ * so that lookups from the mempool and the block validation threads only
+ * contend when they hit the same shard while it is being written to.
+ *
+ * Elements go to a shard by the low bits of their first hash, while the cuckoo
+ * table of each shard indexes by the high bits of the hashes.
+ */
+template <typename Element, typename Hash, size_t NUM_SHARDS = 16>
+class ShardedCuckooCache {
+    static_assert((NUM_SHARDS & (NUM_SHARDS - 1)) == 0,
+                  "the number of shards must be a power of two");
+
+    using Key = typename Element::KeyType;
+    using map_type = CuckooCache::cache<Element, Hash>;
+
+    struct alignas(64) Shard {
+        map_type map;
+        std::shared_mutex mutex;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> inserts{0};
+        std::atomic<uint64_t> contended{0};
+    };
+
+    std::array<Shard, NUM_SHARDS> shards;
+    uint32_t capacity = 0;
+
+    Shard &GetShard(const Key &key) {
+        return shards[Hash().template operator()<0>(key) & (NUM_SHARDS - 1)];
+    }
+
+    static std::shared_lock<std::shared_mutex> LockShared(Shard &shard) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            shard.contended.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+        return lock;
+    }
+
+    static std::unique_lock<std::shared_mutex> LockUnique(Shard &shard) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            shard.contended.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+        }
+        return lock;
+    }
+
+public:
+    /**
+     * Size the cache to about the given number of bytes, dropping all
+     * elements. Must not run concurrently with any other call.
+     *
+     * @returns the number of elements the cache can hold
+     */
+    uint32_t setup_bytes(size_t bytes) {
+        capacity = 0;
+        for (Shard &shard : shards) {
+            // CuckooCache::cache can only be set up once, so replace it.
+            shard.map.~map_type();
+            new (&shard.map) map_type();
+            capacity += shard.map.setup_bytes(bytes / NUM_SHARDS);
+            shard.hits = 0;
+            shard.misses = 0;
+            shard.inserts = 0;
+            shard.contended = 0;
+        }
+        return capacity;
+    }
+
+    /** See CuckooCache::cache::contains. */
+    bool contains(const Key &key, bool erase) {
+        Shard &shard = GetShard(key);
+        bool found;
+        {
+            auto lock = LockShared(shard);
+            found = shard.map.contains(key, erase);
+        }
+        (found ? shard.hits : shard.misses).fetch_add(1, std::memory_order_relaxed);
+        return found;
+    }
+
+    /** See CuckooCache::cache::get. */
+    bool get(Element &e, bool erase) {
+        Shard &shard = GetShard(e.getKey());
+        bool found;
+        {
+            auto lock = LockShared(shard);
+            found = shard.map.get(e, erase);
+        }
+        (found ? shard.hits : shard.misses).fetch_add(1, std::memory_order_relaxed);
+        return found;
+    }
+
+    /** See CuckooCache::cache::insert. */
+    void insert(Element e, bool replace = false) {
+        Shard &shard = GetShard(e.getKey());
+        {
+            auto lock = LockUnique(shard);
+            shard.map.insert(std::move(e), replace);
+        }
+        shard.inserts.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Call f on each element which has not been erased, one shard at a time.
+     * Elements inserted meanwhile may or may not be seen.
+     */
+    template <typename F> void ForEach(F &&f) {
+        for (Shard &shard : shards) {
+            auto lock = LockShared(shard);
+            shard.map.for_each(f);
+        }
+    }
+
+    CacheStats GetStats() const {
+        CacheStats stats;
+        stats.capacity = capacity;
+        stats.shards = NUM_SHARDS;
+        for (const Shard &shard : shards) {
+            stats.hits += shard.hits.load(std::memory_order_relaxed);
+            stats.misses += shard.misses.load(std::memory_order_relaxed);
+            stats.inserts += shard.inserts.load(std::memory_order_relaxed);
+            stats.contended += shard.contended.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+};
@@ -9,11 +9,11 @@
 #include <memusage.h>
 #include <pubkey.h>
 #include <random.h>
+#include <script/shardedcache.h>
+#include <streams.h>
 #include <uint256.h>
 #include <util/system.h>
 
-#include <boost/thread/shared_mutex.hpp>
-
 namespace {
 
 /**
@@ -24,18 +24,10 @@ namespace {
 class CSignatureCache {
     //! Entries are SHA256(nonce || signature hash || public key || signature):
     uint256 nonce;
-    using map_type = CuckooCache::cache<CuckooCache::KeyOnly<uint256>, SignatureCacheHasher>;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+    ShardedCuckooCache<CuckooCache::KeyOnly<uint256>, SignatureCacheHasher> setValid;
 
     bool ready = false;
 
-    void Reset() {
-        setValid.~map_type(); // manually destroy the cache
-        new (&setValid) map_type(); // replace cache with placement new
-        ready = false;
-    }
-
 public:
     CSignatureCache() { GetRandBytes(nonce.begin(), 32); }
 
@@ -52,21 +44,38 @@ public:
 
     bool Get(const uint256 &entry, const bool erase) {
         assert(ready);
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
         return setValid.contains(entry, erase);
     }
 
     void Set(uint256 &entry) {
         assert(ready);
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
         setValid.insert(entry);
     }
     uint32_t setup_bytes(size_t n) {
-        Reset();
+        ready = false;
         const uint32_t ret = setValid.setup_bytes(n);
         ready = true;
         return ret;
     }
+    CacheStats GetStats() const { return setValid.GetStats(); }
+
+    size_t Dump(CAutoFile &file) {
+        assert(ready);
+        std::vector<uint256> entries;
+        setValid.ForEach([&](const uint256 &entry) { entries.push_back(entry); });
+        file << nonce << entries;
+        return entries.size();
+    }
+
+    size_t Load(CAutoFile &file) {
+        assert(ready);
+        std::vector<uint256> entries;
+        file >> nonce >> entries;
+        for (const uint256 &entry : entries) {
+            setValid.insert(entry);
+        }
+        return entries.size();
+    }
 };
 
 /**
@@ -93,6 +102,18 @@ void InitSignatureCache() {
               (nElems * sizeof(uint256)) >> 20, nMaxCacheSize >> 20, nElems);
 }
 
+CacheStats GetSignatureCacheStats() {
+    return signatureCache.GetStats();
+}
+
+size_t DumpSignatureCache(CAutoFile &file) {
+    return signatureCache.Dump(file);
+}
+
+size_t LoadSignatureCache(CAutoFile &file) {
+    return signatureCache.Load(file);
+}
+
 template <typename F>
 bool RunMemoizedCheck(const std::vector<uint8_t> &vchSig, const CPubKey &pubkey,
                       const uint256 &sighash, bool storeOrErase, const F &fun) {
@@ -117,9 +138,25 @@ bool CachingTransactionSignatureChecker::IsCached(
                             [] { return false; });
 }
 
+void AddToSignatureCache(const std::vector<SchnorrBatchEntry> &entries) {
+    for (const SchnorrBatchEntry &e : entries) {
+        uint256 entry;
+        signatureCache.ComputeEntry(entry, e.hash, e.vchSig, e.pubkey);
+        signatureCache.Set(entry);
+    }
+}
+
 bool CachingTransactionSignatureChecker::VerifySignature(
     const std::vector<uint8_t> &vchSig, const CPubKey &pubkey,
     const uint256 &sighash) const {
+    if (deferredSchnorr && vchSig.size() == 64) {
+        uint256 entry;
+        signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
+        if (!signatureCache.Get(entry, !store)) {
+            deferredSchnorr->push_back({pubkey, sighash, vchSig});
+        }
+        return true;
+    }
     return RunMemoizedCheck(vchSig, pubkey, sighash, store, [&] {
         return TransactionSignatureChecker::VerifySignature(vchSig, pubkey,
                                                             sighash);
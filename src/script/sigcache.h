@@ -16,7 +16,10 @@ static constexpr int64_t DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static constexpr int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
 
+class CAutoFile;
 class CPubKey;
+struct CacheStats;
+struct SchnorrBatchEntry;
 
 /**
  * We're hashing a nonce into the entries themselves, so we don't need extra
@@ -41,17 +44,25 @@ public:
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker {
 private:
     bool store;
+    std::vector<SchnorrBatchEntry> *deferredSchnorr;
 
     bool IsCached(const std::vector<uint8_t> &vchSig, const CPubKey &vchPubKey,
                   const uint256 &sighash) const;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction *txToIn,
-                                       unsigned int nInIn,
-                                       const Amount amountIn, bool storeIn,
-                                       PrecomputedTransactionData &txdataIn)
+    /**
+     * With deferredSchnorrIn, Schnorr signatures which are not in the cache
+     * are appended to it instead of being verified, and taken as valid. This is only
+     * sound if the script fails whenever a signature does not verify
+     * (SCRIPT_VERIFY_NULLFAIL), and if the caller verifies the deferred
+     * signatures and fails the script if any of them is invalid.
+     */
+    CachingTransactionSignatureChecker(
+        const CTransaction *txToIn, unsigned int nInIn, const Amount amountIn,
+        bool storeIn, PrecomputedTransactionData &txdataIn,
+        std::vector<SchnorrBatchEntry> *deferredSchnorrIn = nullptr)
         : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn),
-          store(storeIn) {}
+          store(storeIn), deferredSchnorr(deferredSchnorrIn) {}
 
     bool VerifySignature(const std::vector<uint8_t> &vchSig,
                          const CPubKey &vchPubKey,
@@ -68,3 +79,26 @@ public:
  * this function takes no locks.
  */
 void InitSignatureCache();
+
+/**
+ * Write the entries of the signature cache to file, with the nonce they were
+ * computed with. Returns the number of entries written.
+ */
+size_t DumpSignatureCache(CAutoFile &file);
+
+/**
+ * Replace the nonce of the signature cache with the one in file and insert
+ * the entries dumped along with it, returning their number. Throws if file
+ * cannot be read. Like InitSignatureCache, this must run before other threads
+ * use the cache.
+ */
+size_t LoadSignatureCache(CAutoFile &file);
+
+/**
+ * Add signatures verified outside of CachingTransactionSignatureChecker, such
+ * as its deferred Schnorr signatures, to the signature cache.
+ */
+void AddToSignatureCache(const std::vector<SchnorrBatchEntry> &entries);
+
+/** Hit, miss and lock contention counters of the signature cache. */
+CacheStats GetSignatureCacheStats();
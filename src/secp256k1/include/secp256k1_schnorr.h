@@ -23,6 +23,31 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorr_verify(
   const secp256k1_pubkey *pubkey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/**
+ * Verify a batch of signatures created by secp256k1_schnorr_sign, using a
+ * single multi-scalar multiplication, which is faster than verifying them
+ * one by one. When the batch fails, which of its signatures are incorrect is
+ * up to the caller to find out, with secp256k1_schnorr_verify.
+ * Returns: 1: all signatures are correct (or n_sigs is 0)
+ *          0: at least one signature is incorrect
+ * Args:    ctx:       a secp256k1 context object, initialized for verification.
+ *          scratch:   scratch space for the multiplication, or NULL to
+ *                     multiply point by point, which is no faster than
+ *                     verifying the signatures one by one.
+ * In:      sig64:     array of pointers to the n_sigs 64-byte signatures
+ *          msg32:     array of pointers to the 32-byte message hashes they sign
+ *          pubkeys:   array of pointers to the public keys to verify with
+ *          n_sigs:    the number of signatures
+ */
+SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_schnorr_verify_batch(
+  const secp256k1_context* ctx,
+  secp256k1_scratch_space *scratch,
+  const unsigned char *const *sig64,
+  const unsigned char *const *msg32,
+  const secp256k1_pubkey *const *pubkeys,
+  size_t n_sigs
+) SECP256K1_ARG_NONNULL(1);
+
 /**
  * Create a signature using a custom EC-Schnorr-SHA256 construction. It
  * produces non-malleable 64-byte signatures which support batch validation,
@@ -27,6 +27,147 @@ int secp256k1_schnorr_verify(
     return secp256k1_schnorr_sig_verify(&ctx->ecmult_ctx, sig64, &q, msg32);
 }
 
+/** The data secp256k1_schnorr_verify_batch_ecmult_callback works from. */
+typedef struct {
+    const secp256k1_context *ctx;
+    const unsigned char *const *sig64;
+    const unsigned char *const *msg32;
+    const secp256k1_pubkey *const *pubkeys;
+    unsigned char seed[32];
+} secp256k1_schnorr_verify_batch_data;
+
+/**
+ * Compute the random coefficient of the i-th signature of a batch, as the hash
+ * of the seed of the batch and i. The first coefficient is 1, which is as
+ * good as random and saves a multiplication.
+ */
+static void secp256k1_schnorr_verify_batch_coefficient(
+    secp256k1_scalar *a,
+    const unsigned char *seed32,
+    size_t i
+) {
+    secp256k1_sha256 sha;
+    unsigned char buf[32];
+    int j;
+
+    if (i == 0) {
+        secp256k1_scalar_set_int(a, 1);
+        return;
+    }
+
+    for (j = 0; j < 8; j++) {
+        buf[j] = (i >> (8 * j)) & 0xff;
+    }
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, seed32, 32);
+    secp256k1_sha256_write(&sha, buf, 8);
+    secp256k1_sha256_finalize(&sha, buf);
+    secp256k1_scalar_set_b32(a, buf, NULL);
+}
+
+/**
+ * Point 2*i of the multiplication is R_i, with coefficient a_i, and point
+ * 2*i+1 is P_i, with coefficient a_i * e_i.
+ */
+static int secp256k1_schnorr_verify_batch_ecmult_callback(
+    secp256k1_scalar *sc,
+    secp256k1_ge *pt,
+    size_t idx,
+    void *cbdata
+) {
+    const secp256k1_schnorr_verify_batch_data *data = (const secp256k1_schnorr_verify_batch_data *)cbdata;
+    const size_t i = idx / 2;
+    secp256k1_schnorr_verify_batch_coefficient(sc, data->seed, i);
+
+    if (idx % 2 == 0) {
+        /* Decompress r into R, with R.y a quadratic residue. */
+        secp256k1_fe Rx;
+        if (!secp256k1_fe_set_b32(&Rx, data->sig64[i])) {
+            return 0;
+        }
+        return secp256k1_ge_set_xquad(pt, &Rx);
+    } else {
+        secp256k1_scalar e;
+        if (!secp256k1_pubkey_load(data->ctx, pt, data->pubkeys[i])) {
+            return 0;
+        }
+        secp256k1_schnorr_compute_e(&e, data->sig64[i], pt, data->msg32[i]);
+        secp256k1_scalar_mul(sc, sc, &e);
+        return 1;
+    }
+}
+
+int secp256k1_schnorr_verify_batch(
+    const secp256k1_context *ctx,
+    secp256k1_scratch_space *scratch,
+    const unsigned char *const *sig64,
+    const unsigned char *const *msg32,
+    const secp256k1_pubkey *const *pubkeys,
+    size_t n_sigs
+) {
+    secp256k1_schnorr_verify_batch_data data;
+    secp256k1_sha256 sha;
+    secp256k1_scalar s, a, sum;
+    secp256k1_gej r;
+    secp256k1_ge p;
+    unsigned char buf[33];
+    size_t size;
+    size_t i;
+    int overflow;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(n_sigs == 0 || sig64 != NULL);
+    ARG_CHECK(n_sigs == 0 || msg32 != NULL);
+    ARG_CHECK(n_sigs == 0 || pubkeys != NULL);
+    ARG_CHECK(n_sigs <= SIZE_MAX / 2);
+
+    /**
+     * The coefficients must not be predictable by whoever made the
+     * signatures, so they are derived from a hash of the whole batch.
+     */
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n_sigs; i++) {
+        ARG_CHECK(sig64[i] != NULL);
+        ARG_CHECK(msg32[i] != NULL);
+        ARG_CHECK(pubkeys[i] != NULL);
+        if (!secp256k1_pubkey_load(ctx, &p, pubkeys[i])) {
+            return 0;
+        }
+        size = 0;
+        secp256k1_eckey_pubkey_serialize(&p, buf, &size, 1);
+        VERIFY_CHECK(size == 33);
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        secp256k1_sha256_write(&sha, buf, 33);
+    }
+    secp256k1_sha256_finalize(&sha, data.seed);
+
+    /* Compute -sum(a_i * s_i), the coefficient of G. */
+    secp256k1_scalar_set_int(&sum, 0);
+    for (i = 0; i < n_sigs; i++) {
+        overflow = 0;
+        secp256k1_scalar_set_b32(&s, sig64[i] + 32, &overflow);
+        if (overflow) {
+            return 0;
+        }
+        secp256k1_schnorr_verify_batch_coefficient(&a, data.seed, i);
+        secp256k1_scalar_mul(&s, &s, &a);
+        secp256k1_scalar_add(&sum, &sum, &s);
+    }
+    secp256k1_scalar_negate(&sum, &sum);
+
+    /* The batch is valid if sum(a_i * (R_i + e_i * P_i - s_i * G)) == 0. */
+    data.ctx = ctx;
+    data.sig64 = sig64;
+    data.msg32 = msg32;
+    data.pubkeys = pubkeys;
+    if (!secp256k1_ecmult_multi_var(&ctx->error_callback, &ctx->ecmult_ctx, scratch, &r, &sum,
+                                    secp256k1_schnorr_verify_batch_ecmult_callback, &data, 2 * n_sigs)) {
+        return 0;
+    }
+    return secp256k1_gej_is_infinity(&r);
+}
+
 int secp256k1_schnorr_sign(
     const secp256k1_context *ctx,
     unsigned char *sig64,
@@ -509,6 +509,79 @@ void run_schnorr_compact_test(void) {
     }
 }
 
+#define SIG_COUNT 64
+
+void test_schnorr_verify_batch(void) {
+    unsigned char privkey[32];
+    unsigned char msg[SIG_COUNT][32];
+    unsigned char sig[SIG_COUNT][64];
+    secp256k1_pubkey pubkey[SIG_COUNT];
+    const unsigned char *sigptr[SIG_COUNT];
+    const unsigned char *msgptr[SIG_COUNT];
+    const secp256k1_pubkey *pubkeyptr[SIG_COUNT];
+    secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, 1 << 20);
+    int i, j;
+
+    for (i = 0; i < SIG_COUNT; i++) {
+        secp256k1_scalar key;
+        random_scalar_order_test(&key);
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_rand256_test(msg[i]);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkey[i], privkey) == 1);
+        CHECK(secp256k1_schnorr_sign(ctx, sig[i], msg[i], privkey, NULL, NULL) == 1);
+        sigptr[i] = sig[i];
+        msgptr[i] = msg[i];
+        pubkeyptr[i] = &pubkey[i];
+    }
+
+    /* An empty batch is valid. */
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, NULL, NULL, NULL, 0) == 1);
+
+    /* Batches of valid signatures of any size are valid, with or without a
+     * scratch space. */
+    for (i = 1; i <= SIG_COUNT; i *= 2) {
+        CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, i) == 1);
+        CHECK(secp256k1_schnorr_verify_batch(ctx, NULL, sigptr, msgptr, pubkeyptr, i) == 1);
+    }
+
+    /* A single modified signature, message or key makes the batch fail. */
+    for (j = 0; j < count; j++) {
+        int k = secp256k1_rand_int(SIG_COUNT);
+        int pos = secp256k1_rand_bits(6);
+        int mod = 1 + secp256k1_rand_int(255);
+        sig[k][pos] ^= mod;
+        CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, SIG_COUNT) == 0);
+        sig[k][pos] ^= mod;
+
+        msg[k][pos % 32] ^= mod;
+        CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, SIG_COUNT) == 0);
+        msg[k][pos % 32] ^= mod;
+
+        pubkeyptr[k] = &pubkey[(k + 1) % SIG_COUNT];
+        CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, SIG_COUNT) == 0);
+        pubkeyptr[k] = &pubkey[k];
+    }
+
+    /* Swapping the signatures of two messages makes the batch fail, even
+     * though the set of signatures is the same. */
+    sigptr[0] = sig[1];
+    sigptr[1] = sig[0];
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, SIG_COUNT) == 0);
+    sigptr[0] = sig[0];
+    sigptr[1] = sig[1];
+
+    /* r must be the x coordinate of a point, and s must be below the order. */
+    memset(sig[0], 0xff, 32);
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, SIG_COUNT) == 0);
+    CHECK(secp256k1_schnorr_sign(ctx, sig[0], msg[0], privkey, NULL, NULL) == 1);
+    memset(sig[0] + 32, 0xff, 32);
+    CHECK(secp256k1_schnorr_verify_batch(ctx, scratch, sigptr, msgptr, pubkeyptr, SIG_COUNT) == 0);
+
+    secp256k1_scratch_space_destroy(ctx, scratch);
+}
+
+#undef SIG_COUNT
+
 void run_schnorr_tests(void) {
     int i;
     for (i = 0; i < 32 * count; i++) {
@@ -516,6 +589,7 @@ void run_schnorr_tests(void) {
     }
 
     test_schnorr_sign_verify();
+    test_schnorr_verify_batch();
     run_schnorr_compact_test();
 }
 
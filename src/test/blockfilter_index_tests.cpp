@@ -0,0 +1,203 @@
+// Copyright (c) 2017-2019 The Bitcoin Core developers
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockfilter.h>
+#include <chainparams.h>
+#include <config.h>
+#include <consensus/validation.h>
+#include <index/blockfilterindex.h>
+#include <script/standard.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(blockfilter_index_tests)
+
+static bool CheckFilterLookups(BlockFilterIndex &filter_index,
+                               const CBlockIndex *block_index,
+                               uint256 &last_header) {
+    CBlock block;
+    BOOST_REQUIRE(ReadBlockFromDisk(block, block_index, Params().GetConsensus()));
+    CBlockUndo block_undo;
+    if (block_index->nHeight > 0) {
+        BOOST_REQUIRE(UndoReadFromDisk(block_undo, block_index));
+    }
+    BlockFilter expected_filter(filter_index.GetFilterType(), block, block_undo);
+
+    BlockFilter filter;
+    uint256 filter_header;
+    std::vector<BlockFilter> filters;
+    std::vector<uint256> filter_hashes;
+
+    BOOST_CHECK(filter_index.LookupFilter(block_index, filter));
+    BOOST_CHECK(filter_index.LookupFilterHeader(block_index, filter_header));
+    BOOST_CHECK(filter_index.LookupFilterRange(block_index->nHeight, block_index, filters));
+    BOOST_CHECK(filter_index.LookupFilterHashRange(block_index->nHeight, block_index, filter_hashes));
+
+    BOOST_CHECK_EQUAL(filters.size(), 1U);
+    BOOST_CHECK_EQUAL(filter_hashes.size(), 1U);
+
+    BOOST_CHECK_EQUAL(filter.GetHash(), expected_filter.GetHash());
+    BOOST_CHECK_EQUAL(filter_header, expected_filter.ComputeHeader(last_header));
+    BOOST_CHECK_EQUAL(filters[0].GetHash(), expected_filter.GetHash());
+    BOOST_CHECK_EQUAL(filter_hashes[0], expected_filter.GetHash());
+
+    filters.clear();
+    filter_hashes.clear();
+    last_header = filter_header;
+    return true;
+}
+
+static void WaitForSync(BlockFilterIndex &filter_index) {
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_initial_sync, TestChain100Setup) {
+    BlockFilterIndex filter_index(BlockFilterType::BASIC, 1 << 20, true);
+
+    uint256 last_header;
+
+    // Filter should not be found in the index before it is started.
+    {
+        LOCK(cs_main);
+
+        BlockFilter filter;
+        uint256 filter_header;
+        std::vector<BlockFilter> filters;
+        std::vector<uint256> filter_hashes;
+
+        for (const CBlockIndex *block_index = ::ChainActive().Genesis();
+             block_index != nullptr;
+             block_index = ::ChainActive().Next(block_index)) {
+            BOOST_CHECK(!filter_index.LookupFilter(block_index, filter));
+            BOOST_CHECK(!filter_index.LookupFilterHeader(block_index, filter_header));
+            BOOST_CHECK(!filter_index.LookupFilterRange(block_index->nHeight, block_index, filters));
+            BOOST_CHECK(!filter_index.LookupFilterHashRange(block_index->nHeight, block_index, filter_hashes));
+        }
+    }
+
+    // BlockUntilSyncedToCurrentChain should return false before index is
+    // started.
+    BOOST_CHECK(!filter_index.BlockUntilSyncedToCurrentChain());
+
+    filter_index.Start();
+    WaitForSync(filter_index);
+
+    // Check that filter index has all blocks that were in the chain before it
+    // started.
+    {
+        LOCK(cs_main);
+        const CBlockIndex *block_index;
+        for (block_index = ::ChainActive().Genesis(); block_index != nullptr;
+             block_index = ::ChainActive().Next(block_index)) {
+            CheckFilterLookups(filter_index, block_index, last_header);
+        }
+    }
+
+    // The whole chain can be fetched at once.
+    {
+        const CBlockIndex *tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+        std::vector<BlockFilter> filters;
+        std::vector<uint256> filter_hashes;
+        BOOST_CHECK(filter_index.LookupFilterRange(0, tip, filters));
+        BOOST_CHECK(filter_index.LookupFilterHashRange(0, tip, filter_hashes));
+        BOOST_CHECK_EQUAL(filters.size(), size_t(tip->nHeight + 1));
+        BOOST_CHECK_EQUAL(filter_hashes.size(), size_t(tip->nHeight + 1));
+        BOOST_CHECK(!filter_index.LookupFilterRange(tip->nHeight + 1, tip, filters));
+    }
+
+    // Mine a block to a new script and check that it gets indexed.
+    const CScript coinbase_script = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    const CBlock block = CreateAndProcessBlock({}, coinbase_script);
+    BOOST_CHECK(filter_index.BlockUntilSyncedToCurrentChain());
+    const CBlockIndex *stale_index = WITH_LOCK(cs_main, return LookupBlockIndex(block.GetHash()));
+    BOOST_REQUIRE(stale_index);
+    CheckFilterLookups(filter_index, stale_index, last_header);
+    const uint256 stale_header = last_header;
+
+    // Disconnect it and mine a competing chain. The filter of the disconnected
+    // block remains available, and the new chain gets its own filters.
+    {
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(GetConfig(), state, const_cast<CBlockIndex *>(stale_index)));
+    }
+    SyncWithValidationInterfaceQueue();
+
+    uint256 fork_header;
+    BOOST_CHECK(filter_index.LookupFilterHeader(stale_index->pprev, fork_header));
+    const CScript other_script = CScript() << OP_TRUE;
+    CreateAndProcessBlock({}, other_script);
+    CreateAndProcessBlock({}, other_script);
+    BOOST_CHECK(filter_index.BlockUntilSyncedToCurrentChain());
+
+    {
+        LOCK(cs_main);
+        last_header = fork_header;
+        for (const CBlockIndex *block_index = ::ChainActive()[stale_index->nHeight]; block_index != nullptr;
+             block_index = ::ChainActive().Next(block_index)) {
+            BOOST_CHECK(block_index->GetBlockHash() != stale_index->GetBlockHash());
+            CheckFilterLookups(filter_index, block_index, last_header);
+        }
+    }
+
+    // Lookups of the stale block go to the hash index.
+    BlockFilter filter;
+    uint256 filter_header;
+    BOOST_CHECK(filter_index.LookupFilter(stale_index, filter));
+    BOOST_CHECK_EQUAL(filter.GetBlockHash(), stale_index->GetBlockHash());
+    BOOST_CHECK(filter_index.LookupFilterHeader(stale_index, filter_header));
+    BOOST_CHECK_EQUAL(filter_header, stale_header);
+
+    filter_index.Interrupt();
+    filter_index.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_init_destroy, BasicTestingSetup) {
+    SetDataDir("tempdir");
+
+    BlockFilterIndex *filter_index;
+
+    filter_index = GetBlockFilterIndex(BlockFilterType::BASIC);
+    BOOST_CHECK(filter_index == nullptr);
+
+    BOOST_CHECK(InitBlockFilterIndex(BlockFilterType::BASIC, 1 << 20, true, false));
+
+    filter_index = GetBlockFilterIndex(BlockFilterType::BASIC);
+    BOOST_CHECK(filter_index != nullptr);
+    BOOST_CHECK(filter_index->GetFilterType() == BlockFilterType::BASIC);
+
+    // Initialize returns false if index already exists.
+    BOOST_CHECK(!InitBlockFilterIndex(BlockFilterType::BASIC, 1 << 20, true, false));
+
+    int iter_count = 0;
+    ForEachBlockFilterIndex([&iter_count](BlockFilterIndex &_index) { iter_count++; });
+    BOOST_CHECK_EQUAL(iter_count, 1);
+
+    BOOST_CHECK(DestroyBlockFilterIndex(BlockFilterType::BASIC));
+
+    // Destroy returns false because index was already destroyed.
+    BOOST_CHECK(!DestroyBlockFilterIndex(BlockFilterType::BASIC));
+
+    filter_index = GetBlockFilterIndex(BlockFilterType::BASIC);
+    BOOST_CHECK(filter_index == nullptr);
+
+    // Reinitialize index.
+    BOOST_CHECK(InitBlockFilterIndex(BlockFilterType::BASIC, 1 << 20, true, false));
+
+    DestroyAllBlockFilterIndexes();
+
+    filter_index = GetBlockFilterIndex(BlockFilterType::BASIC);
+    BOOST_CHECK(filter_index == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,148 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockprefetcher.h>
+
+#include <chainparams.h>
+#include <config.h>
+#include <primitives/block.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <script/sighashtype.h>
+#include <txdb.h>
+#include <util/time.h>
+#include <version.h>
+#include <validation.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(blockprefetcher_tests, TestChain100Setup)
+
+static void Prefetch(BlockPrefetcher &prefetcher,
+                     const std::vector<const CBlockIndex *> &blocks) {
+    LOCK(cs_main);
+    prefetcher.Prefetch(blocks, Params().GetConsensus(),
+                        BlockValidationOptions(GetConfig()),
+                        pcoinsdbview.get());
+}
+
+static std::shared_ptr<PrefetchedBlock>
+PrefetchOne(BlockPrefetcher &prefetcher, const CBlockIndex *pindex) {
+    // Take does not wait for the blocks no thread started on yet.
+    for (int i = 0; i < 1000; ++i) {
+        Prefetch(prefetcher, {pindex});
+        MilliSleep(10);
+        if (auto prefetched = prefetcher.Take(pindex)) {
+            return prefetched;
+        }
+    }
+    return nullptr;
+}
+
+BOOST_AUTO_TEST_CASE(prefetch_block) {
+    // Have the coin spent next written to the coins database.
+    FlushStateToDisk();
+
+    const CScript coinbaseScript =
+        CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const COutPoint outpoint(m_coinbase_txns[0]->GetId(), 0);
+    CMutableTransaction spend;
+    spend.vin.emplace_back(outpoint);
+    spend.vout.emplace_back(m_coinbase_txns[0]->vout[0].nValue - CENT,
+                            coinbaseScript);
+    std::vector<uint8_t> vchSig;
+    const uint256 hash = SignatureHash(
+        coinbaseScript, CTransaction(spend), 0, SigHashType().withForkId(),
+        m_coinbase_txns[0]->vout[0].nValue);
+    BOOST_CHECK(coinbaseKey.SignECDSA(hash, vchSig));
+    vchSig.push_back(uint8_t(SIGHASH_ALL | SIGHASH_FORKID));
+    spend.vin[0].scriptSig << vchSig;
+    const CBlock block = CreateAndProcessBlock({spend}, coinbaseScript);
+    const CBlockIndex *pindex = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    BOOST_REQUIRE_EQUAL(pindex->GetBlockHash(), block.GetHash());
+
+    BlockPrefetcher prefetcher;
+    prefetcher.Start(2, 4, MAX_BLOCK_PREFETCH_BYTES);
+    auto prefetched = PrefetchOne(prefetcher, pindex);
+    BOOST_REQUIRE(prefetched && prefetched->block);
+    BOOST_CHECK_EQUAL(prefetched->block->GetHash(), block.GetHash());
+    BOOST_CHECK(prefetched->block->fChecked);
+
+    // The coin is still in the database, as the block which spent it has not
+    // been flushed yet.
+    BOOST_CHECK_EQUAL(prefetched->inputs, 1U);
+    BOOST_REQUIRE_EQUAL(prefetched->coins.size(), 1U);
+    BOOST_CHECK(prefetched->coins[0].first == outpoint);
+    BOOST_CHECK(prefetched->coins[0].second.GetTxOut() ==
+                m_coinbase_txns[0]->vout[0]);
+    BOOST_CHECK_EQUAL(prefetched->coins_sequence % 2, 0U);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(prefetched->coins_sequence,
+                          pcoinsdbview->GetWriteSequence());
+
+        // The coins cache knows better, and keeps the coin spent.
+        pcoinsTip->AddFetchedCoin(outpoint, prefetched->coins[0].second);
+        BOOST_CHECK(!pcoinsTip->HaveCoin(outpoint));
+    }
+
+    // Writing to the database makes the coins read from it before stale.
+    FlushStateToDisk();
+    BOOST_CHECK(WITH_LOCK(cs_main, return pcoinsdbview->GetWriteSequence()) !=
+                prefetched->coins_sequence);
+    prefetched = PrefetchOne(prefetcher, pindex);
+    BOOST_REQUIRE(prefetched && prefetched->block);
+    BOOST_CHECK(prefetched->coins.empty());
+
+    prefetcher.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(take_unstarted) {
+    // Without threads, no block gets started on.
+    BlockPrefetcher prefetcher;
+    prefetcher.Start(0, 4, MAX_BLOCK_PREFETCH_BYTES);
+    std::vector<const CBlockIndex *> blocks;
+    {
+        LOCK(cs_main);
+        for (int height = 90; height <= 100; ++height) {
+            blocks.push_back(::ChainActive()[height]);
+        }
+    }
+    Prefetch(prefetcher, blocks);
+    BOOST_CHECK(!prefetcher.Take(blocks[0]));
+    // Beyond the depth, or taken already.
+    BOOST_CHECK(!prefetcher.Take(blocks[5]));
+    BOOST_CHECK(!prefetcher.Take(blocks[0]));
+    prefetcher.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(byte_limit) {
+    // The first block done fills the window, so the second one is not started
+    // on until the first is taken.
+    BlockPrefetcher prefetcher;
+    prefetcher.Start(1, 4, 1);
+    const std::vector<const CBlockIndex *> blocks = WITH_LOCK(
+        cs_main, return std::vector<const CBlockIndex *>(
+                     {::ChainActive()[99], ::ChainActive()[100]}));
+    Prefetch(prefetcher, blocks);
+    MilliSleep(100);
+    BOOST_CHECK(!prefetcher.Take(blocks[1]));
+    auto prefetched = PrefetchOne(prefetcher, blocks[0]);
+    BOOST_REQUIRE(prefetched && prefetched->block);
+    BOOST_CHECK_EQUAL(prefetched->size,
+                      ::GetSerializeSize(*prefetched->block, PROTOCOL_VERSION));
+
+    // Once taken, the window has room again. Clear drops what is left over.
+    BOOST_CHECK(PrefetchOne(prefetcher, blocks[1]));
+    Prefetch(prefetcher, blocks);
+    prefetcher.Clear();
+    BOOST_CHECK(!prefetcher.Take(blocks[0]));
+    prefetcher.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,145 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockservecache.h>
+#include <hash.h>
+#include <net.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(blockservecache_tests, BasicTestingSetup)
+
+static BlockServeCache::Payload MakePayload(size_t size, uint8_t fill) {
+    return std::make_shared<const SharedNetMsgPayload>(std::vector<uint8_t>(size, fill));
+}
+
+BOOST_AUTO_TEST_CASE(shared_payload) {
+    std::vector<uint8_t> data(1000, 0x42);
+    const uint256 hash = Hash(data);
+    auto payload = MakePayload(1000, 0x42);
+    BOOST_CHECK_EQUAL(payload->data.size(), 1000);
+    BOOST_CHECK(payload->data[999] == 0x42);
+    BOOST_CHECK(payload->hash == hash);
+}
+
+BOOST_AUTO_TEST_CASE(evict_least_recently_used) {
+    BlockServeCache cache(240);
+    const BlockHash a(InsecureRand256()), b(InsecureRand256()), c(InsecureRand256()), d(InsecureRand256());
+
+    cache.Insert(a, false, MakePayload(100, 1));
+    cache.Insert(a, true, MakePayload(50, 2));
+    BOOST_CHECK_EQUAL(cache.GetCount(), 2);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 150);
+    BOOST_CHECK(cache.Get(a, false)->data[0] == 1);
+    BOOST_CHECK(cache.Get(a, true)->data[0] == 2);
+    BOOST_CHECK(!cache.Get(b, false));
+
+    // Inserting what is cached already keeps it.
+    cache.Insert(a, false, MakePayload(100, 3));
+    BOOST_CHECK(cache.Get(a, false)->data[0] == 1);
+
+    // a's block was used more recently than its compact block, which goes.
+    cache.Insert(b, false, MakePayload(100, 4));
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 200);
+    BOOST_CHECK(!cache.Get(a, true));
+    BOOST_CHECK(cache.Get(a, false));
+    cache.Insert(c, false, MakePayload(100, 5));
+    BOOST_CHECK(!cache.Get(b, false));
+    BOOST_CHECK(cache.Get(a, false));
+    BOOST_CHECK(cache.Get(c, false));
+
+    // A payload larger than the cache is not kept.
+    cache.Insert(d, false, MakePayload(300, 6));
+    BOOST_CHECK_EQUAL(cache.GetCount(), 0);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 0);
+
+    cache.Insert(a, false, MakePayload(100, 7));
+    cache.Insert(b, false, MakePayload(100, 8));
+    cache.SetMaxBytes(100);
+    BOOST_CHECK(!cache.Get(a, false));
+    BOOST_CHECK(cache.Get(b, false));
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 100);
+
+    // However small, no more than MAX_BLOCK_SERVE_CACHE_COUNT payloads are kept.
+    cache.SetMaxBytes(1000);
+    for (size_t i = 0; i < MAX_BLOCK_SERVE_CACHE_COUNT; ++i) {
+        cache.Insert(BlockHash(InsecureRand256()), false, MakePayload(1, i));
+    }
+    BOOST_CHECK_EQUAL(cache.GetCount(), MAX_BLOCK_SERVE_CACHE_COUNT);
+    BOOST_CHECK(!cache.Get(b, false));
+}
+
+BOOST_AUTO_TEST_CASE(get_or_make) {
+    BlockServeCache cache(1000);
+    const BlockHash a(InsecureRand256()), b(InsecureRand256());
+    int made = 0;
+
+    auto payload = cache.GetOrMake(a, false, [&]() {
+        ++made;
+        return MakePayload(100, 1);
+    });
+    BOOST_CHECK(payload->data[0] == 1);
+    auto again = cache.GetOrMake(a, false, [&]() {
+        ++made;
+        return MakePayload(100, 2);
+    });
+    BOOST_CHECK(again == payload);
+    BOOST_CHECK_EQUAL(made, 1);
+
+    // Blocks which cannot be read are not cached.
+    BOOST_CHECK(!cache.GetOrMake(b, false, []() { return nullptr; }));
+    BOOST_CHECK_EQUAL(cache.GetCount(), 1);
+
+    // Nor are those whose reading threw.
+    BOOST_CHECK_THROW(cache.GetOrMake(b, false,
+                                      []() -> BlockServeCache::Payload { throw std::runtime_error("read error"); }),
+                      std::runtime_error);
+    BOOST_CHECK_EQUAL(cache.GetCount(), 1);
+    BOOST_CHECK(cache.GetOrMake(b, false, []() { return MakePayload(100, 3); })->data[0] == 3);
+}
+
+BOOST_AUTO_TEST_CASE(get_or_make_concurrently) {
+    BlockServeCache cache(1000);
+    const BlockHash hash(InsecureRand256());
+    std::atomic<int> made{0};
+    std::atomic<bool> release{false};
+
+    std::vector<std::thread> threads;
+    std::vector<BlockServeCache::Payload> payloads(8);
+    for (size_t i = 0; i < payloads.size(); ++i) {
+        threads.emplace_back([&, i]() {
+            payloads[i] = cache.GetOrMake(hash, false, [&]() {
+                ++made;
+                while (!release) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                return MakePayload(100, 1);
+            });
+        });
+    }
+    // While being made, the payload is not returned by Get, which does not wait.
+    BOOST_CHECK(!cache.Get(hash, false));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    release = true;
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    BOOST_CHECK_EQUAL(made, 1);
+    for (const auto &payload : payloads) {
+        BOOST_CHECK(payload && payload == payloads[0]);
+    }
+    BOOST_CHECK(cache.Get(hash, false) == payloads[0]);
+    BOOST_CHECK_EQUAL(cache.GetBytes(), 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -81,6 +81,20 @@ struct MemoryCheck {
     void swap(MemoryCheck &x) { std::swap(b, x.b); };
 };
 
+struct FinishBatchCheck {
+    static std::atomic<size_t> n_finished;
+    bool fails{false};
+    FinishBatchCheck(bool _fails) : fails(_fails){};
+    FinishBatchCheck(){};
+    bool operator()() { return true; }
+    static bool FinishBatch(std::vector<FinishBatchCheck> &checks) {
+        n_finished.fetch_add(checks.size(), std::memory_order_relaxed);
+        return std::none_of(checks.begin(), checks.end(),
+                            [](const FinishBatchCheck &c) { return c.fails; });
+    }
+    void swap(FinishBatchCheck &x) { std::swap(fails, x.fails); };
+};
+
 struct FrozenCleanupCheck {
     static std::atomic<uint64_t> nFrozen;
     static std::condition_variable cv;
@@ -112,6 +126,7 @@ std::mutex UniqueCheck::m;
 std::unordered_multiset<size_t> UniqueCheck::results;
 std::atomic<size_t> FakeCheckCheckCompletion::n_calls{0};
 std::atomic<size_t> MemoryCheck::fake_allocated_memory{0};
+std::atomic<size_t> FinishBatchCheck::n_finished{0};
 
 // Queue Typedefs
 typedef CCheckQueue<FakeCheckCheckCompletion> Correct_Queue;
@@ -120,6 +135,7 @@ typedef CCheckQueue<FailingCheck> Failing_Queue;
 typedef CCheckQueue<UniqueCheck> Unique_Queue;
 typedef CCheckQueue<MemoryCheck> Memory_Queue;
 typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
+typedef CCheckQueue<FinishBatchCheck> FinishBatch_Queue;
 
 /** This test case checks that the CCheckQueue works properly
  * with each specified size_t Checks pushed.
@@ -230,6 +246,34 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure) {
     fail_queue->StopWorkerThreads();
 }
 
+// Test that every check which ran gets to FinishBatch before Wait returns, and
+// that FinishBatch failing fails the whole lot.
+BOOST_AUTO_TEST_CASE(test_CheckQueue_FinishBatch) {
+    auto queue = std::make_unique<FinishBatch_Queue>(QUEUE_BATCH_SIZE);
+    queue->StartWorkerThreads(SCRIPT_CHECK_THREADS);
+
+    for (const size_t n : {0, 1, 10, 127, 128, 129, 1000, 10000}) {
+        for (const bool fails : {false, true}) {
+            FinishBatchCheck::n_finished = 0;
+            CCheckQueueControl<FinishBatchCheck> control(queue.get());
+            size_t remaining = n;
+            while (remaining) {
+                std::vector<FinishBatchCheck> vChecks;
+                for (size_t r = InsecureRandRange(100); r && remaining;
+                     r--, remaining--) {
+                    vChecks.emplace_back(fails && remaining == 1);
+                }
+                control.Add(vChecks);
+            }
+            BOOST_REQUIRE_EQUAL(control.Wait(), !fails || n == 0);
+            if (!fails) {
+                BOOST_REQUIRE_EQUAL(FinishBatchCheck::n_finished, n);
+            }
+        }
+    }
+    queue->StopWorkerThreads();
+}
+
 // Test that unique checks are actually all called individually, rather than
 // just one check being called repeatedly. Test that checks are not called
 // more than once as well
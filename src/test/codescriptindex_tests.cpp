@@ -0,0 +1,110 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/codescriptindex.h>
+
+#include <config.h>
+#include <consensus/validation.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <script/script_execution_context.h>
+#include <script/sighashtype.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(codescriptindex_tests)
+
+static std::vector<CodeScriptIndexEntry> FindOutputs(const CodeScriptIndex &index, const uint256 &codeScriptHash,
+                                                     const std::optional<COutPoint> &start = std::nullopt,
+                                                     size_t limit = 100) {
+    std::vector<CodeScriptIndexEntry> entries;
+    BOOST_CHECK(index.FindOutputs(codeScriptHash, start, limit, entries));
+    return entries;
+}
+
+BOOST_FIXTURE_TEST_CASE(codescriptindex_spend_and_reorg, TestChain100Setup) {
+    CodeScriptIndex index(1 << 20, true);
+    index.Start();
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Two instances of a contract, with different state.
+    const CScript coinbaseScript = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    auto contract = [](uint8_t state) {
+        return CScript() << std::vector<uint8_t>(20, state) << OP_STATESEPARATOR << OP_DROP << OP_TRUE;
+    };
+    const uint256 codeScriptHash = RefScriptsSummary::summarize(contract(1), Amount::zero()).codeScriptHash;
+    BOOST_CHECK(codeScriptHash == RefScriptsSummary::summarize(contract(2), Amount::zero()).codeScriptHash);
+    // Plain outputs are not indexed.
+    const uint256 plainHash = RefScriptsSummary::summarize(coinbaseScript, Amount::zero()).codeScriptHash;
+
+    CMutableTransaction deploy;
+    deploy.vin.emplace_back(COutPoint(m_coinbase_txns[0]->GetId(), 0));
+    deploy.vout.emplace_back(10 * CENT, contract(1));
+    deploy.vout.emplace_back(20 * CENT, contract(2));
+    deploy.vout.emplace_back(30 * CENT, coinbaseScript);
+    std::vector<uint8_t> vchSig;
+    const uint256 hash = SignatureHash(coinbaseScript, CTransaction(deploy), 0, SigHashType().withForkId(),
+                                       m_coinbase_txns[0]->vout[0].nValue);
+    BOOST_CHECK(coinbaseKey.SignECDSA(hash, vchSig));
+    vchSig.push_back(uint8_t(SIGHASH_ALL | SIGHASH_FORKID));
+    deploy.vin[0].scriptSig << vchSig;
+    const CBlock deployBlock = CreateAndProcessBlock({deploy}, coinbaseScript);
+    BOOST_REQUIRE_EQUAL(::ChainActive().Tip()->GetBlockHash(), deployBlock.GetHash());
+    BOOST_CHECK(index.BlockUntilSyncedToCurrentChain());
+
+    std::vector<CodeScriptIndexEntry> entries = FindOutputs(index, codeScriptHash);
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    BOOST_CHECK(entries[0].outpoint == COutPoint(deploy.GetId(), 0));
+    BOOST_CHECK(entries[0].value == 10 * CENT);
+    BOOST_CHECK_EQUAL(entries[0].height, ::ChainActive().Height());
+    BOOST_CHECK(entries[1].outpoint == COutPoint(deploy.GetId(), 1));
+    BOOST_CHECK(FindOutputs(index, plainHash).empty());
+
+    // Paging.
+    entries = FindOutputs(index, codeScriptHash, std::nullopt, 1);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    entries = FindOutputs(index, codeScriptHash, entries[0].outpoint, 1);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].outpoint == COutPoint(deploy.GetId(), 1));
+    BOOST_CHECK(FindOutputs(index, codeScriptHash, entries[0].outpoint).empty());
+
+    // Spending an instance removes it...
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(deploy.GetId(), 0));
+    spend.vout.emplace_back(9 * CENT, CScript() << OP_TRUE);
+    const CBlock spendBlock = CreateAndProcessBlock({spend}, coinbaseScript);
+    BOOST_REQUIRE_EQUAL(::ChainActive().Tip()->GetBlockHash(), spendBlock.GetHash());
+    BOOST_CHECK(index.BlockUntilSyncedToCurrentChain());
+    entries = FindOutputs(index, codeScriptHash);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].outpoint == COutPoint(deploy.GetId(), 1));
+
+    // ... until the spending block is disconnected.
+    {
+        CValidationState state;
+        CBlockIndex *pindex = WITH_LOCK(cs_main, return LookupBlockIndex(spendBlock.GetHash()));
+        BOOST_CHECK(InvalidateBlock(GetConfig(), state, pindex));
+    }
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(::ChainActive().Tip()->GetBlockHash(), deployBlock.GetHash());
+    entries = FindOutputs(index, codeScriptHash);
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    BOOST_CHECK(entries[0].outpoint == COutPoint(deploy.GetId(), 0));
+    BOOST_CHECK(entries[0].value == 10 * CENT);
+
+    index.Stop();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -803,6 +803,39 @@ BOOST_AUTO_TEST_CASE(coin_add) {
     CheckAddCoin(VALUE2, VALUE3, VALUE3, DIRTY | FRESH, DIRTY | FRESH, true);
 }
 
+static void CheckAddFetchedCoin(Amount cache_value, Amount expected_value,
+                                char cache_flags, char expected_flags) {
+    SingleEntryCacheTest test(VALUE1, cache_value, cache_flags);
+    CTxOut output;
+    output.nValue = VALUE1;
+    test.cache.AddFetchedCoin(OUTPOINT, Coin(std::move(output), 1, false));
+    test.cache.SelfTest();
+
+    Amount result_value;
+    char result_flags;
+    GetCoinMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+}
+
+BOOST_AUTO_TEST_CASE(coin_add_fetched) {
+    /**
+     * Check AddFetchedCoin behavior, adding the coin the base view has to a
+     * cache view, as fetching it would have, and checking the resulting entry
+     * in the cache: the entries the cache has already are kept.
+     *
+     *                  Cache   Result  Cache          Result
+     *                  Value   Value   Flags          Flags
+     */
+    CheckAddFetchedCoin(ABSENT, VALUE1, NO_ENTRY, 0);
+    CheckAddFetchedCoin(PRUNED, PRUNED, 0, 0);
+    CheckAddFetchedCoin(PRUNED, PRUNED, DIRTY, DIRTY);
+    CheckAddFetchedCoin(PRUNED, PRUNED, DIRTY | FRESH, DIRTY | FRESH);
+    CheckAddFetchedCoin(VALUE2, VALUE2, 0, 0);
+    CheckAddFetchedCoin(VALUE2, VALUE2, DIRTY, DIRTY);
+    CheckAddFetchedCoin(VALUE2, VALUE2, DIRTY | FRESH, DIRTY | FRESH);
+}
+
 void CheckWriteCoin(Amount parent_value, Amount child_value,
                     Amount expected_value, char parent_flags, char child_flags,
                     char expected_flags) {
@@ -11,6 +11,7 @@
 #include <crypto/sha256.h>
 #include <crypto/sha3.h>
 #include <crypto/sha512.h>
+#include <crypto/sha512_256.h>
 
 #include <random.h>
 #include <util/strencodings.h>
@@ -697,6 +698,27 @@ BOOST_AUTO_TEST_CASE(sha256d64) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha512_256d64_d80) {
+    for (int i = 0; i <= 32; ++i) {
+        uint8_t in[80 * 32];
+        uint8_t out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 80 * i; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        for (int j = 0; j < i; ++j) {
+            CHash512_256().Write({in + 64 * j, 64}).Finalize({out1 + 32 * j, 32});
+        }
+        SHA512_256D64(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+
+        for (int j = 0; j < i; ++j) {
+            CHash512_256().Write({in + 80 * j, 80}).Finalize({out1 + 32 * j, 32});
+        }
+        SHA512_256D80(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
 static void TestSHA3_256(const std::string &input, const std::string &output) {
     const auto in_bytes = ParseHex(input);
     const auto out_bytes = ParseHex(output);
@@ -5,6 +5,7 @@
 #include <cuckoocache.h>
 
 #include <random.h>
+#include <script/shardedcache.h>
 #include <script/sigcache.h>
 #include <sync.h>
 
@@ -537,4 +538,53 @@ BOOST_AUTO_TEST_CASE(cuckoocache_map) {
     }
 }
 
+BOOST_AUTO_TEST_CASE(cuckoocache_sharded) {
+    SeedInsecureRand(true);
+    ShardedCuckooCache<CuckooCache::KeyOnly<uint256>, SignatureCacheHasher> set;
+    const uint32_t capacity = set.setup_bytes(4 << 20);
+    BOOST_CHECK_EQUAL(capacity, (4 << 20) / sizeof(uint256));
+
+    std::vector<uint256> hashes(capacity / 4);
+    for (uint256 &hash : hashes) {
+        hash = InsecureRand256();
+    }
+
+    // Insert and look up from several threads at once, each over its own part
+    // of the hashes, which spread over all the shards.
+    std::vector<std::thread> threads;
+    std::list<bool> thread_ok_flags;
+    const size_t n_threads = 4;
+    const size_t per_thread = hashes.size() / n_threads;
+    for (size_t x = 0; x < n_threads; ++x) {
+        threads.emplace_back([&set, &hashes, per_thread](size_t thread_num, bool &flag) {
+            for (size_t i = per_thread * thread_num; i < per_thread * (thread_num + 1); ++i) {
+                flag = !set.contains(hashes[i], false) && flag;
+                set.insert(hashes[i]);
+                flag = set.contains(hashes[i], false) && flag;
+            }
+        }, x, std::ref(thread_ok_flags.emplace_back(true)));
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+    BOOST_CHECK(std::all_of(thread_ok_flags.begin(), thread_ok_flags.end(), [](bool b) { return b; }));
+
+    const uint64_t n = per_thread * n_threads;
+    CacheStats stats = set.GetStats();
+    BOOST_CHECK_EQUAL(stats.capacity, capacity);
+    BOOST_CHECK_EQUAL(stats.shards, 16U);
+    BOOST_CHECK_EQUAL(stats.hits, n);
+    BOOST_CHECK_EQUAL(stats.misses, n);
+    BOOST_CHECK_EQUAL(stats.inserts, n);
+    BOOST_CHECK(stats.contended <= 3 * n);
+
+    // Setting the cache up again empties it and resets the counters.
+    set.setup_bytes(4 << 20);
+    BOOST_CHECK(!set.contains(hashes[0], false));
+    stats = set.GetStats();
+    BOOST_CHECK_EQUAL(stats.hits, 0U);
+    BOOST_CHECK_EQUAL(stats.misses, 1U);
+    BOOST_CHECK_EQUAL(stats.inserts, 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -130,4 +130,41 @@ BOOST_AUTO_TEST_CASE(flatfile_flush) {
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+BOOST_AUTO_TEST_CASE(flatfile_map) {
+    auto data_dir = SetDataDir("flatfile_test");
+    FlatFileSeq seq(data_dir, "a", 100);
+
+    const std::string text("Commerce on the Internet has come to rely almost "
+                           "exclusively on financial institutions serving as "
+                           "trusted third parties to process electronic "
+                           "payments.");
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, 0)), SER_DISK, CLIENT_VERSION);
+        file << LIMITED_STRING(text, 256);
+    }
+
+    // The mapping holds the whole file, as it was written.
+    auto mapped = seq.Map(FlatFilePos(0, 0));
+    BOOST_REQUIRE(mapped);
+    BOOST_CHECK_EQUAL(mapped->Data().size(),
+                      GetSerializeSize(text, CLIENT_VERSION));
+    std::string mappedText;
+    SpanReader(SER_DISK, CLIENT_VERSION, mapped->Data()) >>
+        LIMITED_STRING(mappedText, 256);
+    BOOST_CHECK_EQUAL(mappedText, text);
+
+    // Reading past the end of the mapping throws.
+    SpanReader reader(SER_DISK, CLIENT_VERSION, mapped->Data().first(10));
+    BOOST_CHECK_THROW(reader >> LIMITED_STRING(mappedText, 256),
+                      std::ios_base::failure);
+
+    // Missing files cannot be mapped, and empty files map to nothing.
+    BOOST_CHECK(!seq.Map(FlatFilePos(1, 0)));
+    BOOST_CHECK(!seq.Map(FlatFilePos()));
+    fclose(seq.Open(FlatFilePos(2, 0)));
+    mapped = seq.Map(FlatFilePos(2, 0));
+    BOOST_REQUIRE(mapped);
+    BOOST_CHECK_EQUAL(mapped->Data().size(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -253,4 +253,49 @@ BOOST_AUTO_TEST_CASE(CheckMerkleBranch) {
     BOOST_CHECK_MESSAGE(resEven == expectedE, "MakeMerkleBranch (even) should yield the expected results");
 }
 
+BOOST_AUTO_TEST_CASE(merkle_branch_tree) {
+    // the incrementally maintained tree must always agree with MakeMerkleBranch over the same txids
+    std::vector<uint256> txids;
+    gbtl::MerkleBranchTree tree;
+    BOOST_CHECK(tree.GetBranch().empty());
+    auto check = [&] {
+        BOOST_REQUIRE_EQUAL(tree.size(), txids.size());
+        BOOST_CHECK(tree.GetBranch() == gbtl::MakeMerkleBranch(txids));
+        BOOST_CHECK(gbtl::MerkleBranchTree(txids).GetBranch() == tree.GetBranch());
+    };
+
+    // grow one txid at a time, crossing several powers of two
+    for (size_t i = 0; i < 70; ++i) {
+        txids.push_back(InsecureRand256());
+        tree.Append(txids.back());
+        check();
+    }
+    // erase from the middle, the front and the back
+    for (size_t i = 0; i < 20; ++i) {
+        const size_t pos = i % 3 == 0 ? 0 : i % 3 == 1 ? txids.size() - 1 : InsecureRandRange(txids.size());
+        txids.erase(txids.begin() + pos);
+        tree.Erase(pos);
+        check();
+    }
+    // reassign: an unchanged set, a changed tail, a shrunk and a grown set, and finally nothing at all
+    BOOST_CHECK_EQUAL(tree.Assign(txids), txids.size());
+    check();
+    for (size_t i = 40; i < txids.size(); ++i) {
+        txids[i] = InsecureRand256();
+    }
+    BOOST_CHECK_EQUAL(tree.Assign(txids), 40U);
+    check();
+    txids.resize(5);
+    BOOST_CHECK_EQUAL(tree.Assign(txids), 5U);
+    check();
+    for (size_t i = 0; i < 100; ++i) {
+        txids.push_back(InsecureRand256());
+    }
+    BOOST_CHECK_EQUAL(tree.Assign(txids), 5U);
+    check();
+    txids.clear();
+    BOOST_CHECK_EQUAL(tree.Assign(txids), 0U);
+    check();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
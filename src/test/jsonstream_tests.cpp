@@ -0,0 +1,93 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(jsonstream_tests, BasicTestingSetup)
+
+/** Write a block-like document, both piecewise and from whole values. */
+static void WriteDocument(JSONStreamWriter &writer, UniValue::Object &expected) {
+    UniValue::Object header;
+    header.emplace_back("hash", "00ff");
+    header.emplace_back("height", 42);
+    header.emplace_back("quote\"d", "new\nline");
+    UniValue::Array txs;
+    for (int i = 0; i < 10; ++i) {
+        UniValue::Object tx;
+        tx.emplace_back("txid", std::to_string(i));
+        tx.emplace_back("vin", UniValue::Array());
+        txs.emplace_back(std::move(tx));
+    }
+
+    writer.BeginObject();
+    writer.Members(header);
+    writer.Key("tx");
+    writer.BeginArray();
+    for (const auto &tx : txs) {
+        writer.Value(tx);
+    }
+    writer.EndArray();
+    writer.Key("empty");
+    writer.BeginObject();
+    writer.EndObject();
+    writer.Key("error");
+    writer.Value(NullUniValue);
+    writer.EndObject();
+
+    expected = header;
+    expected.emplace_back("tx", std::move(txs));
+    expected.emplace_back("empty", UniValue::Object());
+    expected.emplace_back("error", NullUniValue);
+}
+
+BOOST_AUTO_TEST_CASE(jsonstream_matches_univalue) {
+    std::vector<std::string> chunks;
+    JSONStreamWriter writer([&chunks](std::string &&chunk) { chunks.push_back(std::move(chunk)); });
+    UniValue::Object expected;
+    WriteDocument(writer, expected);
+
+    // Everything fits within the default flush size.
+    BOOST_CHECK(!writer.Flushed());
+    BOOST_CHECK(chunks.empty());
+    BOOST_CHECK_EQUAL(writer.TakeBuffer(), UniValue::stringify(expected));
+}
+
+BOOST_AUTO_TEST_CASE(jsonstream_chunked) {
+    std::vector<std::string> chunks;
+    JSONStreamWriter writer([&chunks](std::string &&chunk) { chunks.push_back(std::move(chunk)); }, 16);
+    UniValue::Object expected;
+    WriteDocument(writer, expected);
+    writer.Flush();
+
+    BOOST_CHECK(writer.Flushed());
+    BOOST_CHECK(chunks.size() > 1);
+    std::string joined;
+    for (const auto &chunk : chunks) {
+        BOOST_CHECK(!chunk.empty());
+        joined += chunk;
+    }
+    BOOST_CHECK_EQUAL(joined, UniValue::stringify(expected));
+    BOOST_CHECK(writer.TakeBuffer().empty());
+}
+
+BOOST_AUTO_TEST_CASE(jsonstream_awaiting_value) {
+    JSONStreamWriter writer([](std::string &&) {});
+    writer.BeginObject();
+    BOOST_CHECK(!writer.AwaitingValue());
+    writer.Key("result");
+    BOOST_CHECK(writer.AwaitingValue());
+    writer.Value(UniValue(1));
+    BOOST_CHECK(!writer.AwaitingValue());
+    writer.EndObject();
+    BOOST_CHECK_EQUAL(writer.TakeBuffer(), "{\"result\":1}");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -330,4 +330,48 @@ BOOST_AUTO_TEST_CASE(key_signature_tests) {
     BOOST_CHECK(found_small);
 }
 
+BOOST_AUTO_TEST_CASE(key_schnorr_batch) {
+    std::vector<SchnorrBatchEntry> entries;
+    for (int i = 0; i < 100; i++) {
+        CKey key;
+        key.MakeNewKey(i % 2 == 0);
+        SchnorrBatchEntry entry;
+        entry.pubkey = key.GetPubKey();
+        entry.hash = InsecureRand256();
+        BOOST_CHECK(key.SignSchnorr(entry.hash, entry.vchSig));
+        entries.push_back(entry);
+    }
+
+    std::vector<const SchnorrBatchEntry *> batch;
+    BOOST_CHECK(CPubKey::VerifySchnorrBatch(batch));
+    for (const SchnorrBatchEntry &entry : entries) {
+        batch.push_back(&entry);
+    }
+    BOOST_CHECK(CPubKey::VerifySchnorrBatch(batch));
+    BOOST_CHECK(CPubKey::VerifySchnorrBatch({&entries[0]}));
+
+    // Any single bad signature makes the batch fail.
+    for (int i = 0; i < 10; i++) {
+        SchnorrBatchEntry &entry = entries[InsecureRandRange(entries.size())];
+        const size_t pos = InsecureRandRange(64);
+        entry.vchSig[pos] ^= 1;
+        BOOST_CHECK(!CPubKey::VerifySchnorrBatch(batch));
+        entry.vchSig[pos] ^= 1;
+
+        const uint256 hash = entry.hash;
+        entry.hash = InsecureRand256();
+        BOOST_CHECK(!CPubKey::VerifySchnorrBatch(batch));
+        BOOST_CHECK(!CPubKey::VerifySchnorrBatch({&entry}));
+        entry.hash = hash;
+        BOOST_CHECK(CPubKey::VerifySchnorrBatch(batch));
+    }
+
+    // ECDSA signatures do not belong in a batch.
+    CKey key;
+    key.MakeNewKey(true);
+    SchnorrBatchEntry ecdsa{key.GetPubKey(), InsecureRand256(), {}};
+    BOOST_CHECK(key.SignECDSA(ecdsa.hash, ecdsa.vchSig));
+    BOOST_CHECK(!CPubKey::VerifySchnorrBatch({&ecdsa, &ecdsa}));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -15,6 +15,8 @@
 #include <consensus/validation.h>
 #include <policy/policy.h>
 #include <pubkey.h>
+#include <script/sighashtype.h>
+#include <script/sign.h>
 #include <script/standard.h>
 #include <txmempool.h>
 #include <uint256.h>
@@ -26,6 +28,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
 #include <memory>
 
 BOOST_FIXTURE_TEST_SUITE(miner_tests, TestingSetup)
@@ -695,4 +698,77 @@ BOOST_AUTO_TEST_CASE(TestCBlockTemplateEntry) {
     BOOST_CHECK_EQUAL(txEntry.sigChecks, 10);
 }
 
+static std::vector<TxId> TemplateTxIds(const CBlockTemplate &blocktemplate) {
+    std::vector<TxId> txids;
+    for (size_t i = 1; i < blocktemplate.block.vtx.size(); ++i) {
+        txids.push_back(blocktemplate.block.vtx[i]->GetId());
+    }
+    std::sort(txids.begin(), txids.end());
+    return txids;
+}
+
+BOOST_FIXTURE_TEST_CASE(IncrementalBlockAssembler_updates, TestChain100Setup) {
+    const Config &config = GetConfig();
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // Mature two more coinbases.
+    for (int i = 0; i < 2; ++i) {
+        CreateAndProcessBlock({}, scriptPubKey);
+    }
+
+    // Spend the first output of prev back to the coinbase key.
+    auto Spend = [&](const CTransaction &prev) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint(prev.GetId(), 0));
+        tx.vout.emplace_back(prev.vout[0].nValue - COIN / 10, scriptPubKey);
+        std::vector<uint8_t> vchSig;
+        const uint256 hash = SignatureHash(prev.vout[0].scriptPubKey, CTransaction(tx), 0, SigHashType().withForkId(),
+                                           prev.vout[0].nValue);
+        BOOST_CHECK(coinbaseKey.SignECDSA(hash, vchSig));
+        vchSig.push_back(uint8_t(SIGHASH_ALL | SIGHASH_FORKID));
+        tx.vin[0].scriptSig << vchSig;
+        return MakeTransactionRef(tx);
+    };
+    auto ToMemPool = [&](const CTransactionRef &tx) {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(AcceptToMemoryPool(config, g_mempool, state, tx, nullptr /* pfMissingInputs */,
+                                       false /* bypass_limits */, Amount::zero() /* nAbsurdFee */));
+    };
+    // The incremental template must match a template built from scratch.
+    IncrementalBlockAssembler incremental(config, g_mempool);
+    auto CheckTemplate = [&](size_t nTx) {
+        auto pblocktemplate = incremental.CreateNewBlock(scriptPubKey);
+        auto pexpected = BlockAssembler(config, g_mempool).CreateNewBlock(scriptPubKey);
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), nTx + 1);
+        BOOST_CHECK(TemplateTxIds(*pblocktemplate) == TemplateTxIds(*pexpected));
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx[0]->GetValueOut(), pexpected->block.vtx[0]->GetValueOut());
+        BOOST_CHECK(pblocktemplate->block.hashPrevBlock ==
+                    WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()));
+    };
+
+    const CTransactionRef tx0 = Spend(*m_coinbase_txns[0]);
+    ToMemPool(tx0);
+    CheckTemplate(1);
+
+    // New transactions, including a child of a template transaction, are appended.
+    const CTransactionRef tx1 = Spend(*m_coinbase_txns[1]);
+    const CTransactionRef tx2 = Spend(*tx0);
+    ToMemPool(tx1);
+    ToMemPool(tx2);
+    CheckTemplate(3);
+
+    // Transactions leaving the mempool leave the template too.
+    g_mempool.removeRecursive(*tx2);
+    CheckTemplate(2);
+
+    // So do the ones mined in a new block.
+    CreateAndProcessBlock({CMutableTransaction(*tx0), CMutableTransaction(*tx1)}, scriptPubKey);
+    BOOST_CHECK_EQUAL(g_mempool.size(), 0UL);
+    CheckTemplate(0);
+
+    ToMemPool(Spend(*m_coinbase_txns[2]));
+    CheckTemplate(1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
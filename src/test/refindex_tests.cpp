@@ -0,0 +1,113 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/refindex.h>
+
+#include <config.h>
+#include <consensus/validation.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <script/sighashtype.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(refindex_tests)
+
+static void WaitForSync(RefIndex &refindex) {
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!refindex.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+}
+
+static CScript RefScript(opcodetype opcode, const uint288 &ref) {
+    CScript script;
+    script << opcode;
+    script.insert(script.end(), ref.begin(), ref.end());
+    script << OP_DROP << OP_TRUE;
+    return script;
+}
+
+static std::vector<RefIndexEntry> FindRefOutputs(const RefIndex &refindex, const uint288 &ref, bool include_spent) {
+    std::vector<RefIndexEntry> entries;
+    BOOST_CHECK(refindex.FindRefOutputs(ref, include_spent, entries));
+    return entries;
+}
+
+BOOST_FIXTURE_TEST_CASE(refindex_spend_and_reorg, TestChain100Setup) {
+    RefIndex refindex(1 << 20, true);
+    refindex.Start();
+    WaitForSync(refindex);
+
+    const CScript coinbaseScript = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const COutPoint mintOutpoint(m_coinbase_txns[0]->GetId(), 0);
+    const uint288 ref = Converters::fromOutpoint(mintOutpoint);
+
+    // Mint the ref: the coinbase output being spent is the ref.
+    CMutableTransaction mint;
+    mint.vin.emplace_back(mintOutpoint);
+    mint.vout.emplace_back(m_coinbase_txns[0]->vout[0].nValue - CENT, RefScript(OP_PUSHINPUTREFSINGLETON, ref));
+    std::vector<uint8_t> vchSig;
+    const uint256 hash = SignatureHash(coinbaseScript, CTransaction(mint), 0, SigHashType().withForkId(),
+                                       m_coinbase_txns[0]->vout[0].nValue);
+    BOOST_CHECK(coinbaseKey.SignECDSA(hash, vchSig));
+    vchSig.push_back(uint8_t(SIGHASH_ALL | SIGHASH_FORKID));
+    mint.vin[0].scriptSig << vchSig;
+    const CBlock mintBlock = CreateAndProcessBlock({mint}, coinbaseScript);
+    BOOST_REQUIRE_EQUAL(::ChainActive().Tip()->GetBlockHash(), mintBlock.GetHash());
+    BOOST_CHECK(refindex.BlockUntilSyncedToCurrentChain());
+
+    std::vector<RefIndexEntry> entries = FindRefOutputs(refindex, ref, false);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].outpoint == COutPoint(mint.GetId(), 0));
+    BOOST_CHECK_EQUAL(entries[0].height, ::ChainActive().Height());
+    BOOST_CHECK(entries[0].value == mint.vout[0].nValue);
+    BOOST_CHECK_EQUAL(entries[0].types, REF_SINGLETON);
+    BOOST_CHECK(!entries[0].IsSpent());
+
+    // Pass the singleton on.
+    CMutableTransaction transfer;
+    transfer.vin.emplace_back(COutPoint(mint.GetId(), 0));
+    transfer.vout.emplace_back(mint.vout[0].nValue - CENT, RefScript(OP_PUSHINPUTREFSINGLETON, ref));
+    const CBlock transferBlock = CreateAndProcessBlock({transfer}, coinbaseScript);
+    BOOST_REQUIRE_EQUAL(::ChainActive().Tip()->GetBlockHash(), transferBlock.GetHash());
+    BOOST_CHECK(refindex.BlockUntilSyncedToCurrentChain());
+
+    entries = FindRefOutputs(refindex, ref, false);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].outpoint == COutPoint(transfer.GetId(), 0));
+    entries = FindRefOutputs(refindex, ref, true);
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    BOOST_CHECK(entries[0].outpoint == COutPoint(mint.GetId(), 0));
+    BOOST_CHECK(entries[0].spentTxId == transfer.GetId());
+    BOOST_CHECK_EQUAL(entries[0].spentHeight, ::ChainActive().Height());
+    BOOST_CHECK(!entries[1].IsSpent());
+
+    // Disconnecting the transfer makes the minted output unspent again.
+    {
+        CValidationState state;
+        CBlockIndex *pindex = WITH_LOCK(cs_main, return LookupBlockIndex(transferBlock.GetHash()));
+        BOOST_CHECK(InvalidateBlock(GetConfig(), state, pindex));
+    }
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(::ChainActive().Tip()->GetBlockHash(), mintBlock.GetHash());
+
+    entries = FindRefOutputs(refindex, ref, true);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].outpoint == COutPoint(mint.GetId(), 0));
+    BOOST_CHECK(!entries[0].IsSpent());
+    BOOST_CHECK_EQUAL(FindRefOutputs(refindex, ref, false).size(), 1U);
+
+    refindex.Stop();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,228 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <script/refsummarycache.h>
+#include <script/script_execution_context.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <map>
+#include <set>
+#include <thread>
+
+BOOST_FIXTURE_TEST_SUITE(script_execution_context_tests, BasicTestingSetup)
+
+static uint288 MakeRef(uint8_t n) {
+    std::vector<uint8_t> data(uint288::size(), 0);
+    data.back() = n;
+    return uint288(data);
+}
+
+static CScript &AppendRef(CScript &script, opcodetype opcode, const uint288 &ref) {
+    script << opcode;
+    script.insert(script.end(), ref.begin(), ref.end());
+    return script;
+}
+
+BOOST_AUTO_TEST_CASE(flat_summary_map_matches_std_map) {
+    // Apply the same random sequence of add / insert-if-absent operations to a std::map and to a
+    // FlatSummaryMap and check that they agree.
+    for (int round = 0; round < 20; ++round) {
+        std::map<uint256, Amount> reference;
+        FlatSummaryMap<uint256, Amount> flat;
+        const int nOps = InsecureRandRange(200);
+        for (int i = 0; i < nOps; ++i) {
+            uint256 key;
+            *key.begin() = InsecureRandRange(16);
+            const Amount value = int64_t(InsecureRandRange(1000)) * SATOSHI;
+            if (InsecureRandBool()) {
+                reference[key] += value;
+                flat.add(key, value);
+            } else {
+                reference.insert({key, value});
+                flat.addIfAbsent(key, value);
+            }
+        }
+        flat.finalize();
+        BOOST_CHECK_EQUAL(flat.size(), reference.size());
+        for (int k = 0; k < 16; ++k) {
+            uint256 key;
+            *key.begin() = k;
+            auto it = reference.find(key);
+            const Amount *found = flat.find(key);
+            if (it == reference.end()) {
+                BOOST_CHECK(found == nullptr);
+            } else {
+                BOOST_REQUIRE(found != nullptr);
+                BOOST_CHECK_EQUAL(*found, it->second);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(get_push_refs_vector_and_set) {
+    const uint288 a = MakeRef(1), b = MakeRef(2), c = MakeRef(3);
+    CScript script;
+    AppendRef(script, OP_PUSHINPUTREF, b);
+    AppendRef(script, OP_PUSHINPUTREF, a);
+    AppendRef(script, OP_PUSHINPUTREF, b);
+    AppendRef(script, OP_REQUIREINPUTREF, c);
+    AppendRef(script, OP_PUSHINPUTREFSINGLETON, c);
+    script << OP_STATESEPARATOR << OP_1;
+
+    std::vector<uint288> pushRefs, requireRefs, disallowedSiblingRefs, singletonRefs;
+    uint32_t stateSeparatorIndex = 0;
+    BOOST_REQUIRE(script.GetPushRefs(pushRefs, requireRefs, disallowedSiblingRefs, singletonRefs, stateSeparatorIndex));
+    BOOST_CHECK(pushRefs == std::vector<uint288>({a, b, c}));
+    BOOST_CHECK(requireRefs == std::vector<uint288>({c}));
+    BOOST_CHECK(disallowedSiblingRefs == std::vector<uint288>({c}));
+    BOOST_CHECK(singletonRefs == std::vector<uint288>({c}));
+    BOOST_CHECK_EQUAL(stateSeparatorIndex, script.size() - 1);
+
+    std::set<uint288> pushRefSet, requireRefSet, disallowedSiblingRefSet, singletonRefSet;
+    uint32_t stateSeparatorIndex2 = 0;
+    BOOST_REQUIRE(script.GetPushRefs(pushRefSet, requireRefSet, disallowedSiblingRefSet, singletonRefSet,
+                                     stateSeparatorIndex2));
+    BOOST_CHECK(std::vector<uint288>(pushRefSet.begin(), pushRefSet.end()) == pushRefs);
+    BOOST_CHECK(std::vector<uint288>(singletonRefSet.begin(), singletonRefSet.end()) == singletonRefs);
+    BOOST_CHECK_EQUAL(stateSeparatorIndex, stateSeparatorIndex2);
+
+    // A ref that is both pushed and disallowed is rejected, and the outputs are left untouched
+    AppendRef(script, OP_DISALLOWPUSHINPUTREF, a);
+    BOOST_CHECK(!script.GetPushRefs(pushRefs, requireRefs, disallowedSiblingRefs, singletonRefs, stateSeparatorIndex));
+    BOOST_CHECK(pushRefs == std::vector<uint288>({a, b, c}));
+}
+
+BOOST_AUTO_TEST_CASE(ref_summaries) {
+    const uint288 a = MakeRef(1), b = MakeRef(2);
+    CScript scriptA, scriptAB, plain;
+    AppendRef(scriptA, OP_PUSHINPUTREF, a) << OP_DROP;
+    AppendRef(AppendRef(scriptAB, OP_PUSHINPUTREF, a), OP_PUSHINPUTREFSINGLETON, b) << OP_2DROP;
+    plain << OP_TRUE;
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(3);
+    mtx.vout.emplace_back(5 * SATOSHI, scriptA);
+    mtx.vout.emplace_back(Amount::zero(), scriptAB);
+    mtx.vout.emplace_back(7 * SATOSHI, plain);
+    mtx.vout.emplace_back(11 * SATOSHI, plain);
+
+    CCoinsView dummy;
+    CCoinsViewCache coins(&dummy);
+    for (size_t i = 0; i < mtx.vin.size(); ++i) {
+        mtx.vin[i].prevout = COutPoint(TxId(InsecureRand256()), i);
+    }
+    const CTransaction spending(mtx);
+    coins.AddCoin(spending.vin[0].prevout, Coin(CTxOut(3 * SATOSHI, scriptAB), 1, false), false);
+    coins.AddCoin(spending.vin[1].prevout, Coin(CTxOut(2 * SATOSHI, scriptA), 1, false), false);
+    coins.AddCoin(spending.vin[2].prevout, Coin(CTxOut(13 * SATOSHI, plain), 1, false), false);
+
+    const auto contexts = ScriptExecutionContext::createForAllInputs(spending, coins);
+    BOOST_REQUIRE_EQUAL(contexts.size(), 3U);
+    const auto &context = contexts.back();
+
+    // Outputs
+    BOOST_CHECK_EQUAL(context.getRefValueSumOutputs(a), 5 * SATOSHI);
+    BOOST_CHECK_EQUAL(context.getRefValueSumOutputs(b), Amount::zero());
+    BOOST_CHECK_EQUAL(context.getRefOutputCountOutputs(a), 2U);
+    BOOST_CHECK_EQUAL(context.getRefOutputCountOutputs(b), 1U);
+    BOOST_CHECK_EQUAL(context.getRefOutputZeroValuedCountOutputs(a), 1U);
+    BOOST_CHECK_EQUAL(context.getRefOutputZeroValuedCountOutputs(MakeRef(9)), 0U);
+    // Scripts without refs are recorded under the zero refAssetId with the value of the first such script
+    BOOST_CHECK_EQUAL(context.getRefValueSumOutputs(uint288()), 7 * SATOSHI);
+    BOOST_CHECK_EQUAL(context.getRefOutputCountOutputs(uint288()), 0U);
+    BOOST_CHECK_EQUAL(context.getRefTypeOutput(a), 1U);
+    BOOST_CHECK_EQUAL(context.getRefTypeOutput(b), 2U);
+    BOOST_CHECK_EQUAL(context.getRefTypeOutput(MakeRef(9)), 0U);
+
+    // Utxos
+    BOOST_CHECK_EQUAL(context.getRefValueSumUtxos(a), 5 * SATOSHI);
+    BOOST_CHECK_EQUAL(context.getRefValueSumUtxos(b), 3 * SATOSHI);
+    BOOST_CHECK_EQUAL(context.getRefOutputCountUtxos(a), 2U);
+    BOOST_CHECK_EQUAL(context.getRefValueSumUtxos(uint288()), 13 * SATOSHI);
+
+    // Codescript hashes: the two plain outputs share one
+    const uint256 plainCodeScriptHash = (CHashWriter(SER_GETHASH, 0) << CFlatData(plain)).GetHash();
+    BOOST_CHECK_EQUAL(context.getCodeScriptHashValueSumOutputs(plainCodeScriptHash), 18 * SATOSHI);
+    BOOST_CHECK_EQUAL(context.getCodeScriptHashOutputCountOutputs(plainCodeScriptHash), 2U);
+    BOOST_CHECK_EQUAL(context.getCodeScriptHashOutputZeroValuedCountOutputs(plainCodeScriptHash), 0U);
+    BOOST_CHECK_EQUAL(context.getCodeScriptHashValueSumUtxos(plainCodeScriptHash), 13 * SATOSHI);
+
+    // Refs per output
+    std::vector<uint8_t> refs;
+    BOOST_CHECK(context.getRefsPerOutput(1, refs));
+    BOOST_CHECK_EQUAL(refs.size(), 2 * uint288::size());
+    refs.clear();
+    BOOST_CHECK(!context.getRefsPerOutput(2, refs));
+    BOOST_CHECK(refs.empty());
+
+    // The summaries are computed lazily on first use; many inputs racing to be first must all see the
+    // same result.
+    const auto racingContexts = ScriptExecutionContext::createForAllInputs(spending, coins);
+    std::vector<std::thread> threads;
+    std::atomic<int> nBad{0};
+    for (const auto &ctx : racingContexts) {
+        threads.emplace_back([&ctx, &nBad, &a, &plainCodeScriptHash] {
+            if (ctx.getRefValueSumOutputs(a) != 5 * SATOSHI ||
+                ctx.getCodeScriptHashOutputCountUtxos(plainCodeScriptHash) != 1) {
+                ++nBad;
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    BOOST_CHECK_EQUAL(nBad, 0);
+}
+
+BOOST_AUTO_TEST_CASE(ref_summary_cache) {
+    const uint288 a = MakeRef(1);
+    CScript scriptA;
+    AppendRef(scriptA, OP_PUSHINPUTREF, a) << OP_DROP;
+
+    CMutableTransaction mtx;
+    mtx.vin.emplace_back(COutPoint(TxId(InsecureRand256()), 0));
+    mtx.vout.emplace_back(5 * SATOSHI, scriptA);
+    mtx.vout.emplace_back(6 * SATOSHI, scriptA);
+    const CTransaction tx(mtx);
+
+    CCoinsView dummy;
+    CCoinsViewCache coins(&dummy);
+    coins.AddCoin(tx.vin[0].prevout, Coin(CTxOut(2 * SATOSHI, scriptA), 1, false), false);
+
+    RefSummaryCache cache(1 << 20);
+    auto contexts = ScriptExecutionContext::createForAllInputs(tx, coins, &cache);
+    // Nothing is cached until the summaries are needed
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+    BOOST_CHECK_EQUAL(contexts[0].getRefValueSumOutputs(a), 11 * SATOSHI);
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+    const auto cached = cache.Get(COutPoint(tx.GetId(), 1));
+    BOOST_REQUIRE(cached);
+    BOOST_CHECK_EQUAL(cached->nValue, 6 * SATOSHI);
+    BOOST_CHECK(cached->pushRefSet == std::vector<uint288>({a}));
+
+    // A second evaluation is served from the cache, without copying, and gives the same results
+    contexts = ScriptExecutionContext::createForAllInputs(tx, coins, &cache);
+    BOOST_CHECK_EQUAL(contexts[0].getRefValueSumOutputs(a), 11 * SATOSHI);
+    BOOST_CHECK_EQUAL(contexts[0].getRefValueSumUtxos(a), 2 * SATOSHI);
+    BOOST_CHECK_EQUAL(cache.Size(), 3U);
+    BOOST_CHECK(cache.Get(COutPoint(tx.GetId(), 1)) == cached);
+
+    // Shrinking the cache evicts the oldest entries first
+    cache.SetMaxBytes(cache.DynamicMemoryUsage() - 1);
+    BOOST_CHECK_EQUAL(cache.Size(), 2U);
+    BOOST_CHECK(!cache.Get(tx.vin[0].prevout));
+    cache.SetMaxBytes(0);
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,135 @@
+// Copyright (c) 2022 The Bitcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/scripthashindex.h>
+
+#include <config.h>
+#include <consensus/validation.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <script/sighashtype.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(scripthashindex_tests)
+
+static void WaitForSync(ScriptHashIndex &index) {
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+}
+
+static std::vector<ScriptHashHistoryEntry> FindHistory(const ScriptHashIndex &index, const uint256 &scripthash,
+                                                       const std::optional<ScriptHashHistoryEntry> &start = {},
+                                                       size_t limit = 1000) {
+    std::vector<ScriptHashHistoryEntry> entries;
+    BOOST_CHECK(index.FindHistory(scripthash, start, limit, entries));
+    return entries;
+}
+
+static std::vector<ScriptHashUnspentEntry> FindUnspent(const ScriptHashIndex &index, const uint256 &scripthash,
+                                                       const std::optional<COutPoint> &start = {},
+                                                       size_t limit = 1000) {
+    std::vector<ScriptHashUnspentEntry> entries;
+    BOOST_CHECK(index.FindUnspent(scripthash, start, limit, entries));
+    return entries;
+}
+
+BOOST_FIXTURE_TEST_CASE(scripthashindex_spend_and_reorg, TestChain100Setup) {
+    ScriptHashIndex index(1 << 20, true);
+    index.Start();
+    WaitForSync(index);
+
+    const CScript coinbaseScript = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const uint256 coinbaseHash = ScriptHashIndex::GetScriptHash(coinbaseScript);
+
+    // Every coinbase of the test chain paid to the coinbase key, and none was
+    // spent yet.
+    BOOST_CHECK_EQUAL(FindHistory(index, coinbaseHash).size(), m_coinbase_txns.size());
+    BOOST_CHECK_EQUAL(FindUnspent(index, coinbaseHash).size(), m_coinbase_txns.size());
+
+    // Pages follow on from each other.
+    const std::vector<ScriptHashHistoryEntry> firstPage = FindHistory(index, coinbaseHash, {}, 10);
+    BOOST_REQUIRE_EQUAL(firstPage.size(), 10U);
+    BOOST_CHECK_EQUAL(firstPage[0].height, 1);
+    BOOST_CHECK(firstPage[0].txid == m_coinbase_txns[0]->GetId());
+    const std::vector<ScriptHashHistoryEntry> secondPage = FindHistory(index, coinbaseHash, firstPage.back(), 10);
+    BOOST_REQUIRE_EQUAL(secondPage.size(), 10U);
+    BOOST_CHECK_EQUAL(secondPage[0].height, 11);
+    const std::vector<ScriptHashUnspentEntry> unspentPage = FindUnspent(index, coinbaseHash, {}, 10);
+    BOOST_REQUIRE_EQUAL(unspentPage.size(), 10U);
+    BOOST_CHECK_EQUAL(FindUnspent(index, coinbaseHash, unspentPage.back().outpoint).size(),
+                      m_coinbase_txns.size() - 10);
+
+    // Spend the first coinbase to another script.
+    const CScript payScript = CScript() << OP_TRUE;
+    const uint256 payHash = ScriptHashIndex::GetScriptHash(payScript);
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint(m_coinbase_txns[0]->GetId(), 0));
+    spend.vout.emplace_back(m_coinbase_txns[0]->vout[0].nValue - CENT, payScript);
+    spend.vout.emplace_back(Amount::zero(), CScript() << OP_RETURN);
+    std::vector<uint8_t> vchSig;
+    const uint256 hash = SignatureHash(coinbaseScript, CTransaction(spend), 0, SigHashType().withForkId(),
+                                       m_coinbase_txns[0]->vout[0].nValue);
+    BOOST_CHECK(coinbaseKey.SignECDSA(hash, vchSig));
+    vchSig.push_back(uint8_t(SIGHASH_ALL | SIGHASH_FORKID));
+    spend.vin[0].scriptSig << vchSig;
+    // The new coinbase pays elsewhere, to leave the coinbase script alone.
+    const CBlock spendBlock = CreateAndProcessBlock({spend}, payScript);
+    BOOST_REQUIRE_EQUAL(::ChainActive().Tip()->GetBlockHash(), spendBlock.GetHash());
+    BOOST_CHECK(index.BlockUntilSyncedToCurrentChain());
+    const int spendHeight = ::ChainActive().Height();
+
+    std::vector<ScriptHashHistoryEntry> history = FindHistory(index, coinbaseHash);
+    BOOST_REQUIRE_EQUAL(history.size(), m_coinbase_txns.size() + 1);
+    BOOST_CHECK_EQUAL(history.back().height, spendHeight);
+    BOOST_CHECK(history.back().txid == spend.GetId());
+    std::vector<ScriptHashUnspentEntry> unspent = FindUnspent(index, coinbaseHash);
+    BOOST_CHECK_EQUAL(unspent.size(), m_coinbase_txns.size() - 1);
+    for (const auto &entry : unspent) {
+        BOOST_CHECK(entry.outpoint.GetTxId() != m_coinbase_txns[0]->GetId());
+    }
+
+    // The spend and the new coinbase paid to the other script, but not the
+    // OP_RETURN output.
+    history = FindHistory(index, payHash);
+    BOOST_CHECK_EQUAL(history.size(), 2U);
+    unspent = FindUnspent(index, payHash);
+    BOOST_REQUIRE_EQUAL(unspent.size(), 2U);
+    BOOST_CHECK_EQUAL(FindHistory(index, ScriptHashIndex::GetScriptHash(CScript() << OP_RETURN)).size(), 0U);
+
+    // Disconnecting the block restores the spent coinbase.
+    {
+        CValidationState state;
+        CBlockIndex *pindex = WITH_LOCK(cs_main, return LookupBlockIndex(spendBlock.GetHash()));
+        BOOST_CHECK(InvalidateBlock(GetConfig(), state, pindex));
+    }
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(::ChainActive().Height(), spendHeight - 1);
+
+    BOOST_CHECK_EQUAL(FindHistory(index, coinbaseHash).size(), m_coinbase_txns.size());
+    unspent = FindUnspent(index, coinbaseHash);
+    BOOST_REQUIRE_EQUAL(unspent.size(), m_coinbase_txns.size());
+    const auto restored = std::find_if(unspent.begin(), unspent.end(), [&](const ScriptHashUnspentEntry &entry) {
+        return entry.outpoint == COutPoint(m_coinbase_txns[0]->GetId(), 0);
+    });
+    BOOST_REQUIRE(restored != unspent.end());
+    BOOST_CHECK_EQUAL(restored->height, 1);
+    BOOST_CHECK(restored->value == m_coinbase_txns[0]->vout[0].nValue);
+    BOOST_CHECK_EQUAL(FindHistory(index, payHash).size(), 0U);
+    BOOST_CHECK_EQUAL(FindUnspent(index, payHash).size(), 0U);
+
+    index.Stop();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
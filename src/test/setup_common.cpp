@@ -12,6 +12,7 @@
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <crypto/sha512_256.h>
 #include <fs.h>
 #include <key.h>
 #include <logging.h>
@@ -25,6 +26,7 @@
 #include <rpc/register.h>
 #include <rpc/server.h>
 #include <script/script_error.h>
+#include <script/refsummarycache.h>
 #include <script/scriptcache.h>
 #include <script/sigcache.h>
 #include <streams.h>
@@ -63,11 +65,13 @@ std::ostream &operator<<(std::ostream &os, const ScriptError &err) {
 BasicTestingSetup::BasicTestingSetup(const std::string &chainName)
     : m_path_root(MakePathRoot()) {
     SHA256AutoDetect();
+    SHA512_256AutoDetect();
     ECC_Start();
     SetupEnvironment();
     SetupNetworking();
     InitSignatureCache();
     InitScriptExecutionCache();
+    InitRefSummaryCache();
 
     fCheckBlockIndex = true;
     SelectParams(chainName);
@@ -82,4 +82,38 @@ BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup) {
     // Rest of shutdown sequence and destructors happen in ~TestingSetup()
 }
 
+BOOST_FIXTURE_TEST_CASE(txindex_sync_threads, TestChain100Setup) {
+    // The blocks are read ahead by a pool of threads but written in order, so
+    // the index ends up the same whatever the number of threads.
+    for (const char *n_threads : {"1", "4", "16"}) {
+        gArgs.ForceSetArg("-indexsyncthreads", n_threads);
+        TxIndex txindex(1 << 20, true);
+        txindex.Start();
+
+        constexpr int64_t timeout_ms = 10 * 1000;
+        int64_t time_start = GetTimeMillis();
+        while (!txindex.BlockUntilSyncedToCurrentChain()) {
+            BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+            MilliSleep(100);
+        }
+
+        CTransactionRef tx_disk;
+        BlockHash block_hash;
+        for (const auto &txn : m_coinbase_txns) {
+            if (!txindex.FindTx(txn->GetId(), block_hash, tx_disk)) {
+                BOOST_ERROR("FindTx failed");
+            } else if (tx_disk->GetId() != txn->GetId()) {
+                BOOST_ERROR("Read incorrect tx");
+            }
+        }
+        BOOST_CHECK(block_hash == ::ChainActive().Tip()->GetBlockHash());
+
+        txindex.Stop();
+    }
+    gArgs.ClearArg("-indexsyncthreads");
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -25,6 +25,10 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 BOOST_AUTO_TEST_SUITE(txvalidationcache_tests)
 
 static bool ToMemPool(const CMutableTransaction &tx) {
@@ -94,6 +98,129 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_block_doublespend, TestChain100Setup) {
     BOOST_CHECK_EQUAL(g_mempool.size(), 0U);
 }
 
+BOOST_FIXTURE_TEST_CASE(tx_mempool_parallel_inputs, TestChain100Setup) {
+    // The scripts of transactions with at least nMempoolParallelInputs inputs
+    // are checked on the script check threads, with the same outcome.
+    const uint32_t nOldParallelInputs = nMempoolParallelInputs;
+    nMempoolParallelInputs = 2;
+
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey())
+                                     << OP_CHECKSIG;
+    const size_t nInputs = 10;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(nInputs);
+    Amount nValue = Amount::zero();
+    for (size_t i = 0; i < nInputs; i++) {
+        spend.vin[i].prevout = COutPoint(m_coinbase_txns[i]->GetId(), 0);
+        nValue += m_coinbase_txns[i]->vout[0].nValue;
+    }
+    spend.vout.resize(1);
+    spend.vout[0].nValue = nValue - CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    for (size_t i = 0; i < nInputs; i++) {
+        std::vector<uint8_t> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, CTransaction(spend), i,
+                                     SigHashType().withForkId(),
+                                     m_coinbase_txns[i]->vout[0].nValue);
+        BOOST_CHECK(coinbaseKey.SignECDSA(hash, vchSig));
+        vchSig.push_back(uint8_t(SIGHASH_ALL | SIGHASH_FORKID));
+        spend.vin[i].scriptSig = CScript() << vchSig;
+    }
+
+    // A bad signature on the last input gets the transaction rejected as it
+    // would be if checked on this thread.
+    CMutableTransaction badSpend = spend;
+    std::vector<uint8_t> vchBadSig(spend.vin.back().scriptSig.begin() + 1,
+                                   spend.vin.back().scriptSig.end());
+    vchBadSig[10] ^= 1;
+    badSpend.vin.back().scriptSig = CScript() << vchBadSig;
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(!AcceptToMemoryPool(
+            GetConfig(), g_mempool, state, MakeTransactionRef(badSpend),
+            nullptr /* pfMissingInputs */, true /* bypass_limits */,
+            Amount::zero() /* nAbsurdFee */));
+        BOOST_CHECK_EQUAL(state.GetRejectReason().substr(0, 35),
+                          "mandatory-script-verify-flag-failed");
+    }
+
+    BOOST_CHECK(ToMemPool(spend));
+    {
+        LOCK(g_mempool.cs);
+        auto it = g_mempool.mapTx.find(spend.GetId());
+        BOOST_REQUIRE(it != g_mempool.mapTx.end());
+        BOOST_CHECK_EQUAL(it->GetSigChecks(), int64_t(nInputs));
+    }
+
+    g_mempool.clear();
+    nMempoolParallelInputs = nOldParallelInputs;
+}
+
+BOOST_FIXTURE_TEST_CASE(tx_mempool_precheck, TestChain100Setup) {
+    // Transactions prechecked without cs_main are rejected ahead of
+    // AcceptToMemoryPool only when their scripts fail.
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey())
+                                     << OP_CHECKSIG;
+    std::vector<CTransactionRef> txs;
+    for (size_t i = 0; i < 3; i++) {
+        CMutableTransaction spend;
+        spend.nVersion = 1;
+        spend.vin.resize(1);
+        spend.vin[0].prevout = COutPoint(m_coinbase_txns[i]->GetId(), 0);
+        spend.vout.resize(1);
+        spend.vout[0].nValue = m_coinbase_txns[i]->vout[0].nValue - CENT;
+        spend.vout[0].scriptPubKey = scriptPubKey;
+        std::vector<uint8_t> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, CTransaction(spend), 0,
+                                     SigHashType().withForkId(),
+                                     m_coinbase_txns[i]->vout[0].nValue);
+        BOOST_CHECK(coinbaseKey.SignECDSA(hash, vchSig));
+        vchSig.push_back(uint8_t(SIGHASH_ALL | SIGHASH_FORKID));
+        if (i == 1) {
+            // A bad signature.
+            vchSig[10] ^= 1;
+        }
+        spend.vin[0].scriptSig = CScript() << vchSig;
+        if (i == 2) {
+            // A missing input, which is left to AcceptToMemoryPool.
+            spend.vin[0].prevout = COutPoint(TxId(InsecureRand256()), 0);
+        }
+        txs.push_back(MakeTransactionRef(spend));
+    }
+
+    std::vector<CValidationState> states;
+    PreCheckTransactionsForMempool(GetConfig(), g_mempool, txs, states);
+    BOOST_REQUIRE_EQUAL(states.size(), txs.size());
+    BOOST_CHECK(states[0].IsValid());
+    BOOST_CHECK(!states[1].IsValid());
+    BOOST_CHECK_EQUAL(states[1].GetRejectReason().substr(0, 35),
+                      "mandatory-script-verify-flag-failed");
+    BOOST_CHECK(states[2].IsValid());
+
+    {
+        LOCK(cs_main);
+        bool fMissingInputs = false;
+        BOOST_CHECK(AcceptToMemoryPool(
+            GetConfig(), g_mempool, states[0], txs[0], &fMissingInputs,
+            true /* bypass_limits */, Amount::zero() /* nAbsurdFee */));
+        BOOST_CHECK(!AcceptToMemoryPool(
+            GetConfig(), g_mempool, states[2], txs[2], &fMissingInputs,
+            true /* bypass_limits */, Amount::zero() /* nAbsurdFee */));
+        BOOST_CHECK(fMissingInputs);
+    }
+    BOOST_CHECK(g_mempool.exists(txs[0]->GetId()));
+
+    // Once in the mempool, the transaction is left alone.
+    CValidationState state;
+    BOOST_CHECK(PreCheckTransactionForMempool(GetConfig(), g_mempool, state,
+                                              txs[0]));
+    BOOST_CHECK(state.IsValid());
+
+    g_mempool.clear();
+}
+
 static inline bool
 CheckInputs(const CTransaction &tx, CValidationState &state,
             const CCoinsViewCache &view, bool fScriptChecks,
@@ -172,7 +299,6 @@ ValidateCheckInputsForAllFlags(const CTransaction &tx, uint32_t failing_flags,
 }
 
 BOOST_AUTO_TEST_CASE(scriptcache_values) {
-    LOCK(cs_main);
     // Test insertion and querying of keys&values from the script cache.
 
     // Define a couple of macros (handier than functions since errors will print
@@ -254,4 +380,65 @@ BOOST_AUTO_TEST_CASE(scriptcache_values) {
     CHECK_CACHE_HAS(key1A, 42);
 }
 
+BOOST_AUTO_TEST_CASE(scriptcache_concurrent) {
+    // The mempool precheck threads use the script cache without cs_main, as
+    // the block validation threads do.
+    InitScriptExecutionCache();
+
+    const int nThreads = 8;
+    const int nKeys = 1000;
+    std::atomic<int> nBad{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nThreads; ++t) {
+        threads.emplace_back([t, &nBad] {
+            std::vector<ScriptCacheKey> keys;
+            for (int i = 0; i < nKeys; ++i) {
+                CMutableTransaction tx;
+                tx.nLockTime = t * nKeys + i;
+                keys.emplace_back(CTransaction(tx), 0);
+                AddKeyInScriptCache(keys.back(), i);
+            }
+            for (int i = 0; i < nKeys; ++i) {
+                int nSigChecks;
+                if (!IsKeyInScriptCache(keys[i], false, nSigChecks) ||
+                    nSigChecks != i) {
+                    ++nBad;
+                }
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(nBad, 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(scriptcache_persist, BasicTestingSetup) {
+    SetDataDir("scriptcache_persist");
+    InitScriptExecutionCache();
+
+    CMutableTransaction tx1;
+    tx1.nVersion = 1;
+    CMutableTransaction tx2;
+    tx2.nVersion = 2;
+    ScriptCacheKey key1(CTransaction(tx1), 0);
+    ScriptCacheKey key2(CTransaction(tx2), 0);
+    ScriptCacheKey keyErased(CTransaction(tx1), 1);
+    AddKeyInScriptCache(key1, 42);
+    AddKeyInScriptCache(key2, 0);
+    AddKeyInScriptCache(keyErased, 1);
+    int nSigChecks;
+    BOOST_CHECK(IsKeyInScriptCache(keyErased, true, nSigChecks));
+
+    BOOST_CHECK(DumpSignatureCaches());
+    InitScriptExecutionCache();
+    CHECK_CACHE_MISSING(key1);
+
+    // The entries come back, but not the one which was erased.
+    BOOST_CHECK(LoadSignatureCaches());
+    CHECK_CACHE_HAS(key1, 42);
+    CHECK_CACHE_HAS(key2, 0);
+    CHECK_CACHE_MISSING(keyErased);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,11 +5,15 @@
 
 #include <validation.h>
 
+#include <arith_uint256.h>
 #include <chainparams.h>
 #include <clientversion.h>
 #include <config.h>
 #include <consensus/consensus.h>
+#include <hash.h>
 #include <net.h>
+#include <pow.h>
+#include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <streams.h>
 #include <util/system.h>
@@ -19,6 +23,7 @@
 #include <boost/signals2/signal.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <vector>
@@ -129,4 +134,88 @@ BOOST_AUTO_TEST_CASE(validation_load_external_block_file) {
     BOOST_CHECK_NO_THROW({ LoadExternalBlockFile(config, fp, 0); });
 }
 
+BOOST_AUTO_TEST_CASE(block_hash_batch) {
+    const auto chainParams = CreateChainParams(CBaseChainParams::MAIN);
+    const CBlockHeader genesis = chainParams->GenesisBlock().GetBlockHeader();
+    BOOST_CHECK_EQUAL(genesis.GetHash(), chainParams->GetConsensus().hashGenesisBlock);
+
+    // The block hash is the plain double SHA-512/256 of the serialized header.
+    std::vector<uint8_t> raw;
+    uint256 expected;
+    CVectorWriter(SER_GETHASH, PROTOCOL_VERSION, raw, 0, genesis);
+    CHash512_256().Write(raw).Finalize(expected);
+    BOOST_CHECK_EQUAL(genesis.GetHash(), BlockHash(expected));
+
+    // Batched hashing must agree with hashing headers one by one, for batch
+    // sizes that exercise every multi-way kernel and the scalar tail.
+    for (size_t n : {0, 1, 3, 4, 7, 8, 13, 64}) {
+        std::vector<CBlockHeader> headers(n, genesis);
+        for (CBlockHeader &header : headers) {
+            header.nNonce = InsecureRand32();
+            header.hashMerkleRoot = InsecureRand256();
+        }
+        const std::vector<BlockHash> hashes = BlockHashCalculator::CalculateBlockHashesFromHeaders_sha512_256(headers);
+        BOOST_REQUIRE_EQUAL(hashes.size(), n);
+        for (size_t i = 0; i < n; ++i) {
+            BOOST_CHECK_EQUAL(hashes[i], headers[i].GetHash());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(check_block_headers_pow) {
+    const auto chainParams = CreateChainParams(CBaseChainParams::REGTEST);
+    const Consensus::Params &params = chainParams->GetConsensus();
+
+    // Mine enough headers for several header checks plus a partial one, at the
+    // proof of work limit (the genesis block's is much harder).
+    std::vector<CBlockHeader> headers(150, chainParams->GenesisBlock().GetBlockHeader());
+    for (CBlockHeader &header : headers) {
+        header.nBits = UintToArith256(params.powLimit).GetCompact();
+        header.hashMerkleRoot = InsecureRand256();
+        while (!CheckProofOfWork(header.GetHash(), header.nBits, params)) {
+            ++header.nNonce;
+        }
+    }
+
+    std::vector<BlockHash> hashes;
+    BOOST_CHECK(CheckBlockHeadersProofOfWork(headers, hashes, params));
+    BOOST_REQUIRE_EQUAL(hashes.size(), headers.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+        BOOST_CHECK_EQUAL(hashes[i], headers[i].GetHash());
+    }
+
+    BOOST_CHECK(CheckBlockHeadersProofOfWork({}, hashes, params));
+    BOOST_CHECK(hashes.empty());
+
+    // A single header with insufficient work fails the whole batch.
+    CBlockHeader &bad = headers[97];
+    do {
+        ++bad.nNonce;
+    } while (CheckProofOfWork(bad.GetHash(), bad.nBits, params));
+    BOOST_CHECK(!CheckBlockHeadersProofOfWork(headers, hashes, params));
+}
+
+BOOST_AUTO_TEST_CASE(read_raw_block) {
+    const Consensus::Params &params = GetConfig().GetChainParams().GetConsensus();
+    const CBlockIndex *pindex = WITH_LOCK(cs_main, return ::ChainActive().Genesis());
+    BOOST_REQUIRE(pindex);
+
+    // The raw block is exactly the serialization of the block.
+    CBlock block;
+    BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, params));
+    RawBlock rawBlock;
+    BOOST_REQUIRE(ReadRawBlockFromDisk(rawBlock, pindex, params));
+    std::vector<uint8_t> serialized;
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, serialized, 0, block);
+    BOOST_CHECK(rawBlock.data.size() == serialized.size());
+    BOOST_CHECK(std::equal(rawBlock.data.begin(), rawBlock.data.end(), serialized.begin(), serialized.end()));
+
+    // Positions that do not point at a block are rejected.
+    const FlatFilePos pos = WITH_LOCK(cs_main, return pindex->GetBlockPos());
+    BOOST_CHECK(!ReadRawBlockFromDisk(rawBlock, FlatFilePos(pos.nFile, pos.nPos + 1), params));
+    BOOST_CHECK(!ReadRawBlockFromDisk(rawBlock, FlatFilePos(pos.nFile, 0), params));
+    BOOST_CHECK(!ReadRawBlockFromDisk(rawBlock, FlatFilePos(pos.nFile + 1, pos.nPos), params));
+    BOOST_CHECK(!rawBlock.file);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,7 +12,9 @@
 #include <random.h>
 #include <shutdown.h>
 #include <ui_interface.h>
+#include <util/defer.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <util/vector.h>
 
 #include <boost/thread.hpp> // boost::this_thread::interruption_point() (mingw)
@@ -28,6 +30,9 @@ static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
+
+//! Number of block index entries read before hashing them in parallel.
+static constexpr size_t BLOCK_INDEX_LOAD_BATCH_SIZE = 16384;
 static const char DB_LAST_BLOCK = 'l';
 
 namespace {
@@ -82,6 +87,9 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const BlockHash &hashBlock) {
         (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
+    ++m_write_sequence;
+    // Even again once done, also if a write throws.
+    Defer endWrite([this] { ++m_write_sequence; });
 
     BlockHash old_tip = GetBestBlock();
     if (old_tip.IsNull()) {
@@ -257,48 +265,91 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
 
 bool CBlockTreeDB::LoadBlockIndexGuts(
     const Consensus::Params &params,
-    std::function<CBlockIndex *(const BlockHash &)> insertBlockIndex) {
+    std::function<CBlockIndex *(const BlockHash &)> insertBlockIndex,
+    std::function<bool(const std::vector<CBlockHeader> &,
+                       std::vector<BlockHash> &)>
+        checkHeadersProofOfWork) {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX) {
-            break;
-        }
+    int64_t nTimeRead = 0, nTimeHash = 0, nTimeInsert = 0;
+    size_t nLoaded = 0;
+    std::vector<CDiskBlockIndex> batch;
+    std::vector<CBlockHeader> headers;
+    std::vector<BlockHash> hashes;
+    batch.reserve(BLOCK_INDEX_LOAD_BATCH_SIZE);
+    headers.reserve(BLOCK_INDEX_LOAD_BATCH_SIZE);
+
+    // Load mapBlockIndex. Entries are read in batches so that the header
+    // hashing and proof of work checks can be spread over the header checking
+    // threads.
+    bool fDone = false;
+    while (!fDone) {
+        const int64_t nTimeStart = GetTimeMicros();
+        batch.clear();
+        headers.clear();
+        while (batch.size() < BLOCK_INDEX_LOAD_BATCH_SIZE) {
+            boost::this_thread::interruption_point();
+            std::pair<char, uint256> key;
+            if (!pcursor->Valid() || !pcursor->GetKey(key) ||
+                key.first != DB_BLOCK_INDEX) {
+                fDone = true;
+                break;
+            }
 
-        CDiskBlockIndex diskindex;
-        if (!pcursor->GetValue(diskindex)) {
-            return error("%s : failed to read value", __func__);
-        }
+            CDiskBlockIndex &diskindex = batch.emplace_back();
+            if (!pcursor->GetValue(diskindex)) {
+                return error("%s : failed to read value", __func__);
+            }
+            headers.push_back(diskindex.GetBlockHeader());
 
-        // Construct block index object
-        CBlockIndex *pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-        pindexNew->pprev = insertBlockIndex(diskindex.hashPrev);
-        pindexNew->nHeight = diskindex.nHeight;
-        pindexNew->nFile = diskindex.nFile;
-        pindexNew->nDataPos = diskindex.nDataPos;
-        pindexNew->nUndoPos = diskindex.nUndoPos;
-        pindexNew->nVersion = diskindex.nVersion;
-        pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-        pindexNew->nTime = diskindex.nTime;
-        pindexNew->nBits = diskindex.nBits;
-        pindexNew->nNonce = diskindex.nNonce;
-        pindexNew->nStatus = diskindex.nStatus;
-        pindexNew->nTx = diskindex.nTx;
-
-        if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits,
-                              params)) {
-            return error("%s: CheckProofOfWork failed: %s", __func__,
-                         pindexNew->ToString());
+            pcursor->Next();
         }
-
-        pcursor->Next();
+        const int64_t nTime1 = GetTimeMicros();
+        nTimeRead += nTime1 - nTimeStart;
+
+        if (!checkHeadersProofOfWork(headers, hashes)) {
+            // Find the culprit to report it.
+            for (const CDiskBlockIndex &diskindex : batch) {
+                if (!CheckProofOfWork(diskindex.GetBlockHash(), diskindex.nBits,
+                                      params)) {
+                    return error("%s: CheckProofOfWork failed: %s", __func__,
+                                 diskindex.ToString());
+                }
+            }
+            return error("%s: CheckProofOfWork failed", __func__);
+        }
+        const int64_t nTime2 = GetTimeMicros();
+        nTimeHash += nTime2 - nTime1;
+
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const CDiskBlockIndex &diskindex = batch[i];
+
+            // Construct block index object
+            CBlockIndex *pindexNew = insertBlockIndex(hashes[i]);
+            pindexNew->pprev = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight = diskindex.nHeight;
+            pindexNew->nFile = diskindex.nFile;
+            pindexNew->nDataPos = diskindex.nDataPos;
+            pindexNew->nUndoPos = diskindex.nUndoPos;
+            pindexNew->nVersion = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime = diskindex.nTime;
+            pindexNew->nBits = diskindex.nBits;
+            pindexNew->nNonce = diskindex.nNonce;
+            pindexNew->nStatus = diskindex.nStatus;
+            pindexNew->nTx = diskindex.nTx;
+        }
+        nTimeInsert += GetTimeMicros() - nTime2;
+        nLoaded += batch.size();
     }
 
+    LogPrintf("%s: loaded %u block index entries in %.2fms (read %.2fms, "
+              "hash and check proof of work %.2fms, insert %.2fms)\n",
+              __func__, nLoaded, (nTimeRead + nTimeHash + nTimeInsert) * 0.001,
+              nTimeRead * 0.001, nTimeHash * 0.001, nTimeInsert * 0.001);
+
     return true;
 }
 
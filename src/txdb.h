@@ -11,6 +11,8 @@
 #include <flatfile.h>
 #include <primitives/block.h>
 
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <string>
@@ -42,6 +44,14 @@ static const int64_t nMaxBlockDBCache = 2;
 // a meaningful difference:
 // https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to the ref index DB specific cache, if -refindex (MiB)
+static const int64_t nMaxRefIndexCache = 1024;
+//! Max memory allocated to the codescript index DB specific cache, if -codescriptindex (MiB)
+static const int64_t nMaxCodeScriptIndexCache = 1024;
+//! Max memory allocated to the scripthash index DB specific cache, if -scripthashindex (MiB)
+static const int64_t nMaxScriptHashIndexCache = 1024;
+//! Max memory allocated to all block filter index caches combined in MiB.
+static const int64_t nMaxFilterIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -49,6 +59,8 @@ static const int64_t nMaxCoinsDBCache = 8;
 class CCoinsViewDB final : public CCoinsView {
 protected:
     CDBWrapper db;
+    //! Number of writes begun and ended, odd while one is in progress
+    std::atomic<uint64_t> m_write_sequence{0};
 
 public:
     explicit CCoinsViewDB(size_t nCacheSize, bool fMemory = false,
@@ -61,6 +73,12 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const BlockHash &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    /**
+     * Changes with every write, and is odd while one is in progress: coins
+     * read from other threads are current as long as it is unchanged since.
+     */
+    uint64_t GetWriteSequence() const { return m_write_sequence; }
+
     //! Attempt to update from an older database format.
     //! Returns whether an error occurred.
     bool Upgrade();
@@ -105,5 +123,8 @@ public:
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(
         const Consensus::Params &params,
-        std::function<CBlockIndex *(const BlockHash &)> insertBlockIndex);
+        std::function<CBlockIndex *(const BlockHash &)> insertBlockIndex,
+        std::function<bool(const std::vector<CBlockHeader> &,
+                           std::vector<BlockHash> &)>
+            checkHeadersProofOfWork);
 };
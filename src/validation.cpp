@@ -8,10 +8,12 @@
 
 #include <arith_uint256.h>
 #include <blockindexworkcomparator.h>
+#include <blockprefetcher.h>
 #include <blockvalidity.h>
 #include <chainparams.h>
 #include <checkpoints.h>
 #include <checkqueue.h>
+#include <clientversion.h>
 #include <config.h>
 #include <consensus/activation.h>
 #include <consensus/consensus.h>
@@ -19,6 +21,7 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
 #include <dsproof/dsproof.h>
 #include <dsproof/storage.h>
 #include <flatfile.h>
@@ -33,11 +36,13 @@
 #include <primitives/transaction.h>
 #include <random.h>
 #include <reverse_iterator.h>
+#include <script/refsummarycache.h>
 #include <script/script.h>
 #include <script/scriptcache.h>
 #include <script/sigcache.h>
 #include <script/standard.h>
 #include <shutdown.h>
+#include <streams.h>
 #include <timedata.h>
 #include <tinyformat.h>
 #include <txdb.h>
@@ -150,10 +155,12 @@ public:
     /**
      * If a block header hasn't already been seen, call CheckBlockHeader on it,
      * ensure that it doesn't descend from an invalid block, and then add it to
-     * mapBlockIndex.
+     * mapBlockIndex. If pknownHash is set, it is the header's hash and its
+     * proof of work has already been checked.
      */
     bool AcceptBlockHeader(const Config &config, const CBlockHeader &block,
-                           CValidationState &state, CBlockIndex **ppindex)
+                           CValidationState &state, CBlockIndex **ppindex,
+                           const BlockHash *pknownHash = nullptr)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AcceptBlock(const Config &config,
                      const std::shared_ptr<const CBlock> &pblock,
@@ -215,6 +222,11 @@ private:
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     CBlockIndex *AddToBlockIndex(const CBlockHeader &block)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+        return AddToBlockIndex(block, block.GetHash());
+    }
+    CBlockIndex *AddToBlockIndex(const CBlockHeader &block,
+                                 const BlockHash &hash)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Create a new block index entry for a given block hash */
     CBlockIndex *InsertBlockIndex(const BlockHash &hash)
@@ -270,6 +282,7 @@ bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = false;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool g_batch_schnorr_verification = DEFAULT_BATCH_SCHNORR_VERIFICATION;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
@@ -463,6 +476,112 @@ std::string FormatStateMessage(const CValidationState &state) {
         state.GetRejectCode());
 }
 
+static bool CheckInputScripts(const CTransaction &tx, CValidationState &state,
+                              const CCoinsViewCache &view, bool fScriptChecks,
+                              const uint32_t flags, bool sigCacheStore,
+                              bool scriptCacheStore,
+                              const PrecomputedTransactionData &txdata,
+                              int &nSigChecksOut,
+                              TxSigCheckLimiter &txLimitSigChecks,
+                              CheckInputsLimiter *pBlockLimitSigChecks,
+                              std::vector<CScriptCheck> *pvChecks);
+
+namespace {
+/**
+ * A script check run for AcceptToMemoryPool, which adds up the SigChecks of
+ * the scripts of a transaction as they get checked on other threads.
+ */
+class CMempoolScriptCheck {
+private:
+    CScriptCheck check;
+    std::atomic<int> *pnSigChecks{};
+
+public:
+    CMempoolScriptCheck() = default;
+
+    CMempoolScriptCheck(CScriptCheck &checkIn, std::atomic<int> *pnSigChecksIn)
+        : pnSigChecks(pnSigChecksIn) {
+        check.swap(checkIn);
+    }
+
+    bool operator()() {
+        if (!check()) {
+            return false;
+        }
+        *pnSigChecks += check.GetScriptExecutionMetrics().nSigChecks;
+        return true;
+    }
+
+    void swap(CMempoolScriptCheck &x) {
+        check.swap(x.check);
+        std::swap(pnSigChecks, x.pnSigChecks);
+    }
+};
+} // namespace
+
+// Separate from the block script check queue, so that a large transaction
+// never waits for a block to be connected, or the other way around.
+static CCheckQueue<CMempoolScriptCheck> mempoolscriptcheckqueue(128);
+
+/**
+ * Same as the short form of CheckInputs, but the scripts of transactions with
+ * at least -mempoolparallelinputs inputs are checked on the mempool script
+ * check threads, for such a transaction not to hold up the calling thread for
+ * the time it takes to check all of its inputs one after the other. Does not
+ * need cs_main.
+ */
+static bool CheckInputsForMempool(const CTransaction &tx,
+                                  CValidationState &state,
+                                  const CCoinsViewCache &view,
+                                  const uint32_t flags, bool sigCacheStore,
+                                  bool scriptCacheStore,
+                                  const PrecomputedTransactionData &txdata,
+                                  int &nSigChecksOut) {
+    TxSigCheckLimiter nSigChecksTxLimiter;
+    if (nMempoolParallelInputs == 0 || tx.vin.size() < nMempoolParallelInputs) {
+        return CheckInputScripts(tx, state, view, true, flags, sigCacheStore,
+                                 scriptCacheStore, txdata, nSigChecksOut,
+                                 nSigChecksTxLimiter, nullptr, nullptr);
+    }
+
+    std::vector<CScriptCheck> vChecks;
+    int nSigChecksCached = 0;
+    if (!CheckInputScripts(tx, state, view, true, flags, sigCacheStore,
+                           scriptCacheStore, txdata, nSigChecksCached,
+                           nSigChecksTxLimiter, nullptr, &vChecks)) {
+        return false;
+    }
+    if (vChecks.empty()) {
+        // Found in the script cache.
+        nSigChecksOut = nSigChecksCached;
+        return true;
+    }
+
+    std::atomic<int> nSigChecks{0};
+    std::vector<CMempoolScriptCheck> vMempoolChecks;
+    vMempoolChecks.reserve(vChecks.size());
+    for (CScriptCheck &check : vChecks) {
+        vMempoolChecks.emplace_back(check, &nSigChecks);
+    }
+    CCheckQueueControl<CMempoolScriptCheck> control(&mempoolscriptcheckqueue);
+    control.Add(vMempoolChecks);
+    if (!control.Wait()) {
+        // Check the inputs again on this thread, which stops at the first
+        // failure and tells failures of standardness flags apart. The
+        // signatures which were valid are in the signature cache by now.
+        TxSigCheckLimiter nSigChecksTxLimiter2;
+        return CheckInputScripts(tx, state, view, true, flags, sigCacheStore,
+                                 scriptCacheStore, txdata, nSigChecksOut,
+                                 nSigChecksTxLimiter2, nullptr, nullptr);
+    }
+
+    nSigChecksOut = nSigChecks;
+    if (scriptCacheStore) {
+        AddKeyInScriptCache(ScriptCacheKey(tx, flags), nSigChecksOut);
+    }
+    return true;
+}
+
 // Used to avoid mempool polluting consensus critical paths if CCoinsViewMempool
 // were somehow broken and returning the wrong scriptPubKeys
 static bool CheckInputsFromMempoolAndCache(
@@ -501,8 +620,8 @@ static bool CheckInputsFromMempoolAndCache(
         }
     }
 
-    return CheckInputs(tx, state, view, true, flags, cacheSigStore, true,
-                       txdata, nSigChecksOut);
+    return CheckInputsForMempool(tx, state, view, flags, cacheSigStore, true,
+                                 txdata, nSigChecksOut);
 }
 
 static bool
@@ -762,8 +881,8 @@ AcceptToMemoryPoolWorker(const Config &config, CTxMemPool &pool,
             nextBlockScriptVerifyFlags | STANDARD_SCRIPT_VERIFY_FLAGS;
         PrecomputedTransactionData txdata(tx);
         int nSigChecksStandard;
-        if (!CheckInputs(tx, state, view, true, scriptVerifyFlags, true, false,
-                         txdata, nSigChecksStandard)) {
+        if (!CheckInputsForMempool(tx, state, view, scriptVerifyFlags, true,
+                                   false, txdata, nSigChecksStandard)) {
             // State filled in by CheckInputs.
             return false;
         }
@@ -845,7 +964,6 @@ AcceptToMemoryPoolWorker(const Config &config, CTxMemPool &pool,
                                  "mempool full");
             }
         }
-
     }
 
     GetMainSignals().TransactionAddedToMempool(ptx);
@@ -936,6 +1054,176 @@ bool AcceptToMemoryPool(const Config &config, CTxMemPool &pool,
                                       test_accept);
 }
 
+bool PreCheckTransactionForMempool(const Config &config, CTxMemPool &pool,
+                                   CValidationState &state,
+                                   const CTransactionRef &ptx,
+                                   std::vector<COutPoint> *pcoins_to_uncache) {
+    AssertLockNotHeld(cs_main);
+
+    const Consensus::Params &consensusParams =
+        config.GetChainParams().GetConsensus();
+    const CTransaction &tx = *ptx;
+    const TxId txid = tx.GetId();
+
+    // Transactions which fail any of the cheaper checks are left to
+    // AcceptToMemoryPool, which rejects them before it gets to the scripts.
+    CValidationState stateDummy;
+    std::string reason;
+    if (!CheckRegularTransaction(tx, stateDummy) ||
+        (fRequireStandard && !IsStandardTx(tx, reason))) {
+        return true;
+    }
+
+    // Coins brought into the UTXO cache for these checks are taken out again,
+    // as AcceptToMemoryPool does for the transactions it rejects, unless the
+    // caller takes that over.
+    std::vector<COutPoint> coins_to_uncache_local;
+    std::vector<COutPoint> &coins_to_uncache =
+        pcoins_to_uncache ? *pcoins_to_uncache : coins_to_uncache_local;
+    Defer uncache([&coins_to_uncache_local]() {
+        if (!coins_to_uncache_local.empty()) {
+            LOCK(cs_main);
+            for (const COutPoint &outpoint : coins_to_uncache_local) {
+                pcoinsTip->Uncache(outpoint);
+            }
+        }
+    });
+
+    // Copy the coins spent by the transaction, and what else is needed of the
+    // chain and the mempool, holding the locks for as short as possible.
+    CCoinsView dummy;
+    CCoinsViewCache view(&dummy);
+    int nSpendHeight;
+    uint32_t nextBlockScriptVerifyFlags;
+    Amount nFeeDelta = Amount::zero();
+    CFeeRate mempoolMinFee;
+    {
+        LOCK2(cs_main, pool.cs);
+        if (pool.exists(txid) ||
+            !ContextualCheckTransactionForCurrentBlock(
+                consensusParams, tx, stateDummy,
+                STANDARD_LOCKTIME_VERIFY_FLAGS)) {
+            return true;
+        }
+
+        CCoinsViewMemPool viewMemPool(pcoinsTip.get(), pool);
+        view.SetBackend(viewMemPool);
+        for (const CTxIn &txin : tx.vin) {
+            if (!pcoinsTip->HaveCoinInCache(txin.prevout)) {
+                coins_to_uncache.push_back(txin.prevout);
+            }
+            // Conflicts (which may call for a double spend proof) and orphans
+            // are up to AcceptToMemoryPool.
+            if (pool.mapNextTx.count(txin.prevout) ||
+                !view.HaveCoin(txin.prevout)) {
+                return true;
+            }
+        }
+        view.GetBestBlock();
+        view.SetBackend(dummy);
+
+        nSpendHeight = ::ChainActive().Height() + 1;
+        nextBlockScriptVerifyFlags =
+            GetNextBlockScriptFlags(consensusParams, ::ChainActive().Tip());
+        pool.ApplyDelta(txid, nFeeDelta);
+        mempoolMinFee = pool.GetMinFee(config.GetMaxMemPoolSize());
+    }
+
+    const uint64_t maxEffectiveTxSize =
+        nSpendHeight < consensusParams.PushTXStateHeight ? MAX_TX_SIZE
+                                                          : MAX_TX_SIZE_ENERGY;
+    if (GetSerializeSize(tx, PROTOCOL_VERSION) > maxEffectiveTxSize) {
+        return true;
+    }
+
+    Amount nFees = Amount::zero();
+    if (!Consensus::CheckTxInputs(tx, stateDummy, view, nSpendHeight, nFees) ||
+        !ReferenceParser::validateTransactionReferenceOperations(tx, view) ||
+        (fRequireStandard &&
+         !AreInputsStandard(tx, view, nextBlockScriptVerifyFlags))) {
+        return true;
+    }
+    const Amount nModifiedFees = nFees + nFeeDelta;
+    const unsigned int nSize = tx.GetTotalSize();
+    if (nModifiedFees < minRelayTxFee.GetFee(nSize)) {
+        return true;
+    }
+
+    // Both script checks of AcceptToMemoryPool are done here, storing what it
+    // stores: the signatures in the signature cache, and the result of the
+    // consensus flags check in the script cache. A failure with the standard
+    // flags is final: the coins spent by a transaction cannot change.
+    const uint32_t scriptVerifyFlags =
+        nextBlockScriptVerifyFlags | STANDARD_SCRIPT_VERIFY_FLAGS;
+    PrecomputedTransactionData txdata(tx);
+    int nSigChecksStandard;
+    if (!CheckInputsForMempool(tx, state, view, scriptVerifyFlags, true, false,
+                               txdata, nSigChecksStandard)) {
+        return false;
+    }
+    if (nModifiedFees <
+        mempoolMinFee.GetFee(GetVirtualTransactionSize(nSize,
+                                                       nSigChecksStandard))) {
+        return true;
+    }
+    int nSigChecksConsensus;
+    CheckInputsForMempool(tx, stateDummy, view, nextBlockScriptVerifyFlags,
+                          true, true, txdata, nSigChecksConsensus);
+    return true;
+}
+
+namespace {
+/**
+ * A transaction checked by PreCheckTransactionForMempool on the precheck
+ * threads. Never fails, so that the other transactions of the batch are
+ * checked whatever the outcome for this one.
+ */
+class CTxPreCheck {
+private:
+    const Config *config{};
+    CTxMemPool *pool{};
+    CTransactionRef tx;
+    CValidationState *pstate{};
+
+public:
+    CTxPreCheck() = default;
+
+    CTxPreCheck(const Config &configIn, CTxMemPool &poolIn,
+                const CTransactionRef &txIn, CValidationState &stateIn)
+        : config(&configIn), pool(&poolIn), tx(txIn), pstate(&stateIn) {}
+
+    bool operator()() {
+        PreCheckTransactionForMempool(*config, *pool, *pstate, tx);
+        return true;
+    }
+
+    void swap(CTxPreCheck &x) {
+        std::swap(config, x.config);
+        std::swap(pool, x.pool);
+        std::swap(tx, x.tx);
+        std::swap(pstate, x.pstate);
+    }
+};
+} // namespace
+
+static CCheckQueue<CTxPreCheck> txprecheckqueue(8);
+
+void PreCheckTransactionsForMempool(const Config &config, CTxMemPool &pool,
+                                    const std::vector<CTransactionRef> &txs,
+                                    std::vector<CValidationState> &states) {
+    AssertLockNotHeld(cs_main);
+
+    states.assign(txs.size(), CValidationState());
+    std::vector<CTxPreCheck> vChecks;
+    vChecks.reserve(txs.size());
+    for (size_t i = 0; i < txs.size(); ++i) {
+        vChecks.emplace_back(config, pool, txs[i], states[i]);
+    }
+    CCheckQueueControl<CTxPreCheck> control(&txprecheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
 /**
  * Return transaction in txOut, and if it was found inside a block, its hash is
  * placed in hashBlock. If blockIndex is provided, the transaction is fetched
@@ -1063,6 +1351,73 @@ bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex,
     return true;
 }
 
+bool ReadRawBlockFromDisk(RawBlock &block, const FlatFilePos &pos,
+                          const Consensus::Params &params) {
+    block = RawBlock{};
+
+    auto file = BlockFileSeq().Map(pos);
+    if (!file) {
+        return error("ReadRawBlockFromDisk: Map failed for %s",
+                     pos.ToString());
+    }
+
+    // The block is preceded by the disk magic and its size, see
+    // WriteBlockToDisk().
+    const Span<const uint8_t> fileData = file->Data();
+    uint32_t nSize;
+    if (pos.nPos < sizeof(nSize) || pos.nPos > fileData.size()) {
+        return error("ReadRawBlockFromDisk: Out of bounds position %s",
+                     pos.ToString());
+    }
+    nSize = ReadLE32(fileData.data() + pos.nPos - sizeof(nSize));
+    if (nSize > fileData.size() - pos.nPos) {
+        return error("ReadRawBlockFromDisk: Block size %u out of bounds at %s",
+                     nSize, pos.ToString());
+    }
+    const Span<const uint8_t> data = fileData.subspan(pos.nPos, nSize);
+
+    // Check the header
+    CBlockHeader header;
+    try {
+        SpanReader(SER_DISK, CLIENT_VERSION, data) >> header;
+    } catch (const std::exception &e) {
+        return error("%s: Deserialize error - %s at %s", __func__, e.what(),
+                     pos.ToString());
+    }
+    if (!CheckProofOfWork(header.GetHash(), header.nBits, params)) {
+        return error("ReadRawBlockFromDisk: Errors in block header at %s",
+                     pos.ToString());
+    }
+
+    block.file = std::move(file);
+    block.data = data;
+    return true;
+}
+
+bool ReadRawBlockFromDisk(RawBlock &block, const CBlockIndex *pindex,
+                          const Consensus::Params &params) {
+    FlatFilePos blockPos;
+    {
+        LOCK(cs_main);
+        blockPos = pindex->GetBlockPos();
+    }
+
+    if (!ReadRawBlockFromDisk(block, blockPos, params)) {
+        return false;
+    }
+
+    CBlockHeader header;
+    SpanReader(SER_DISK, CLIENT_VERSION, block.data) >> header;
+    if (header.GetHash() != pindex->GetBlockHash()) {
+        block = RawBlock{};
+        return error("ReadRawBlockFromDisk(RawBlock&, CBlockIndex*): GetHash() "
+                     "doesn't match index for %s at %s",
+                     pindex->ToString(), blockPos.ToString());
+    }
+
+    return true;
+}
+
 Amount GetBlockSubsidy(int nHeight, const Consensus::Params &consensusParams) {
     int halvings = nHeight / consensusParams.nSubsidyHalvingInterval;
     // Force block reward to zero when right shift is undefined.
@@ -1282,10 +1637,13 @@ bool CScriptCheck::operator()() {
     assert(bool(context));
     assert(bool(context->tx().constantTx()));
 
+    deferredSchnorr.clear();
+    const bool fDefer = deferSchnorr && (nFlags & SCRIPT_VERIFY_NULLFAIL);
     if ( ! VerifyScript(context->scriptSig(), context->coinScriptPubKey(), nFlags,
                         CachingTransactionSignatureChecker(context->tx().constantTx(),
                                                            context->inputIndex(), context->coinAmount(),
-                                                           cacheStore, txdata),
+                                                           cacheStore, txdata,
+                                                           fDefer ? &deferredSchnorr : nullptr),
                         metrics, context, &error)) {
         
         return false;
@@ -1305,6 +1663,43 @@ bool CScriptCheck::operator()() {
     return true;
 }
 
+bool CScriptCheck::FinishBatch(std::vector<CScriptCheck> &checks) {
+    std::vector<const SchnorrBatchEntry *> batch;
+    for (const CScriptCheck &check : checks) {
+        for (const SchnorrBatchEntry &entry : check.deferredSchnorr) {
+            batch.push_back(&entry);
+        }
+    }
+    if (batch.empty()) {
+        return true;
+    }
+
+    if (CPubKey::VerifySchnorrBatch(batch)) {
+        for (CScriptCheck &check : checks) {
+            if (check.cacheStore) {
+                AddToSignatureCache(check.deferredSchnorr);
+            }
+            check.deferredSchnorr.clear();
+        }
+        return true;
+    }
+
+    // Some signature is invalid. Verifying the signatures one by one is what
+    // decides the outcome, and tells which script fails. The first run already
+    // charged the sigchecks to the limiters, so they are left out this time.
+    for (CScriptCheck &check : checks) {
+        if (!check.deferredSchnorr.empty()) {
+            check.deferSchnorr = false;
+            check.pTxLimitSigChecks = nullptr;
+            check.pBlockLimitSigChecks = nullptr;
+            if (!check()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache &inputs) {
     LOCK(cs_main);
     CBlockIndex *pindexPrev = LookupBlockIndex(inputs.GetBestBlock());
@@ -1319,8 +1714,27 @@ bool CheckInputs(const CTransaction &tx, CValidationState &state,
                  TxSigCheckLimiter &txLimitSigChecks,
                  CheckInputsLimiter *pBlockLimitSigChecks,
                  std::vector<CScriptCheck> *pvChecks) {
- 
     AssertLockHeld(cs_main);
+    return CheckInputScripts(tx, state, view, fScriptChecks, flags,
+                             sigCacheStore, scriptCacheStore, txdata,
+                             nSigChecksOut, txLimitSigChecks,
+                             pBlockLimitSigChecks, pvChecks);
+}
+
+/**
+ * CheckInputs without cs_main: the scripts are checked against the coins in
+ * view alone, which the caller may have copied out of the UTXO set and the
+ * mempool beforehand.
+ */
+static bool CheckInputScripts(const CTransaction &tx, CValidationState &state,
+                              const CCoinsViewCache &view, bool fScriptChecks,
+                              const uint32_t flags, bool sigCacheStore,
+                              bool scriptCacheStore,
+                              const PrecomputedTransactionData &txdata,
+                              int &nSigChecksOut,
+                              TxSigCheckLimiter &txLimitSigChecks,
+                              CheckInputsLimiter *pBlockLimitSigChecks,
+                              std::vector<CScriptCheck> *pvChecks) {
     assert(!tx.IsCoinBase());
  
     if (pvChecks) {
@@ -1345,7 +1759,8 @@ bool CheckInputs(const CTransaction &tx, CValidationState &state,
     }
 
     int nSigChecksTotal = 0;
-    auto contextVec = ScriptExecutionContext::createForAllInputs(tx, view);
+    // The coins in `view` are the validated ones, so the ref summary cache may be used here.
+    auto contextVec = ScriptExecutionContext::createForAllInputs(tx, view, &g_refSummaryCache);
     for (size_t i = 0; i < tx.vin.size(); ++i) {
  
         assert(!contextVec[i].coin().IsSpent());
@@ -1651,14 +2066,98 @@ static bool WriteUndoDataForBlock(const CBlockUndo &blockundo,
     return true;
 }
 
+// Up to 128 checks are taken at once, fewer for checks which take long to run.
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
 
+namespace {
+/**
+ * Hashes a run of consecutive block headers and checks their proof of work.
+ * The headers and hashes are owned by the caller of
+ * CheckBlockHeadersProofOfWork, which waits for all checks to complete.
+ */
+class CHeaderCheck {
+private:
+    const CBlockHeader *headers = nullptr;
+    BlockHash *hashes = nullptr;
+    size_t count = 0;
+    const Consensus::Params *params = nullptr;
+
+public:
+    CHeaderCheck() = default;
+    CHeaderCheck(const CBlockHeader *headersIn, BlockHash *hashesIn,
+                 size_t countIn, const Consensus::Params &paramsIn)
+        : headers(headersIn), hashes(hashesIn), count(countIn),
+          params(&paramsIn) {}
+
+    bool operator()() {
+        BlockHashCalculator::CalculateBlockHashesFromHeaders_sha512_256(
+            headers, count, hashes);
+        for (size_t i = 0; i < count; ++i) {
+            if (!CheckProofOfWork(hashes[i], headers[i].nBits, *params)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void swap(CHeaderCheck &check) {
+        std::swap(headers, check.headers);
+        std::swap(hashes, check.hashes);
+        std::swap(count, check.count);
+        std::swap(params, check.params);
+    }
+};
+
+/**
+ * Number of headers hashed per check. A multiple of the widest multi-buffer
+ * SHA-512/256 kernel, and large enough to amortize the queue overhead.
+ */
+constexpr size_t HEADER_CHECK_SIZE = 64;
+} // namespace
+
+static CCheckQueue<CHeaderCheck> headercheckqueue(4);
+
 void StartScriptCheckWorkerThreads(int threads_num) {
     scriptcheckqueue.StartWorkerThreads(threads_num);
+    headercheckqueue.StartWorkerThreads(threads_num, "headerch");
+    mempoolscriptcheckqueue.StartWorkerThreads(threads_num, "mempoolch");
+    txprecheckqueue.StartWorkerThreads(threads_num, "txprech");
 }
 
 void StopScriptCheckWorkerThreads() {
     scriptcheckqueue.StopWorkerThreads();
+    headercheckqueue.StopWorkerThreads();
+    mempoolscriptcheckqueue.StopWorkerThreads();
+    txprecheckqueue.StopWorkerThreads();
+}
+
+static BlockPrefetcher g_block_prefetcher;
+
+void StartBlockPrefetchThreads(int threads_num, int depth) {
+    g_block_prefetcher.Start(threads_num, depth, MAX_BLOCK_PREFETCH_BYTES);
+}
+
+void StopBlockPrefetchThreads() {
+    g_block_prefetcher.Stop();
+}
+
+bool CheckBlockHeadersProofOfWork(const std::vector<CBlockHeader> &headers,
+                                  std::vector<BlockHash> &hashes,
+                                  const Consensus::Params &params) {
+    hashes.assign(headers.size(), BlockHash());
+
+    std::vector<CHeaderCheck> vChecks;
+    vChecks.reserve((headers.size() + HEADER_CHECK_SIZE - 1) /
+                    HEADER_CHECK_SIZE);
+    for (size_t i = 0; i < headers.size(); i += HEADER_CHECK_SIZE) {
+        vChecks.emplace_back(&headers[i], &hashes[i],
+                             std::min(HEADER_CHECK_SIZE, headers.size() - i),
+                             params);
+    }
+
+    CCheckQueueControl<CHeaderCheck> control(&headercheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
 }
 
 int32_t ComputeBlockVersion(const CBlockIndex *pindexPrev,
@@ -2017,6 +2516,11 @@ bool CChainState::ConnectBlock(const CBlock &block, CValidationState &state,
             return error("ConnectBlock(): CheckInputs on %s failed with %s",
                          tx.GetId().ToString(), FormatStateMessage(state));
         }
+        if (g_batch_schnorr_verification) {
+            for (CScriptCheck &check : vChecks) {
+                check.DeferSchnorrSignatures();
+            }
+        }
         control.Add(vChecks);
 
         // Note: this must execute in the same iteration as CheckTxInputs (not
@@ -2379,6 +2883,10 @@ bool CChainState::DisconnectTip(const CChainParams &params,
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetchRead = 0;
+static int64_t nTimePrefetchCheck = 0;
+static int64_t nTimePrefetchCoins = 0;
+static int64_t nTimeAddPrefetchedCoins = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2556,27 +3064,64 @@ bool CChainState::ConnectTip(const Config &config, CValidationState &state,
     const Consensus::Params &consensusParams = params.GetConsensus();
 
     assert(pindexNew->pprev == m_chain.Tip());
-    // Read block from disk.
+    // Read block from disk, or take it from the prefetcher.
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
+    std::shared_ptr<PrefetchedBlock> prefetched;
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, consensusParams)) {
-            return AbortNode(state, "Failed to read block");
+        prefetched = g_block_prefetcher.Take(pindexNew);
+        if (prefetched && prefetched->block) {
+            pthisBlock = prefetched->block;
+        } else {
+            std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*pblockNew, pindexNew, consensusParams)) {
+                return AbortNode(state, "Failed to read block");
+            }
+            pthisBlock = pblockNew;
         }
-        pthisBlock = pblockNew;
     } else {
         pthisBlock = pblock;
     }
 
     const CBlock &blockConnecting = *pthisBlock;
 
-    // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros();
     nTimeReadFromDisk += nTime2 - nTime1;
-    int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n",
              (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    if (prefetched) {
+        // Time the prefetching threads spent on the block meanwhile.
+        nTimePrefetchRead += prefetched->time_read;
+        nTimePrefetchCheck += prefetched->time_check;
+        nTimePrefetchCoins += prefetched->time_coins;
+        LogPrint(BCLog::BENCH, "    - Prefetch read: %.2fms [%.2fs]\n",
+                 prefetched->time_read * MILLI, nTimePrefetchRead * MICRO);
+        LogPrint(BCLog::BENCH, "    - Prefetch check: %.2fms [%.2fs]\n",
+                 prefetched->time_check * MILLI, nTimePrefetchCheck * MICRO);
+        LogPrint(BCLog::BENCH,
+                 "    - Prefetch inputs: %.2fms (%u/%u found) [%.2fs]\n",
+                 prefetched->time_coins * MILLI, prefetched->coins.size(),
+                 prefetched->inputs, nTimePrefetchCoins * MICRO);
+
+        // The coins are those of the database as it was when they were read,
+        // so they are only current if it was not written to since.
+        if (prefetched->coins_sequence % 2 == 0 &&
+            prefetched->coins_sequence == pcoinsdbview->GetWriteSequence()) {
+            for (auto &entry : prefetched->coins) {
+                pcoinsTip->AddFetchedCoin(entry.first,
+                                          std::move(entry.second));
+            }
+        }
+        int64_t nTimeAdded = GetTimeMicros();
+        nTimeAddPrefetchedCoins += nTimeAdded - nTime2;
+        LogPrint(BCLog::BENCH, "  - Add prefetched inputs: %.2fms [%.2fs]\n",
+                 (nTimeAdded - nTime2) * MILLI,
+                 nTimeAddPrefetchedCoins * MICRO);
+        nTime2 = nTimeAdded;
+    }
+
+    // Apply the block atomically to the chain state.
+    int64_t nTime3;
     {
         CCoinsViewCache view(pcoinsTip.get());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, params,
@@ -2866,6 +3411,15 @@ bool CChainState::ActivateBestChainStep(
     const CBlockIndex *pindexOldTip = m_chain.Tip();
     const CBlockIndex *pindexFork = m_chain.FindFork(pindexMostWork);
 
+    // Unless this returns to be called again for the blocks after the one it
+    // connected, the blocks prefetched for it are not going to be taken.
+    bool fPrefetchedNext = false;
+    Defer clearPrefetched([&fPrefetchedNext]() {
+        if (!fPrefetchedNext) {
+            g_block_prefetcher.Clear();
+        }
+    });
+
     // Disconnect active blocks which are no longer in the best chain.
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool;
@@ -2911,6 +3465,19 @@ bool CChainState::ActivateBestChainStep(
 
         nHeight = nTargetHeight;
 
+        // Have the blocks after the one connecting read, checked and their
+        // inputs fetched meanwhile.
+        std::vector<const CBlockIndex *> vpindexToPrefetch;
+        for (const CBlockIndex *pindex : reverse_iterate(vpindexToConnect)) {
+            if (pindex != pindexMostWork || !pblock) {
+                vpindexToPrefetch.push_back(pindex);
+            }
+        }
+        g_block_prefetcher.Prefetch(vpindexToPrefetch,
+                                    config.GetChainParams().GetConsensus(),
+                                    BlockValidationOptions(config),
+                                    pcoinsdbview.get());
+
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
             if (!ConnectTip(config, state, pindexConnect,
@@ -2941,6 +3508,7 @@ bool CChainState::ActivateBestChainStep(
                     m_chain.Tip()->nChainWork > pindexOldTip->nChainWork) {
                     // We're in a better position than we were. Return
                     // temporarily to release the lock.
+                    fPrefetchedNext = m_chain.Tip() != pindexMostWork;
                     fContinue = false;
                     break;
                 }
@@ -3492,11 +4060,11 @@ bool IsBlockFinalized(const CBlockIndex *pindex) {
            pindexFinalized->GetAncestor(pindex->nHeight) == pindex;
 }
 
-CBlockIndex *CChainState::AddToBlockIndex(const CBlockHeader &block) {
+CBlockIndex *CChainState::AddToBlockIndex(const CBlockHeader &block,
+                                          const BlockHash &hash) {
     AssertLockHeld(cs_main);
 
     // Check for duplicate
-    BlockHash hash = block.GetHash();
     BlockMap::iterator it = mapBlockIndex.find(hash);
     if (it != mapBlockIndex.end()) {
         return it->second;
@@ -3983,12 +4551,13 @@ static bool ContextualCheckBlock(const CBlock &block, CValidationState &state,
 bool CChainState::AcceptBlockHeader(const Config &config,
                                     const CBlockHeader &block,
                                     CValidationState &state,
-                                    CBlockIndex **ppindex) {
+                                    CBlockIndex **ppindex,
+                                    const BlockHash *pknownHash) {
     AssertLockHeld(cs_main);
     const CChainParams &chainparams = config.GetChainParams();
 
     // Check for duplicate
-    BlockHash hash = block.GetHash();
+    const BlockHash hash = pknownHash ? *pknownHash : block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = nullptr;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -4008,7 +4577,8 @@ bool CChainState::AcceptBlockHeader(const Config &config,
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(),
+        if (!pknownHash &&
+            !CheckBlockHeader(block, state, chainparams.GetConsensus(),
                               BlockValidationOptions(config))) {
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__,
                          hash.ToString(), FormatStateMessage(state));
@@ -4078,7 +4648,7 @@ bool CChainState::AcceptBlockHeader(const Config &config,
     }
 
     if (pindex == nullptr) {
-        pindex = AddToBlockIndex(block);
+        pindex = AddToBlockIndex(block, hash);
     }
 
     if (ppindex) {
@@ -4099,13 +4669,29 @@ bool ProcessNewBlockHeaders(const Config &config,
         first_invalid->SetNull();
     }
 
+    // Hash the headers and check their proof of work before taking cs_main,
+    // spreading the work over the header checking threads. If any of them
+    // fails, fall back to checking them one by one under the lock so that the
+    // first invalid header is reported exactly as before.
+    std::vector<BlockHash> hashes;
+    bool fPreChecked = false;
+    if (headers.size() > 1) {
+        const int64_t nTimeStart = GetTimeMicros();
+        fPreChecked = CheckBlockHeadersProofOfWork(
+            headers, hashes, config.GetChainParams().GetConsensus());
+        LogPrint(BCLog::BENCH, "- Hash and check %u headers: %.2fms\n",
+                 headers.size(), (GetTimeMicros() - nTimeStart) * MILLI);
+    }
+
     {
         LOCK(cs_main);
-        for (const CBlockHeader &header : headers) {
+        for (size_t i = 0; i < headers.size(); ++i) {
+            const CBlockHeader &header = headers[i];
             // Use a temp pindex instead of ppindex to avoid a const_cast
             CBlockIndex *pindex = nullptr;
-            if (!g_chainstate.AcceptBlockHeader(config, header, state,
-                                                &pindex)) {
+            if (!g_chainstate.AcceptBlockHeader(
+                    config, header, state, &pindex,
+                    fPreChecked ? &hashes[i] : nullptr)) {
                 if (first_invalid) {
                     *first_invalid = header;
                 }
@@ -4416,6 +5002,55 @@ bool TestBlockValidity(CValidationState &state, const CChainParams &params,
     return true;
 }
 
+bool TestBlockTemplateTransaction(CValidationState &state,
+                                  const CChainParams &params,
+                                  CCoinsViewCache &view, const CTransaction &tx,
+                                  const CBlockIndex *pindexPrev) {
+    AssertLockHeld(cs_main);
+    assert(pindexPrev && pindexPrev == ::ChainActive().Tip());
+    const Consensus::Params &consensusParams = params.GetConsensus();
+    const int nHeight = pindexPrev->nHeight + 1;
+
+    if (!CheckRegularTransaction(tx, state)) {
+        return false;
+    }
+
+    Amount txfee = Amount::zero();
+    if (!Consensus::CheckTxInputs(tx, state, view, nHeight, txfee)) {
+        return false;
+    }
+
+    if (!ReferenceParser::validateTransactionReferenceOperations(tx, view)) {
+        return state.Invalid(false, REJECT_INVALIDPUSHREFS,
+                             "bad-txns-inputs-outputs-invalid-induction-rules");
+    }
+
+    std::vector<int> prevheights(tx.vin.size());
+    for (size_t j = 0; j < tx.vin.size(); j++) {
+        prevheights[j] = view.AccessCoin(tx.vin[j].prevout).GetHeight();
+    }
+    CBlockIndex indexDummy;
+    indexDummy.pprev = const_cast<CBlockIndex *>(pindexPrev);
+    indexDummy.nHeight = nHeight;
+    const int nLockTimeFlags =
+        nHeight >= consensusParams.CSVHeight ? LOCKTIME_VERIFY_SEQUENCE : 0;
+    if (!SequenceLocks(tx, nLockTimeFlags, &prevheights, indexDummy)) {
+        return state.DoS(100, false, REJECT_INVALID, "bad-txns-nonfinal");
+    }
+
+    // Transactions come from the mempool, so their scripts are normally found
+    // in the script cache.
+    const uint32_t flags = GetNextBlockScriptFlags(consensusParams, pindexPrev);
+    int nSigChecks;
+    if (!CheckInputs(tx, state, view, true, flags, true, true,
+                     PrecomputedTransactionData(tx), nSigChecks)) {
+        return false;
+    }
+
+    UpdateCoins(view, tx, nHeight);
+    return true;
+}
+
 /**
  * BLOCK PRUNING CODE
  */
@@ -4659,11 +5294,17 @@ bool CChainState::LoadBlockIndex(const Config &config,
             config.GetChainParams().GetConsensus(),
             [this](const BlockHash &hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
                 return this->InsertBlockIndex(hash);
+            },
+            [&config](const std::vector<CBlockHeader> &headers,
+                      std::vector<BlockHash> &hashes) {
+                return CheckBlockHeadersProofOfWork(
+                    headers, hashes, config.GetChainParams().GetConsensus());
             })) {
         return false;
     }
 
     // Calculate nChainWork
+    const int64_t nTimeStart = GetTimeMicros();
     std::vector<std::pair<int, CBlockIndex *>> vSortedByHeight;
     vSortedByHeight.reserve(mapBlockIndex.size());
     for (const std::pair<const BlockHash, CBlockIndex *> &item : mapBlockIndex) {
@@ -4733,6 +5374,9 @@ bool CChainState::LoadBlockIndex(const Config &config,
             pindexBestHeader = pindex;
         }
     }
+    LogPrintf("%s: computed chain work for %u block index entries in %.2fms\n",
+              __func__, vSortedByHeight.size(),
+              (GetTimeMicros() - nTimeStart) * MILLI);
 
     return true;
 }
@@ -5717,6 +6361,9 @@ CBlockFileInfo *GetBlockFileInfo(size_t n) {
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
 
+//! Number of transactions of mempool.dat checked ahead at once
+static constexpr size_t MEMPOOL_LOAD_CHUNK_SIZE = 1000;
+
 bool LoadMempool(const Config &config, CTxMemPool &pool) {
     int64_t nExpiryTimeout =
         gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
@@ -5743,25 +6390,45 @@ bool LoadMempool(const Config &config, CTxMemPool &pool) {
 
         uint64_t num;
         file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            Amount amountdelta = nFeeDelta * SATOSHI;
-            if (amountdelta != Amount::zero()) {
-                pool.PrioritiseTransaction(tx->GetId(), amountdelta);
+        while (num) {
+            // Read the transactions by chunks, whose scripts are checked on the
+            // precheck threads before they are accepted one after the other.
+            std::vector<CTransactionRef> txs;
+            std::vector<int64_t> times;
+            while (num && txs.size() < MEMPOOL_LOAD_CHUNK_SIZE) {
+                --num;
+                CTransactionRef tx;
+                int64_t nTime;
+                int64_t nFeeDelta;
+                file >> tx;
+                file >> nTime;
+                file >> nFeeDelta;
+
+                Amount amountdelta = nFeeDelta * SATOSHI;
+                if (amountdelta != Amount::zero()) {
+                    pool.PrioritiseTransaction(tx->GetId(), amountdelta);
+                }
+                if (nTime + nExpiryTimeout > nNow) {
+                    txs.push_back(std::move(tx));
+                    times.push_back(nTime);
+                } else {
+                    ++expired;
+                }
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(
-                    config, pool, state, tx, nullptr /* pfMissingInputs */,
-                    nTime, false /* bypass_limits */,
-                    Amount::zero() /* nAbsurdFee */, false /* test_accept */);
+
+            std::vector<CValidationState> prechecks;
+            PreCheckTransactionsForMempool(config, pool, txs, prechecks);
+            for (size_t i = 0; i < txs.size(); ++i) {
+                const CTransactionRef &tx = txs[i];
+                CValidationState &state = prechecks[i];
+                if (state.IsValid()) {
+                    LOCK(cs_main);
+                    AcceptToMemoryPoolWithTime(
+                        config, pool, state, tx, nullptr /* pfMissingInputs */,
+                        times[i], false /* bypass_limits */,
+                        Amount::zero() /* nAbsurdFee */,
+                        false /* test_accept */);
+                }
                 if (state.IsValid()) {
                     ++count;
                 } else {
@@ -5775,12 +6442,10 @@ bool LoadMempool(const Config &config, CTxMemPool &pool) {
                         ++failed;
                     }
                 }
-            } else {
-                ++expired;
-            }
 
-            if (ShutdownRequested()) {
-                return false;
+                if (ShutdownRequested()) {
+                    return false;
+                }
             }
         }
         std::map<TxId, Amount> mapDeltas;
@@ -5858,6 +6523,91 @@ bool DumpMempool(const CTxMemPool &pool) {
     return true;
 }
 
+static const uint64_t SIGCACHE_DUMP_VERSION = 2;
+
+/**
+ * The script-execution cache holds the outcome of running scripts, which is
+ * only valid for the interpreter and the meaning of the script flags of the
+ * build which ran them. The dump is therefore only loaded back by the very
+ * same build, with the same standard flags.
+ */
+static std::string GetSigCacheDumpBuild() {
+    return strprintf("%d %s %08x", CLIENT_VERSION, FormatFullVersion(),
+                     STANDARD_SCRIPT_VERIFY_FLAGS);
+}
+
+bool DumpSignatureCaches() {
+    int64_t start = GetTimeMicros();
+    try {
+        FILE *filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat.new", "wb");
+        if (!filestr) {
+            return false;
+        }
+
+        CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+        file << SIGCACHE_DUMP_VERSION << GetSigCacheDumpBuild();
+        const size_t nSigs = DumpSignatureCache(file);
+        const size_t nScripts = DumpScriptExecutionCache(file);
+        if (!FileCommit(file.Get())) {
+            throw std::runtime_error("FileCommit failed");
+        }
+        file.fclose();
+        RenameOver(GetDataDir() / "sigcache.dat.new",
+                   GetDataDir() / "sigcache.dat");
+        LogPrintf("Dumped signature caches: %u signatures, %u scripts, %gs\n",
+                  nSigs, nScripts, (GetTimeMicros() - start) * MICRO);
+    } catch (const std::exception &e) {
+        LogPrintf("Failed to dump signature caches: %s. Continuing anyway.\n",
+                  e.what());
+        return false;
+    }
+    return true;
+}
+
+bool LoadSignatureCaches() {
+    int64_t start = GetTimeMicros();
+    FILE *filestr = fsbridge::fopen(GetDataDir() / "sigcache.dat", "rb");
+    CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        LogPrintf("Failed to open signature cache file from disk. Continuing "
+                  "anyway.\n");
+        return false;
+    }
+
+    size_t nSigs = 0;
+    size_t nScripts = 0;
+    try {
+        uint64_t version;
+        file >> version;
+        if (version != SIGCACHE_DUMP_VERSION) {
+            LogPrintf("Signature cache file has version %u, expected %u. "
+                      "Ignoring it.\n",
+                      version, SIGCACHE_DUMP_VERSION);
+            return false;
+        }
+        std::string build;
+        file >> LIMITED_STRING(build, 256);
+        if (build != GetSigCacheDumpBuild()) {
+            LogPrintf("Signature cache file was written by build \"%s\", "
+                      "this is \"%s\". Ignoring it.\n",
+                      build, GetSigCacheDumpBuild());
+            return false;
+        }
+        nSigs = LoadSignatureCache(file);
+        nScripts = LoadScriptExecutionCache(file);
+    } catch (const std::exception &e) {
+        LogPrintf("Failed to deserialize signature cache data on disk: %s. "
+                  "Continuing anyway.\n",
+                  e.what());
+        return false;
+    }
+
+    LogPrintf("Imported signature caches from disk: %u signatures, %u "
+              "scripts, %gs\n",
+              nSigs, nScripts, (GetTimeMicros() - start) * MICRO);
+    return true;
+}
+
 inline constexpr uint64_t DSPROOF_DUMP_VERSION = 1;
 
 bool DumpDSProofs(const CTxMemPool &pool) {
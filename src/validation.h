@@ -18,6 +18,7 @@
 #include <flatfile.h>
 #include <fs.h>
 #include <protocol.h> // For CMessageHeader::MessageMagic
+#include <pubkey.h>
 #include <script/script_error.h>
 #include <script/script_execution_context.h>
 #include <script/script_metrics.h>
@@ -96,6 +97,22 @@ static constexpr unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static constexpr int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static constexpr int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of block prefetching threads allowed */
+static constexpr int MAX_BLOCK_PREFETCH_THREADS = 16;
+/** -prefetchthreads default */
+static constexpr int DEFAULT_BLOCK_PREFETCH_THREADS = 2;
+/**
+ * Maximum number of blocks prefetched ahead, as many as ActivateBestChainStep
+ * looks ahead
+ */
+static constexpr int MAX_BLOCK_PREFETCH_DEPTH = 32;
+/** -prefetchblocks default */
+static constexpr int DEFAULT_BLOCK_PREFETCH_DEPTH = 16;
+/**
+ * Size on disk of the prefetched blocks waiting to be connected, beyond which
+ * no more blocks are started on
+ */
+static constexpr uint64_t MAX_BLOCK_PREFETCH_BYTES = 256 * ONE_MEGABYTE;
 /**
  * Number of blocks that can be requested at any given time from a single peer.
  */
@@ -152,7 +169,12 @@ static constexpr int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 /** Default for -permitbaremultisig */
 static constexpr bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static constexpr bool DEFAULT_CHECKPOINTS_ENABLED = true;
+/** Default for -batchschnorr */
+static constexpr bool DEFAULT_BATCH_SCHNORR_VERIFICATION = true;
 static constexpr bool DEFAULT_TXINDEX = true;
+static constexpr bool DEFAULT_REFINDEX = false;
+static constexpr bool DEFAULT_CODESCRIPTINDEX = false;
+static constexpr bool DEFAULT_SCRIPTHASHINDEX = false;
 static constexpr unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 
 /** Default for -persistmempool */
@@ -170,6 +192,7 @@ static constexpr unsigned int MAX_BLOCKS_TO_ANNOUNCE = 8;
 static constexpr int MAX_UNCONNECTING_HEADERS = 10;
 
 static constexpr bool DEFAULT_PEERBLOOMFILTERS = true;
+static constexpr bool DEFAULT_PEERBLOCKFILTERS = false;
 
 /** Default for -stopatheight */
 static constexpr int DEFAULT_STOPATHEIGHT = 0;
@@ -206,6 +229,8 @@ extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Whether blocks verify the Schnorr signatures of their scripts by batch. */
+extern bool g_batch_schnorr_verification;
 extern size_t nCoinCacheUsage;
 
 /**
@@ -390,11 +415,38 @@ bool LoadChainTip(const Config &config) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
  */
 void UnloadBlockIndex();
 
-/** Run instances of script checking worker threads */
+/**
+ * Run instances of script checking worker threads, along with as many header
+ * checking worker threads, as many threads checking the scripts of large
+ * transactions for the mempool, and as many threads prechecking transactions
+ * for the mempool.
+ */
 void StartScriptCheckWorkerThreads(int threads_num);
-/** Stop all of the script checking worker threads */
+/** Stop all of the script and header checking worker threads */
 void StopScriptCheckWorkerThreads();
 
+/**
+ * Run threads reading, checking and fetching the inputs of up to depth of the
+ * blocks to connect next, while those before them are being connected.
+ */
+void StartBlockPrefetchThreads(int threads_num, int depth);
+/** Stop all of the block prefetching threads */
+void StopBlockPrefetchThreads();
+
+/**
+ * Compute the hashes of a batch of block headers and check their proof of
+ * work, spreading the work over the header checking worker threads. Does not
+ * need cs_main, so callers should run it before taking the lock.
+ *
+ * @param[in]  headers  The block headers to check.
+ * @param[out] hashes   Resized to match headers and filled with their hashes.
+ *                      Only meaningful if true is returned.
+ * @return True if every header has valid proof of work.
+ */
+bool CheckBlockHeadersProofOfWork(const std::vector<CBlockHeader> &headers,
+                                  std::vector<BlockHash> &hashes,
+                                  const Consensus::Params &params);
+
 /**
  * Check whether we are doing an initial block download (synchronizing from disk
  * or network)
@@ -458,6 +510,38 @@ bool AcceptToMemoryPool(const Config &config, CTxMemPool &pool,
                         const Amount nAbsurdFee, bool test_accept = false)
     EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/**
+ * Run the checks of AcceptToMemoryPool which need no more than a copy of the
+ * coins spent by the transaction, taking cs_main and the mempool lock only
+ * briefly to make that copy. The script checks, which take most of the time,
+ * store their results in the script cache, where AcceptToMemoryPool finds
+ * them right after. This lets callers check transactions concurrently, and
+ * keeps the part of their admission which holds cs_main short.
+ *
+ * Returns false, with state filled in, only for a transaction which
+ * AcceptToMemoryPool would reject whatever the state of the chain and the
+ * mempool. Anything else is left to AcceptToMemoryPool to decide.
+ *
+ * The coins this brings into the UTXO cache are uncached before it returns,
+ * unless pcoins_to_uncache is given: they are then left in the cache for
+ * AcceptToMemoryPool and appended to pcoins_to_uncache, and the caller must
+ * uncache them unless the transaction is accepted.
+ */
+bool PreCheckTransactionForMempool(
+    const Config &config, CTxMemPool &pool, CValidationState &state,
+    const CTransactionRef &tx,
+    std::vector<COutPoint> *pcoins_to_uncache = nullptr)
+    LOCKS_EXCLUDED(cs_main);
+
+/**
+ * PreCheckTransactionForMempool for a batch of transactions, which are checked
+ * on the precheck threads. states gets the state of each transaction.
+ */
+void PreCheckTransactionsForMempool(const Config &config, CTxMemPool &pool,
+                                    const std::vector<CTransactionRef> &txs,
+                                    std::vector<CValidationState> &states)
+    LOCKS_EXCLUDED(cs_main);
+
 /**
  * (try to) add transaction to memory pool with a specified acceptance time,
  * and an optional height override.
@@ -607,6 +691,9 @@ bool CheckSequenceLocks(const CTxMemPool &pool, const CTransaction &tx,
  *
  * Note that if pLimitSigChecks is passed, then failure does not imply that
  * scripts have failed.
+ *
+ * Checks may defer the verification of their Schnorr signatures, which get
+ * verified by batch in FinishBatch once a whole batch of checks ran.
  */
 class CScriptCheck {
 private:
@@ -618,6 +705,8 @@ private:
     PrecomputedTransactionData txdata{};
     TxSigCheckLimiter *pTxLimitSigChecks{};
     CheckInputsLimiter *pBlockLimitSigChecks{};
+    bool deferSchnorr{};
+    std::vector<SchnorrBatchEntry> deferredSchnorr;
 
 public:
     CScriptCheck() = default;
@@ -643,8 +732,24 @@ public:
         std::swap(txdata, check.txdata);
         std::swap(pTxLimitSigChecks, check.pTxLimitSigChecks);
         std::swap(pBlockLimitSigChecks, check.pBlockLimitSigChecks);
+        std::swap(deferSchnorr, check.deferSchnorr);
+        deferredSchnorr.swap(check.deferredSchnorr);
     }
 
+    /**
+     * Leave the Schnorr signatures to FinishBatch rather than verify them in
+     * operator(). Only has an effect with SCRIPT_VERIFY_NULLFAIL, under which
+     * any signature which does not verify fails the script.
+     */
+    void DeferSchnorrSignatures() { deferSchnorr = true; }
+
+    /**
+     * Verify the Schnorr signatures deferred by a batch of checks which all
+     * succeeded, together. If that fails, the checks with deferred signatures
+     * are run again without deferring, to find which failed and why.
+     */
+    static bool FinishBatch(std::vector<CScriptCheck> &checks);
+
     ScriptError GetScriptError() const { return error; }
 
     ScriptExecutionMetrics GetScriptExecutionMetrics() const { return metrics; }
@@ -656,6 +761,25 @@ bool ReadBlockFromDisk(CBlock &block, const FlatFilePos &pos,
 bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex,
                        const Consensus::Params &params);
 
+/**
+ * A serialized block, pointing straight into a memory mapping of its block
+ * file. `data` is valid for as long as `file` is held.
+ */
+struct RawBlock {
+    std::shared_ptr<const MappedFlatFile> file;
+    Span<const uint8_t> data;
+};
+
+/**
+ * Read a block without deserializing it, for callers that only need its
+ * serialized bytes (relaying it to peers, hex or binary RPC/REST output). Only
+ * the header is parsed, to check its proof of work (and hash, given pindex).
+ */
+bool ReadRawBlockFromDisk(RawBlock &block, const FlatFilePos &pos,
+                          const Consensus::Params &params);
+bool ReadRawBlockFromDisk(RawBlock &block, const CBlockIndex *pindex,
+                          const Consensus::Params &params);
+
 bool UndoReadFromDisk(CBlockUndo &blockundo, const CBlockIndex *pindex);
 
 /** Functions for validating blocks and updating the block tree */
@@ -690,6 +814,17 @@ bool TestBlockValidity(CValidationState &state, const CChainParams &params,
                        BlockValidationOptions validationOptions)
     EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/**
+ * Check a transaction appended to a block template on top of our current best
+ * block the way ConnectBlock would. `view` holds the coins of the tip with the
+ * template's other transactions applied; on success tx is applied to it too.
+ */
+bool TestBlockTemplateTransaction(CValidationState &state,
+                                  const CChainParams &params,
+                                  CCoinsViewCache &view, const CTransaction &tx,
+                                  const CBlockIndex *pindexPrev)
+    EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /**
  * RAII wrapper for VerifyDB: Verify consistency of the block and coin
  * databases.
@@ -808,6 +943,15 @@ bool DumpMempool(const CTxMemPool &pool);
 /** Load the mempool from disk. */
 bool LoadMempool(const Config &config, CTxMemPool &pool);
 
+/** Dump the signature and script-execution caches to disk. */
+bool DumpSignatureCaches();
+
+/**
+ * Load the signature and script-execution caches from disk. Must be called
+ * after they are initialized and before other threads use them.
+ */
+bool LoadSignatureCaches();
+
 /** Dump all dsproofs to disk. */
 bool DumpDSProofs(const CTxMemPool &pool);
 